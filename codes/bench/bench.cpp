@@ -0,0 +1,337 @@
+//
+// dragon_bench: 分阶段 (词法/语法/求值) 统计各工作负载的耗时与内存分配, 结果输出为 JSON
+//
+// usage: dragon_bench [--engine=eval|vm|flat|closure|stack] [--no-jit] [--warmup=N] [--reps=N] [--filter=name] [--out=file] [--list]
+//
+
+#include "workloads.h"
+
+#include "compiler.h"
+#include "environment.hpp"
+#include "evaluator.h"
+#include "closure_compiler.h"
+#include "flat_evaluator.h"
+#include "stack_evaluator.h"
+#include "jit.h"
+#include "lexer.h"
+#include "parser.h"
+#include "repl.h"
+#include "vm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 替换全局 operator new 统计分配次数和字节数, 只在本程序中生效
+static uint64_t g_allocs = 0;
+static uint64_t g_allocBytes = 0;
+
+void *operator new(std::size_t size)
+{
+    ++g_allocs;
+    g_allocBytes += size;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+// operator new 已替换为 malloc, GCC 在内联后仍会误报 new/free 不匹配
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+using namespace dragon;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    repl::Engine engine = repl::Engine::EVAL;
+    int warmup = 2;
+    int reps = 10;
+    std::string filter;
+    std::string out;
+};
+
+struct Sample {
+    double micros;
+    uint64_t allocs;
+    uint64_t bytes;
+};
+
+// 记录一个阶段的耗时和分配
+class Probe {
+public:
+    Probe() : allocs_(g_allocs), bytes_(g_allocBytes), start_(Clock::now()) {}
+    Sample done() const {
+        auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start_).count();
+        return {elapsed, g_allocs - allocs_, g_allocBytes - bytes_};
+    }
+private:
+    uint64_t allocs_;
+    uint64_t bytes_;
+    Clock::time_point start_;
+};
+
+struct Run {
+    Sample lex;
+    Sample parse;
+    Sample eval;
+    size_t tokens = 0;
+    std::string result;
+};
+
+Run runOnce(const bench::Workload &w, repl::Engine engine)
+{
+    Run run;
+
+    {
+        Probe probe;
+        lexer::Lexer l(w.source, lexer::InputMode::BORROW);
+        for (auto tok = l.NextTokenView(); tok.Type != token::TokenType::MEOF; tok = l.NextTokenView()) {
+            ++run.tokens;
+        }
+        run.lex = probe.done();
+    }
+
+    // 语法分析按需从词法分析器取 token, 因此 parse 阶段包含词法分析
+    std::shared_ptr<ast::Program> program;
+    {
+        Probe probe;
+        lexer::Lexer l(w.source, lexer::InputMode::BORROW);
+        parser::Parser p(l);
+        program = p.parseProgram();
+        run.parse = probe.done();
+        if (!p.getErrors().empty()) {
+            run.result = "parse error: " + p.getErrors()[0];
+            return run;
+        }
+    }
+
+    // vm 与 closure 引擎的 eval 阶段包含编译, flat 引擎的 eval 阶段包含转换
+    std::shared_ptr<object::Object> result;
+    {
+        Probe probe;
+        if (engine == repl::Engine::VM) {
+            compiler::Compiler c;
+            result = c.compile(program);
+            if (!result) {
+                vm::VM machine(c.bytecode());
+                result = machine.run();
+            }
+        } else if (engine == repl::Engine::FLAT) {
+            auto env = std::make_shared<Environment>();
+            result = evaluator::FlatEvaluator::eval(program, env);
+        } else if (engine == repl::Engine::CLOSURE) {
+            auto env = std::make_shared<Environment>();
+            result = evaluator::ClosureCompiler::eval(program, env);
+        } else if (engine == repl::Engine::STACK) {
+            auto env = std::make_shared<Environment>();
+            result = evaluator::StackEvaluator::eval(program, env);
+        } else {
+            auto env = std::make_shared<Environment>();
+            result = evaluator::Evaluator::eval(program, env);
+        }
+        run.eval = probe.done();
+    }
+    run.result = result ? result->Inspect() : "";
+    return run;
+}
+
+double percentile(std::vector<double> v, double p)
+{
+    std::sort(v.begin(), v.end());
+    // nearest-rank
+    size_t rank = static_cast<size_t>(p / 100.0 * v.size() + 0.999999);
+    rank = std::min(std::max<size_t>(rank, 1), v.size());
+    return v[rank - 1];
+}
+
+template <typename T>
+T median(std::vector<T> v)
+{
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+std::string jsonString(const std::string &s)
+{
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : s) {
+        switch (c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out << buf;
+            } else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+void writePhase(std::ostream &out, const char *name, const std::vector<Sample> &samples, bool last)
+{
+    std::vector<double> times;
+    std::vector<uint64_t> allocs, bytes;
+    for (const auto &s : samples) {
+        times.push_back(s.micros);
+        allocs.push_back(s.allocs);
+        bytes.push_back(s.bytes);
+    }
+    double sum = 0;
+    for (double t : times) {
+        sum += t;
+    }
+    out << "        \"" << name << "\": {"
+        << "\"median_us\": " << median(times)
+        << ", \"p99_us\": " << percentile(times, 99)
+        << ", \"mean_us\": " << sum / times.size()
+        << ", \"min_us\": " << *std::min_element(times.begin(), times.end())
+        << ", \"max_us\": " << *std::max_element(times.begin(), times.end())
+        << ", \"allocs\": " << median(allocs)
+        << ", \"alloc_bytes\": " << median(bytes)
+        << "}" << (last ? "" : ",") << "\n";
+}
+
+bool parseInt(const std::string &s, int &v)
+{
+    char *end = nullptr;
+    long n = std::strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end != '\0' || n < 0) {
+        return false;
+    }
+    v = static_cast<int>(n);
+    return true;
+}
+
+void usage()
+{
+    std::cerr << "usage: dragon_bench [--engine=eval|vm|flat|closure|stack] [--no-jit] [--warmup=N] [--reps=N] [--filter=name] [--out=file] [--list]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg.compare(0, 9, "--engine=") == 0) {
+            ok = repl::ParseEngine(arg.substr(9), opts.engine);
+        } else if (arg == "--no-jit") {
+            jit::SetEnabled(false);
+        } else if (arg.compare(0, 9, "--warmup=") == 0) {
+            ok = parseInt(arg.substr(9), opts.warmup);
+        } else if (arg.compare(0, 7, "--reps=") == 0) {
+            ok = parseInt(arg.substr(7), opts.reps) && opts.reps > 0;
+        } else if (arg.compare(0, 9, "--filter=") == 0) {
+            opts.filter = arg.substr(9);
+        } else if (arg.compare(0, 6, "--out=") == 0) {
+            opts.out = arg.substr(6);
+        } else if (arg == "--list") {
+            for (const auto &w : bench::Workloads()) {
+                std::cout << w.name << "\t" << w.description << std::endl;
+            }
+            return 0;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage();
+            return 1;
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"engine\": \"" << repl::EngineName(opts.engine) << "\",\n"
+         << "  \"jit\": " << (jit::Enabled() ? "true" : "false") << ",\n"
+         << "  \"warmup\": " << opts.warmup << ",\n"
+         << "  \"repetitions\": " << opts.reps << ",\n"
+         << "  \"workloads\": [\n";
+
+    int failed = 0;
+    bool first = true;
+    for (const auto &w : bench::Workloads()) {
+        if (!opts.filter.empty() && w.name.find(opts.filter) == std::string::npos) {
+            continue;
+        }
+
+        for (int i = 0; i < opts.warmup; ++i) {
+            runOnce(w, opts.engine);
+        }
+        std::vector<Sample> lex, parse, eval;
+        Run run;
+        for (int i = 0; i < opts.reps; ++i) {
+            run = runOnce(w, opts.engine);
+            lex.push_back(run.lex);
+            parse.push_back(run.parse);
+            eval.push_back(run.eval);
+        }
+        bool ok = run.result == w.expected;
+        if (!ok) {
+            ++failed;
+            std::cerr << w.name << ": expected " << w.expected << ", got " << run.result << std::endl;
+        }
+
+        json << (first ? "" : ",\n")
+             << "    {\n"
+             << "      \"name\": " << jsonString(w.name) << ",\n"
+             << "      \"description\": " << jsonString(w.description) << ",\n"
+             << "      \"source_bytes\": " << w.source.size() << ",\n"
+             << "      \"tokens\": " << run.tokens << ",\n"
+             << "      \"ok\": " << (ok ? "true" : "false") << ",\n"
+             << "      \"phases\": {\n";
+        writePhase(json, "lex", lex, false);
+        writePhase(json, "parse", parse, false);
+        writePhase(json, "eval", eval, true);
+        json << "      }\n"
+             << "    }";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    if (opts.out.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(opts.out);
+        if (!out) {
+            std::cerr << "can not open file: " << opts.out << std::endl;
+            return 1;
+        }
+        out << json.str();
+    }
+    return failed ? 1 : 0;
+}
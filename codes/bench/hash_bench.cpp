@@ -0,0 +1,140 @@
+//
+// dragon_hash_bench: 字符串哈希的微基准, 对比 util::times33_hash 与 util::string_hash, 结果输出为 JSON
+//
+// usage: dragon_hash_bench [--iters=N]
+//
+
+#include "hash.h"
+#include "object.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 防止编译器把哈希计算整体优化掉
+volatile uint64_t g_sink = 0;
+
+template <typename F>
+double nanosPerOp(size_t iters, F &&f)
+{
+    uint64_t acc = 0;
+    for (size_t i = 0; i < iters / 10; ++i) {
+        acc += f(i);
+    }
+    auto start = Clock::now();
+    for (size_t i = 0; i < iters; ++i) {
+        acc += f(i);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    g_sink = g_sink + acc;
+    return elapsed / iters;
+}
+
+// times33 下互相碰撞的键: "Ez" 与 "FY" 哈希相同, 任意拼接后仍然相同
+std::vector<std::string> collidingKeys(int blocks)
+{
+    std::vector<std::string> keys = {""};
+    for (int i = 0; i < blocks; ++i) {
+        std::vector<std::string> next;
+        for (const auto &k : keys) {
+            next.push_back(k + "Ez");
+            next.push_back(k + "FY");
+        }
+        keys.swap(next);
+    }
+    return keys;
+}
+
+// 用给定的哈希函数建表并逐个查找, 返回总耗时 (微秒)
+template <typename H>
+double tableMicros(const std::vector<dragon::object::Value> &keys, H &&hash)
+{
+    auto start = Clock::now();
+    dragon::object::HashTable table;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        table.set(hash(keys[i]), keys[i], dragon::object::Value::Int(static_cast<int64_t>(i)));
+    }
+    int64_t sum = 0;
+    for (const auto &k : keys) {
+        sum += table.find(hash(k), k)->value_.AsInteger();
+    }
+    g_sink = g_sink + static_cast<uint64_t>(sum);
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+const std::string &asString(const dragon::object::Value &v)
+{
+    return static_cast<const dragon::object::String *>(v.get())->str();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t iters = 2000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 8, "--iters=") == 0 && std::atol(arg.c_str() + 8) > 0) {
+            iters = static_cast<size_t>(std::atol(arg.c_str() + 8));
+        } else {
+            std::cerr << "usage: dragon_hash_bench [--iters=N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "{\n  \"iterations\": " << iters << ",\n  \"throughput\": [\n";
+    const size_t lengths[] = {4, 8, 16, 32, 64, 256, 1024, 4096};
+    bool first = true;
+    for (size_t len : lengths) {
+        // 轮流哈希一组不同的字符串, 避免结果被当作循环不变量提出循环
+        std::vector<std::string> pool(64, std::string(len, 'x'));
+        for (size_t k = 0; k < pool.size(); ++k) {
+            for (size_t i = 0; i < len; ++i) {
+                pool[k][i] = static_cast<char>('a' + (i * 7 + k) % 26);
+            }
+        }
+        size_t n = std::max<size_t>(iters * 16 / (len + 16), 1000);
+        double oldNs = nanosPerOp(n, [&pool](size_t i) {
+            return static_cast<uint64_t>(util::times33_hash(pool[i & 63].c_str()));
+        });
+        double newNs = nanosPerOp(n, [&pool](size_t i) {
+            return util::string_hash(pool[i & 63]);
+        });
+        std::cout << (first ? "" : ",\n")
+                  << "    {\"bytes\": " << len
+                  << ", \"times33_ns\": " << oldNs
+                  << ", \"string_hash_ns\": " << newNs
+                  << ", \"times33_gbps\": " << len / oldNs
+                  << ", \"string_hash_gbps\": " << len / newNs
+                  << ", \"speedup\": " << oldNs / newNs << "}";
+        first = false;
+    }
+    std::cout << "\n  ],\n";
+
+    // 对抗输入: 所有键在 times33 下哈希相同, 线性探测退化为 O(n)
+    auto strs = collidingKeys(12);
+    std::vector<dragon::object::Value> keys;
+    for (const auto &k : strs) {
+        keys.emplace_back(std::make_shared<dragon::object::String>(k));
+    }
+    double oldUs = tableMicros(keys, [](const dragon::object::Value &v) {
+        return static_cast<uint64_t>(util::times33_hash(asString(v).c_str()));
+    });
+    double newUs = tableMicros(keys, [](const dragon::object::Value &v) {
+        uint64_t h = 0;
+        dragon::object::HashCodeOf(v, h);
+        return h;
+    });
+    std::cout << "  \"adversarial\": {\"keys\": " << keys.size()
+              << ", \"times33_us\": " << oldUs
+              << ", \"string_hash_us\": " << newUs << "}\n}\n";
+    return 0;
+}
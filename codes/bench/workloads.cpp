@@ -0,0 +1,128 @@
+#include "workloads.h"
+
+#include <cstdint>
+#include <sstream>
+
+namespace dragon {
+namespace bench {
+
+static Workload fib()
+{
+    return {"fib", "naive recursive fibonacci, call heavy",
+            R"(
+let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+fib(22);
+)", "17711"};
+}
+
+// 与 fib 相同, 但用 return 提前结束函数
+static Workload earlyReturn()
+{
+    return {"early_return", "explicit return statements in recursive calls",
+            R"(
+let fib = fn(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); };
+let count = fn(n, acc) { if (n == 0) { return acc; } return count(n - 1, acc + 1); };
+fib(20) + count(5000, 0);
+)", "11765"};
+}
+
+// 语言中没有循环和 push, 用 [head, tail] 组成的链表表示序列
+static Workload mapReduce()
+{
+    return {"map_reduce", "recursive map/reduce over array-based lists",
+            R"(
+let range = fn(lo, hi, acc) { if (hi < lo) { acc } else { range(lo, hi - 1, [hi, acc]) } };
+let map = fn(list, f) { if (len(list) == 0) { [] } else { [f(list[0]), map(list[1], f)] } };
+let reduce = fn(list, acc, f) { if (len(list) == 0) { acc } else { reduce(list[1], f(acc, list[0]), f) } };
+let xs = range(1, 1000, []);
+let squares = map(xs, fn(x) { x * x });
+reduce(squares, 0, fn(acc, x) { acc + x });
+)", "333833500"};
+}
+
+static Workload stringBuild()
+{
+    return {"string_build", "repeated string concatenation",
+            R"(
+let build = fn(n, s) { if (n == 0) { s } else { build(n - 1, s + "abc") } };
+len(build(3000, ""));
+)", "9000"};
+}
+
+static Workload hashLookup()
+{
+    const int n = 256;
+    const int iterations = 5000;
+    std::ostringstream src;
+    src << "let ints = {";
+    for (int i = 0; i < n; ++i) {
+        src << (i ? ", " : "") << i << ": " << i * 2;
+    }
+    src << "};\nlet strs = {";
+    for (int i = 0; i < n; ++i) {
+        src << (i ? ", " : "") << "\"key" << i << "\": " << i;
+    }
+    src << "};\nlet keys = [";
+    for (int i = 0; i < n; ++i) {
+        src << (i ? ", " : "") << "\"key" << i << "\"";
+    }
+    src << "];\n"
+        << "let sum = fn(i, acc) {\n"
+        << "    if (i == 0) { acc } else {\n"
+        << "        let k = i - (i / " << n << ") * " << n << ";\n"
+        << "        sum(i - 1, acc + ints[k] + strs[keys[k]])\n"
+        << "    }\n"
+        << "};\n"
+        << "sum(" << iterations << ", 0);\n";
+
+    int64_t expected = 0;
+    for (int i = iterations; i > 0; --i) {
+        int64_t k = i % n;
+        expected += k * 2 + k;
+    }
+    return {"hash_lookup", "integer and string keyed hash lookups", src.str(), std::to_string(expected)};
+}
+
+static Workload closures()
+{
+    return {"closures", "deeply nested closures and composed functions",
+            R"(
+let compose = fn(f, g) { fn(x) { g(f(x)) } };
+let inc = fn(x) { x + 1 };
+let chain = fn(n, f) { if (n == 0) { f } else { chain(n - 1, compose(f, inc)) } };
+let f = chain(200, inc);
+let adder = fn(a) { fn(b) { fn(c) { fn(d) { a + b + c + d } } } };
+let run = fn(i, acc) { if (i == 0) { acc } else { run(i - 1, acc + f(0) + adder(i)(1)(2)(3)) } };
+run(100, 0);
+)", "25750"};
+}
+
+static Workload largeLiteral()
+{
+    const int n = 20000;
+    const int m = 5000;
+    std::ostringstream src;
+    src << "let data = [";
+    for (int i = 0; i < n; ++i) {
+        src << (i ? ", " : "") << i;
+    }
+    src << "];\nlet table = {";
+    for (int i = 0; i < m; ++i) {
+        src << (i ? ", " : "") << i << ": \"value" << i << "\"";
+    }
+    src << "};\nlen(data) + len(table[" << m - 1 << "]);\n";
+
+    auto expected = n + std::to_string(m - 1).size() + 5;
+    return {"large_literal", "parsing of large array and hash literals", src.str(), std::to_string(expected)};
+}
+
+const std::vector<Workload> &Workloads()
+{
+    static const std::vector<Workload> workloads = {
+            fib(), earlyReturn(), mapReduce(), stringBuild(), hashLookup(), closures(), largeLiteral(),
+    };
+    return workloads;
+}
+
+} // namespace bench
+} // namespace dragon
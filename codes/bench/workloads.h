@@ -0,0 +1,26 @@
+//
+// 基准测试的工作负载: 每个负载是一段完整的 dragon 程序及其期望结果
+//
+
+#ifndef DRAGON_BENCH_WORKLOADS_H
+#define DRAGON_BENCH_WORKLOADS_H
+
+#include <string>
+#include <vector>
+
+namespace dragon {
+namespace bench {
+
+struct Workload {
+    std::string name;
+    std::string description;
+    std::string source;
+    std::string expected;   // 程序结果的 Inspect(), 用于校验各执行引擎的正确性
+};
+
+const std::vector<Workload> &Workloads();
+
+} // namespace bench
+} // namespace dragon
+
+#endif //DRAGON_BENCH_WORKLOADS_H
@@ -0,0 +1,114 @@
+//
+// 预先编译的运行时
+//
+
+#include "aot_runtime.h"
+#include "builtin.h"
+
+#include <iostream>
+#include <typeinfo>
+
+namespace dragon {
+namespace aot {
+
+using evaluator::Evaluator;
+
+object::Value Lookup(const char *name, const Env &env)
+{
+    return Evaluator::lookupName(name, env);
+}
+
+object::Value Builtin(int index)
+{
+    return GetBuiltInFunc(static_cast<size_t>(index));
+}
+
+object::Value String(const char *data, size_t size)
+{
+    return std::make_shared<object::String>(std::string(data, size));
+}
+
+object::Value MakeArray(std::vector<object::Value> elements)
+{
+    return Evaluator::makeArray(std::move(elements));
+}
+
+object::Value CheckHashKey(const object::Value &key)
+{
+    uint64_t code = 0;
+    if (!object::HashCodeOf(key, code)) {
+        return Evaluator::unusableHashKey(key);
+    }
+    return object::Value();
+}
+
+object::Value MakeHash(std::vector<std::pair<object::Value, object::Value>> pairs)
+{
+    object::HashTable table;
+    table.reserve(pairs.size());
+    for (auto &pair : pairs) {
+        uint64_t code = 0;
+        object::HashCodeOf(pair.first, code);
+        table.set(code, std::move(pair.first), std::move(pair.second));
+    }
+    return Evaluator::makeHash(std::move(table));
+}
+
+object::Value MakeFunction(const FunctionInfo &info, const Env &env)
+{
+    return Evaluator::makeFunction(std::make_shared<Function>(info, env), env);
+}
+
+object::Value Function::call(std::vector<object::Value> args) const
+{
+    const Function *function = this;
+    object::Value callee;   // 尾调用的被调函数, 保证 function 在循环中有效
+    TailCall tail;
+    for (;;) {
+        const auto &info = function->info_;
+        if (info.params.size() != args.size()) {
+            return Evaluator::newError("wrong number of arguments: want=%d, got=%d",
+                                       static_cast<int>(info.params.size()), static_cast<int>(args.size()));
+        }
+        auto env = Environment::newEnclosedEnvironment(function->env_, info.locals);
+        for (size_t i = 0; i < args.size(); ++i) {
+            env->setLocal(info.params[i], std::move(args[i]));
+        }
+
+        auto result = info.body(env, tail);
+        if (!tail.pending) {
+            return result;
+        }
+        tail.pending = false;
+        callee = std::move(tail.fn);
+        args = std::move(tail.args);
+        tail.fn.reset();
+        tail.args.clear();
+        if (callee.Type() != object::Object::ObjectType::NATIVE_FUNCTION_OBJ || typeid(*callee.get()) != typeid(Function)) {
+            return Call(callee, std::move(args));
+        }
+        function = static_cast<const Function *>(callee.get());
+    }
+}
+
+object::Value Call(const object::Value &fn, std::vector<object::Value> args)
+{
+    if (fn.Type() == object::Object::ObjectType::NATIVE_FUNCTION_OBJ) {
+        return static_cast<const object::NativeFunction *>(fn.get())->call(std::move(args));
+    }
+    return Evaluator::applyFunction(fn, args);
+}
+
+int Main(Script script)
+{
+    auto env = Environment::newEnvironment();
+    auto result = script(env);
+    if (IsError(result)) {
+        std::cerr << result.Inspect() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace aot
+} // namespace dragon
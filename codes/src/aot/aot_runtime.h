@@ -0,0 +1,128 @@
+//
+// 预先编译的运行时: dragon --emit-cpp 生成的 C++ 代码调用这里的函数, 语义与 Evaluator 一致
+//
+
+#ifndef DRAGON_AOT_RUNTIME_H
+#define DRAGON_AOT_RUNTIME_H
+
+#include "environment.hpp"
+#include "evaluator.h"
+#include "gc.h"
+#include "object.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dragon {
+namespace aot {
+
+using Env = std::shared_ptr<Environment>;
+using TailCall = evaluator::Evaluator::TailCall;
+// 函数体: env 为调用环境, 参数已写入槽位; 尾位置上的调用记录到 tail 中
+using Body = object::Value (*)(const Env &env, TailCall &tail);
+// 整个脚本: 在 env 中执行, 返回最后一条语句的值
+using Script = object::Value (*)(const Env &env);
+
+// 每个函数字面量对应一个, 由生成的代码静态定义
+struct FunctionInfo {
+    Body body;
+    std::vector<int> params;                        // 各参数的槽位
+    std::shared_ptr<const Environment::Names> locals;   // 函数环境的槽位名, 见 ast::FunctionLiteral
+    const char *source;                             // Inspect 的结果, 与 object::Function 一致
+};
+
+// 生成的代码创建的函数; 求值器通过 object::NativeFunction::call 调用它
+class Function final : public object::NativeFunction {
+public:
+    Function(const FunctionInfo &info, Env env) : info_(info), env_(std::move(env)) {}
+    std::string Inspect() const override { return info_.source; }
+    // 函数体以尾调用结束时循环执行被调函数, C++ 栈不再增长
+    object::Value call(std::vector<object::Value> args) const override;
+
+    void traverse(gc::Visitor &visitor) const override {
+        if (env_) {
+            visitor.visit(env_.get());
+        }
+    }
+    void clear() override { env_.reset(); }
+
+public:
+    const FunctionInfo &info_;
+    Env env_;
+};
+
+inline bool IsError(const object::Value &v)
+{
+    return evaluator::Evaluator::isError(v);
+}
+
+inline bool Truthy(const object::Value &v)
+{
+    return evaluator::Evaluator::isTruthy(v);
+}
+
+// 槽位为空时按名字查找, 与 Evaluator::evalIdentifier 的慢速路径一致
+object::Value Lookup(const char *name, const Env &env);
+
+inline object::Value Local(const Env &env, int depth, int slot, const char *name)
+{
+    const auto &val = env->getLocal(depth, slot);
+    return val ? val : Lookup(name, env);
+}
+
+inline object::Value Global(const Env &env, int slot, const char *name)
+{
+    const auto &val = env->getGlobal(slot);
+    return val ? val : Lookup(name, env);
+}
+
+object::Value Builtin(int index);
+object::Value String(const char *data, size_t size);
+
+inline object::Value Prefix(ast::Operator op, const object::Value &right)
+{
+    if (op == ast::Operator::MINUS && right.IsInteger()) {
+        return object::Value::Int(evaluator::Evaluator::wrappingNeg(right.AsInteger()));
+    }
+    return evaluator::Evaluator::evalPrefixExpression(op, right);
+}
+
+inline object::Value Infix(ast::Operator op, const object::Value &left, const object::Value &right)
+{
+    return evaluator::Evaluator::evalInfixExpression(op, left, right);
+}
+
+inline object::Value Index(const object::Value &left, const object::Value &index)
+{
+    return evaluator::Evaluator::evalIndexExpression(left, index);
+}
+
+object::Value MakeArray(std::vector<object::Value> elements);
+// 键不能作为哈希键时返回错误, 否则返回空值; 在求值对应的值之前检查
+object::Value CheckHashKey(const object::Value &key);
+object::Value MakeHash(std::vector<std::pair<object::Value, object::Value>> pairs);
+object::Value MakeFunction(const FunctionInfo &info, const Env &env);
+
+// 调用函数; 不是 NativeFunction 的 (内置函数, 求值器创建的函数) 交给 Evaluator 执行
+object::Value Call(const object::Value &fn, std::vector<object::Value> args);
+// 函数体尾位置上的调用, 由 Call 执行
+inline object::Value TailCallTo(TailCall &tail, object::Value fn, std::vector<object::Value> args)
+{
+    tail.pending = true;
+    tail.fn = std::move(fn);
+    tail.args = std::move(args);
+    return object::Value();
+}
+
+// 可执行文件的入口: 在新的全局环境中执行脚本, 出错时把错误输出到 stderr 并返回 1, 与 dragon script 一致
+int Main(Script script);
+
+} // namespace aot
+} // namespace dragon
+
+// 生成的代码定义的脚本入口, 编译为共享库时由加载方调用
+dragon::object::Value dragon_script(const dragon::aot::Env &env);
+
+#endif //DRAGON_AOT_RUNTIME_H
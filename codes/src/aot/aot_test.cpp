@@ -0,0 +1,174 @@
+#include "aot_test.h"
+#include "aot_runtime.h"
+#include "cpp_emitter.h"
+#include "closure_compiler.h"
+#include "evaluator.h"
+#include "flat_evaluator.h"
+#include "lexer.h"
+#include "parser.h"
+#include "stack_evaluator.h"
+#include "test_tool.h"
+
+#include <memory>
+#include <string>
+
+using namespace dragon;
+
+namespace {
+
+std::string emit(const std::string &input)
+{
+    lexer::Lexer lexer(input);
+    parser::Parser parser(lexer);
+    auto program = parser.parseProgram();
+    return aot::EmitCpp(program.get(), "test.dr");
+}
+
+bool contains(const std::string &code, const std::string &part)
+{
+    if (code.find(part) != std::string::npos) {
+        return true;
+    }
+    std::cerr << "missing: " << part << "\n" << code << std::endl;
+    return false;
+}
+
+// 手写的函数体: count(n) { if (n == 0) { 0 } else { count(n - 1) } }, 自身在参数之后的槽位中
+object::Value countBody(const aot::Env &env, aot::TailCall &tail)
+{
+    auto n = env->getLocal(0, 0);
+    if (n.AsInteger() == 0) {
+        return object::Value::Int(0);
+    }
+    return aot::TailCallTo(tail, env->getLocal(1, 0), {object::Value::Int(n.AsInteger() - 1)});
+}
+
+// 手写的函数体: inc(n) { n + 1 }
+object::Value incBody(const aot::Env &env, aot::TailCall &)
+{
+    return object::Value::Int(env->getLocal(0, 0).AsInteger() + 1);
+}
+
+// 手写的函数体: apply(f, x) { f(x) }, 尾调用的目标可以是求值器创建的函数
+object::Value applyBody(const aot::Env &env, aot::TailCall &tail)
+{
+    return aot::TailCallTo(tail, env->getLocal(0, 0), {env->getLocal(0, 1)});
+}
+
+using Engine = std::shared_ptr<object::Object> (*)(const std::shared_ptr<ast::Program> &,
+                                                    const std::shared_ptr<Environment> &);
+
+std::string evalWith(Engine engine, const std::string &input, const std::shared_ptr<Environment> &env)
+{
+    lexer::Lexer lexer(input);
+    parser::Parser parser(lexer);
+    auto result = engine(parser.parseProgram(), env);
+    return result ? result->Inspect() : "";
+}
+
+} // namespace
+
+// 生成的代码: 函数体尾位置的调用交给蹦床, 顶层的调用直接执行; 标识符按槽位访问
+void TestCppEmitter()
+{
+    auto code = emit("let f = fn(n) { if (n == 0) { return \"done\"; } f(n - 1) }; f(3)");
+    ASSERT_TRUE(contains(code, "int globals[1];"));
+    ASSERT_TRUE(contains(code, "aot::String(\"done\", 4)"));
+    ASSERT_TRUE(contains(code, "aot::Local(env, 0, 0, \"n\")"));
+    ASSERT_TRUE(contains(code, "return aot::TailCallTo(tail, "));
+    ASSERT_TRUE(contains(code, "return aot::Call("));
+    ASSERT_TRUE(contains(code, "env->setGlobal(globals[0], "));
+    ASSERT_TRUE(contains(code, "Value dragon_script(const aot::Env &env)"));
+    ASSERT_TRUE(contains(code, "#ifndef DRAGON_AOT_NO_MAIN"));
+
+    // 常量在生成前折叠, 内置函数按下标取出
+    code = emit("len(\"ab\" + \"c\") + 2 * 3");
+    ASSERT_TRUE(contains(code, "aot::String(\"abc\", 3)"));
+    ASSERT_TRUE(contains(code, "Value::Int(6)"));
+    ASSERT_TRUE(contains(code, "aot::Builtin("));
+    ASSERT_TRUE(code.find("globals") == std::string::npos);
+
+    // 值被使用的 if 中的 return 只结束这个 if; 作为语句的 if 中的 return 结束函数
+    code = emit("let f = fn(n) { let x = if (n) { return 5; }; x + 1 }; f(true)");
+    ASSERT_TRUE(contains(code, "do {"));
+    ASSERT_TRUE(contains(code, "break;"));
+    ASSERT_TRUE(contains(code, "} while (false);"));
+    code = emit("let f = fn(n) { if (n) { return 5; }; 1 }; f(true)");
+    ASSERT_TRUE(code.find("do {") == std::string::npos);
+    ASSERT_TRUE(contains(code, "return Value::Int(5);"));
+
+    // 非打印字符与引号转义
+    code = emit("let s = \"a?b\"; s");
+    ASSERT_TRUE(contains(code, "aot::String(\"a\\077b\", 3)"));
+}
+
+// 运行时的调用与错误信息与 Evaluator 一致
+void TestAotRuntime()
+{
+    auto env = Environment::newEnvironment();
+    aot::FunctionInfo info = {countBody, {0}, std::make_shared<const Environment::Names>(Environment::Names{"n"}), "count"};
+    auto outer = Environment::newEnclosedEnvironment(env, std::make_shared<const Environment::Names>(Environment::Names{"count"}));
+    auto count = aot::MakeFunction(info, outer);
+    outer->setLocal(0, count);
+
+    // 尾调用不增长 C++ 栈
+    auto result = aot::Call(count, {object::Value::Int(1000000)});
+    ASSERT_TRUE(result.IsInteger() && result.AsInteger() == 0);
+    ASSERT_EQ(count.Inspect(), "count");
+
+    ASSERT_EQ(aot::Call(count, {}).Inspect(), "ERROR: wrong number of arguments: want=1, got=0");
+    ASSERT_EQ(aot::Call(object::Value::Int(1), {}).Inspect(), "ERROR: not a function: INTEGER");
+    ASSERT_EQ(aot::Call(aot::Lookup("len", env), {aot::String("abc", 3)}).Inspect(), "3");
+    ASSERT_EQ(aot::Lookup("missing", env).Inspect(), "ERROR: identifier not found: missing");
+    ASSERT_EQ(aot::CheckHashKey(aot::MakeArray({})).Inspect(), "ERROR: unusable as hash key: ARRAY");
+    ASSERT_TRUE(!aot::CheckHashKey(object::Value::Int(1)));
+
+    auto hash = aot::MakeHash({{aot::String("a", 1), object::Value::Int(1)}, {object::Value::Bool(true), count}});
+    ASSERT_EQ(aot::Index(hash, aot::String("a", 1)).Inspect(), "1");
+    ASSERT_TRUE(aot::Index(hash, object::Value::Bool(true)).get() == count.get());
+}
+
+// 生成的代码与求值器互相传递函数: 求值器调用 aot 函数, aot 函数 (包括尾调用) 调用求值器创建的函数
+void TestAotInterop()
+{
+    // 与生成的代码一样, FunctionInfo 的生存期长于函数对象
+    const aot::FunctionInfo incInfo = {incBody, {0}, std::make_shared<const Environment::Names>(Environment::Names{"n"}), "inc"};
+    const aot::FunctionInfo applyInfo = {applyBody, {0, 1},
+                                         std::make_shared<const Environment::Names>(Environment::Names{"f", "x"}), "apply"};
+    Engine engines[] = {
+        [](const std::shared_ptr<ast::Program> &program, const std::shared_ptr<Environment> &env) {
+            return evaluator::Evaluator::eval(program, env);
+        },
+        evaluator::FlatEvaluator::eval,
+        evaluator::ClosureCompiler::eval,
+        evaluator::StackEvaluator::eval,
+    };
+    for (auto engine : engines) {
+        auto env = Environment::newEnvironment();
+        auto inc = aot::MakeFunction(incInfo, env);
+        auto apply = aot::MakeFunction(applyInfo, env);
+        env->set("inc", inc);
+        env->set("apply", apply);
+
+        ASSERT_EQ(evalWith(engine, "let twice = fn(f, x) { f(f(x)) }; twice(inc, 1)", env), "3");
+        ASSERT_EQ(evalWith(engine, "let tail = fn(n) { inc(n) }; tail(41)", env), "42");
+        ASSERT_EQ(evalWith(engine, "apply(fn(x) { x * 2 }, 21)", env), "42");
+        ASSERT_EQ(evalWith(engine, "apply(apply, [inc, 1])", env), "ERROR: wrong number of arguments: want=2, got=1");
+        ASSERT_EQ(evalWith(engine, "inc(1, 2)", env), "ERROR: wrong number of arguments: want=1, got=2");
+
+        auto twice = env->get("twice").first;
+        ASSERT_TRUE(twice.Type() == object::Object::ObjectType::FUNCTION_OBJ);
+        auto result = aot::Call(twice, {inc, object::Value::Int(5)});
+        ASSERT_TRUE(result.IsInteger() && result.AsInteger() == 7);
+        result = aot::Call(apply, {twice, object::Value::Int(5)});
+        ASSERT_EQ(result.Inspect(), "ERROR: wrong number of arguments: want=2, got=1");
+        ASSERT_EQ(aot::Call(apply, {aot::Lookup("len", env), aot::String("abc", 3)}).Inspect(), "3");
+    }
+}
+
+void TestAot()
+{
+    TestCppEmitter();
+    TestAotRuntime();
+    TestAotInterop();
+}
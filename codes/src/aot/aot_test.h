@@ -0,0 +1,6 @@
+#ifndef DRAGON_AOT_TEST_H
+#define DRAGON_AOT_TEST_H
+
+void TestAot();
+
+#endif //DRAGON_AOT_TEST_H
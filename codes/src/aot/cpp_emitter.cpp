@@ -0,0 +1,516 @@
+//
+// 预先编译: 把脚本翻译为独立的 C++ 翻译单元 (dragon --emit-cpp)
+//
+
+#include "cpp_emitter.h"
+#include "folder.h"
+#include "resolver.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+
+namespace dragon {
+namespace aot {
+
+namespace {
+// C++ 字符串字面量, 非打印字符按八进制转义
+std::string quote(const std::string &s)
+{
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c < 0x20 || c >= 0x7f || c == '?') {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\%03o", c);
+            out += buf;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+const char *operatorName(ast::Operator op)
+{
+    switch (op) {
+    case ast::Operator::PLUS: return "Operator::PLUS";
+    case ast::Operator::MINUS: return "Operator::MINUS";
+    case ast::Operator::BANG: return "Operator::BANG";
+    case ast::Operator::ASTERISK: return "Operator::ASTERISK";
+    case ast::Operator::SLASH: return "Operator::SLASH";
+    case ast::Operator::LT: return "Operator::LT";
+    case ast::Operator::GT: return "Operator::GT";
+    case ast::Operator::EQ: return "Operator::EQ";
+    case ast::Operator::NOT_EQ: return "Operator::NOT_EQ";
+    default: return "Operator::ILLEGAL";
+    }
+}
+
+// 与 object::Function::Inspect 一致
+std::string inspect(const ast::FunctionLiteral *func)
+{
+    std::string out = "fn(";
+    for (size_t i = 0; i < func->parameters_.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += func->parameters_[i]->String();
+    }
+    out += ") {\n";
+    if (func->body_) {
+        out += func->body_->String();
+    }
+    return out + "\n}";
+}
+// node 中是否有 return, 不进入内层函数
+bool containsReturn(const ast::Node *node)
+{
+    bool found = false;
+    ast::ForEachChild(node, [&found](ast::Node *child) {
+        if (!found && child->Kind() != ast::NodeKind::FUNCTION_LITERAL) {
+            found = child->Kind() == ast::NodeKind::RETURN_STATEMENT || containsReturn(child);
+        }
+    });
+    return found;
+}
+} // namespace
+
+std::string EmitCpp(ast::Program *program, const std::string &sourceName)
+{
+    evaluator::FoldConstants(program);
+    auto globals = Environment::newEnvironment();
+    evaluator::Resolver(*globals).resolve(program);
+    return CppEmitter().emit(program, sourceName);
+}
+
+std::string CppEmitter::emit(const ast::Program *program, const std::string &sourceName)
+{
+    Body script;
+    body_ = &script;
+    const auto &statements = program->statements_;
+    for (size_t i = 0; i < statements.size(); ++i) {
+        if (i + 1 == statements.size()) {
+            result(statements[i]);
+        } else {
+            statement(statements[i]);
+        }
+    }
+    if (statements.empty()) {
+        line("return Value();");
+    }
+    body_ = nullptr;
+
+    std::ostringstream out;
+    out << "// 由 dragon --emit-cpp 从 " << sourceName << " 生成, 不要手工修改\n"
+        << "#include \"aot_runtime.h\"\n\n"
+        << "#include <cstdint>\n\n"
+        << "using dragon::object::Value;\n"
+        << "using ast::Operator;\n"
+        << "namespace aot = dragon::aot;\n\n"
+        << "namespace {\n";
+    if (!globals_.empty()) {
+        out << "// 全局变量在执行环境中的槽位, 由 dragon_script 分配\n"
+            << "int globals[" << globals_.size() << "];\n";
+    }
+    for (size_t i = 0; i < strings_.size(); ++i) {
+        out << "const Value s" << i << " = aot::String(" << quote(strings_[i]) << ", "
+            << strings_[i].size() << ");\n";
+    }
+    for (size_t i = 0; i < functions_.size(); ++i) {
+        out << "Value fn" << i << "(const aot::Env &env, aot::TailCall &tail);\n";
+    }
+    for (const auto &info : infos_) {
+        out << info;
+    }
+    for (const auto &fn : functions_) {
+        out << "\n" << fn;
+    }
+    out << "} // namespace\n\n"
+        << "Value dragon_script(const aot::Env &env)\n{\n";
+    if (!globals_.empty()) {
+        out << "    static const char *const names[] = {";
+        for (size_t i = 0; i < globals_.size(); ++i) {
+            out << (i ? ", " : "") << quote(globals_[i]);
+        }
+        out << "};\n"
+            << "    for (size_t i = 0; i < " << globals_.size() << "; ++i) {\n"
+            << "        globals[i] = env->globalSlot(names[i]);\n"
+            << "    }\n";
+    }
+    out << script.out.str() << "}\n\n"
+        << "#ifndef DRAGON_AOT_NO_MAIN\n"
+        << "int main()\n{\n"
+        << "    return aot::Main(dragon_script);\n"
+        << "}\n"
+        << "#endif\n";
+    return out.str();
+}
+
+void CppEmitter::line(const std::string &code)
+{
+    body_->out << std::string(body_->indent * 4, ' ') << code << "\n";
+}
+
+std::string CppEmitter::temp()
+{
+    return "t" + std::to_string(body_->temps++);
+}
+
+// 结果可能是错误的运算: 保存到临时变量, 出错时立即返回
+std::string CppEmitter::checked(const std::string &init)
+{
+    auto t = temp();
+    line("Value " + t + " = " + init + ";");
+    line("if (aot::IsError(" + t + ")) return " + t + ";");
+    return t;
+}
+
+std::string CppEmitter::value(const ast::Expression *expr)
+{
+    if (!expr) {
+        return "Value()";
+    }
+    switch (expr->Kind()) {
+    case ast::NodeKind::INTEGER_LITERAL: {
+        auto v = static_cast<const ast::IntegerLiteral *>(expr)->value_;
+        if (v == std::numeric_limits<int64_t>::min()) {
+            return "Value::Int(INT64_MIN)";
+        }
+        return "Value::Int(" + std::to_string(v) + ")";
+    }
+    case ast::NodeKind::BOOLEAN:
+        return static_cast<const ast::Boolean *>(expr)->value_ ? "Value::Bool(true)" : "Value::Bool(false)";
+    case ast::NodeKind::STRING_LITERAL:
+        return string(static_cast<const ast::StringLiteral *>(expr)->value_);
+    case ast::NodeKind::IDENTIFIER:
+        return identifier(static_cast<const ast::Identifier *>(expr));
+    case ast::NodeKind::PREFIX_EXPRESSION: {
+        auto prefix = static_cast<const ast::PrefixExpression *>(expr);
+        auto right = value(prefix->right_);
+        return checked(std::string("aot::Prefix(") + operatorName(prefix->op_) + ", " + right + ")");
+    }
+    case ast::NodeKind::INFIX_EXPRESSION: {
+        auto infix = static_cast<const ast::InfixExpression *>(expr);
+        auto left = value(infix->left_);
+        auto right = value(infix->right_);
+        return checked(std::string("aot::Infix(") + operatorName(infix->op_) + ", " + left + ", " + right + ")");
+    }
+    case ast::NodeKind::INDEX_EXPRESSION: {
+        auto index = static_cast<const ast::IndexExpression *>(expr);
+        auto left = value(index->left_);
+        auto idx = value(index->index_);
+        return checked("aot::Index(" + left + ", " + idx + ")");
+    }
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto ie = static_cast<const ast::IfExpression *>(expr);
+        auto cond = value(ie->condition_);
+        auto t = temp();
+        line("Value " + t + " = Value::Nil();");
+        // 其中的 return 以 break 跳出 do-while, 嵌套的 if 各自有 do-while, 跳出的总是最内层值被使用的 if
+        bool returns = containsReturn(ie);
+        auto outer = returnTarget_;
+        if (returns) {
+            returnTarget_ = &t;
+            line("do {");
+            ++body_->indent;
+        }
+        line("if (aot::Truthy(" + cond + ")) {");
+        ++body_->indent;
+        block(ie->consequence_, t);
+        --body_->indent;
+        if (ie->alternative_) {
+            line("} else {");
+            ++body_->indent;
+            block(ie->alternative_, t);
+            --body_->indent;
+        }
+        line("}");
+        if (returns) {
+            --body_->indent;
+            line("} while (false);");
+        }
+        returnTarget_ = outer;
+        return t;
+    }
+    case ast::NodeKind::ARRAY_LITERAL: {
+        auto elements = list(static_cast<const ast::ArrayLiteral *>(expr)->elements_);
+        auto t = temp();
+        line("Value " + t + " = aot::MakeArray(" + elements + ");");
+        return t;
+    }
+    case ast::NodeKind::HASH_LITERAL: {
+        std::string pairs;
+        for (const auto &pair : static_cast<const ast::HashLiteral *>(expr)->pairs_) {
+            auto key = value(pair.first);
+            line("if (auto e = aot::CheckHashKey(" + key + ")) return e;");
+            auto val = value(pair.second);
+            pairs += (pairs.empty() ? "" : ", ") + std::string("{") + key + ", " + val + "}";
+        }
+        auto t = temp();
+        line("Value " + t + " = aot::MakeHash({" + pairs + "});");
+        return t;
+    }
+    case ast::NodeKind::FUNCTION_LITERAL: {
+        int index = function(static_cast<const ast::FunctionLiteral *>(expr));
+        auto t = temp();
+        line("Value " + t + " = aot::MakeFunction(fn" + std::to_string(index) + "Info, env);");
+        return t;
+    }
+    case ast::NodeKind::CALL_EXPRESSION: {
+        auto call = static_cast<const ast::CallExpression *>(expr);
+        auto fn = value(call->function_);
+        auto args = list(call->arguments_);
+        return checked("aot::Call(" + fn + ", " + args + ")");
+    }
+    default:
+        return "Value()";
+    }
+}
+
+void CppEmitter::result(const ast::Node *node)
+{
+    if (!node) {
+        line("return Value();");
+        return;
+    }
+    switch (node->Kind()) {
+    case ast::NodeKind::BLOCK_STATEMENT: {
+        const auto &statements = static_cast<const ast::BlockStatement *>(node)->statements_;
+        if (statements.empty()) {
+            line("return Value();");
+            return;
+        }
+        for (size_t i = 0; i + 1 < statements.size(); ++i) {
+            statement(statements[i]);
+        }
+        result(statements.back());
+        return;
+    }
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        result(static_cast<const ast::ExpressionStatement *>(node)->expression_);
+        return;
+    case ast::NodeKind::RETURN_STATEMENT:
+        result(static_cast<const ast::ReturnStatement *>(node)->returnValue_);
+        return;
+    case ast::NodeKind::LET_STATEMENT:
+        let(static_cast<const ast::LetStatement *>(node));
+        line("return Value();");
+        return;
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto ie = static_cast<const ast::IfExpression *>(node);
+        auto cond = value(ie->condition_);
+        line("if (aot::Truthy(" + cond + ")) {");
+        ++body_->indent;
+        result(ie->consequence_);
+        --body_->indent;
+        line("}");
+        if (ie->alternative_) {
+            result(ie->alternative_);
+        } else {
+            line("return Value::Nil();");
+        }
+        return;
+    }
+    case ast::NodeKind::CALL_EXPRESSION: {
+        auto call = static_cast<const ast::CallExpression *>(node);
+        auto fn = value(call->function_);
+        auto args = list(call->arguments_);
+        if (body_->function) {
+            line("return aot::TailCallTo(tail, " + fn + ", " + args + ");");
+        } else {
+            line("return aot::Call(" + fn + ", " + args + ");");
+        }
+        return;
+    }
+    default:
+        line("return " + value(static_cast<const ast::Expression *>(node)) + ";");
+        return;
+    }
+}
+
+void CppEmitter::statement(const ast::Statement *stmt)
+{
+    if (!stmt) {
+        return;
+    }
+    switch (stmt->Kind()) {
+    case ast::NodeKind::EXPRESSION_STATEMENT: {
+        auto expr = static_cast<const ast::ExpressionStatement *>(stmt)->expression_;
+        if (expr && expr->Kind() == ast::NodeKind::IF_EXPRESSION) {
+            ifStatement(static_cast<const ast::IfExpression *>(expr));
+        } else {
+            value(expr);
+        }
+        return;
+    }
+    case ast::NodeKind::LET_STATEMENT:
+        let(static_cast<const ast::LetStatement *>(stmt));
+        return;
+    case ast::NodeKind::RETURN_STATEMENT:
+        if (returnTarget_) {
+            auto val = value(static_cast<const ast::ReturnStatement *>(stmt)->returnValue_);
+            line(*returnTarget_ + " = " + val + ";");
+            line("break;");
+            return;
+        }
+        result(stmt);
+        return;
+    default:
+        return;
+    }
+}
+
+void CppEmitter::ifStatement(const ast::IfExpression *ie)
+{
+    auto cond = value(ie->condition_);
+    line("if (aot::Truthy(" + cond + ")) {");
+    ++body_->indent;
+    statements(ie->consequence_);
+    --body_->indent;
+    if (ie->alternative_) {
+        line("} else {");
+        ++body_->indent;
+        statements(ie->alternative_);
+        --body_->indent;
+    }
+    line("}");
+}
+
+void CppEmitter::statements(const ast::BlockStatement *block)
+{
+    if (!block) {
+        return;
+    }
+    for (auto stmt : block->statements_) {
+        statement(stmt);
+    }
+}
+
+void CppEmitter::block(const ast::BlockStatement *block, const std::string &target)
+{
+    const auto *last = block && !block->statements_.empty() ? block->statements_.back() : nullptr;
+    if (!last || last->Kind() != ast::NodeKind::EXPRESSION_STATEMENT) {
+        // 空块或以 let 结尾的块没有值
+        line(target + " = Value();");
+    }
+    if (!block) {
+        return;
+    }
+    for (auto stmt : block->statements_) {
+        if (stmt == last && last->Kind() == ast::NodeKind::EXPRESSION_STATEMENT) {
+            line(target + " = " + value(static_cast<const ast::ExpressionStatement *>(stmt)->expression_) + ";");
+        } else {
+            statement(stmt);
+        }
+    }
+}
+
+void CppEmitter::let(const ast::LetStatement *let)
+{
+    auto val = value(let->value_);
+    auto name = let->name_;
+    switch (name->scope_) {
+    case ast::Identifier::Scope::LOCAL:
+        line("env->setLocal(" + std::to_string(name->slot_) + ", " + val + ");");
+        return;
+    case ast::Identifier::Scope::GLOBAL:
+        global(name);
+        line("env->setGlobal(globals[" + std::to_string(name->slot_) + "], " + val + ");");
+        return;
+    default:
+        line("env->set(" + quote(name->value_) + ", " + val + ");");
+        return;
+    }
+}
+
+std::string CppEmitter::identifier(const ast::Identifier *ident)
+{
+    auto name = quote(ident->value_);
+    auto slot = std::to_string(ident->slot_);
+    switch (ident->scope_) {
+    case ast::Identifier::Scope::LOCAL:
+        return checked("aot::Local(env, " + std::to_string(ident->depth_) + ", " + slot + ", " + name + ")");
+    case ast::Identifier::Scope::GLOBAL:
+        global(ident);
+        return checked("aot::Global(env, globals[" + slot + "], " + name + ")");
+    case ast::Identifier::Scope::BUILTIN:
+        return "aot::Builtin(" + slot + ")";
+    case ast::Identifier::Scope::UNRESOLVED:
+        break;
+    }
+    return checked("aot::Lookup(" + name + ", env)");
+}
+
+void CppEmitter::global(const ast::Identifier *ident)
+{
+    if (globals_.size() <= static_cast<size_t>(ident->slot_)) {
+        globals_.resize(ident->slot_ + 1);
+    }
+    globals_[ident->slot_] = ident->value_;
+}
+
+// 依次求值, 返回 std::vector<Value> 的初始化列表
+std::string CppEmitter::list(const std::vector<ast::Expression *> &exps)
+{
+    std::string items;
+    for (auto e : exps) {
+        auto v = value(e);
+        items += (items.empty() ? "" : ", ") + v;
+    }
+    return "{" + items + "}";
+}
+
+std::string CppEmitter::string(const std::string &value)
+{
+    for (size_t i = 0; i < strings_.size(); ++i) {
+        if (strings_[i] == value) {
+            return "s" + std::to_string(i);
+        }
+    }
+    strings_.push_back(value);
+    return "s" + std::to_string(strings_.size() - 1);
+}
+
+// 生成函数体与 FunctionInfo, 返回函数的编号
+int CppEmitter::function(const ast::FunctionLiteral *func)
+{
+    int index = static_cast<int>(functions_.size());
+    auto name = "fn" + std::to_string(index);
+    functions_.emplace_back();
+    infos_.emplace_back();
+
+    Body body;
+    body.function = true;
+    Body *outer = body_;
+    auto outerTarget = returnTarget_;
+    body_ = &body;
+    returnTarget_ = nullptr;
+    result(func->body_);
+    body_ = outer;
+    returnTarget_ = outerTarget;
+
+    functions_[index] = "Value " + name + "([[maybe_unused]] const aot::Env &env, [[maybe_unused]] aot::TailCall &tail)\n{\n" +
+                        body.out.str() + "}\n";
+
+    std::string params;
+    for (auto p : func->parameters_) {
+        params += (params.empty() ? "" : ", ") + std::to_string(p->slot_);
+    }
+    std::string locals;
+    if (func->locals_) {
+        for (const auto &l : *func->locals_) {
+            locals += (locals.empty() ? "" : ", ") + quote(l);
+        }
+    }
+    infos_[index] = "const aot::FunctionInfo " + name + "Info = {" + name + ", {" + params + "},\n" +
+                    "    std::make_shared<const dragon::Environment::Names>(dragon::Environment::Names{" + locals +
+                    "}),\n    " + quote(inspect(func)) + "};\n";
+    return index;
+}
+
+} // namespace aot
+} // namespace dragon
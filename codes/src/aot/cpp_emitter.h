@@ -0,0 +1,74 @@
+//
+// 预先编译: 把脚本翻译为独立的 C++ 翻译单元 (dragon --emit-cpp)
+//
+
+#ifndef DRAGON_CPP_EMITTER_H
+#define DRAGON_CPP_EMITTER_H
+
+#include "ast.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dragon {
+namespace aot {
+
+// 每个函数字面量生成一个 C++ 函数, 表达式展开为对 aot 运行时 (aot_runtime.h) 的调用,
+// 标识符按 resolver 给出的槽位访问, 执行时不再遍历语法树.
+// 生成的代码与 dragon_core 链接即为可执行文件; 定义 DRAGON_AOT_NO_MAIN 时不生成 main,
+// 可编译为共享库, 加载后调用 dragon_script(env).
+// 与求值器一致, 值被使用的 if 中的 return 不结束函数, 只结束这个 if, 并以 return 的值作为 if 的值
+class CppEmitter {
+public:
+    // program 须已做过常量折叠与静态解析, 且全局变量在新的全局环境中分配槽位
+    std::string emit(const ast::Program *program, const std::string &sourceName);
+
+private:
+    // 正在生成的函数 (或整个脚本) 的代码
+    struct Body {
+        std::ostringstream out;
+        int indent = 1;
+        int temps = 0;
+        bool function = false;      // false 表示脚本的顶层语句
+    };
+
+    void line(const std::string &code);
+    std::string temp();
+    std::string checked(const std::string &init);
+
+    // 非尾位置: 生成求值 expr 的语句, 返回保存结果的 C++ 表达式
+    std::string value(const ast::Expression *expr);
+    // 尾位置: 生成求值 node 并以其值 return 的语句 (函数体中的调用记录为尾调用)
+    void result(const ast::Node *node);
+    // 结果不使用的语句
+    void statement(const ast::Statement *stmt);
+    // 作为语句的 if: 其中的 return 与 if 之外的 return 作用相同
+    void ifStatement(const ast::IfExpression *ie);
+    void statements(const ast::BlockStatement *block);
+    // 非尾位置的块, 值赋给 target
+    void block(const ast::BlockStatement *block, const std::string &target);
+    void let(const ast::LetStatement *let);
+
+    std::string identifier(const ast::Identifier *ident);
+    void global(const ast::Identifier *ident);
+    std::string list(const std::vector<ast::Expression *> &exps);
+    std::string string(const std::string &value);
+    int function(const ast::FunctionLiteral *func);
+
+    Body *body_ = nullptr;
+    // 为空时 return 结束函数; 非空时位于值被使用的 if 中, return 把值赋给它并跳出包围这个 if 的 do-while
+    const std::string *returnTarget_ = nullptr;
+    std::vector<std::string> globals_;      // 按槽位排列的全局变量名
+    std::vector<std::string> strings_;      // 字符串常量, 脚本开始前创建
+    std::vector<std::string> functions_;    // 各函数的定义
+    std::vector<std::string> infos_;        // 各函数的 FunctionInfo
+};
+
+// 常量折叠与静态解析后生成代码
+std::string EmitCpp(ast::Program *program, const std::string &sourceName);
+
+} // namespace aot
+} // namespace dragon
+
+#endif //DRAGON_CPP_EMITTER_H
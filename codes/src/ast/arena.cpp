@@ -0,0 +1,38 @@
+//
+// 语法树节点的内存池
+//
+
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace ast {
+
+Arena::~Arena()
+{
+    for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it) {
+        (*it)->~Node();
+    }
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    auto p = reinterpret_cast<uintptr_t>(cur_);
+    uintptr_t aligned = (p + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    if (!cur_ || aligned + size > reinterpret_cast<uintptr_t>(end_)) {
+        size_t next = blocks_.empty() ? kFirstBlock : std::min(reserved_, kMaxBlock);
+        size_t blockSize = std::max(next, size + align);
+        blocks_.emplace_back(new char[blockSize]);
+        cur_ = blocks_.back().get();
+        end_ = cur_ + blockSize;
+        reserved_ += blockSize;
+        p = reinterpret_cast<uintptr_t>(cur_);
+        aligned = (p + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    }
+    cur_ = reinterpret_cast<char *>(aligned + size);
+    used_ += size;
+    return reinterpret_cast<void *>(aligned);
+}
+
+} // namespace ast
@@ -0,0 +1,58 @@
+//
+// 语法树节点的内存池
+//
+
+#ifndef DRAGON_AST_ARENA_H
+#define DRAGON_AST_ARENA_H
+
+#include "ast.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ast {
+
+// 节点按解析顺序依次放进大块内存中, 节点之间用普通指针相互引用, 整棵树随内存池一起释放.
+// Program 持有内存池; 求值器创建的函数对象也持有它, 使函数体在 Program 释放后仍然有效
+class Arena : public std::enable_shared_from_this<Arena> {
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena();
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+        static_assert(std::is_base_of<Node, T>::value, "arena only holds ast nodes");
+        T *node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        nodes_.push_back(node);
+        return node;
+    }
+
+    size_t nodeCount() const { return nodes_.size(); }
+    // 节点实际占用的字节数与已申请的块大小
+    size_t bytesUsed() const { return used_; }
+    size_t bytesReserved() const { return reserved_; }
+
+private:
+    // 块大小从 kFirstBlock 开始倍增, 小脚本不必一次申请大块内存
+    static constexpr size_t kFirstBlock = 1024;
+    static constexpr size_t kMaxBlock = 64 * 1024;
+
+    void *allocate(size_t size, size_t align);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char *cur_ = nullptr;
+    char *end_ = nullptr;
+    std::vector<Node *> nodes_;     // 析构时按创建的逆序调用析构函数
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+};
+
+} // namespace ast
+
+#endif //DRAGON_AST_ARENA_H
@@ -6,37 +6,136 @@
 #define MYPROJECT_AST_H
 #include "token.h"
 
+#include <cstdint>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <iostream>
 #include <memory>
-#include <map>
+#include <utility>
 
 using std::string;
 using std::vector;
+
+namespace dragon {
+class Environment;
+namespace object {
+class String;
+}
+}
+
 namespace ast {
+// 节点类型标签, 在构造时确定; 求值器/编译器据此 switch 分发, 不再逐个 dynamic_cast
+enum class NodeKind : uint8_t {
+    PROGRAM,
+
+    LET_STATEMENT,
+    RETURN_STATEMENT,
+    EXPRESSION_STATEMENT,
+    BLOCK_STATEMENT,
+
+    IDENTIFIER,
+    BOOLEAN,
+    INTEGER_LITERAL,
+    STRING_LITERAL,
+    ARRAY_LITERAL,
+    INDEX_EXPRESSION,
+    HASH_LITERAL,
+    PREFIX_EXPRESSION,
+    INFIX_EXPRESSION,
+    IF_EXPRESSION,
+    FUNCTION_LITERAL,
+    CALL_EXPRESSION,
+};
+
+// 前缀/中缀运算符, 解析时由 token 确定; 求值器按它查运算表, 编译器按它选指令, 不再比较字符串.
+// 新增运算符时需要同步修改 kOperatorNames 和 OperatorFromToken
+enum class Operator : uint8_t {
+    ILLEGAL,
+    PLUS,
+    MINUS,
+    BANG,
+    ASTERISK,
+    SLASH,
+    LT,
+    GT,
+    EQ,
+    NOT_EQ,
+
+    COUNT,      // 运算符总数, 不是真正的运算符
+};
+
+constexpr size_t kOperatorCount = static_cast<size_t>(Operator::COUNT);
+
+// 运算符的源码写法, 用于错误信息与 String()
+constexpr const char *kOperatorNames[kOperatorCount] = {
+    "", "+", "-", "!", "*", "/", "<", ">", "==", "!=",
+};
+
+constexpr const char *OperatorName(Operator op)
+{
+    return kOperatorNames[static_cast<size_t>(op)];
+}
+
+constexpr Operator OperatorFromToken(token::TokenType tt)
+{
+    switch (tt) {
+    case token::TokenType::PLUS: return Operator::PLUS;
+    case token::TokenType::MINUS: return Operator::MINUS;
+    case token::TokenType::BANG: return Operator::BANG;
+    case token::TokenType::ASTERISK: return Operator::ASTERISK;
+    case token::TokenType::SLASH: return Operator::SLASH;
+    case token::TokenType::LT: return Operator::LT;
+    case token::TokenType::GT: return Operator::GT;
+    case token::TokenType::EQ: return Operator::EQ;
+    case token::TokenType::NOT_EQ: return Operator::NOT_EQ;
+    default: return Operator::ILLEGAL;
+    }
+}
+
+// 求值器在节点上记录首次求值时观察到的操作数类型 (quickening), 之后走该类型的特化路径;
+// 守卫失败时退回通用路径且不再特化. 只由 evaluator::Evaluator 读写, 其它遍历忽略
+enum class Quickening : uint8_t {
+    UNSEEN,         // 尚未求值
+    INTEGER,        // InfixExpression: 两个整数
+    ARRAY_INDEX,    // IndexExpression: 数组与整数下标
+    FUNCTION,       // CallExpression: 被调用的是 object::Function
+    GENERIC,        // 其它类型, 或特化后守卫失败
+};
+
 class Node {
 public:
+    explicit Node(NodeKind kind) : kind_(kind) {}
     virtual ~Node() = default;
     virtual string TokenLiteral() const = 0;
     virtual string String() const = 0;
+    NodeKind Kind() const { return kind_; }
+
+    // 子树中是否含有函数调用, 由 evaluator::StackEvaluator 在求值前标记; 未标记时按含有处理
+    mutable bool hasCall_ = true;
+
+private:
+    const NodeKind kind_;
 };
 
 class Statement : public Node {
 public:
+    explicit Statement(NodeKind kind) : Node(kind) {}
     virtual void statementNode() = 0;
 };
 
 class Expression : public Node {
 public:
-    Expression() {};
+    explicit Expression(NodeKind kind) : Node(kind) {}
     virtual void expressionNode() = 0;
 };
 
+class Arena;
+
+// 所有节点都分配在 arena_ 中, 节点之间的指针不持有所有权
 class Program :public Node {
 public:
-    Program() = default;
+    Program() : Node(NodeKind::PROGRAM) {}
 
     string TokenLiteral() const{
         if (statements_.size()) {
@@ -56,13 +155,14 @@ public:
         return out.str();
     }
 public:
-    vector<std::shared_ptr<Statement>> statements_;
+    vector<Statement*> statements_;
+    std::shared_ptr<Arena> arena_;
 };
 
 class Identifier : public Expression {
 public:
-    Identifier() = default;
-    Identifier(const token::Token& t, const string& v) {
+    Identifier() : Expression(NodeKind::IDENTIFIER) {}
+    Identifier(const token::Token& t, const string& v) : Expression(NodeKind::IDENTIFIER) {
         token_ = t;
         value_ = v;
     }
@@ -72,13 +172,19 @@ public:
 public:
     token::Token token_;
     string value_;
+
+    // 以下由 resolver 填写: LOCAL 时按 (depth, slot) 访问函数环境, GLOBAL 时 slot 为全局槽位,
+    // BUILTIN 时 slot 为内置函数下标
+    enum class Scope : uint8_t { UNRESOLVED, LOCAL, GLOBAL, BUILTIN };
+    Scope scope_ = Scope::UNRESOLVED;
+    int depth_ = 0;
+    int slot_ = -1;
 };
 
 
 class LetStatement :public Statement {
 public:
-//    LetStatement() {}
-    LetStatement() {};
+    LetStatement() : Statement(NodeKind::LET_STATEMENT) {}
     void statementNode() override {}
     std::string TokenLiteral() const override {
         return token_.Literal;
@@ -96,16 +202,17 @@ public:
     ~LetStatement() override = default;
 public:
     token::Token token_;
-    std::shared_ptr<Identifier> name_;
-    std::shared_ptr<Expression> value_;
+    Identifier *name_ = nullptr;
+    Expression *value_ = nullptr;
 };
 
 
 class ReturnStatement: public Statement
 {
 public:
+    ReturnStatement() : Statement(NodeKind::RETURN_STATEMENT) {}
     token::Token token_;
-    std::shared_ptr<Expression> returnValue_;
+    Expression *returnValue_ = nullptr;
 
     void statementNode() override {}
     string TokenLiteral() const override {return token_.Literal;}
@@ -122,8 +229,9 @@ public:
 
 class ExpressionStatement: public Statement {
 public:
+    ExpressionStatement() : Statement(NodeKind::EXPRESSION_STATEMENT) {}
     token::Token token_;
-    std::shared_ptr<Expression> expression_;
+    Expression *expression_ = nullptr;
 
     void statementNode() override{}
     std::string TokenLiteral() const override {return token_.Literal;}
@@ -137,9 +245,10 @@ public:
 
 class BlockStatement: public Statement {
 public:
+    BlockStatement() : Statement(NodeKind::BLOCK_STATEMENT) {}
     token::Token token_;
 
-    std::vector<std::shared_ptr<Statement>> statements_;
+    std::vector<Statement*> statements_;
     void statementNode() override {}
     std::string TokenLiteral()const override{return token_.Literal;}
 
@@ -157,6 +266,7 @@ public:
 
 class Boolean : public Expression {
 public:
+    Boolean() : Expression(NodeKind::BOOLEAN) {}
     token::Token token_;
     bool value_;
 
@@ -167,6 +277,7 @@ public:
 
 class IntegerLiteral : public Expression {
 public:
+    IntegerLiteral() : Expression(NodeKind::INTEGER_LITERAL) {}
     token::Token token_;
     int64_t value_;
 
@@ -180,8 +291,11 @@ public:
 // 字符串
 class StringLiteral : public Expression {
 public:
+    StringLiteral() : Expression(NodeKind::STRING_LITERAL) {}
     token::Token token_;
     string value_;
+    // resolver 驻留到全局环境中的字符串对象, 求值时直接复用, 见 object::InternTable; 常量折叠产生的字面量持有未驻留的对象
+    std::shared_ptr<dragon::object::String> interned_;
     void expressionNode() override {}
     std::string TokenLiteral() const override {
         return token_.Literal;
@@ -195,12 +309,13 @@ public:
 // 数组
 class ArrayLiteral : public Expression {
 public:
-    ArrayLiteral(){}
-    ArrayLiteral(const std::vector<std::shared_ptr<Expression>> & eles) :elements_(eles) {
+    ArrayLiteral() : Expression(NodeKind::ARRAY_LITERAL) {}
+    ArrayLiteral(const std::vector<Expression*> & eles)
+        : Expression(NodeKind::ARRAY_LITERAL), elements_(eles) {
 
     }
     token::Token token_;
-    std::vector<std::shared_ptr<Expression>> elements_;
+    std::vector<Expression*> elements_;
     void expressionNode() override {}
     std::string TokenLiteral() const override {
         return token_.Literal;
@@ -225,9 +340,11 @@ public:
 // 索引表达式
 class IndexExpression : public Expression {
 public:
+    IndexExpression() : Expression(NodeKind::INDEX_EXPRESSION) {}
     token::Token token_;
-    std::shared_ptr<Expression> left_;
-    std::shared_ptr<Expression> index_;
+    Expression *left_ = nullptr;
+    Expression *index_ = nullptr;
+    mutable Quickening quick_ = Quickening::UNSEEN;
 
     void expressionNode() override {}
     std::string TokenLiteral()const override {
@@ -246,8 +363,9 @@ public:
 
 class HashLiteral : public Expression {
 public:
+    HashLiteral() : Expression(NodeKind::HASH_LITERAL) {}
     token::Token token_;
-    std::map<std::shared_ptr<Expression>, std::shared_ptr<Expression>> pairs_;
+    std::vector<std::pair<Expression*, Expression*>> pairs_;   // 按源码顺序
 
     void expressionNode() override {}
     std::string TokenLiteral()const override {
@@ -274,9 +392,11 @@ public:
 // 前缀表达式
 class PrefixExpression : public Expression {
 public:
+    PrefixExpression() : Expression(NodeKind::PREFIX_EXPRESSION) {}
     token::Token token_;
     std::string operator_;
-    std::shared_ptr<Expression> right_;
+    Operator op_ = Operator::ILLEGAL;
+    Expression *right_ = nullptr;
 
     void expressionNode() override {}
     std::string TokenLiteral() const override { return token_.Literal;}
@@ -289,10 +409,13 @@ public:
 
 class InfixExpression : public Expression {
 public:
+    InfixExpression() : Expression(NodeKind::INFIX_EXPRESSION) {}
     token::Token token_;
-    std::shared_ptr<Expression> left_;
+    Expression *left_ = nullptr;
     std::string operator_;
-    std::shared_ptr<Expression> right_;
+    Operator op_ = Operator::ILLEGAL;
+    Expression *right_ = nullptr;
+    mutable Quickening quick_ = Quickening::UNSEEN;
     void expressionNode() override {}
     std::string TokenLiteral() const override { return token_.Literal;}
 
@@ -305,10 +428,11 @@ public:
 
 class IfExpression : public Expression {
 public:
+    IfExpression() : Expression(NodeKind::IF_EXPRESSION) {}
     token::Token token_;  // The 'if' token
-    std::shared_ptr<Expression> condition_;
-    std::shared_ptr<BlockStatement> consequence_;
-    std::shared_ptr<BlockStatement> alternative_;
+    Expression *condition_ = nullptr;
+    BlockStatement *consequence_ = nullptr;
+    BlockStatement *alternative_ = nullptr;
 
     void expressionNode() override {}
     std::string TokenLiteral() const override { return token_.Literal; }
@@ -324,9 +448,14 @@ public:
 
 class FunctionLiteral : public Expression {
 public:
+    FunctionLiteral() : Expression(NodeKind::FUNCTION_LITERAL) {}
     token::Token token_;
-    std::vector<std::shared_ptr<Identifier>> parameters_;
-    std::shared_ptr<BlockStatement> body_;
+    std::vector<Identifier*> parameters_;
+    BlockStatement *body_ = nullptr;
+    // 函数环境的槽位名, 参数在前, 由 resolver 填写
+    std::shared_ptr<const std::vector<std::string>> locals_;
+    // 节点所在的内存池, 函数对象借此延长语法树的生命周期
+    Arena *arena_ = nullptr;
 
     void expressionNode() override {}
     std::string TokenLiteral() const override { return token_.Literal;}
@@ -342,9 +471,20 @@ public:
 
 class CallExpression : public Expression {
 public:
+    CallExpression() : Expression(NodeKind::CALL_EXPRESSION) {}
     token::Token token_;
-    std::shared_ptr<Expression> function_;
-    std::vector<std::shared_ptr<Expression>> arguments_;
+    Expression *function_ = nullptr;
+    std::vector<Expression*> arguments_;
+    mutable Quickening quick_ = Quickening::UNSEEN;
+
+    // 单态内联缓存, 只由 evaluator::Evaluator 读写. 被调函数是全局变量时, 记录全局环境
+    // 及其版本戳和槽位中对象的种类; 两者不变时槽位未被改写, 不必再取值和判断类型
+    struct CallCache {
+        const dragon::Environment *env = nullptr;
+        uint64_t version = 0;
+        bool builtin = false;
+    };
+    mutable CallCache cache_;
 
 public:
     void expressionNode() override {}
@@ -365,5 +505,85 @@ public:
         return out.str();
     }
 };
+// 依次访问 node 的直接子节点, 空指针跳过
+template <typename F>
+void ForEachChild(const Node *node, F &&f)
+{
+    auto visit = [&f](Node *child) {
+        if (child) {
+            f(child);
+        }
+    };
+
+    switch (node->Kind()) {
+    case NodeKind::PROGRAM:
+        for (auto &s : static_cast<const Program*>(node)->statements_) visit(s);
+        break;
+    case NodeKind::BLOCK_STATEMENT:
+        for (auto &s : static_cast<const BlockStatement*>(node)->statements_) visit(s);
+        break;
+    case NodeKind::LET_STATEMENT: {
+        auto let = static_cast<const LetStatement*>(node);
+        visit(let->name_);
+        visit(let->value_);
+        break;
+    }
+    case NodeKind::RETURN_STATEMENT:
+        visit(static_cast<const ReturnStatement*>(node)->returnValue_);
+        break;
+    case NodeKind::EXPRESSION_STATEMENT:
+        visit(static_cast<const ExpressionStatement*>(node)->expression_);
+        break;
+    case NodeKind::ARRAY_LITERAL:
+        for (auto &e : static_cast<const ArrayLiteral*>(node)->elements_) visit(e);
+        break;
+    case NodeKind::INDEX_EXPRESSION: {
+        auto index = static_cast<const IndexExpression*>(node);
+        visit(index->left_);
+        visit(index->index_);
+        break;
+    }
+    case NodeKind::HASH_LITERAL:
+        for (auto &pair : static_cast<const HashLiteral*>(node)->pairs_) {
+            visit(pair.first);
+            visit(pair.second);
+        }
+        break;
+    case NodeKind::PREFIX_EXPRESSION:
+        visit(static_cast<const PrefixExpression*>(node)->right_);
+        break;
+    case NodeKind::INFIX_EXPRESSION: {
+        auto infix = static_cast<const InfixExpression*>(node);
+        visit(infix->left_);
+        visit(infix->right_);
+        break;
+    }
+    case NodeKind::IF_EXPRESSION: {
+        auto ie = static_cast<const IfExpression*>(node);
+        visit(ie->condition_);
+        visit(ie->consequence_);
+        visit(ie->alternative_);
+        break;
+    }
+    case NodeKind::FUNCTION_LITERAL: {
+        auto func = static_cast<const FunctionLiteral*>(node);
+        for (auto &p : func->parameters_) visit(p);
+        visit(func->body_);
+        break;
+    }
+    case NodeKind::CALL_EXPRESSION: {
+        auto call = static_cast<const CallExpression*>(node);
+        visit(call->function_);
+        for (auto &a : call->arguments_) visit(a);
+        break;
+    }
+    case NodeKind::IDENTIFIER:
+    case NodeKind::BOOLEAN:
+    case NodeKind::INTEGER_LITERAL:
+    case NodeKind::STRING_LITERAL:
+        break;
+    }
+}
+
 } // namespace node
 #endif //MYPROJECT_AST_H
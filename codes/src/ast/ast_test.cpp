@@ -4,8 +4,15 @@
 // ast 测试代码
 //
 #include "ast.h"
+#include "arena.h"
+#include "flat_ast.h"
+#include "function.h"
+#include "parser.h"
+#include "test_tool.h"
+#include <cstdint>
 #include <memory>
 #include <iostream>
+#include <vector>
 /*
  // 测试用例
 TEST(ASTTest, ProgramString) {
@@ -24,20 +31,21 @@ TEST(ASTTest, ProgramString) {
 
 void TestAst()
 {
+    ast::Arena arena;
     auto p = std::make_unique<ast::Program>();
     token::Token token;
-    token.Type = "LET";
+    token.Type = token::TokenType::LET;
     token.Literal = "let";
 
-    auto identi = std::make_shared<ast::Identifier>();
-    identi->token_ = token::Token("IDENT", "myVar");
+    auto identi = arena.make<ast::Identifier>();
+    identi->token_ = token::Token(token::TokenType::IDENT, "myVar");
     identi->value_ = "myVar";
 
-    auto exp = std::make_shared<ast::Identifier>();
-    exp->token_ = token::Token("IDENT", "anotherVar");
+    auto exp = arena.make<ast::Identifier>();
+    exp->token_ = token::Token(token::TokenType::IDENT, "anotherVar");
     exp->value_ = "anotherVar";
 
-    auto letStatement = std::make_shared<ast::LetStatement>();
+    auto letStatement = arena.make<ast::LetStatement>();
     letStatement->token_ = token;
     letStatement->name_ = identi;
     letStatement->value_ = exp;
@@ -49,4 +57,114 @@ void TestAst()
 
     std::cout << p->String();
 
-}
\ No newline at end of file
+}
+// 每种节点在构造时都带上自己的 NodeKind
+void TestNodeKind()
+{
+    ast::Program program;
+    ASSERT_TRUE(program.Kind() == ast::NodeKind::PROGRAM);
+
+    std::vector<std::pair<std::shared_ptr<ast::Node>, ast::NodeKind>> nodes = {
+            {std::make_shared<ast::LetStatement>(), ast::NodeKind::LET_STATEMENT},
+            {std::make_shared<ast::ReturnStatement>(), ast::NodeKind::RETURN_STATEMENT},
+            {std::make_shared<ast::ExpressionStatement>(), ast::NodeKind::EXPRESSION_STATEMENT},
+            {std::make_shared<ast::BlockStatement>(), ast::NodeKind::BLOCK_STATEMENT},
+            {std::make_shared<ast::Identifier>(token::Token(token::TokenType::IDENT, "x"), "x"), ast::NodeKind::IDENTIFIER},
+            {std::make_shared<ast::Boolean>(), ast::NodeKind::BOOLEAN},
+            {std::make_shared<ast::IntegerLiteral>(), ast::NodeKind::INTEGER_LITERAL},
+            {std::make_shared<ast::StringLiteral>(), ast::NodeKind::STRING_LITERAL},
+            {std::make_shared<ast::ArrayLiteral>(), ast::NodeKind::ARRAY_LITERAL},
+            {std::make_shared<ast::IndexExpression>(), ast::NodeKind::INDEX_EXPRESSION},
+            {std::make_shared<ast::HashLiteral>(), ast::NodeKind::HASH_LITERAL},
+            {std::make_shared<ast::PrefixExpression>(), ast::NodeKind::PREFIX_EXPRESSION},
+            {std::make_shared<ast::InfixExpression>(), ast::NodeKind::INFIX_EXPRESSION},
+            {std::make_shared<ast::IfExpression>(), ast::NodeKind::IF_EXPRESSION},
+            {std::make_shared<ast::FunctionLiteral>(), ast::NodeKind::FUNCTION_LITERAL},
+            {std::make_shared<ast::CallExpression>(), ast::NodeKind::CALL_EXPRESSION},
+    };
+    for (const auto &n : nodes) {
+        ASSERT_TRUE(n.first->Kind() == n.second);
+    }
+
+    // 运算符 token 与 Operator 一一对应, 名字与源码写法一致
+    for (size_t i = 1; i < ast::kOperatorCount; ++i) {
+        auto op = static_cast<ast::Operator>(i);
+        lexer::Lexer lexer(ast::OperatorName(op));
+        ASSERT_TRUE(ast::OperatorFromToken(lexer.NextToken().Type) == op);
+    }
+    ASSERT_TRUE(ast::OperatorFromToken(token::TokenType::ASSIGN) == ast::Operator::ILLEGAL);
+}
+
+// 节点在内存池中按地址对齐分配, 内存池释放时析构所有节点; 函数对象持有解析得到的内存池
+void TestArena()
+{
+    ast::Arena arena;
+    auto program = arena.make<ast::BlockStatement>();
+    for (int i = 0; i < 10000; ++i) {
+        auto ident = arena.make<ast::Identifier>(token::Token(token::TokenType::IDENT, "x"), "x");
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(ident) % alignof(ast::Identifier), 0u);
+        program->statements_.push_back(arena.make<ast::ExpressionStatement>());
+        static_cast<ast::ExpressionStatement *>(program->statements_.back())->expression_ = ident;
+    }
+    ASSERT_EQ(arena.nodeCount(), 20001u);
+    ASSERT_TRUE(arena.bytesUsed() <= arena.bytesReserved());
+    ASSERT_EQ(program->statements_[9999]->String(), "x");
+
+    std::shared_ptr<ast::Program> parsed;
+    {
+        lexer::Lexer lexer("let f = fn(x) { x + 1 }; f(2)");
+        parser::Parser parser(lexer);
+        parsed = parser.parseProgram();
+    }
+    std::weak_ptr<ast::Arena> weak = parsed->arena_;
+    auto let = static_cast<ast::LetStatement *>(parsed->statements_[0]);
+    auto fn = std::make_shared<dragon::object::Function>(
+            static_cast<ast::FunctionLiteral *>(let->value_), nullptr);
+    parsed.reset();
+    ASSERT_TRUE(!weak.expired());
+    ASSERT_EQ(fn->body_->String(), "(x + 1)");
+    fn.reset();
+    ASSERT_TRUE(weak.expired());
+}
+
+// 转换后节点按前序排列, 子节点列表连续存放, 字面量进入旁表
+void TestFlatAst()
+{
+    std::shared_ptr<ast::Program> program;
+    {
+        lexer::Lexer lexer(R"(let x = -1; if (x < 2) { [x, "s", true] } else { f(x)[0] }; {"k": fn(a) { a }})");
+        parser::Parser parser(lexer);
+        program = parser.parseProgram();
+    }
+    auto flat = ast::FlatAst::Build(program);
+    ASSERT_TRUE(flat->kind(flat->root()) == ast::NodeKind::PROGRAM);
+    ASSERT_EQ(flat->childCount(flat->root()), 3u);
+
+    auto let = flat->children(flat->root())[0];
+    ASSERT_TRUE(flat->kind(let) == ast::NodeKind::LET_STATEMENT);
+    const auto &x = flat->identifier(flat->second(let));
+    ASSERT_EQ(flat->name(x), "x");
+    auto neg = flat->first(let);
+    ASSERT_TRUE(neg > let && flat->kind(neg) == ast::NodeKind::PREFIX_EXPRESSION);
+    ASSERT_TRUE(flat->op(neg) == ast::Operator::MINUS);
+    ASSERT_EQ(flat->integer(flat->first(neg)), 1);
+
+    auto ie = flat->first(flat->children(flat->root())[1]);
+    ASSERT_TRUE(flat->kind(ie) == ast::NodeKind::IF_EXPRESSION);
+    ASSERT_TRUE(flat->op(flat->first(ie)) == ast::Operator::LT);
+    // 同名的标识符共用名字表中的一项
+    ASSERT_EQ(flat->identifier(flat->first(flat->first(ie))).name, x.name);
+    auto array = flat->first(flat->children(flat->second(ie))[0]);
+    ASSERT_EQ(flat->childCount(array), 3u);
+    ASSERT_EQ(flat->string(flat->children(array)[1])->str(), "s");
+    ASSERT_TRUE(flat->boolean(flat->children(array)[2]));
+    auto index = flat->first(flat->children(flat->third(ie))[0]);
+    ASSERT_TRUE(flat->kind(index) == ast::NodeKind::INDEX_EXPRESSION);
+    ASSERT_TRUE(flat->kind(flat->first(index)) == ast::NodeKind::CALL_EXPRESSION);
+
+    auto hash = flat->first(flat->children(flat->root())[2]);
+    ASSERT_EQ(flat->childCount(hash), 2u);
+    auto fn = flat->children(hash)[1];
+    ASSERT_EQ(flat->function(fn)->parameters_[0]->value_, "a");
+    ASSERT_TRUE(flat->kind(flat->first(fn)) == ast::NodeKind::BLOCK_STATEMENT);
+}
@@ -2,5 +2,8 @@
 #define __AST_TEST_H__
 
 void TestAst();
+void TestNodeKind();
+void TestArena();
+void TestFlatAst();
 
 #endif
\ No newline at end of file
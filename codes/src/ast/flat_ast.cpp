@@ -0,0 +1,173 @@
+//
+// 扁平的语法树布局: 节点按前序存放在若干并列数组中, 子节点用 32 位下标引用
+//
+
+#include "flat_ast.h"
+#include "object.h"
+
+#include <unordered_map>
+
+namespace ast {
+
+class FlatAst::Builder {
+public:
+    explicit Builder(FlatAst &out) : out_(out) {}
+
+    // 先占位再转换子节点, 父节点因此排在子节点之前
+    NodeIndex add(const Node *node) {
+        if (!node) {
+            return kNoNode;
+        }
+        auto n = static_cast<NodeIndex>(out_.kinds_.size());
+        out_.kinds_.push_back(node->Kind());
+        out_.first_.push_back(kNoNode);
+        out_.second_.push_back(kNoNode);
+        out_.third_.push_back(kNoNode);
+
+        switch (node->Kind()) {
+        case NodeKind::PROGRAM:
+            setList(n, static_cast<const Program *>(node)->statements_);
+            break;
+        case NodeKind::BLOCK_STATEMENT:
+            setList(n, static_cast<const BlockStatement *>(node)->statements_);
+            break;
+        case NodeKind::ARRAY_LITERAL:
+            setList(n, static_cast<const ArrayLiteral *>(node)->elements_);
+            break;
+        case NodeKind::HASH_LITERAL: {
+            std::vector<const Node *> items;
+            for (const auto &pair : static_cast<const HashLiteral *>(node)->pairs_) {
+                items.push_back(pair.first);
+                items.push_back(pair.second);
+            }
+            setList(n, items);
+            break;
+        }
+        case NodeKind::CALL_EXPRESSION: {
+            auto call = static_cast<const CallExpression *>(node);
+            out_.first_[n] = add(call->function_);
+            setList(n, call->arguments_);
+            break;
+        }
+        case NodeKind::EXPRESSION_STATEMENT:
+            out_.first_[n] = add(static_cast<const ExpressionStatement *>(node)->expression_);
+            break;
+        case NodeKind::RETURN_STATEMENT:
+            out_.first_[n] = add(static_cast<const ReturnStatement *>(node)->returnValue_);
+            break;
+        case NodeKind::LET_STATEMENT: {
+            auto let = static_cast<const LetStatement *>(node);
+            out_.first_[n] = add(let->value_);
+            out_.second_[n] = add(let->name_);
+            break;
+        }
+        case NodeKind::PREFIX_EXPRESSION: {
+            auto prefix = static_cast<const PrefixExpression *>(node);
+            out_.third_[n] = static_cast<uint32_t>(prefix->op_);
+            out_.first_[n] = add(prefix->right_);
+            break;
+        }
+        case NodeKind::INFIX_EXPRESSION: {
+            auto infix = static_cast<const InfixExpression *>(node);
+            out_.third_[n] = static_cast<uint32_t>(infix->op_);
+            out_.first_[n] = add(infix->left_);
+            out_.second_[n] = add(infix->right_);
+            break;
+        }
+        case NodeKind::INDEX_EXPRESSION: {
+            auto index = static_cast<const IndexExpression *>(node);
+            out_.first_[n] = add(index->left_);
+            out_.second_[n] = add(index->index_);
+            break;
+        }
+        case NodeKind::IF_EXPRESSION: {
+            auto ie = static_cast<const IfExpression *>(node);
+            out_.first_[n] = add(ie->condition_);
+            out_.second_[n] = add(ie->consequence_);
+            out_.third_[n] = add(ie->alternative_);
+            break;
+        }
+        case NodeKind::IDENTIFIER: {
+            auto ident = static_cast<const Identifier *>(node);
+            out_.third_[n] = static_cast<uint32_t>(out_.idents_.size());
+            out_.idents_.push_back(Ident{ident->scope_, ident->depth_, ident->slot_, name(ident->value_)});
+            break;
+        }
+        case NodeKind::INTEGER_LITERAL:
+            out_.third_[n] = static_cast<uint32_t>(out_.ints_.size());
+            out_.ints_.push_back(static_cast<const IntegerLiteral *>(node)->value_);
+            break;
+        case NodeKind::STRING_LITERAL: {
+            auto lit = static_cast<const StringLiteral *>(node);
+            out_.third_[n] = static_cast<uint32_t>(out_.strings_.size());
+            out_.strings_.push_back(lit->interned_ ? lit->interned_
+                                                   : std::make_shared<dragon::object::String>(lit->value_));
+            break;
+        }
+        case NodeKind::BOOLEAN:
+            out_.third_[n] = static_cast<const Boolean *>(node)->value_ ? 1 : 0;
+            break;
+        case NodeKind::FUNCTION_LITERAL: {
+            auto func = static_cast<const FunctionLiteral *>(node);
+            out_.third_[n] = static_cast<uint32_t>(out_.functions_.size());
+            out_.functions_.push_back(func);
+            out_.first_[n] = add(func->body_);
+            break;
+        }
+        }
+        return n;
+    }
+
+private:
+    uint32_t name(const std::string &value) {
+        auto it = names_.find(value);
+        if (it != names_.end()) {
+            return it->second;
+        }
+        auto index = static_cast<uint32_t>(out_.names_.size());
+        out_.names_.push_back(value);
+        names_.emplace(value, index);
+        return index;
+    }
+
+    template <typename T>
+    void setList(NodeIndex n, const std::vector<T *> &nodes) {
+        // 子节点自身的列表会先追加到 lists_, 因此先转换完再整体追加
+        std::vector<NodeIndex> items;
+        items.reserve(nodes.size());
+        for (const auto *node : nodes) {
+            items.push_back(add(node));
+        }
+        out_.second_[n] = static_cast<uint32_t>(out_.lists_.size());
+        out_.third_[n] = static_cast<uint32_t>(items.size());
+        out_.lists_.insert(out_.lists_.end(), items.begin(), items.end());
+    }
+
+    FlatAst &out_;
+    std::unordered_map<std::string, uint32_t> names_;
+};
+
+std::shared_ptr<FlatAst> FlatAst::Build(const std::shared_ptr<Program> &program)
+{
+    auto out = std::make_shared<FlatAst>();
+    out->arena_ = program->arena_;
+    Builder(*out).add(program.get());
+    return out;
+}
+
+size_t FlatAst::bytes() const
+{
+    size_t names = names_.size() * sizeof(std::string);
+    for (const auto &name : names_) {
+        names += name.size();
+    }
+    return kinds_.size() * sizeof(NodeKind)
+           + (first_.size() + second_.size() + third_.size() + lists_.size()) * sizeof(NodeIndex)
+           + ints_.size() * sizeof(int64_t)
+           + strings_.size() * sizeof(strings_[0])
+           + idents_.size() * sizeof(Ident)
+           + names
+           + functions_.size() * sizeof(functions_[0]);
+}
+
+} // namespace ast
@@ -0,0 +1,92 @@
+//
+// 扁平的语法树布局: 节点按前序存放在若干并列数组中, 子节点用 32 位下标引用
+//
+
+#ifndef DRAGON_AST_FLAT_AST_H
+#define DRAGON_AST_FLAT_AST_H
+
+#include "ast.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ast {
+
+using NodeIndex = uint32_t;
+constexpr NodeIndex kNoNode = UINT32_MAX;
+
+// 由 ast::Program 转换得到, 只读. 节点不再带 token, 字面量和标识符放在旁表中.
+// 每个节点只有 kind 和三个 32 位操作数, 子节点列表 (children) 与旁表取值都由操作数间接给出,
+// 对外按以下含义访问:
+//   PROGRAM, BLOCK_STATEMENT, ARRAY_LITERAL   children: 语句 / 元素
+//   HASH_LITERAL                              children: 键, 值, 键, 值 ...
+//   CALL_EXPRESSION                           first: 被调函数, children: 参数
+//   EXPRESSION_STATEMENT, RETURN_STATEMENT    first: 表达式
+//   LET_STATEMENT                             first: 值, second: 名字 (IDENTIFIER 节点)
+//   PREFIX_EXPRESSION                         first: 操作数, op
+//   INFIX_EXPRESSION                          first: 左, second: 右, op
+//   INDEX_EXPRESSION                          first: 左, second: 下标
+//   IF_EXPRESSION                             first: 条件, second: 成立分支, third: 否则分支
+//   IDENTIFIER                                identifier, 名字为 name(identifier) (同名的标识符共用名字表中的一项)
+//   INTEGER_LITERAL, STRING_LITERAL, BOOLEAN  integer / string / boolean
+//   FUNCTION_LITERAL                          function, first: 函数体
+// 缺失的子节点为 kNoNode. 转换应在 resolver 之后进行, 标识符的槽位随之复制
+class FlatAst : public std::enable_shared_from_this<FlatAst> {
+public:
+    struct Ident {
+        Identifier::Scope scope;
+        int depth;
+        int slot;
+        uint32_t name;      // 在 names_ 中的下标
+    };
+
+    static std::shared_ptr<FlatAst> Build(const std::shared_ptr<Program> &program);
+
+    NodeIndex root() const { return 0; }
+    size_t size() const { return kinds_.size(); }
+    // 节点表, 旁表与名字表占用的字节数 (不含字符串常量的内容)
+    size_t bytes() const;
+
+    NodeKind kind(NodeIndex n) const { return kinds_[n]; }
+    NodeIndex first(NodeIndex n) const { return first_[n]; }
+    NodeIndex second(NodeIndex n) const { return second_[n]; }
+    NodeIndex third(NodeIndex n) const { return third_[n]; }
+
+    // 子节点列表连续存放在 lists_ 中, second 为起始位置, third 为个数
+    const NodeIndex *children(NodeIndex n) const { return lists_.data() + second_[n]; }
+    uint32_t childCount(NodeIndex n) const { return third_[n]; }
+
+    // 旁表下标放在 third 中, BOOLEAN 和运算符直接存值
+    int64_t integer(NodeIndex n) const { return ints_[third_[n]]; }
+    bool boolean(NodeIndex n) const { return third_[n] != 0; }
+    const std::shared_ptr<dragon::object::String> &string(NodeIndex n) const { return strings_[third_[n]]; }
+    const Ident &identifier(NodeIndex n) const { return idents_[third_[n]]; }
+    const std::string &name(const Ident &ident) const { return names_[ident.name]; }
+    Operator op(NodeIndex n) const { return static_cast<Operator>(third_[n]); }
+    // 参数与槽位名仍取自原节点, arena_ 保证其有效
+    const FunctionLiteral *function(NodeIndex n) const { return functions_[third_[n]]; }
+
+private:
+    class Builder;
+
+    std::vector<NodeKind> kinds_;
+    std::vector<NodeIndex> first_;
+    std::vector<NodeIndex> second_;
+    std::vector<NodeIndex> third_;
+    std::vector<NodeIndex> lists_;
+
+    std::vector<int64_t> ints_;
+    std::vector<std::shared_ptr<dragon::object::String>> strings_;
+    std::vector<Ident> idents_;
+    std::vector<std::string> names_;    // 去重后的标识符名字
+    std::vector<const FunctionLiteral *> functions_;
+
+    std::shared_ptr<Arena> arena_;      // 保证 functions_ 中的原节点有效
+};
+
+} // namespace ast
+
+#endif //DRAGON_AST_FLAT_AST_H
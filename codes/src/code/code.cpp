@@ -0,0 +1,128 @@
+//
+// 字节码定义
+//
+
+#include "code.h"
+
+#include <sstream>
+#include <iomanip>
+
+namespace dragon {
+namespace code {
+
+static const Definition definitions[OpCount] = {
+        {"OpConstant", {2}},
+        {"OpAdd", {}},
+        {"OpSub", {}},
+        {"OpMul", {}},
+        {"OpDiv", {}},
+        {"OpPop", {}},
+        {"OpTrue", {}},
+        {"OpFalse", {}},
+        {"OpEqual", {}},
+        {"OpNotEqual", {}},
+        {"OpGreaterThan", {}},
+        {"OpLessThan", {}},
+        {"OpMinus", {}},
+        {"OpBang", {}},
+        {"OpJumpNotTruthy", {2}},
+        {"OpJump", {2}},
+        {"OpNull", {}},
+        {"OpGetGlobal", {2}},
+        {"OpSetGlobal", {2}},
+        {"OpArray", {2}},
+        {"OpHash", {2}},
+        {"OpIndex", {}},
+        {"OpCall", {1}},
+        {"OpReturnValue", {}},
+        {"OpReturn", {}},
+        {"OpGetLocal", {1}},
+        {"OpSetLocal", {1}},
+        {"OpGetBuiltin", {1}},
+        {"OpClosure", {2, 1}},
+        {"OpGetFree", {1}},
+        {"OpGetFreeCell", {1}},
+        {"OpMakeCell", {1}},
+        {"OpGetCell", {1}},
+        {"OpSetCell", {1}},
+        {"OpGetName", {2}},
+        {"OpTailCall", {1}},
+};
+
+const Definition *Lookup(Opcode op)
+{
+    if (op >= OpCount) {
+        return nullptr;
+    }
+    return &definitions[op];
+}
+
+Instructions Make(Opcode op, const std::vector<int> &operands)
+{
+    const Definition *def = Lookup(op);
+    if (!def) {
+        return {};
+    }
+
+    Instructions ins;
+    ins.push_back(op);
+    for (size_t i = 0; i < def->operandWidths.size() && i < operands.size(); ++i) {
+        int o = operands[i];
+        switch (def->operandWidths[i]) {
+            case 2:
+                ins.push_back(static_cast<uint8_t>((o >> 8) & 0xff));
+                ins.push_back(static_cast<uint8_t>(o & 0xff));
+                break;
+            case 1:
+                ins.push_back(static_cast<uint8_t>(o & 0xff));
+                break;
+        }
+    }
+    return ins;
+}
+
+std::vector<int> ReadOperands(const Definition &def, const uint8_t *ins, int &read)
+{
+    std::vector<int> operands;
+    int offset = 0;
+    for (int width : def.operandWidths) {
+        switch (width) {
+            case 2:
+                operands.push_back(ReadUint16(ins + offset));
+                break;
+            case 1:
+                operands.push_back(ReadUint8(ins + offset));
+                break;
+        }
+        offset += width;
+    }
+    read = offset;
+    return operands;
+}
+
+std::string String(const Instructions &ins)
+{
+    std::stringstream out;
+    size_t i = 0;
+    while (i < ins.size()) {
+        const Definition *def = Lookup(ins[i]);
+        if (!def) {
+            out << "ERROR: opcode " << static_cast<int>(ins[i]) << " undefined\n";
+            ++i;
+            continue;
+        }
+
+        int read = 0;
+        auto operands = ReadOperands(*def, ins.data() + i + 1, read);
+        out << std::setw(4) << std::setfill('0') << i << " " << def->name;
+        for (int o : operands) {
+            out << " " << o;
+        }
+        out << "\n";
+        i += 1 + read;
+    }
+    return out.str();
+}
+
+} // namespace code
+} // namespace dragon
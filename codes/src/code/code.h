@@ -0,0 +1,88 @@
+//
+// 字节码定义
+//
+
+#ifndef DRAGON_CODE_H
+#define DRAGON_CODE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dragon {
+namespace code {
+
+using Instructions = std::vector<uint8_t>;
+using Opcode = uint8_t;
+
+// 新增指令时需要同步修改 code.cpp 中的 definitions 以及 vm.cpp 中的跳转表
+enum : Opcode {
+    OpConstant,         // [常量池下标 u16]
+    OpAdd,
+    OpSub,
+    OpMul,
+    OpDiv,
+    OpPop,
+    OpTrue,
+    OpFalse,
+    OpEqual,
+    OpNotEqual,
+    OpGreaterThan,
+    OpLessThan,
+    OpMinus,
+    OpBang,
+    OpJumpNotTruthy,    // [跳转目标 u16]
+    OpJump,             // [跳转目标 u16]
+    OpNull,
+    OpGetGlobal,        // [全局槽位 u16]
+    OpSetGlobal,        // [全局槽位 u16]
+    OpArray,            // [元素个数 u16]
+    OpHash,             // [键值对个数 * 2, u16]
+    OpIndex,
+    OpCall,             // [参数个数 u8]
+    OpReturnValue,
+    OpReturn,
+    OpGetLocal,         // [局部槽位 u8]
+    OpSetLocal,         // [局部槽位 u8]
+    OpGetBuiltin,       // [内置函数下标 u8]
+    OpClosure,          // [常量池下标 u16] [自由变量个数 u8], 自由变量的 Cell 事先压栈
+    OpGetFree,          // [自由变量下标 u8], 取出 Cell 中的值
+    OpGetFreeCell,      // [自由变量下标 u8], 压入 Cell 本身, 供内层闭包捕获
+    OpMakeCell,         // [局部槽位 u8], 把槽位中的值移入新的 Cell, 在函数体开头执行
+    OpGetCell,          // [局部槽位 u8], 槽位中是 Cell, 取出其中的值
+    OpSetCell,          // [局部槽位 u8]
+    OpGetName,          // [常量池下标 u16], 常量为名字
+    OpTailCall,         // [参数个数 u8], 尾位置的 OpCall, 被调函数为闭包时复用当前帧
+
+    OpCount             // 指令总数, 不是真正的指令
+};
+
+struct Definition {
+    const char *name;
+    std::vector<int> operandWidths;
+};
+
+// 查找指令定义, 未知指令返回 nullptr
+const Definition *Lookup(Opcode op);
+
+// 按照定义编码一条指令
+Instructions Make(Opcode op, const std::vector<int> &operands = {});
+
+// 解码指令的操作数, read 返回读取的字节数
+std::vector<int> ReadOperands(const Definition &def, const uint8_t *ins, int &read);
+
+// 反汇编, 用于调试与测试
+std::string String(const Instructions &ins);
+
+inline uint16_t ReadUint16(const uint8_t *ins) {
+    return static_cast<uint16_t>((ins[0] << 8) | ins[1]);
+}
+
+inline uint8_t ReadUint8(const uint8_t *ins) {
+    return ins[0];
+}
+
+} // namespace code
+} // namespace dragon
+
+#endif //DRAGON_CODE_H
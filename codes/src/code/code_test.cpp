@@ -0,0 +1,67 @@
+#include "code_test.h"
+#include "code.h"
+#include "test_tool.h"
+
+#include <vector>
+
+using namespace dragon;
+
+void TestMake()
+{
+    struct TestCase {
+        code::Opcode op;
+        std::vector<int> operands;
+        code::Instructions expected;
+    };
+
+    std::vector<TestCase> tests = {
+            {code::OpConstant, {65534}, {code::OpConstant, 255, 254}},
+            {code::OpAdd, {}, {code::OpAdd}},
+            {code::OpGetLocal, {255}, {code::OpGetLocal, 255}},
+            {code::OpClosure, {65534, 255}, {code::OpClosure, 255, 254, 255}},
+    };
+
+    for (const auto &tt : tests) {
+        auto ins = code::Make(tt.op, tt.operands);
+        ASSERT_EQ(ins.size(), tt.expected.size());
+        for (size_t i = 0; i < ins.size(); ++i) {
+            ASSERT_EQ(static_cast<int>(ins[i]), static_cast<int>(tt.expected[i]));
+        }
+    }
+}
+
+void TestInstructionsString()
+{
+    code::Instructions ins;
+    for (const auto &i : {code::Make(code::OpAdd),
+                          code::Make(code::OpGetLocal, {1}),
+                          code::Make(code::OpConstant, {2}),
+                          code::Make(code::OpConstant, {65535}),
+                          code::Make(code::OpClosure, {65535, 255})}) {
+        ins.insert(ins.end(), i.begin(), i.end());
+    }
+
+    std::string expected = "0000 OpAdd\n"
+                           "0001 OpGetLocal 1\n"
+                           "0003 OpConstant 2\n"
+                           "0006 OpConstant 65535\n"
+                           "0009 OpClosure 65535 255\n";
+    ASSERT_EQ(code::String(ins), expected);
+}
+
+void TestReadOperands()
+{
+    auto ins = code::Make(code::OpClosure, {65535, 255});
+    int read = 0;
+    auto operands = code::ReadOperands(*code::Lookup(code::OpClosure), ins.data() + 1, read);
+    ASSERT_EQ(read, 3);
+    ASSERT_EQ(operands[0], 65535);
+    ASSERT_EQ(operands[1], 255);
+}
+
+void TestCode()
+{
+    TestMake();
+    TestInstructionsString();
+    TestReadOperands();
+}
@@ -0,0 +1,6 @@
+#ifndef DRAGON_CODE_TEST_H
+#define DRAGON_CODE_TEST_H
+
+void TestCode();
+
+#endif //DRAGON_CODE_TEST_H
@@ -0,0 +1,563 @@
+//
+// 编译器: 把 ast::Program 编译成字节码, 交给 vm::VM 执行
+//
+
+#include "compiler.h"
+#include "builtin.h"
+#include "compiled_function.h"
+#include "folder.h"
+
+#include <set>
+
+namespace dragon {
+namespace compiler {
+
+static const size_t kMaxUint16 = 0xffff;
+static const size_t kMaxUint8 = 0xff;
+
+Compiler::Compiler() : Compiler(newSymbolTable(), {})
+{
+}
+
+Compiler::Compiler(std::shared_ptr<SymbolTable> symbolTable,
+                   std::vector<std::shared_ptr<object::Object>> constants)
+    : symbolTable_(std::move(symbolTable)), constants_(std::move(constants))
+{
+    scopes_.emplace_back();
+}
+
+std::shared_ptr<SymbolTable> Compiler::newSymbolTable()
+{
+    auto st = std::make_shared<SymbolTable>();
+    const auto &names = BuiltInFuncNames();
+    for (size_t i = 0; i < names.size(); ++i) {
+        st->defineBuiltin(static_cast<int>(i), names[i]);
+    }
+    return st;
+}
+
+std::shared_ptr<object::Error> Compiler::compile(const std::shared_ptr<ast::Program> &program)
+{
+    error_.clear();
+    evaluator::FoldConstants(program.get());
+    if (!compileBody(program->statements_)) {
+        return std::make_shared<object::Error>(error_);
+    }
+    return nullptr;
+}
+
+Bytecode Compiler::bytecode() const
+{
+    return Bytecode{scopes_.front().instructions, constants_, symbolTable_};
+}
+
+bool Compiler::fail(const std::string &msg)
+{
+    if (error_.empty()) {
+        error_ = msg;
+    }
+    return false;
+}
+
+// 函数体和顶层程序: 最后一个表达式语句的值作为返回值
+bool Compiler::compileBody(const std::vector<ast::Statement *> &statements)
+{
+    // 顶层程序没有可以复用的帧, 只有函数体有尾位置
+    if (!compileStatements(statements, scopes_.size() > 1)) {
+        return false;
+    }
+
+    if (!statements.empty() && statements.back()->Kind() == ast::NodeKind::EXPRESSION_STATEMENT) {
+        removeLastPop();
+        emit(code::OpReturnValue);
+    } else if (!lastInstructionIs(code::OpReturnValue)) {
+        emit(code::OpReturn);
+    }
+    return true;
+}
+
+bool Compiler::compileStatements(const std::vector<ast::Statement *> &statements, bool tail)
+{
+    for (size_t i = 0; i < statements.size(); ++i) {
+        auto s = statements[i];
+        bool ok = s->Kind() == ast::NodeKind::EXPRESSION_STATEMENT
+                  ? compileExpressionStatement(static_cast<const ast::ExpressionStatement *>(s),
+                                               tail && i + 1 == statements.size())
+                  : compileNode(s);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Compiler::compileExpressionStatement(const ast::ExpressionStatement *stmt, bool tail)
+{
+    auto expr = stmt->expression_;
+    bool ok;
+    if (expr && expr->Kind() == ast::NodeKind::IF_EXPRESSION) {
+        ok = compileIfExpression(static_cast<const ast::IfExpression *>(expr), true, tail);
+    } else if (expr && expr->Kind() == ast::NodeKind::CALL_EXPRESSION) {
+        ok = compileCall(static_cast<const ast::CallExpression *>(expr), tail);
+    } else {
+        ok = compileNode(expr);
+    }
+    if (!ok) {
+        return false;
+    }
+    emit(code::OpPop);
+    return true;
+}
+
+// if 的分支: 最后一个表达式语句的值留在栈上, 否则压入 null
+bool Compiler::compileBlock(const ast::BlockStatement *block, bool tail)
+{
+    if (!block) {
+        emit(code::OpNull);
+        return true;
+    }
+    if (!compileStatements(block->statements_, tail)) return false;
+    if (!block->statements_.empty() &&
+        block->statements_.back()->Kind() == ast::NodeKind::EXPRESSION_STATEMENT) {
+        removeLastPop();
+    } else {
+        emit(code::OpNull);
+    }
+    return true;
+}
+
+bool Compiler::compileNode(const ast::Node *node)
+{
+    if (!node) {
+        emit(code::OpNull);
+        return true;
+    }
+
+    switch (node->Kind()) {
+    case ast::NodeKind::PROGRAM:
+        return compileBody(static_cast<const ast::Program *>(node)->statements_);
+
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return compileExpressionStatement(static_cast<const ast::ExpressionStatement *>(node), false);
+
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto value = static_cast<const ast::ReturnStatement *>(node)->returnValue_;
+        if (returnJumps_) {
+            if (!compileNode(value)) return false;
+            returnJumps_->push_back(emit(code::OpJump, {9999}));
+            return true;
+        }
+        bool ok = value && value->Kind() == ast::NodeKind::CALL_EXPRESSION
+                  ? compileCall(static_cast<const ast::CallExpression *>(value), scopes_.size() > 1)
+                  : compileNode(value);
+        if (!ok) return false;
+        emit(code::OpReturnValue);
+        return true;
+    }
+
+    case ast::NodeKind::LET_STATEMENT:
+        return compileLetStatement(static_cast<const ast::LetStatement *>(node));
+
+    case ast::NodeKind::BLOCK_STATEMENT:
+        return compileBlock(static_cast<const ast::BlockStatement *>(node), false);
+
+    case ast::NodeKind::INTEGER_LITERAL: {
+        auto integer = static_cast<const ast::IntegerLiteral *>(node);
+        emit(code::OpConstant, {static_cast<int>(addConstant(object::NewInteger(integer->value_)))});
+        return true;
+    }
+
+    case ast::NodeKind::STRING_LITERAL: {
+        auto str = static_cast<const ast::StringLiteral *>(node);
+        std::shared_ptr<object::Object> constant = str->interned_;
+        if (!constant) {
+            constant = std::make_shared<object::String>(str->value_);
+        }
+        emit(code::OpConstant, {static_cast<int>(addConstant(constant))});
+        return true;
+    }
+
+    case ast::NodeKind::BOOLEAN:
+        emit(static_cast<const ast::Boolean *>(node)->value_ ? code::OpTrue : code::OpFalse);
+        return true;
+
+    case ast::NodeKind::PREFIX_EXPRESSION: {
+        auto prefix = static_cast<const ast::PrefixExpression *>(node);
+        if (!compileNode(prefix->right_)) return false;
+        switch (prefix->op_) {
+        case ast::Operator::BANG: emit(code::OpBang); return true;
+        case ast::Operator::MINUS: emit(code::OpMinus); return true;
+        default: return fail("unknown operator: " + prefix->operator_);
+        }
+    }
+
+    case ast::NodeKind::INFIX_EXPRESSION:
+        return compileInfixExpression(static_cast<const ast::InfixExpression *>(node));
+
+    case ast::NodeKind::IF_EXPRESSION:
+        return compileIfExpression(static_cast<const ast::IfExpression *>(node), false, false);
+
+    case ast::NodeKind::HASH_LITERAL: {
+        // 与 Evaluator 一致, 按 pairs_ 的遍历顺序求值
+        auto hash = static_cast<const ast::HashLiteral *>(node);
+        for (const auto &pair : hash->pairs_) {
+            if (!compileNode(pair.first)) return false;
+            if (!compileNode(pair.second)) return false;
+        }
+        if (hash->pairs_.size() * 2 > kMaxUint16) {
+            return fail("too many hash pairs");
+        }
+        emit(code::OpHash, {static_cast<int>(hash->pairs_.size() * 2)});
+        return true;
+    }
+
+    case ast::NodeKind::IDENTIFIER: {
+        auto ident = static_cast<const ast::Identifier *>(node);
+        Symbol sym;
+        if (!symbolTable_->resolve(ident->value_, sym)) {
+            // 可能是之后才定义的全局变量, 也可能在不会执行的分支中; 与 Evaluator 一样到执行时再报错
+            auto name = std::make_shared<object::String>(ident->value_);
+            emit(code::OpGetName, {static_cast<int>(addConstant(std::move(name)))});
+            return true;
+        }
+        loadSymbol(sym);
+        return true;
+    }
+
+    case ast::NodeKind::FUNCTION_LITERAL:
+        return compileFunctionLiteral(static_cast<const ast::FunctionLiteral *>(node));
+
+    case ast::NodeKind::CALL_EXPRESSION:
+        return compileCall(static_cast<const ast::CallExpression *>(node), false);
+
+    case ast::NodeKind::ARRAY_LITERAL: {
+        auto al = static_cast<const ast::ArrayLiteral *>(node);
+        for (const auto &e : al->elements_) {
+            if (!compileNode(e)) return false;
+        }
+        if (al->elements_.size() > kMaxUint16) {
+            return fail("too many array elements");
+        }
+        emit(code::OpArray, {static_cast<int>(al->elements_.size())});
+        return true;
+    }
+
+    case ast::NodeKind::INDEX_EXPRESSION: {
+        auto index = static_cast<const ast::IndexExpression *>(node);
+        if (!compileNode(index->left_)) return false;
+        if (!compileNode(index->index_)) return false;
+        emit(code::OpIndex);
+        return true;
+    }
+    }
+
+    return fail("unsupported node: " + node->String());
+}
+
+bool Compiler::compileLetStatement(const ast::LetStatement *let)
+{
+    Symbol sym;
+    // 先定义函数名, 这样函数体内可以按全局变量递归引用自己 (函数内的变量已在开头定义)
+    if (let->value_ && let->value_->Kind() == ast::NodeKind::FUNCTION_LITERAL) {
+        sym = symbolTable_->define(let->name_->value_);
+        if (!compileFunctionLiteral(static_cast<const ast::FunctionLiteral *>(let->value_))) return false;
+    } else {
+        if (!compileNode(let->value_)) return false;
+        sym = symbolTable_->define(let->name_->value_);
+    }
+
+    if (sym.scope == SymbolScope::GLOBAL_SCOPE) {
+        if (static_cast<size_t>(sym.index) > kMaxUint16) {
+            return fail("too many global bindings");
+        }
+        emit(code::OpSetGlobal, {sym.index});
+    } else {
+        if (static_cast<size_t>(sym.index) > kMaxUint8) {
+            return fail("too many local bindings");
+        }
+        emit(sym.cell ? code::OpSetCell : code::OpSetLocal, {sym.index});
+    }
+    return true;
+}
+
+bool Compiler::compileInfixExpression(const ast::InfixExpression *infix)
+{
+    if (!compileNode(infix->left_)) return false;
+    if (!compileNode(infix->right_)) return false;
+
+    switch (infix->op_) {
+    case ast::Operator::PLUS: emit(code::OpAdd); break;
+    case ast::Operator::MINUS: emit(code::OpSub); break;
+    case ast::Operator::ASTERISK: emit(code::OpMul); break;
+    case ast::Operator::SLASH: emit(code::OpDiv); break;
+    case ast::Operator::GT: emit(code::OpGreaterThan); break;
+    case ast::Operator::LT: emit(code::OpLessThan); break;
+    case ast::Operator::EQ: emit(code::OpEqual); break;
+    case ast::Operator::NOT_EQ: emit(code::OpNotEqual); break;
+    default: return fail("unknown operator: " + infix->operator_);
+    }
+    return true;
+}
+
+bool Compiler::compileCall(const ast::CallExpression *call, bool tail)
+{
+    if (!compileNode(call->function_)) return false;
+    for (const auto &a : call->arguments_) {
+        if (!compileNode(a)) return false;
+    }
+    if (call->arguments_.size() > kMaxUint8) {
+        return fail("too many arguments");
+    }
+    emit(tail ? code::OpTailCall : code::OpCall, {static_cast<int>(call->arguments_.size())});
+    return true;
+}
+
+// 分支中的语句之间栈上没有中间值, 因此 return 跳到末尾时栈上恰好只有它的值.
+// 值被使用的 if 不处于尾位置
+bool Compiler::compileIfExpression(const ast::IfExpression *ie, bool statement, bool tail)
+{
+    if (!compileNode(ie->condition_)) return false;
+
+    std::vector<size_t> returnJumps;
+    auto outerJumps = returnJumps_;
+    if (!statement) {
+        returnJumps_ = &returnJumps;
+    }
+
+    size_t jumpNotTruthyPos = emit(code::OpJumpNotTruthy, {9999});
+    bool ok = compileBlock(ie->consequence_, statement && tail);
+
+    size_t jumpPos = emit(code::OpJump, {9999});
+    changeOperand(jumpNotTruthyPos, static_cast<int>(currentScope().instructions.size()));
+
+    if (ok) {
+        if (ie->alternative_) {
+            ok = compileBlock(ie->alternative_, statement && tail);
+        } else {
+            emit(code::OpNull);
+        }
+    }
+    returnJumps_ = outerJumps;
+    if (!ok) return false;
+
+    if (currentScope().instructions.size() > kMaxUint16) {
+        return fail("jump target out of range");
+    }
+    int end = static_cast<int>(currentScope().instructions.size());
+    changeOperand(jumpPos, end);
+    for (auto pos : returnJumps) {
+        changeOperand(pos, end);
+    }
+    return true;
+}
+
+bool Compiler::compileFunctionLiteral(const ast::FunctionLiteral *func)
+{
+    // 函数体中的 return 结束的是这个函数
+    auto outerJumps = returnJumps_;
+    returnJumps_ = nullptr;
+    bool ok = compileFunctionBody(func);
+    returnJumps_ = outerJumps;
+    return ok;
+}
+
+namespace {
+
+// 收集 node 中 let 定义的名字, 不进入内层函数; 块语句不产生新作用域
+void collectLets(const ast::Node *node, std::vector<std::string> &names)
+{
+    ast::ForEachChild(node, [&names](ast::Node *child) {
+        if (child->Kind() == ast::NodeKind::FUNCTION_LITERAL) {
+            return;
+        }
+        if (child->Kind() == ast::NodeKind::LET_STATEMENT) {
+            auto let = static_cast<const ast::LetStatement *>(child);
+            if (let->name_) {
+                names.push_back(let->name_->value_);
+            }
+        }
+        collectLets(child, names);
+    });
+}
+
+// 收集 node 中的内层函数引用的外部名字; shadowed 为途经的内层函数自己的参数和变量
+void collectCaptured(const ast::Node *node, const std::set<std::string> &shadowed, bool inner,
+                     std::set<std::string> &captured)
+{
+    ast::ForEachChild(node, [&](ast::Node *child) {
+        if (child->Kind() == ast::NodeKind::IDENTIFIER) {
+            const auto &name = static_cast<const ast::Identifier *>(child)->value_;
+            if (inner && !shadowed.count(name)) {
+                captured.insert(name);
+            }
+            return;
+        }
+        if (child->Kind() == ast::NodeKind::FUNCTION_LITERAL) {
+            auto func = static_cast<const ast::FunctionLiteral *>(child);
+            std::vector<std::string> locals;
+            for (const auto &p : func->parameters_) {
+                locals.push_back(p->value_);
+            }
+            if (func->body_) {
+                collectLets(func->body_, locals);
+            }
+            auto names = shadowed;
+            names.insert(locals.begin(), locals.end());
+            collectCaptured(func, names, true, captured);
+            return;
+        }
+        collectCaptured(child, shadowed, inner, captured);
+    });
+}
+
+} // namespace
+
+// 与 Resolver 一样, 函数内的 let 提升到开头分配槽位, 内层函数可以引用外层之后才定义的变量;
+// 被内层函数引用的变量放在 Cell 中按引用捕获, 之后的赋值对闭包可见
+bool Compiler::compileFunctionBody(const ast::FunctionLiteral *func)
+{
+    enterScope();
+    for (const auto &p : func->parameters_) {
+        symbolTable_->define(p->value_);
+    }
+    if (func->body_) {
+        std::vector<std::string> lets;
+        collectLets(func->body_, lets);
+        for (const auto &name : lets) {
+            symbolTable_->define(name);
+        }
+        std::set<std::string> captured;
+        collectCaptured(func->body_, {}, false, captured);
+        for (const auto &name : captured) {
+            symbolTable_->capture(name);
+        }
+    }
+
+    int numLocals = symbolTable_->numDefinitions_;
+    std::vector<std::string> localNames(numLocals);
+    for (const auto &entry : symbolTable_->store_) {
+        const auto &sym = entry.second;
+        if (sym.scope != SymbolScope::LOCAL_SCOPE) {
+            continue;
+        }
+        localNames[sym.index] = sym.name;
+        if (sym.cell) {
+            emit(code::OpMakeCell, {sym.index});
+        }
+    }
+
+    if (!compileBody(func->body_ ? func->body_->statements_ : std::vector<ast::Statement *>{})) {
+        leaveScope();
+        return false;
+    }
+
+    auto freeSymbols = symbolTable_->freeSymbols_;
+    auto instructions = leaveScope();
+
+    if (static_cast<size_t>(numLocals) > kMaxUint8 + 1) {
+        return fail("too many local bindings");
+    }
+
+    std::vector<std::string> freeNames;
+    for (const auto &s : freeSymbols) {
+        loadCell(s);
+        freeNames.push_back(s.name);
+    }
+
+    auto fn = std::make_shared<object::CompiledFunction>(std::move(instructions), numLocals,
+                                                         static_cast<int>(func->parameters_.size()),
+                                                         std::move(localNames), std::move(freeNames));
+    size_t idx = addConstant(fn);
+    emit(code::OpClosure, {static_cast<int>(idx), static_cast<int>(freeSymbols.size())});
+    return true;
+}
+
+void Compiler::loadSymbol(const Symbol &s)
+{
+    switch (s.scope) {
+        case SymbolScope::GLOBAL_SCOPE:
+            emit(code::OpGetGlobal, {s.index});
+            break;
+        case SymbolScope::LOCAL_SCOPE:
+            emit(s.cell ? code::OpGetCell : code::OpGetLocal, {s.index});
+            break;
+        case SymbolScope::BUILTIN_SCOPE:
+            emit(code::OpGetBuiltin, {s.index});
+            break;
+        case SymbolScope::FREE_SCOPE:
+            emit(code::OpGetFree, {s.index});
+            break;
+    }
+}
+
+void Compiler::loadCell(const Symbol &s)
+{
+    // 外层函数的局部变量: 槽位中就是 Cell; 外层函数的自由变量: 取它捕获的 Cell
+    emit(s.scope == SymbolScope::LOCAL_SCOPE ? code::OpGetLocal : code::OpGetFreeCell, {s.index});
+}
+
+size_t Compiler::addConstant(std::shared_ptr<object::Object> obj)
+{
+    constants_.push_back(std::move(obj));
+    if (constants_.size() - 1 > kMaxUint16) {
+        fail("too many constants");
+    }
+    return constants_.size() - 1;
+}
+
+size_t Compiler::emit(code::Opcode op, const std::vector<int> &operands)
+{
+    auto ins = code::Make(op, operands);
+    auto &scope = currentScope();
+    size_t pos = scope.instructions.size();
+    scope.instructions.insert(scope.instructions.end(), ins.begin(), ins.end());
+
+    scope.previousInstruction = scope.lastInstruction;
+    scope.lastInstruction = EmittedInstruction{op, pos};
+    return pos;
+}
+
+bool Compiler::lastInstructionIs(code::Opcode op) const
+{
+    const auto &scope = scopes_.back();
+    if (scope.instructions.empty()) {
+        return false;
+    }
+    return scope.lastInstruction.opcode == op;
+}
+
+void Compiler::removeLastPop()
+{
+    auto &scope = currentScope();
+    if (scope.lastInstruction.opcode != code::OpPop) {
+        return;
+    }
+    scope.instructions.resize(scope.lastInstruction.position);
+    scope.lastInstruction = scope.previousInstruction;
+}
+
+void Compiler::changeOperand(size_t pos, int operand)
+{
+    auto &ins = currentScope().instructions;
+    auto newIns = code::Make(ins[pos], {operand});
+    for (size_t i = 0; i < newIns.size(); ++i) {
+        ins[pos + i] = newIns[i];
+    }
+}
+
+void Compiler::enterScope()
+{
+    scopes_.emplace_back();
+    symbolTable_ = std::make_shared<SymbolTable>(symbolTable_);
+}
+
+code::Instructions Compiler::leaveScope()
+{
+    auto ins = std::move(currentScope().instructions);
+    scopes_.pop_back();
+    symbolTable_ = symbolTable_->outer_;
+    return ins;
+}
+
+} // namespace compiler
+} // namespace dragon
@@ -0,0 +1,95 @@
+//
+// 编译器: 把 ast::Program 编译成字节码, 交给 vm::VM 执行
+//
+
+#ifndef DRAGON_COMPILER_H
+#define DRAGON_COMPILER_H
+
+#include "ast.h"
+#include "code.h"
+#include "object.h"
+#include "symbol_table.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dragon {
+namespace compiler {
+
+struct Bytecode {
+    code::Instructions instructions;
+    std::vector<std::shared_ptr<object::Object>> constants;
+    std::shared_ptr<SymbolTable> symbolTable;   // 全局符号表, OpGetName 执行时按名字查找
+};
+
+struct EmittedInstruction {
+    code::Opcode opcode = code::OpCount;
+    size_t position = 0;
+};
+
+struct CompilationScope {
+    code::Instructions instructions;
+    EmittedInstruction lastInstruction;
+    EmittedInstruction previousInstruction;
+};
+
+class Compiler {
+public:
+    Compiler();
+    // REPL 中多次编译需要共享符号表和常量池
+    Compiler(std::shared_ptr<SymbolTable> symbolTable,
+             std::vector<std::shared_ptr<object::Object>> constants);
+
+    // 编译成功返回 nullptr, 否则返回错误对象, 错误信息与 Evaluator 保持一致
+    std::shared_ptr<object::Error> compile(const std::shared_ptr<ast::Program> &program);
+    Bytecode bytecode() const;
+
+    static std::shared_ptr<SymbolTable> newSymbolTable();
+
+public:
+    std::shared_ptr<SymbolTable> symbolTable_;
+    std::vector<std::shared_ptr<object::Object>> constants_;
+
+private:
+    bool compileNode(const ast::Node *node);
+    // tail 为 true 时最后一条表达式语句处于函数的尾位置
+    bool compileStatements(const std::vector<ast::Statement *> &statements, bool tail);
+    bool compileExpressionStatement(const ast::ExpressionStatement *stmt, bool tail);
+    bool compileBlock(const ast::BlockStatement *block, bool tail);
+    bool compileBody(const std::vector<ast::Statement *> &statements);
+    bool compileLetStatement(const ast::LetStatement *let);
+    bool compileInfixExpression(const ast::InfixExpression *infix);
+    // statement 为 false 表示 if 的值被使用 (let 的值, 运算数, 参数等)
+    bool compileIfExpression(const ast::IfExpression *ie, bool statement, bool tail);
+    bool compileCall(const ast::CallExpression *call, bool tail);
+    bool compileFunctionLiteral(const ast::FunctionLiteral *func);
+    bool compileFunctionBody(const ast::FunctionLiteral *func);
+
+    size_t addConstant(std::shared_ptr<object::Object> obj);
+    size_t emit(code::Opcode op, const std::vector<int> &operands = {});
+    void loadSymbol(const Symbol &s);
+    // 压入自由变量 s 所在的 Cell, 供创建闭包
+    void loadCell(const Symbol &s);
+    bool lastInstructionIs(code::Opcode op) const;
+    void removeLastPop();
+    void changeOperand(size_t pos, int operand);
+
+    void enterScope();
+    code::Instructions leaveScope();
+    CompilationScope &currentScope() { return scopes_.back(); }
+
+    bool fail(const std::string &msg);
+
+private:
+    std::vector<CompilationScope> scopes_;
+    std::string error_;
+    // 为空时 return 结束函数, 其值为调用时按尾调用编译; 非空时 return 不结束函数, 而是带着值跳到值被使用的 if 的末尾, 与 Evaluator 一致;
+    // 这里收集这些跳转的位置
+    std::vector<size_t> *returnJumps_ = nullptr;
+};
+
+} // namespace compiler
+} // namespace dragon
+
+#endif //DRAGON_COMPILER_H
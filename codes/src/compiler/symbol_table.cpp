@@ -0,0 +1,74 @@
+//
+// 符号表: 在编译期把标识符解析为 (作用域, 槽位)
+//
+
+#include "symbol_table.h"
+
+namespace dragon {
+namespace compiler {
+
+Symbol SymbolTable::define(const std::string &name)
+{
+    auto it = store_.find(name);
+    if (it != store_.end() &&
+        (it->second.scope == SymbolScope::GLOBAL_SCOPE || it->second.scope == SymbolScope::LOCAL_SCOPE)) {
+        return it->second;
+    }
+
+    Symbol sym{name, outer_ ? SymbolScope::LOCAL_SCOPE : SymbolScope::GLOBAL_SCOPE, numDefinitions_};
+    store_[name] = sym;
+    numDefinitions_++;
+    return sym;
+}
+
+Symbol SymbolTable::defineBuiltin(int index, const std::string &name)
+{
+    Symbol sym{name, SymbolScope::BUILTIN_SCOPE, index};
+    store_[name] = sym;
+    return sym;
+}
+
+void SymbolTable::capture(const std::string &name)
+{
+    auto it = store_.find(name);
+    if (it != store_.end() && it->second.scope == SymbolScope::LOCAL_SCOPE) {
+        it->second.cell = true;
+    }
+}
+
+Symbol SymbolTable::defineFree(const Symbol &original)
+{
+    freeSymbols_.push_back(original);
+    Symbol sym{original.name, SymbolScope::FREE_SCOPE, static_cast<int>(freeSymbols_.size()) - 1};
+    store_[original.name] = sym;
+    return sym;
+}
+
+bool SymbolTable::resolve(const std::string &name, Symbol &sym)
+{
+    auto it = store_.find(name);
+    if (it != store_.end()) {
+        sym = it->second;
+        return true;
+    }
+
+    if (!outer_) {
+        return false;
+    }
+
+    Symbol outerSym;
+    if (!outer_->resolve(name, outerSym)) {
+        return false;
+    }
+
+    if (outerSym.scope == SymbolScope::GLOBAL_SCOPE || outerSym.scope == SymbolScope::BUILTIN_SCOPE) {
+        sym = outerSym;
+        return true;
+    }
+
+    sym = defineFree(outerSym);
+    return true;
+}
+
+} // namespace compiler
+} // namespace dragon
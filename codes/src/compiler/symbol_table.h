@@ -0,0 +1,55 @@
+//
+// 符号表: 在编译期把标识符解析为 (作用域, 槽位)
+//
+
+#ifndef DRAGON_SYMBOL_TABLE_H
+#define DRAGON_SYMBOL_TABLE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dragon {
+namespace compiler {
+
+enum class SymbolScope {
+    GLOBAL_SCOPE,
+    LOCAL_SCOPE,
+    BUILTIN_SCOPE,
+    FREE_SCOPE,
+};
+
+struct Symbol {
+    std::string name;
+    SymbolScope scope;
+    int index;
+    bool cell = false;  // 局部变量被内层函数引用, 槽位中存放 object::Cell
+};
+
+class SymbolTable {
+public:
+    SymbolTable() = default;
+    explicit SymbolTable(std::shared_ptr<SymbolTable> outer) : outer_(std::move(outer)) {}
+
+    // 同一作用域内重复定义时复用原来的槽位
+    Symbol define(const std::string &name);
+    Symbol defineBuiltin(int index, const std::string &name);
+    // 把本作用域的局部变量 name 改为存放在 Cell 中, 须在编译引用它的代码之前调用
+    void capture(const std::string &name);
+    bool resolve(const std::string &name, Symbol &sym);
+
+public:
+    std::shared_ptr<SymbolTable> outer_;
+    std::map<std::string, Symbol> store_;
+    int numDefinitions_ = 0;
+    std::vector<Symbol> freeSymbols_;
+
+private:
+    Symbol defineFree(const Symbol &original);
+};
+
+} // namespace compiler
+} // namespace dragon
+
+#endif //DRAGON_SYMBOL_TABLE_H
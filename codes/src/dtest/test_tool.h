@@ -6,6 +6,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <cmath>
+#include <cassert>
 
 // 断言失败处理器
 inline void AssertionFailure(const char* file, int line, const std::string& msg) {
@@ -96,7 +97,7 @@ public:
     }
 
     Value(const char* cstr) : type(VSTRING) {
-        s = string(cstr);
+        s = std::string(cstr);
     }
     ~Value() {
         if (type == VSTRING) {
@@ -10,7 +10,7 @@
 #include <string>
 #include <iostream>
 
-std::shared_ptr<dragon::object::Object> len(const std::vector<std::shared_ptr<dragon::object::Object>> &args)
+dragon::object::Value len(const std::vector<dragon::object::Value> &args)
 {
     // 参数个数必须是1
     if (args.size() != 1) {
@@ -18,25 +18,21 @@ std::shared_ptr<dragon::object::Object> len(const std::vector<std::shared_ptr<dr
                         args.size());
     }
 
-    if (args[0]->Type() == dragon::object::Object::ObjectType::ARRAY_OBJ) {
-        auto array = std::dynamic_pointer_cast<dragon::object::Array>(args[0]);
-        if (array) {
-            return std::make_shared<dragon::object::Integer>(array->elements_.size());
-        }
-    } else if (args[0]->Type() == dragon::object::Object::ObjectType::STRING_OBJ) {
-        auto str = std::dynamic_pointer_cast<dragon::object::String>(args[0]);
-        if (str) {
-            return std::make_shared<dragon::object::Integer>(str->Value.length());
-        }
+    if (args[0].Type() == dragon::object::Object::ObjectType::ARRAY_OBJ) {
+        auto array = static_cast<dragon::object::Array*>(args[0].get());
+        return dragon::object::Value::Int(array->elements_.size());
+    } else if (args[0].Type() == dragon::object::Object::ObjectType::STRING_OBJ) {
+        auto str = static_cast<dragon::object::String*>(args[0].get());
+        return dragon::object::Value::Int(str->size());
     }
 
     return dragon::evaluator::Evaluator::newError("unsupported type");
 }
 
-std::shared_ptr<dragon::object::Object> print(const std::vector<std::shared_ptr<dragon::object::Object>> &args)
+dragon::object::Value print(const std::vector<dragon::object::Value> &args)
 {
     for (const auto& arg : args) {
-        std::cout << arg->Inspect();
+        std::cout << arg.Inspect();
     }
     return nullptr;
 }
@@ -54,4 +50,30 @@ std::shared_ptr<dragon::object::Builtin> FindBuiltInFunc(const std::string &name
     }
 
     return nullptr;
-}
\ No newline at end of file
+}
+const std::vector<std::string> &BuiltInFuncNames()
+{
+    static std::vector<std::string> names = [] {
+        std::vector<std::string> v;
+        for (const auto &b : builtins) {
+            v.push_back(b.first);
+        }
+        return v;
+    }();
+    return names;
+}
+
+std::shared_ptr<dragon::object::Builtin> GetBuiltInFunc(size_t index)
+{
+    static std::vector<std::shared_ptr<dragon::object::Builtin>> fns = [] {
+        std::vector<std::shared_ptr<dragon::object::Builtin>> v;
+        for (const auto &b : builtins) {
+            v.push_back(b.second);
+        }
+        return v;
+    }();
+    if (index >= fns.size()) {
+        return nullptr;
+    }
+    return fns[index];
+}
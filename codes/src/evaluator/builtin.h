@@ -7,7 +7,12 @@
 
 #include "object.h"
 #include <string>
+#include <vector>
 
 std::shared_ptr<dragon::object::Builtin> FindBuiltInFunc(const std::string &name);
 
+// 按下标访问内置函数, 供编译器与虚拟机使用, 下标与 BuiltInFuncNames 的顺序一致
+const std::vector<std::string> &BuiltInFuncNames();
+std::shared_ptr<dragon::object::Builtin> GetBuiltInFunc(size_t index);
+
 #endif //DRAGON_BUILTIN_H
@@ -0,0 +1,473 @@
+//
+// 闭包编译: 每个语法树节点编译为一个绑定了子节点代码的 lambda, 执行即逐层调用
+//
+
+#include "closure_compiler.h"
+#include "builtin.h"
+#include "folder.h"
+#include "resolver.h"
+
+#include <string>
+#include <typeinfo>
+
+namespace dragon {
+namespace evaluator {
+
+namespace {
+using Env = std::shared_ptr<Environment>;
+
+// 依次执行 codes, 出错时返回只含该错误的数组
+std::vector<object::Value> runList(const std::vector<Code>& codes, const Env& env) {
+    std::vector<object::Value> result;
+    result.reserve(codes.size());
+    for (const auto& code : codes) {
+        auto evaluated = code(env);
+        if (Evaluator::isError(evaluated)) {
+            return {evaluated};
+        }
+        result.push_back(std::move(evaluated));
+    }
+    return result;
+}
+
+// 运算符在编译时确定, 两个整数时直接计算, 其余情况交给 Evaluator 的通用实现.
+// 除法需要检查除数, 走 Evaluator 的整数运算表
+template <ast::Operator Op>
+object::Value integerOp(int64_t l, int64_t r) {
+    if constexpr (Op == ast::Operator::PLUS) return object::Value::Int(Evaluator::wrappingAdd(l, r));
+    if constexpr (Op == ast::Operator::MINUS) return object::Value::Int(Evaluator::wrappingSub(l, r));
+    if constexpr (Op == ast::Operator::ASTERISK) return object::Value::Int(Evaluator::wrappingMul(l, r));
+    if constexpr (Op == ast::Operator::SLASH) return Evaluator::evalIntegerInfixExpression(Op, l, r);
+    if constexpr (Op == ast::Operator::LT) return object::Value::Bool(l < r);
+    if constexpr (Op == ast::Operator::GT) return object::Value::Bool(l > r);
+    if constexpr (Op == ast::Operator::EQ) return object::Value::Bool(l == r);
+    if constexpr (Op == ast::Operator::NOT_EQ) return object::Value::Bool(l != r);
+}
+
+template <ast::Operator Op>
+Code makeInfix(Code left, Code right) {
+    return [left = std::move(left), right = std::move(right)](const Env& env) -> object::Value {
+        auto l = left(env);
+        if (Evaluator::isError(l)) return l;
+        auto r = right(env);
+        if (Evaluator::isError(r)) return r;
+        if (l.IsInteger() && r.IsInteger()) {
+            return integerOp<Op>(l.AsInteger(), r.AsInteger());
+        }
+        return Evaluator::evalInfixExpression(Op, l, r);
+    };
+}
+
+// ClosureFunction 没有子类, 比较 typeid 即可
+bool isClosureFunction(const object::Value& fn) {
+    return fn.Type() == object::Object::ObjectType::FUNCTION_OBJ && typeid(*fn.get()) == typeid(ClosureFunction);
+}
+} // namespace
+
+std::shared_ptr<object::Object> ClosureCompiler::eval(const std::shared_ptr<ast::Program>& program,
+                                                      const std::shared_ptr<Environment>& env) {
+    if (!program) {
+        return nullptr;
+    }
+    FoldConstants(program.get());
+    Resolver(*env).resolve(program.get());
+    auto code = compile(program.get());
+    return code(env).ToObject();
+}
+
+Code ClosureCompiler::compile(const ast::Program* program) {
+    return compileStatements(program->statements_, true);
+}
+
+Code ClosureCompiler::compileNode(const ast::Node* node) {
+    if (!node) {
+        return [](const Env&) -> object::Value { return nullptr; };
+    }
+
+    switch (node->Kind()) {
+    case ast::NodeKind::PROGRAM:
+        return compile(static_cast<const ast::Program*>(node));
+
+    case ast::NodeKind::BLOCK_STATEMENT:
+        return compileStatements(static_cast<const ast::BlockStatement*>(node)->statements_, false);
+
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return compileNode(static_cast<const ast::ExpressionStatement*>(node)->expression_);
+
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto value = compileNode(static_cast<const ast::ReturnStatement*>(node)->returnValue_);
+        return [value = std::move(value)](const Env& env) -> object::Value {
+            auto val = value(env);
+            return object::Value::Return(std::move(val));
+        };
+    }
+
+    case ast::NodeKind::LET_STATEMENT:
+        return compileLet(static_cast<const ast::LetStatement*>(node));
+
+    case ast::NodeKind::INTEGER_LITERAL: {
+        auto value = object::Value::Int(static_cast<const ast::IntegerLiteral*>(node)->value_);
+        return [value](const Env&) { return value; };
+    }
+
+    case ast::NodeKind::STRING_LITERAL: {
+        auto lit = static_cast<const ast::StringLiteral*>(node);
+        object::Value value = lit->interned_ ? lit->interned_ : std::make_shared<object::String>(lit->value_);
+        return [value](const Env&) { return value; };
+    }
+
+    case ast::NodeKind::BOOLEAN: {
+        auto value = object::Value::Bool(static_cast<const ast::Boolean*>(node)->value_);
+        return [value](const Env&) { return value; };
+    }
+
+    case ast::NodeKind::PREFIX_EXPRESSION:
+        return compilePrefix(static_cast<const ast::PrefixExpression*>(node));
+
+    case ast::NodeKind::INFIX_EXPRESSION:
+        return compileInfix(static_cast<const ast::InfixExpression*>(node));
+
+    case ast::NodeKind::IF_EXPRESSION:
+        return compileIf(static_cast<const ast::IfExpression*>(node));
+
+    case ast::NodeKind::HASH_LITERAL:
+        return compileHashLiteral(static_cast<const ast::HashLiteral*>(node));
+
+    case ast::NodeKind::IDENTIFIER:
+        return compileIdentifier(static_cast<const ast::Identifier*>(node));
+
+    case ast::NodeKind::FUNCTION_LITERAL:
+        return compileFunction(static_cast<const ast::FunctionLiteral*>(node));
+
+    case ast::NodeKind::CALL_EXPRESSION:
+        return compileCall(static_cast<const ast::CallExpression*>(node));
+
+    case ast::NodeKind::ARRAY_LITERAL: {
+        auto elements = compileList(static_cast<const ast::ArrayLiteral*>(node)->elements_);
+        return [elements = std::move(elements)](const Env& env) -> object::Value {
+            auto eles = runList(elements, env);
+            if (eles.size() == 1 && Evaluator::isError(eles[0])) {
+                return std::move(eles[0]);
+            }
+
+            return Evaluator::makeArray(std::move(eles));
+        };
+    }
+
+    case ast::NodeKind::INDEX_EXPRESSION: {
+        auto index = static_cast<const ast::IndexExpression*>(node);
+        auto left = compileNode(index->left_);
+        auto idx = compileNode(index->index_);
+        return [left = std::move(left), idx = std::move(idx)](const Env& env) -> object::Value {
+            auto l = left(env);
+            if (Evaluator::isError(l)) return l;
+            auto i = idx(env);
+            if (Evaluator::isError(i)) return i;
+            return Evaluator::evalIndexExpression(l, i);
+        };
+    }
+    }
+    return [](const Env&) -> object::Value { return nullptr; };
+}
+
+// 程序与块: program 为 true 时解开 return 信号, 否则原样向外传递
+Code ClosureCompiler::compileStatements(const std::vector<ast::Statement*>& statements, bool program) {
+    std::vector<Code> codes;
+    codes.reserve(statements.size());
+    for (auto stmt : statements) {
+        codes.push_back(compileNode(stmt));
+    }
+    return [codes = std::move(codes), program](const Env& env) -> object::Value {
+        object::Value result;
+        for (const auto& code : codes) {
+            result = code(env);
+
+            if (result.IsAbrupt()) {
+                return program ? Evaluator::unwrapReturnValue(std::move(result)) : result;
+            }
+        }
+        return result;
+    };
+}
+
+Code ClosureCompiler::compileLet(const ast::LetStatement* let) {
+    auto value = compileNode(let->value_);
+    auto name = let->name_;
+    int slot = name->slot_;
+    switch (name->scope_) {
+    case ast::Identifier::Scope::LOCAL:
+        return [value = std::move(value), slot](const Env& env) -> object::Value {
+            auto val = value(env);
+            if (Evaluator::isError(val)) return val;
+            env->setLocal(slot, std::move(val));
+            return nullptr;
+        };
+    case ast::Identifier::Scope::GLOBAL:
+        return [value = std::move(value), slot](const Env& env) -> object::Value {
+            auto val = value(env);
+            if (Evaluator::isError(val)) return val;
+            env->setGlobal(slot, std::move(val));
+            return nullptr;
+        };
+    default:
+        return [value = std::move(value), name = name->value_](const Env& env) -> object::Value {
+            auto val = value(env);
+            if (Evaluator::isError(val)) return val;
+            env->set(name, std::move(val));
+            return nullptr;
+        };
+    }
+}
+
+// 按 resolver 给出的作用域选择访问方式, 内置函数在编译时直接取出
+Code ClosureCompiler::compileIdentifier(const ast::Identifier* ident) {
+    int depth = ident->depth_;
+    int slot = ident->slot_;
+    const std::string& name = ident->value_;
+    switch (ident->scope_) {
+    case ast::Identifier::Scope::LOCAL:
+        return [depth, slot, name](const Env& env) -> object::Value {
+            auto &val = env->getLocal(depth, slot);
+            if (val) {
+                return val;
+            }
+            return Evaluator::lookupName(name, env);
+        };
+    case ast::Identifier::Scope::GLOBAL:
+        return [slot, name](const Env& env) -> object::Value {
+            auto &val = env->getGlobal(slot);
+            if (val) {
+                return val;
+            }
+            return Evaluator::lookupName(name, env);
+        };
+    case ast::Identifier::Scope::BUILTIN: {
+        object::Value builtin = GetBuiltInFunc(slot);
+        return [builtin](const Env&) { return builtin; };
+    }
+    case ast::Identifier::Scope::UNRESOLVED:
+        break;
+    }
+    return [name](const Env& env) { return Evaluator::lookupName(name, env); };
+}
+
+Code ClosureCompiler::compilePrefix(const ast::PrefixExpression* prefix) {
+    auto right = compileNode(prefix->right_);
+    if (prefix->op_ == ast::Operator::BANG) {
+        return [right = std::move(right)](const Env& env) -> object::Value {
+            auto r = right(env);
+            if (Evaluator::isError(r)) return r;
+            return object::Value::Bool(r.IsNil() || (r.IsBoolean() && !r.AsBoolean()));
+        };
+    }
+    if (prefix->op_ == ast::Operator::MINUS) {
+        return [right = std::move(right)](const Env& env) -> object::Value {
+            auto r = right(env);
+            if (r.IsInteger()) return object::Value::Int(Evaluator::wrappingNeg(r.AsInteger()));
+            if (Evaluator::isError(r)) return r;
+            return Evaluator::evalPrefixExpression(ast::Operator::MINUS, r);
+        };
+    }
+    return [right = std::move(right), op = prefix->op_](const Env& env) -> object::Value {
+        auto r = right(env);
+        if (Evaluator::isError(r)) return r;
+        return Evaluator::evalPrefixExpression(op, r);
+    };
+}
+
+Code ClosureCompiler::compileInfix(const ast::InfixExpression* infix) {
+    auto left = compileNode(infix->left_);
+    auto right = compileNode(infix->right_);
+    switch (infix->op_) {
+    case ast::Operator::PLUS: return makeInfix<ast::Operator::PLUS>(std::move(left), std::move(right));
+    case ast::Operator::MINUS: return makeInfix<ast::Operator::MINUS>(std::move(left), std::move(right));
+    case ast::Operator::ASTERISK: return makeInfix<ast::Operator::ASTERISK>(std::move(left), std::move(right));
+    case ast::Operator::SLASH: return makeInfix<ast::Operator::SLASH>(std::move(left), std::move(right));
+    case ast::Operator::LT: return makeInfix<ast::Operator::LT>(std::move(left), std::move(right));
+    case ast::Operator::GT: return makeInfix<ast::Operator::GT>(std::move(left), std::move(right));
+    case ast::Operator::EQ: return makeInfix<ast::Operator::EQ>(std::move(left), std::move(right));
+    case ast::Operator::NOT_EQ: return makeInfix<ast::Operator::NOT_EQ>(std::move(left), std::move(right));
+    default:
+        break;
+    }
+    return [left = std::move(left), right = std::move(right), op = infix->op_](const Env& env) -> object::Value {
+        auto l = left(env);
+        if (Evaluator::isError(l)) return l;
+        auto r = right(env);
+        if (Evaluator::isError(r)) return r;
+        return Evaluator::evalInfixExpression(op, l, r);
+    };
+}
+
+Code ClosureCompiler::compileIf(const ast::IfExpression* ie) {
+    auto condition = compileNode(ie->condition_);
+    auto consequence = compileNode(ie->consequence_);
+    if (!ie->alternative_) {
+        return [condition = std::move(condition), consequence = std::move(consequence)](const Env& env) -> object::Value {
+            auto cond = condition(env);
+            if (Evaluator::isError(cond)) return cond;
+            if (Evaluator::isTruthy(cond)) {
+                return consequence(env);
+            }
+            return object::Value::Nil();
+        };
+    }
+    auto alternative = compileNode(ie->alternative_);
+    return [condition = std::move(condition), consequence = std::move(consequence),
+            alternative = std::move(alternative)](const Env& env) -> object::Value {
+        auto cond = condition(env);
+        if (Evaluator::isError(cond)) return cond;
+        return Evaluator::isTruthy(cond) ? consequence(env) : alternative(env);
+    };
+}
+
+Code ClosureCompiler::compileHashLiteral(const ast::HashLiteral* hash) {
+    std::vector<std::pair<Code, Code>> items;
+    items.reserve(hash->pairs_.size());
+    for (const auto& pair : hash->pairs_) {
+        items.emplace_back(compileNode(pair.first), compileNode(pair.second));
+    }
+    return [items = std::move(items)](const Env& env) {
+        return Evaluator::evalHashPairs(items.size(),
+                                        [&](size_t i) { return items[i].first(env); },
+                                        [&](size_t i) { return items[i].second(env); });
+    };
+}
+
+// 函数体只编译一次, 由该字面量每次求值创建的函数共用
+Code ClosureCompiler::compileFunction(const ast::FunctionLiteral* func) {
+    auto body = std::make_shared<const TailCode>(compileTail(func->body_, true));
+    return [func, body](const Env& env) -> object::Value {
+        return Evaluator::makeFunction(std::make_shared<ClosureFunction>(func, env, body), env);
+    };
+}
+
+Code ClosureCompiler::compileCall(const ast::CallExpression* call) {
+    auto function = compileNode(call->function_);
+    auto arguments = compileList(call->arguments_);
+    return [function = std::move(function), arguments = std::move(arguments)](const Env& env) -> object::Value {
+        auto fn = function(env);
+        if (Evaluator::isError(fn)) return fn;
+
+        auto args = runList(arguments, env);
+        if (args.size() == 1 && Evaluator::isError(args[0])) return std::move(args[0]);
+
+        return applyFunction(fn, args);
+    };
+}
+
+std::vector<Code> ClosureCompiler::compileList(const std::vector<ast::Expression*>& exps) {
+    std::vector<Code> codes;
+    codes.reserve(exps.size());
+    for (auto exp : exps) {
+        codes.push_back(compileNode(exp));
+    }
+    return codes;
+}
+
+TailCode ClosureCompiler::compileTail(const ast::Node* node, bool result) {
+    if (!node) {
+        return [](const Env&, TailCall&) -> object::Value { return nullptr; };
+    }
+
+    switch (node->Kind()) {
+    case ast::NodeKind::BLOCK_STATEMENT: {
+        const auto& statements = static_cast<const ast::BlockStatement*>(node)->statements_;
+        std::vector<TailCode> codes;
+        codes.reserve(statements.size());
+        for (size_t i = 0, n = statements.size(); i < n; ++i) {
+            // 只有最后一条语句的值是块的值; 之前的语句中只有 return 处于尾位置
+            codes.push_back(compileTail(statements[i], result && i + 1 == n));
+        }
+        return [codes = std::move(codes)](const Env& env, TailCall& tail) -> object::Value {
+            object::Value val;
+            for (const auto& code : codes) {
+                val = code(env, tail);
+                if (tail.pending) {
+                    return nullptr;
+                }
+                if (val.IsAbrupt()) {
+                    return val;
+                }
+            }
+            return val;
+        };
+    }
+
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return compileTail(static_cast<const ast::ExpressionStatement*>(node)->expression_, result);
+
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto value = compileTail(static_cast<const ast::ReturnStatement*>(node)->returnValue_, true);
+        return [value = std::move(value)](const Env& env, TailCall& tail) -> object::Value {
+            auto val = value(env, tail);
+            if (tail.pending) return val;
+            return object::Value::Return(std::move(val));
+        };
+    }
+
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto ie = static_cast<const ast::IfExpression*>(node);
+        auto condition = compileNode(ie->condition_);
+        auto consequence = compileTail(ie->consequence_, result);
+        TailCode alternative;
+        if (ie->alternative_) {
+            alternative = compileTail(ie->alternative_, result);
+        }
+        return [condition = std::move(condition), consequence = std::move(consequence),
+                alternative = std::move(alternative)](const Env& env, TailCall& tail) -> object::Value {
+            auto cond = condition(env);
+            if (Evaluator::isError(cond)) return cond;
+
+            if (Evaluator::isTruthy(cond)) {
+                return consequence(env, tail);
+            } else if (alternative) {
+                return alternative(env, tail);
+            }
+            return object::Value::Nil();
+        };
+    }
+
+    case ast::NodeKind::CALL_EXPRESSION: {
+        if (!result) {
+            break;
+        }
+        auto call = static_cast<const ast::CallExpression*>(node);
+        auto function = compileNode(call->function_);
+        auto arguments = compileList(call->arguments_);
+        return [function = std::move(function), arguments = std::move(arguments)](const Env& env, TailCall& tail) -> object::Value {
+            auto fn = function(env);
+            if (Evaluator::isError(fn)) return fn;
+
+            auto args = runList(arguments, env);
+            if (args.size() == 1 && Evaluator::isError(args[0])) return std::move(args[0]);
+
+            tail.pending = true;
+            tail.fn = std::move(fn);
+            tail.args = std::move(args);
+            return nullptr;
+        };
+    }
+
+    default:
+        break;
+    }
+    auto code = compileNode(node);
+    return [code = std::move(code)](const Env& env, TailCall&) { return code(env); };
+}
+
+object::Value ClosureCompiler::applyFunction(const object::Value& fn, const std::vector<object::Value>& args) {
+    // 内置函数, 以及不由闭包编译的代码创建的函数
+    if (!isClosureFunction(fn)) {
+        return Evaluator::applyFunction(fn, args);
+    }
+
+    return Evaluator::trampoline(std::static_pointer_cast<ClosureFunction>(fn.AsObject()), args, isClosureFunction,
+                                 [](const std::shared_ptr<ClosureFunction>& function,
+                                    const std::vector<object::Value>& args, TailCall& tail) {
+                                     return (*function->code_)(Evaluator::extendFunctionEnv(function, args), tail);
+                                 });
+}
+
+} // namespace evaluator
+} // namespace dragon
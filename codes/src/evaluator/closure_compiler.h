@@ -0,0 +1,60 @@
+#ifndef __CLOSURE_COMPILER_H__
+#define __CLOSURE_COMPILER_H__
+
+#include "evaluator.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace dragon {
+namespace evaluator {
+
+// 编译得到的代码: 子节点在编译时已绑定, 运算符与标识符的访问方式也已确定
+using Code = std::function<object::Value(const std::shared_ptr<Environment>&)>;
+// 函数体中的代码, 尾位置上的调用记录到 TailCall 中, 由 Evaluator::trampoline 循环执行
+using TailCode = std::function<object::Value(const std::shared_ptr<Environment>&, Evaluator::TailCall&)>;
+
+// 由闭包编译的代码创建的函数, 额外持有编译好的函数体; 同一个函数字面量创建的函数共用函数体
+class ClosureFunction final : public object::Function {
+public:
+    ClosureFunction(const ast::FunctionLiteral *literal, std::shared_ptr<Environment> env,
+                    std::shared_ptr<const TailCode> body)
+        : Function(literal, std::move(env)), code_(std::move(body)) {}
+
+    std::shared_ptr<const TailCode> code_;
+};
+
+// 把语法树编译为预先绑定好的 C++ 可调用对象树再执行, 语义与 Evaluator 一致.
+// 执行时不再按 NodeKind 分发, 也不再做类型转换和运算符查找; 函数体在编译时一并编译
+class ClosureCompiler {
+public:
+    // 对外入口: 常量折叠, 静态解析, 编译后执行
+    static std::shared_ptr<object::Object> eval(const std::shared_ptr<ast::Program>& program,
+                                                const std::shared_ptr<Environment>& env);
+    // 编译已解析过的程序
+    static Code compile(const ast::Program* program);
+
+private:
+    using TailCall = Evaluator::TailCall;
+
+    static Code compileNode(const ast::Node* node);
+    static Code compileStatements(const std::vector<ast::Statement*>& statements, bool program);
+    static Code compileLet(const ast::LetStatement* let);
+    static Code compileIdentifier(const ast::Identifier* ident);
+    static Code compilePrefix(const ast::PrefixExpression* prefix);
+    static Code compileInfix(const ast::InfixExpression* infix);
+    static Code compileIf(const ast::IfExpression* ie);
+    static Code compileHashLiteral(const ast::HashLiteral* hash);
+    static Code compileFunction(const ast::FunctionLiteral* func);
+    static Code compileCall(const ast::CallExpression* call);
+    static std::vector<Code> compileList(const std::vector<ast::Expression*>& exps);
+    // result 表示该节点的值是否就是函数的返回值, 与 Evaluator::evalTail 相同
+    static TailCode compileTail(const ast::Node* node, bool result);
+
+    static object::Value applyFunction(const object::Value& fn, const std::vector<object::Value>& args);
+};
+
+} // namespace evaluator
+} // namespace dragon
+
+#endif
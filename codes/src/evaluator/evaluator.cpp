@@ -1,302 +1,464 @@
 #include "evaluator.h"
+#include <array>
 #include <cstdarg>
 #include <cstdio>
 #include <memory>
 #include <string>
 #include "builtin.h"
+#include "folder.h"
+#include "gc.h"
+#include "jit.h"
+#include "resolver.h"
 namespace dragon {
 namespace evaluator {
 
-#define TRUE_OBJ  std::make_shared<object::Boolean>(true)
-#define FALSE_OBJ std::make_shared<object::Boolean>(false)
+namespace {
+// 按运算符索引的运算表, 每种操作数类型组合一张; 空项表示该类型不支持此运算符
+using IntegerKernel = object::Value (*)(int64_t, int64_t);
+using BooleanKernel = object::Value (*)(bool, bool);
+using StringKernel = object::Value (*)(const object::Value&, const object::Value&);
 
+template <typename Kernel>
+using KernelTable = std::array<Kernel, ast::kOperatorCount>;
+
+constexpr size_t opIndex(ast::Operator op) { return static_cast<size_t>(op); }
+
+// 除数为 0 时报错, 与 VM 一致; INT64_MIN / -1 按补码回绕为 INT64_MIN, 与加减乘的溢出一致
+object::Value divideIntegers(int64_t l, int64_t r) {
+    if (r == 0) {
+        return Evaluator::newError("division by zero");
+    }
+    if (r == -1) {
+        return object::Value::Int(Evaluator::wrappingNeg(l));
+    }
+    return object::Value::Int(l / r);
+}
+
+constexpr KernelTable<IntegerKernel> makeIntegerKernels() {
+    KernelTable<IntegerKernel> t{};
+    t[opIndex(ast::Operator::PLUS)] = [](int64_t l, int64_t r) { return object::Value::Int(Evaluator::wrappingAdd(l, r)); };
+    t[opIndex(ast::Operator::MINUS)] = [](int64_t l, int64_t r) { return object::Value::Int(Evaluator::wrappingSub(l, r)); };
+    t[opIndex(ast::Operator::ASTERISK)] = [](int64_t l, int64_t r) { return object::Value::Int(Evaluator::wrappingMul(l, r)); };
+    t[opIndex(ast::Operator::SLASH)] = divideIntegers;
+    t[opIndex(ast::Operator::LT)] = [](int64_t l, int64_t r) { return object::Value::Bool(l < r); };
+    t[opIndex(ast::Operator::GT)] = [](int64_t l, int64_t r) { return object::Value::Bool(l > r); };
+    t[opIndex(ast::Operator::EQ)] = [](int64_t l, int64_t r) { return object::Value::Bool(l == r); };
+    t[opIndex(ast::Operator::NOT_EQ)] = [](int64_t l, int64_t r) { return object::Value::Bool(l != r); };
+    return t;
+}
+
+constexpr KernelTable<BooleanKernel> makeBooleanKernels() {
+    KernelTable<BooleanKernel> t{};
+    t[opIndex(ast::Operator::EQ)] = [](bool l, bool r) { return object::Value::Bool(l == r); };
+    t[opIndex(ast::Operator::NOT_EQ)] = [](bool l, bool r) { return object::Value::Bool(l != r); };
+    return t;
+}
+
+// 暂时只支持字符串的 + 运算
+constexpr KernelTable<StringKernel> makeStringKernels() {
+    KernelTable<StringKernel> t{};
+    t[opIndex(ast::Operator::PLUS)] = [](const object::Value& l, const object::Value& r) -> object::Value {
+        return object::String::Concat(std::static_pointer_cast<object::String>(l.AsObject()),
+                                      std::static_pointer_cast<object::String>(r.AsObject()));
+    };
+    return t;
+}
+
+constexpr KernelTable<IntegerKernel> kIntegerKernels = makeIntegerKernels();
+constexpr KernelTable<BooleanKernel> kBooleanKernels = makeBooleanKernels();
+constexpr KernelTable<StringKernel> kStringKernels = makeStringKernels();
+
+// 只缓存全局变量形式的被调函数: 全局环境在整个程序中不变, 缓存的键稳定;
+// 局部变量所在的环境每次调用都是新的, 缓存几乎总是不命中
+const ast::Identifier *globalCallee(const ast::Expression* callee) {
+    if (!callee || callee->Kind() != ast::NodeKind::IDENTIFIER) {
+        return nullptr;
+    }
+    auto ident = static_cast<const ast::Identifier*>(callee);
+    return ident->scope_ == ast::Identifier::Scope::GLOBAL ? ident : nullptr;
+}
+
+object::Value unknownInfixOperator(ast::Operator op, const object::Value& left, const object::Value& right) {
+    return Evaluator::newError("unknown operator: %s %s %s",
+                               dragon::object::GetTypeString(left.Type()).c_str(), ast::OperatorName(op),
+                               dragon::object::GetTypeString(right.Type()).c_str());
+}
+} // namespace
+
+// 对外入口: 求值整个程序前先做常量折叠和静态解析
 std::shared_ptr<object::Object> Evaluator::eval(const std::shared_ptr<ast::Node>& node,
                                       const std::shared_ptr<Environment>& env) {
-    if (auto program = std::dynamic_pointer_cast<ast::Program>(node)) {
-        return evalProgram(program, env);
-    }
-    if (auto block = std::dynamic_pointer_cast<ast::BlockStatement>(node)) {
-        return evalBlockStatement(block, env);
+    if (node && node->Kind() == ast::NodeKind::PROGRAM) {
+        FoldConstants(static_cast<ast::Program*>(node.get()));
+        Resolver(*env).resolve(static_cast<ast::Program*>(node.get()));
     }
-    if (auto expr = std::dynamic_pointer_cast<ast::ExpressionStatement>(node)) {
-        return eval(expr->expression_, env);
+    return eval(node.get(), env).ToObject();
+}
+
+// 按 NodeKind 分发; 子节点以裸指针传递, 避免 shared_ptr 的引用计数开销
+object::Value Evaluator::eval(const ast::Node* node,
+                                      const std::shared_ptr<Environment>& env) {
+    if (!node) {
+        return nullptr;
     }
-    if (auto ret = std::dynamic_pointer_cast<ast::ReturnStatement>(node)) {
+
+    switch (node->Kind()) {
+    case ast::NodeKind::PROGRAM:
+        return evalProgram(static_cast<const ast::Program*>(node), env);
+
+    case ast::NodeKind::BLOCK_STATEMENT:
+        return evalBlockStatement(static_cast<const ast::BlockStatement*>(node), env);
+
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return eval(static_cast<const ast::ExpressionStatement*>(node)->expression_, env);
+
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto ret = static_cast<const ast::ReturnStatement*>(node);
         auto val = eval(ret->returnValue_, env);
-        if (isError(val)) return val;
-        return std::make_shared<object::ReturnValue>(val);
+        return object::Value::Return(std::move(val));
     }
-    if (auto let = std::dynamic_pointer_cast<ast::LetStatement>(node)) {
+
+    case ast::NodeKind::LET_STATEMENT: {
+        auto let = static_cast<const ast::LetStatement*>(node);
         auto val = eval(let->value_, env);
         if (isError(val)) return val;
-        env->set(let->name_->value_, val);
+        auto name = let->name_;
+        if (name->scope_ == ast::Identifier::Scope::LOCAL) {
+            env->setLocal(name->slot_, std::move(val));
+        } else if (name->scope_ == ast::Identifier::Scope::GLOBAL) {
+            env->setGlobal(name->slot_, std::move(val));
+        } else {
+            env->set(name->value_, std::move(val));
+        }
         return nullptr;
     }
-    if (auto integer = std::dynamic_pointer_cast<ast::IntegerLiteral>(node)) {
-        return std::make_shared<object::Integer>(integer->value_);
-    }
 
-    if (auto str = std::dynamic_pointer_cast<ast::StringLiteral>(node)) {
-        return std::make_shared<object::String>(str->value_);
-    }
-    if (auto boolean = std::dynamic_pointer_cast<ast::Boolean>(node)) {
-        if (boolean->value_) return std::make_shared<object::Boolean>(true);
-        else return std::make_shared<object::Boolean>(false);
+    case ast::NodeKind::INTEGER_LITERAL:
+        return object::Value::Int(static_cast<const ast::IntegerLiteral*>(node)->value_);
+
+    case ast::NodeKind::STRING_LITERAL: {
+        auto lit = static_cast<const ast::StringLiteral*>(node);
+        if (lit->interned_) {
+            return lit->interned_;
+        }
+        return std::make_shared<object::String>(lit->value_);
     }
-    if (auto prefix = std::dynamic_pointer_cast<ast::PrefixExpression>(node)) {
+
+    case ast::NodeKind::BOOLEAN:
+        return object::Value::Bool(static_cast<const ast::Boolean*>(node)->value_);
+
+    case ast::NodeKind::PREFIX_EXPRESSION: {
+        auto prefix = static_cast<const ast::PrefixExpression*>(node);
         auto right = eval(prefix->right_, env);
         if (isError(right)) return right;
-        return evalPrefixExpression(prefix->operator_, right);
+        return evalPrefixExpression(prefix->op_, right);
     }
-    if (auto infix = std::dynamic_pointer_cast<ast::InfixExpression>(node)) {
-        auto left = eval(infix->left_, env);
-        if (isError(left)) return left;
-        
-        auto right = eval(infix->right_, env);
-        if (isError(right)) return right;
-        
-        return evalInfixExpression(infix->operator_, left, right);
-    }
-    if (auto ifExpr = std::dynamic_pointer_cast<ast::IfExpression>(node)) {
-        return evalIfExpression(ifExpr, env);
+
+    case ast::NodeKind::INFIX_EXPRESSION:
+        return evalInfixNode(static_cast<const ast::InfixExpression*>(node), env);
+
+    case ast::NodeKind::IF_EXPRESSION:
+        return evalIfExpression(static_cast<const ast::IfExpression*>(node), env);
+
+    case ast::NodeKind::HASH_LITERAL:
+        return evalHashLiteral(static_cast<const ast::HashLiteral*>(node), env);
+
+    case ast::NodeKind::IDENTIFIER:
+        return evalIdentifier(static_cast<const ast::Identifier*>(node), env);
+
+    case ast::NodeKind::FUNCTION_LITERAL: {
+        auto func = static_cast<const ast::FunctionLiteral*>(node);
+        return makeFunction(std::make_shared<object::Function>(func, env), env);
     }
 
-    if (auto hash = std::dynamic_pointer_cast<ast::HashLiteral>(node)) {
-        return evalHashLiteral(hash, env);
+    case ast::NodeKind::CALL_EXPRESSION:
+        return evalCallNode(static_cast<const ast::CallExpression*>(node), env);
+
+    case ast::NodeKind::ARRAY_LITERAL: {
+        auto eles = evalExpressions(static_cast<const ast::ArrayLiteral*>(node)->elements_, env);
+        if (eles.size() == 1 && isError(eles[0])) {
+            return std::move(eles[0]);
+        }
+
+        return makeArray(std::move(eles));
     }
-    if (auto ident = std::dynamic_pointer_cast<ast::Identifier>(node)) {
-        return evalIdentifier(ident, env);
+
+    case ast::NodeKind::INDEX_EXPRESSION:
+        return evalIndexNode(static_cast<const ast::IndexExpression*>(node), env);
     }
-    if (auto func = std::dynamic_pointer_cast<ast::FunctionLiteral>(node)) {
-        std::vector<std::string> params;
-        for (const auto& param : func->parameters_) {
-            params.push_back(param->value_);
+    return nullptr;
+}
+
+// 以下三类节点按 quick_ 走特化路径. 特化路径的守卫同时排除了错误值;
+// 守卫失败时把节点改回 GENERIC, 本次及以后都走通用路径
+object::Value Evaluator::evalInfixNode(const ast::InfixExpression* infix,
+                                       const std::shared_ptr<Environment>& env) {
+    auto left = eval(infix->left_, env);
+    if (infix->quick_ == ast::Quickening::INTEGER && left.IsInteger()) {
+        auto right = eval(infix->right_, env);
+        if (right.IsInteger()) {
+            return kIntegerKernels[opIndex(infix->op_)](left.AsInteger(), right.AsInteger());
         }
-        return std::make_shared<object::Function>(func->parameters_, func->body_, env);
+        infix->quick_ = ast::Quickening::GENERIC;
+        if (isError(right)) return right;
+        return evalInfixExpression(infix->op_, left, right);
     }
+    if (isError(left)) return left;
 
-    if (auto call = std::dynamic_pointer_cast<ast::CallExpression>(node)) {
-        auto function = eval(call->function_, env);
-        if (isError(function)) return function;
-        
-        auto args = evalExpressions(call->arguments_, env);
-        if (args.size() == 1 && isError(args[0])) return args[0];
-        
-        return applyFunction(function, args);
+    auto right = eval(infix->right_, env);
+    if (isError(right)) return right;
+
+    if (infix->quick_ == ast::Quickening::UNSEEN) {
+        // 整数运算表中有该运算符时才特化, 特化路径因此不必再检查空项
+        bool integers = left.IsInteger() && right.IsInteger() && kIntegerKernels[opIndex(infix->op_)];
+        infix->quick_ = integers ? ast::Quickening::INTEGER : ast::Quickening::GENERIC;
+    } else if (infix->quick_ == ast::Quickening::INTEGER) {
+        infix->quick_ = ast::Quickening::GENERIC;
     }
+    return evalInfixExpression(infix->op_, left, right);
+}
 
-    if (auto al = std::dynamic_pointer_cast<ast::ArrayLiteral>(node)) {
-        auto eles = evalExpressions(al->elements_, env);
-        if (eles.size() == 1 && isError(eles[0])) {
-            return eles[0];
-        }
+object::Value Evaluator::evalIndexNode(const ast::IndexExpression* index,
+                                       const std::shared_ptr<Environment>& env) {
+    auto left = eval(index->left_, env);
+    if (isError(left)) {
+        return left;
+    }
 
-        return std::make_shared<object::Array>(eles);
+    auto idx = eval(index->index_, env);
+    if (isError(idx)) {
+        return idx;
     }
-    // index
-    if (auto index = std::dynamic_pointer_cast<ast::IndexExpression>(node)) {
-        auto left = eval(index->left_, env);
-        if (isError(left)) {
-            return left;
+
+    bool arrayIndex = idx.IsInteger() && left.Type() == object::Object::ObjectType::ARRAY_OBJ;
+    switch (index->quick_) {
+    case ast::Quickening::ARRAY_INDEX:
+        if (arrayIndex) {
+            return evalArrayIndexExpression(left, idx);
         }
+        index->quick_ = ast::Quickening::GENERIC;
+        break;
+    case ast::Quickening::UNSEEN:
+        index->quick_ = arrayIndex ? ast::Quickening::ARRAY_INDEX : ast::Quickening::GENERIC;
+        break;
+    default:
+        break;
+    }
+    return evalIndexExpression(left, idx);
+}
 
-        auto idx = eval(index->index_, env);
-        if (isError(idx)) {
-            return idx;
+object::Value Evaluator::evalCallee(const ast::CallExpression* call,
+                                    const std::shared_ptr<Environment>& env, bool& cached) {
+    cached = false;
+    auto ident = globalCallee(call->function_);
+    if (!ident) {
+        return eval(call->function_, env);
+    }
+
+    auto& cache = call->cache_;
+    auto scope = env->globalScope();
+    cached = scope == cache.env && scope->version() == cache.version;
+    if (cached) {
+        // 复制一份: 求值参数时槽位可能被改写
+        return scope->getGlobal(ident->slot_);
+    }
+
+    auto function = eval(call->function_, env);
+    // 只缓存取自槽位本身的值, 槽位为空时按名字找到的值不缓存
+    cache.env = nullptr;
+    if (scope->getGlobal(ident->slot_).get() == function.get()) {
+        auto type = function.Type();
+        if (type == object::Object::ObjectType::FUNCTION_OBJ || type == object::Object::ObjectType::BUILTIN_OBJ) {
+            cache.env = scope;
+            cache.version = scope->version();
+            cache.builtin = type == object::Object::ObjectType::BUILTIN_OBJ;
         }
+    }
+    return function;
+}
 
-        return evalIndexExpression(left, idx);
+object::Value Evaluator::evalCallNode(const ast::CallExpression* call,
+                                      const std::shared_ptr<Environment>& env) {
+    bool cached = false;
+    auto function = evalCallee(call, env, cached);
+    if (isError(function)) return function;
+    // 求值参数时可能递归经过本节点并改写缓存, 先取出
+    bool builtin = call->cache_.builtin;
+
+    auto args = evalExpressions(call->arguments_, env);
+    if (args.size() == 1 && isError(args[0])) return std::move(args[0]);
+
+    // 命中缓存时已知被调函数的种类, 跳过类型判断和 quickening 分派
+    if (cached) {
+        if (builtin) {
+            return static_cast<object::Builtin*>(function.get())->fn_(args);
+        }
+        return callFunction(std::static_pointer_cast<object::Function>(function.AsObject()), args);
     }
-    return nullptr;
+
+    bool isFunction = function.Type() == object::Object::ObjectType::FUNCTION_OBJ;
+    switch (call->quick_) {
+    case ast::Quickening::FUNCTION:
+        if (isFunction) {
+            return callFunction(std::static_pointer_cast<object::Function>(function.AsObject()), args);
+        }
+        call->quick_ = ast::Quickening::GENERIC;
+        break;
+    case ast::Quickening::UNSEEN:
+        call->quick_ = isFunction ? ast::Quickening::FUNCTION : ast::Quickening::GENERIC;
+        break;
+    default:
+        break;
+    }
+    return applyFunction(function, args);
 }
 
-std::shared_ptr<object::Object> Evaluator::evalIndexExpression(std::shared_ptr<object::Object>  &left,
-                                                               const std::shared_ptr<object::Object> &index)
+object::Value Evaluator::evalIndexExpression(const object::Value &left,
+                                             const object::Value &index)
 {
-    if (left->Type() == object::Object::ObjectType::ARRAY_OBJ &&
-        index->Type() == object::Object::ObjectType::INTEGER_OBJ) {
+    if (left.Type() == object::Object::ObjectType::ARRAY_OBJ && index.IsInteger()) {
         return evalArrayIndexExpression(left, index);
     }
-    else if (left->Type() == object::Object::ObjectType::HASH_OBJ) {
-        evalHashIndexExpression(left, index);
+    else if (left.Type() == object::Object::ObjectType::HASH_OBJ) {
+        return evalHashIndexExpression(left, index);
     }
-    else {
-        return newError("index operator not supported: %s", left->Type());
-    }
-    return newError("index operator not supported: %s", left->Type());
+    return newError("index operator not supported: %s", dragon::object::GetTypeString(left.Type()).c_str());
 }
 
-std::shared_ptr<object::Object> Evaluator::evalArrayIndexExpression(const std::shared_ptr<object::Object> &array,
-                                                                        const std::shared_ptr<object::Object> &index)
+object::Value Evaluator::evalArrayIndexExpression(const object::Value &array,
+                                                  const object::Value &index)
 {
-    auto arrayObject = std::dynamic_pointer_cast<object::Array>(array);
-    auto idx = std::dynamic_pointer_cast<object::Integer>(index);
-    auto m = arrayObject->elements_.size();
-    decltype(m) i = idx->Value;
-    if (i < 0 || i > m) {
-        return nullptr;
+    auto arrayObject = static_cast<object::Array*>(array.get());
+    auto i = index.AsInteger();
+    auto max = static_cast<int64_t>(arrayObject->elements_.size()) - 1;
+    if (i < 0 || i > max) {
+        return object::Value::Nil();
     }
 
     return arrayObject->elements_[i];
 }
 
-std::shared_ptr<object::Object> Evaluator::evalHashIndexExpression(const std::shared_ptr<object::Object> &hash,
-                                                                       const std::shared_ptr<object::Object> &index)
+object::Value Evaluator::evalHashIndexExpression(const object::Value &hash,
+                                                 const object::Value &index)
 {
-    auto hashObject = std::dynamic_pointer_cast<object::Hash>(hash);
-    if (!hashObject) {
-        return nullptr;
-    }
+    auto hashObject = static_cast<object::Hash*>(hash.get());
 
-    auto key = std::dynamic_pointer_cast<object::Hashable>(index);
-    if (!key) {
-        return newError("unusable as hash key: %d", index->Type());
+    uint64_t code = 0;
+    if (!object::HashCodeOf(index, code)) {
+        return newError("unusable as hash key: %s", dragon::object::GetTypeString(index.Type()).c_str());
     }
-    auto hashKey = key->Hashkey();
-    auto pair = hashObject->pairs_[hashKey].value_;
-    return pair;
+    auto pair = hashObject->pairs_.find(code, index);
+    if (!pair) {
+        return object::Value::Nil();
+    }
+    return pair->value_;
 }
 
-std::shared_ptr<object::Object> Evaluator::evalProgram(const std::shared_ptr<ast::Program>& program,
-                                             const std::shared_ptr<Environment>& env) {
-    std::shared_ptr<object::Object> result;
+object::Value Evaluator::evalProgram(const ast::Program* program,
+                                     const std::shared_ptr<Environment>& env) {
+    object::Value result;
     
     for (const auto& statement : program->statements_) {
         result = eval(statement, env);
         
-        if (auto returnValue = std::dynamic_pointer_cast<object::ReturnValue>(result)) {
-            return returnValue->value_;
-        }
-        if (auto error = std::dynamic_pointer_cast<object::Error>(result)) {
-            return error;
+        if (result.IsAbrupt()) {
+            return unwrapReturnValue(std::move(result));
         }
     }
     
     return result;
 }
 
-std::shared_ptr<object::Object> Evaluator::evalBlockStatement(const std::shared_ptr<ast::BlockStatement>& block,
-                                                    const std::shared_ptr<Environment>& env) {
-    std::shared_ptr<object::Object> result;
+object::Value Evaluator::evalBlockStatement(const ast::BlockStatement* block,
+                                            const std::shared_ptr<Environment>& env) {
+    object::Value result;
     
     for (const auto& statement : block->statements_) {
         result = eval(statement, env);
         
-        if (result) {
-            auto rt = result->Type();
-            if (rt == object::Object::ObjectType::RETURN_VALUE_OBJ || rt == object::Object::ObjectType::ERROR_OBJ) {
-                return result;
-            }
+        if (result.IsAbrupt()) {
+            return result;
         }
     }
     
     return result;
 }
 
-std::shared_ptr<object::Object> Evaluator::evalPrefixExpression(const std::string& op,
-                                                      const std::shared_ptr<object::Object>& right) {
-    if (op == "!") {
-        if (right->Type() == object::Object::ObjectType::NULL_OBJ) {
-            return std::make_shared<object::Boolean>(true);
-        } else if (right->Type() == object::Object::ObjectType::BOOLEAN_OBJ) {
-            auto* o = dynamic_cast<object::Boolean*>(right.get());
-            if (o->Value == true) return std::make_shared<object::Boolean>(false);
-            if (o->Value == false) return std::make_shared<object::Boolean>(true);
+object::Value Evaluator::evalPrefixExpression(ast::Operator op,
+                                              const object::Value& right) {
+    switch (op) {
+    case ast::Operator::BANG:
+        if (right.IsNil()) {
+            return object::Value::Bool(true);
+        } else if (right.IsBoolean()) {
+            return object::Value::Bool(!right.AsBoolean());
         }
-        return FALSE_OBJ;
-    }
-    if (op == "-") {
-        if (right->Type() != object::Object::ObjectType::INTEGER_OBJ) {
-            return newError("unknown operator: -%s", dragon::object::GetTypeString(right->Type()).c_str());
+        return object::Value::Bool(false);
+    case ast::Operator::MINUS:
+        if (!right.IsInteger()) {
+            return newError("unknown operator: -%s", dragon::object::GetTypeString(right.Type()).c_str());
         }
-        auto value = std::dynamic_pointer_cast<object::Integer>(right)->Value;
-        return std::make_shared<object::Integer>(-value);
+        return object::Value::Int(wrappingNeg(right.AsInteger()));
+    default:
+        break;
     }
-    
-    return newError("unknown operator: %s%s", op.c_str(), dragon::object::GetTypeString(right->Type()).c_str());
+
+    return newError("unknown operator: %s%s", ast::OperatorName(op),
+                    dragon::object::GetTypeString(right.Type()).c_str());
 }
 
-std::shared_ptr<object::Object> Evaluator::evalInfixExpression(const std::string& op,
-                                                     const std::shared_ptr<object::Object>& left,
-                                                     const std::shared_ptr<object::Object>& right) {
-    if (left->Type() == object::Object::ObjectType::INTEGER_OBJ &&
-        right->Type() == object::Object::ObjectType::INTEGER_OBJ) {
-        return evalIntegerInfixExpression(op, left, right);
+object::Value Evaluator::evalInfixExpression(ast::Operator op,
+                                             const object::Value& left,
+                                             const object::Value& right) {
+    if (left.IsInteger() && right.IsInteger()) {
+        return evalIntegerInfixExpression(op, left.AsInteger(), right.AsInteger());
+    }
+    if (left.IsBoolean() && right.IsBoolean()) {
+        if (auto kernel = kBooleanKernels[opIndex(op)]) {
+            return kernel(left.AsBoolean(), right.AsBoolean());
+        }
+        return unknownInfixOperator(op, left, right);
     }
-    if (left->Type() == object::Object::ObjectType::STRING_OBJ &&
-        right->Type() == object::Object::ObjectType::STRING_OBJ)
+    if (left.Type() == object::Object::ObjectType::STRING_OBJ &&
+        right.Type() == object::Object::ObjectType::STRING_OBJ)
     {
         return evalStringInfixExpression(op, left, right);
     }
-    
-    if (op == "==") {
-        auto b = TRUE_OBJ;
-        if (*(static_cast<object::Boolean*>((left.get()))) == *(static_cast<object::Boolean*>((right.get())))) {
-            b = TRUE_OBJ;
-        }
-        else {
-            b = FALSE_OBJ;
-        }
-        return b;
+
+    if (op == ast::Operator::EQ) {
+        return object::Value::Bool(isEqual(left, right));
     }
-    if (op == "!=") {
-        auto b = TRUE_OBJ;
-        if (*(static_cast<object::Boolean*>((left.get()))) != *(static_cast<object::Boolean*>((right.get())))) {
-            b = TRUE_OBJ;
-        }
-        else {
-            b = FALSE_OBJ;
-        }
-        return b;
+    if (op == ast::Operator::NOT_EQ) {
+        return object::Value::Bool(!isEqual(left, right));
     }
-    
-    if (left->Type() != right->Type()) {
+
+    if (left.Type() != right.Type()) {
         return newError("type mismatch: %s %s %s",
-                        dragon::object::GetTypeString( left->Type()).c_str(), op.c_str(),
-                        dragon::object::GetTypeString(right->Type()).c_str());
+                        dragon::object::GetTypeString( left.Type()).c_str(), ast::OperatorName(op),
+                        dragon::object::GetTypeString(right.Type()).c_str());
     }
-    
-    return newError("unknown operator: %s %s %s",
-                    dragon::object::GetTypeString(left->Type()).c_str(), op.c_str(),
-                    dragon::object::GetTypeString(right->Type()).c_str());
+
+    return unknownInfixOperator(op, left, right);
 }
 
-std::shared_ptr<object::Object> Evaluator::evalIntegerInfixExpression(const std::string& op,
-                                                            const std::shared_ptr<object::Object>& left,
-                                                            const std::shared_ptr<object::Object>& right) {
-    auto leftVal = std::dynamic_pointer_cast<object::Integer>(left)->Value;
-    auto rightVal = std::dynamic_pointer_cast<object::Integer>(right)->Value;
-    
-    if (op == "+") return std::make_shared<object::Integer>(leftVal + rightVal);
-    if (op == "-") return std::make_shared<object::Integer>(leftVal - rightVal);
-    if (op == "*") return std::make_shared<object::Integer>(leftVal * rightVal);
-    if (op == "/") return std::make_shared<object::Integer>(leftVal / rightVal);
-    if (op == "<") return leftVal < rightVal ? TRUE_OBJ : FALSE_OBJ;
-    if (op == ">") return leftVal > rightVal ? TRUE_OBJ : FALSE_OBJ;
-    if (op == "==") return leftVal == rightVal ? TRUE_OBJ : FALSE_OBJ;
-    if (op == "!=") return leftVal != rightVal ? TRUE_OBJ : FALSE_OBJ;
-    
-    return newError("unknown operator: %s %s %s",
-                    dragon::object::GetTypeString(left->Type()).c_str(), op.c_str(), dragon::object::GetTypeString(right->Type()).c_str());
+object::Value Evaluator::evalIntegerInfixExpression(ast::Operator op, int64_t leftVal, int64_t rightVal) {
+    if (auto kernel = kIntegerKernels[opIndex(op)]) {
+        return kernel(leftVal, rightVal);
+    }
+    return newError("unknown operator: INTEGER %s INTEGER", ast::OperatorName(op));
 }
 
-std::shared_ptr<object::Object> Evaluator::evalStringInfixExpression(const string & oper,
-                                                                         const std::shared_ptr<object::Object> &left,
-                                                                         const std::shared_ptr<object::Object> &right)
+object::Value Evaluator::evalStringInfixExpression(ast::Operator op,
+                                                   const object::Value &left,
+                                                   const object::Value &right)
 {
-    // ʱַֻ֧ + 
-    if (oper != "+") {
-        return newError("unknown operator: %d %s %d",
-                        left->Type(), oper.c_str(), right->Type());
+    if (auto kernel = kStringKernels[opIndex(op)]) {
+        return kernel(left, right);
     }
-
-    auto leftValue = std::dynamic_pointer_cast<object::String>(left);
-    auto rightValue = std::dynamic_pointer_cast<object::String>(right);
-
-    return std::make_shared<object::String>(leftValue->Value + rightValue->Value);
+    return unknownInfixOperator(op, left, right);
 }
 
-std::shared_ptr<object::Object> Evaluator::evalIfExpression(const std::shared_ptr<ast::IfExpression>& ie,
+object::Value Evaluator::evalIfExpression(const ast::IfExpression* ie,
                                                   const std::shared_ptr<Environment>& env) {
     auto condition = eval(ie->condition_, env);
     if (isError(condition)) return condition;
@@ -306,123 +468,264 @@ std::shared_ptr<object::Object> Evaluator::evalIfExpression(const std::shared_pt
     } else if (ie->alternative_) {
         return eval(ie->alternative_, env);
     } else {
-        return NULL_OBJ_INS;
+        return object::Value::Nil();
     }
 }
 
-std::shared_ptr<object::Object> Evaluator::evalHashLiteral(const std::shared_ptr<ast::HashLiteral>& hashliteral,
+object::Value Evaluator::evalHashLiteral(const ast::HashLiteral* hashliteral,
                                                            const std::shared_ptr<Environment>& env)
 {
-    std::map<object::HashKey, object::HashPair> pairs_;
-    // std::map<std::shared_ptr<Expression>, std::shared_ptr<Expression>> pairs_;
-    for (const auto & pair : hashliteral->pairs_) {
-        auto key = eval(pair.first, env);
-        if (isError(key)) {
-            return key;
-        }
+    const auto &pairs = hashliteral->pairs_;
+    return evalHashPairs(pairs.size(),
+                         [&](size_t i) { return eval(pairs[i].first, env); },
+                         [&](size_t i) { return eval(pairs[i].second, env); });
+}
 
-        auto keyType = std::dynamic_pointer_cast<object::Hashable>(key);
-        if (!keyType) {
-            return newError("unusable as hash key: %s", key->Type());
+object::Value Evaluator::makeArray(std::vector<object::Value> elements) {
+    auto arr = std::make_shared<object::Array>(std::move(elements));
+    for (const auto &e : arr->elements_) {
+        if (e.IsCollectable()) {
+            gc::Heap::Instance().track(arr);
+            break;
         }
+    }
+    return arr;
+}
 
-        auto value = eval(pair.second, env);
-        if (isError(value)) {
-            return value;
+object::Value Evaluator::makeHash(object::HashTable pairs) {
+    auto hash = std::make_shared<object::Hash>(std::move(pairs));
+    for (const auto &pair : hash->pairs_) {
+        if (pair.value_.IsCollectable()) {
+            gc::Heap::Instance().track(hash);
+            break;
         }
-
-        auto hashed = keyType->Hashkey();
-        pairs_[hashed] = object::HashPair{key, value};
     }
-    return std::make_shared<object::Hash>(pairs_);
+    return hash;
+}
+
+std::shared_ptr<object::Error> Evaluator::unusableHashKey(const object::Value& key) {
+    return newError("unusable as hash key: %s", dragon::object::GetTypeString(key.Type()).c_str());
 }
 
-std::shared_ptr<object::Object> Evaluator::evalIdentifier(const std::shared_ptr<ast::Identifier>& node,
+object::Value Evaluator::evalIdentifier(const ast::Identifier* node,
                                                 const std::shared_ptr<Environment>& env) {
-    auto val = env->get(node->value_);
+    return lookupIdentifier(node->scope_, node->depth_, node->slot_, node->value_, env);
+}
+
+object::Value Evaluator::lookupIdentifier(ast::Identifier::Scope scope, int depth, int slot,
+                                          const std::string& name, const std::shared_ptr<Environment>& env) {
+    // 快速路径: 按 resolver 给出的地址直接取槽位
+    switch (scope) {
+    case ast::Identifier::Scope::LOCAL: {
+        auto &val = env->getLocal(depth, slot);
+        if (val) {
+            return val;
+        }
+        break;
+    }
+    case ast::Identifier::Scope::GLOBAL: {
+        auto &val = env->getGlobal(slot);
+        if (val) {
+            return val;
+        }
+        break;
+    }
+    case ast::Identifier::Scope::BUILTIN:
+        return GetBuiltInFunc(slot);
+    case ast::Identifier::Scope::UNRESOLVED:
+        break;
+    }
+
+    // 槽位尚未赋值 (如引用外层同名变量后才定义) 时按名字逐层查找
+    return lookupName(name, env);
+}
+
+object::Value Evaluator::lookupName(const std::string& name, const std::shared_ptr<Environment>& env) {
+    auto val = env->get(name);
     if (val.first) {
         return val.first;
     }
 
-    auto b = FindBuiltInFunc(node->value_);
+    auto b = FindBuiltInFunc(name);
     if (b != nullptr) {
         return  b;
     }
-    // ȷǷ
-    return newError(string("identifier not found: " + node->value_).c_str());
+    return newError("identifier not found: %s", name.c_str());
 }
 
-std::vector<std::shared_ptr<object::Object>> Evaluator::evalExpressions(
-    const std::vector<std::shared_ptr<ast::Expression>>& exps,
+std::vector<object::Value> Evaluator::evalExpressions(
+    const std::vector<ast::Expression*>& exps,
     const std::shared_ptr<Environment>& env) {
-    std::vector<std::shared_ptr<object::Object>> result;
+    std::vector<object::Value> result;
+    result.reserve(exps.size());
     
     for (const auto& e : exps) {
         auto evaluated = eval(e, env);
         if (isError(evaluated)) {
             return {evaluated};
         }
-        result.push_back(evaluated);
+        result.push_back(std::move(evaluated));
     }
     
     return result;
 }
 
-std::shared_ptr<object::Object> Evaluator::applyFunction(const std::shared_ptr<object::Object>& fn,
-                                               const std::vector<std::shared_ptr<object::Object>>& args) {
-    auto function = std::dynamic_pointer_cast<object::Function>(fn);
+object::Value Evaluator::applyFunction(const object::Value& fn,
+                                       const std::vector<object::Value>& args) {
+    if (fn.Type() == object::Object::ObjectType::BUILTIN_OBJ) { // 判断是不是内置的函数
+        return static_cast<object::Builtin*>(fn.get())->fn_(args);
+    }
+    if (fn.Type() == object::Object::ObjectType::NATIVE_FUNCTION_OBJ) {
+        return static_cast<const object::NativeFunction*>(fn.get())->call(args);
+    }
+    if (fn.Type() != object::Object::ObjectType::FUNCTION_OBJ) {
+        return newError("not a function: %s",dragon::object::GetTypeString(fn.Type()).c_str() );
+    }
+    return callFunction(std::static_pointer_cast<object::Function>(fn.AsObject()), args);
+}
+
+object::Value Evaluator::callFunction(std::shared_ptr<object::Function> function,
+                                      const std::vector<object::Value>& args) {
+    auto isFunction = [](const object::Value& fn) {
+        return fn.Type() == object::Object::ObjectType::FUNCTION_OBJ;
+    };
+    return trampoline(std::move(function), args, isFunction,
+                      [](const std::shared_ptr<object::Function>& fn, const std::vector<object::Value>& args,
+                         TailCall& tail) -> object::Value {
+                          object::Value jitted;
+                          if (jit::TryCall(*fn, args, jitted)) {
+                              return jitted;
+                          }
+                          return evalTail(fn->body_, extendFunctionEnv(fn, args), tail, true);
+                      });
+}
+
+object::Value Evaluator::evalTail(const ast::Node* node,
+                                  const std::shared_ptr<Environment>& env,
+                                  TailCall& tail, bool result) {
+    if (!node) {
+        return nullptr;
+    }
+
+    switch (node->Kind()) {
+    case ast::NodeKind::BLOCK_STATEMENT: {
+        auto block = static_cast<const ast::BlockStatement*>(node);
+        object::Value val;
+        size_t n = block->statements_.size();
+        for (size_t i = 0; i < n; ++i) {
+            // 只有最后一条语句的值是块的值; 之前的语句中只有 return 处于尾位置
+            val = evalTail(block->statements_[i], env, tail, result && i + 1 == n);
+            if (tail.pending) {
+                return nullptr;
+            }
+            if (val.IsAbrupt()) {
+                return val;
+            }
+        }
+        return val;
+    }
+
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return evalTail(static_cast<const ast::ExpressionStatement*>(node)->expression_, env, tail, result);
 
-    if (function) {
-        auto extendedEnv = extendFunctionEnv(function, args);
-        auto evaluated = eval(function->body_, extendedEnv);
-        return unwrapReturnValue(evaluated);
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto ret = static_cast<const ast::ReturnStatement*>(node);
+        auto val = evalTail(ret->returnValue_, env, tail, true);
+        if (tail.pending) return val;
+        return object::Value::Return(std::move(val));
     }
-    else { // жǲõĺ
-        auto builtin = std::dynamic_pointer_cast<object::Builtin>(fn);
-        return builtin->fn_(args);
+
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto ie = static_cast<const ast::IfExpression*>(node);
+        auto condition = eval(ie->condition_, env);
+        if (isError(condition)) return condition;
+
+        if (isTruthy(condition)) {
+            return evalTail(ie->consequence_, env, tail, result);
+        } else if (ie->alternative_) {
+            return evalTail(ie->alternative_, env, tail, result);
+        }
+        return object::Value::Nil();
     }
 
-    return newError("not a function: %s",dragon::object::GetTypeString(fn->Type()).c_str() );
+    case ast::NodeKind::CALL_EXPRESSION: {
+        if (!result) {
+            break;
+        }
+        auto call = static_cast<const ast::CallExpression*>(node);
+        bool cached = false;
+        auto function = evalCallee(call, env, cached);
+        if (isError(function)) return function;
+
+        auto args = evalExpressions(call->arguments_, env);
+        if (args.size() == 1 && isError(args[0])) return std::move(args[0]);
+
+        tail.pending = true;
+        tail.fn = std::move(function);
+        tail.args = std::move(args);
+        return nullptr;
+    }
+
+    default:
+        break;
+    }
+    return eval(node, env);
 }
 
 std::shared_ptr<Environment> Evaluator::extendFunctionEnv(
     const std::shared_ptr<object::Function>& fn,
-    const std::vector<std::shared_ptr<object::Object>>& args) {
-    auto env = Environment::newEnclosedEnvironment(fn->env_);
-    
+    const std::vector<object::Value>& args) {
+    auto locals = fn->locals_;
+    if (!locals) {
+        // 未经 resolver 处理的函数, 只为参数分配槽位
+        auto names = std::make_shared<Environment::Names>();
+        for (const auto &p : fn->parameters_) {
+            names->push_back(p->value_);
+        }
+        locals = names;
+    }
+    auto env = Environment::newEnclosedEnvironment(fn->env_, locals);
+
     for (size_t i = 0; i < fn->parameters_.size(); ++i) {
-        env->set(fn->parameters_[i]->value_, args[i]); //
+        const auto &param = fn->parameters_[i];
+        if (param->scope_ == ast::Identifier::Scope::LOCAL) {
+            env->setLocal(param->slot_, args[i]);
+        } else {
+            env->set(param->value_, args[i]);
+        }
     }
-    
+
     return env;
 }
 
-std::shared_ptr<object::Object> Evaluator::unwrapReturnValue(const std::shared_ptr<object::Object>& obj) {
-    if (auto returnValue = std::dynamic_pointer_cast<object::ReturnValue>(obj)) {
-        return returnValue->value_;
+bool Evaluator::isTruthy(const object::Value& obj) {
+    // 只有 null 和 false 为假
+    switch (obj.tag()) {
+    case object::Value::Tag::NIL:
+        return false;
+    case object::Value::Tag::BOOLEAN:
+        return obj.AsBoolean();
+    default:
+        return true;
     }
-    return obj;
 }
 
-bool Evaluator::isTruthy(const std::shared_ptr<object::Object>& obj) {
-    // ͨ type ж
-    if (obj->Type() == dragon::object::Object::ObjectType::NULL_OBJ) {
+bool Evaluator::isEqual(const object::Value& left, const object::Value& right) {
+    if (left.tag() != right.tag()) {
         return false;
-    } else if (obj->Type() == dragon::object::Object::ObjectType::BOOLEAN_OBJ) {
-        auto* b = dynamic_cast<object::Boolean*>(obj.get());
-        if (b->Value == true) {
-            return true;
-        } else
-        {
-            return false;
-        }
     }
-
-    return false;
-}
-
-bool Evaluator::isError(const std::shared_ptr<object::Object>& obj) {
-    return obj && obj->Type() == object::Object::ObjectType::ERROR_OBJ;
+    switch (left.tag()) {
+    case object::Value::Tag::INTEGER:
+        return left.AsInteger() == right.AsInteger();
+    case object::Value::Tag::BOOLEAN:
+        return left.AsBoolean() == right.AsBoolean();
+    case object::Value::Tag::NONE:
+    case object::Value::Tag::NIL:
+        return true;
+    case object::Value::Tag::OBJECT:
+        break;
+    }
+    return left.get() == right.get();
 }
 
 std::shared_ptr<object::Error> Evaluator::newError(const char* format, ...) {
@@ -6,69 +6,190 @@
 #include "environment.hpp"
 #include "function.h"
 #include <memory>
+#include <string>
 #include <vector>
 
-#define NULL_OBJ_INS  std::make_shared<object::Null>()
 namespace dragon {
 namespace evaluator {
 class Evaluator {
 public:
+    // 对外入口, 结果装箱为 Object
     static std::shared_ptr<object::Object> eval(const std::shared_ptr<ast::Node>& node, 
                                       const std::shared_ptr<Environment>& env);
+    static object::Value eval(const ast::Node* node,
+                                      const std::shared_ptr<Environment>& env);
 
 public:
-    static std::shared_ptr<object::Object> evalProgram(const std::shared_ptr<ast::Program>& program,
+    static object::Value evalProgram(const ast::Program* program,
                                              const std::shared_ptr<Environment>& env);
     
-    static std::shared_ptr<object::Object> evalBlockStatement(const std::shared_ptr<ast::BlockStatement>& block,
+    static object::Value evalBlockStatement(const ast::BlockStatement* block,
                                                     const std::shared_ptr<Environment>& env);
     
-    static std::shared_ptr<object::Object> evalPrefixExpression(const std::string& op,
-                                                      const std::shared_ptr<object::Object>& right);
+    static object::Value evalPrefixExpression(ast::Operator op,
+                                                      const object::Value& right);
     
-    static std::shared_ptr<object::Object> evalInfixExpression(const std::string& op,
-                                                     const std::shared_ptr<object::Object>& left,
-                                                     const std::shared_ptr<object::Object>& right);
+    static object::Value evalInfixExpression(ast::Operator op,
+                                                     const object::Value& left,
+                                                     const object::Value& right);
     
-    static std::shared_ptr<object::Object> evalIntegerInfixExpression(const std::string& op,
-                                                            const std::shared_ptr<object::Object>& left,
-                                                            const std::shared_ptr<object::Object>& right);
-    static std::shared_ptr<object::Object> evalStringInfixExpression(const string & oper,
-                                                                     const std::shared_ptr<object::Object> &left,
-                                                                     const std::shared_ptr<object::Object> &right);
-    static std::shared_ptr<object::Object> evalIfExpression(const std::shared_ptr<ast::IfExpression>& ie,
+    static object::Value evalIntegerInfixExpression(ast::Operator op, int64_t left, int64_t right);
+    // 整数加减乘和取负按 64 位补码回绕: 经 uint64_t 计算, 避免有符号溢出的未定义行为
+    static int64_t wrappingAdd(int64_t l, int64_t r) {
+        return static_cast<int64_t>(static_cast<uint64_t>(l) + static_cast<uint64_t>(r));
+    }
+    static int64_t wrappingSub(int64_t l, int64_t r) {
+        return static_cast<int64_t>(static_cast<uint64_t>(l) - static_cast<uint64_t>(r));
+    }
+    static int64_t wrappingMul(int64_t l, int64_t r) {
+        return static_cast<int64_t>(static_cast<uint64_t>(l) * static_cast<uint64_t>(r));
+    }
+    static int64_t wrappingNeg(int64_t x) { return wrappingSub(0, x); }
+    static object::Value evalStringInfixExpression(ast::Operator op,
+                                                                     const object::Value &left,
+                                                                     const object::Value &right);
+    // 中缀, 下标和调用节点的求值, 按节点上记录的 quickening 状态特化
+    static object::Value evalInfixNode(const ast::InfixExpression* infix,
+                                       const std::shared_ptr<Environment>& env);
+    static object::Value evalIndexNode(const ast::IndexExpression* index,
+                                       const std::shared_ptr<Environment>& env);
+    static object::Value evalCallNode(const ast::CallExpression* call,
+                                      const std::shared_ptr<Environment>& env);
+    // 求值被调函数, 全局变量形式的被调函数经过调用点的内联缓存; 命中时 cached 为 true, 且值的种类与 call->cache_ 一致
+    static object::Value evalCallee(const ast::CallExpression* call,
+                                    const std::shared_ptr<Environment>& env, bool& cached);
+    static object::Value evalIfExpression(const ast::IfExpression* ie,
                                                   const std::shared_ptr<Environment>& env);
     
-    static std::shared_ptr<object::Object> evalIdentifier(const std::shared_ptr<ast::Identifier>& node,
+    static object::Value evalIdentifier(const ast::Identifier* node,
                                                 const std::shared_ptr<Environment>& env);
-    static std::shared_ptr<object::Object> evalHashLiteral(const std::shared_ptr<ast::HashLiteral>& ie,
+    static object::Value evalHashLiteral(const ast::HashLiteral* ie,
                                                            const std::shared_ptr<Environment>& env);
 
-    static std::shared_ptr<object::Object> evalArrayIndexExpression(const std::shared_ptr<object::Object> &array,
-                                                                    const std::shared_ptr<object::Object> &index);
-    static std::shared_ptr<object::Object> evalHashIndexExpression(const std::shared_ptr<object::Object> &hash,
-                                                                   const std::shared_ptr<object::Object> &index);
-    static std::shared_ptr<object::Object> evalIndexExpression(std::shared_ptr<object::Object>  &obj,
-                                                                   const std::shared_ptr<object::Object>&node);
+    static object::Value evalArrayIndexExpression(const object::Value &array,
+                                                                    const object::Value &index);
+    static object::Value evalHashIndexExpression(const object::Value &hash,
+                                                                   const object::Value &index);
+    static object::Value evalIndexExpression(const object::Value &left,
+                                             const object::Value &index);
 
 
-    static std::vector<std::shared_ptr<object::Object>> evalExpressions(
-        const std::vector<std::shared_ptr<ast::Expression>>& exps,
+    static std::vector<object::Value> evalExpressions(
+        const std::vector<ast::Expression*>& exps,
         const std::shared_ptr<Environment>& env);
 
-    static std::shared_ptr<object::Object> applyFunction(const std::shared_ptr<object::Object>& fn,
-                                               const std::vector<std::shared_ptr<object::Object>>& args);
+    // 按 resolver 给出的地址取值, 槽位尚未赋值或未解析时按名字查找
+    static object::Value lookupIdentifier(ast::Identifier::Scope scope, int depth, int slot,
+                                          const std::string& name, const std::shared_ptr<Environment>& env);
+    // 按名字逐层查找变量, 再查内置函数, 都没有时报错
+    static object::Value lookupName(const std::string& name, const std::shared_ptr<Environment>& env);
+
+    // 创建数组/哈希: 容器不可变, 只有创建时就含有函数/容器的才可能成环, 登记到 gc::Heap
+    static object::Value makeArray(std::vector<object::Value> elements);
+    static object::Value makeHash(object::HashTable pairs);
+    static std::shared_ptr<object::Error> unusableHashKey(const object::Value& key);
+    // 求值 n 对键值并创建哈希; evalKey(i)/evalValue(i) 求第 i 对的键和值, 出错时返回该错误
+    template <typename EvalKey, typename EvalValue>
+    static object::Value evalHashPairs(size_t n, const EvalKey& evalKey, const EvalValue& evalValue);
+
+    // 闭包持有定义环境, 环境又可能持有闭包, 两者都登记到 gc::Heap
+    template <typename F>
+    static object::Value makeFunction(std::shared_ptr<F> fn, const std::shared_ptr<Environment>& env) {
+        Environment::track(env);
+        gc::Heap::Instance().track(fn);
+        return fn;
+    }
+
+    static object::Value applyFunction(const object::Value& fn,
+                                               const std::vector<object::Value>& args);
+    // 已知 fn 是 object::Function 时的调用
+    static object::Value callFunction(std::shared_ptr<object::Function> fn,
+                                      const std::vector<object::Value>& args);
+
+    // 尾位置上的调用不在当前 C++ 栈帧中执行, 而是记录到 TailCall 中, 由 trampoline 循环执行
+    struct TailCall {
+        bool pending = false;
+        object::Value fn;
+        std::vector<object::Value> args;
+    };
+    // 蹦床: 函数体以尾调用结束时, 换成被调函数继续循环, C++ 栈不再增长.
+    // run(fn, args, tail) 执行 fn 的函数体; 尾调用的目标不满足 accepts 时交给 applyFunction
+    template <typename F, typename Accepts, typename Run>
+    static object::Value trampoline(std::shared_ptr<F> function, const std::vector<object::Value>& args,
+                                    const Accepts& accepts, const Run& run);
+    // 求值函数体中的节点; result 表示该节点的值是否就是函数的返回值.
+    // 记录了尾调用时返回空值, 调用方需检查 tail.pending
+    static object::Value evalTail(const ast::Node* node,
+                                  const std::shared_ptr<Environment>& env,
+                                  TailCall& tail, bool result);
     
     static std::shared_ptr<Environment> extendFunctionEnv(
         const std::shared_ptr<object::Function>& fn,
-        const std::vector<std::shared_ptr<object::Object>>& args);
+        const std::vector<object::Value>& args);
     
-    static std::shared_ptr<object::Object> unwrapReturnValue(const std::shared_ptr<object::Object>& obj);
+    // 函数或程序的边界上去掉 return 信号
+    static object::Value unwrapReturnValue(object::Value obj) {
+        obj.ClearReturn();
+        return obj;
+    }
     
-    static bool isTruthy(const std::shared_ptr<object::Object>& obj);
-    static bool isError(const std::shared_ptr<object::Object>& obj);
+    static bool isTruthy(const object::Value& obj);
+    static bool isEqual(const object::Value& left, const object::Value& right);
+    static bool isError(const object::Value& obj) { return obj.IsError(); }
     static std::shared_ptr<object::Error> newError(const char* format, ...);
 };
+
+template <typename EvalKey, typename EvalValue>
+object::Value Evaluator::evalHashPairs(size_t n, const EvalKey& evalKey, const EvalValue& evalValue) {
+    object::HashTable pairs;
+    pairs.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto key = evalKey(i);
+        if (isError(key)) {
+            return key;
+        }
+
+        uint64_t code = 0;
+        if (!object::HashCodeOf(key, code)) {
+            return unusableHashKey(key);
+        }
+
+        auto value = evalValue(i);
+        if (isError(value)) {
+            return value;
+        }
+
+        pairs.set(code, std::move(key), std::move(value));
+    }
+    return makeHash(std::move(pairs));
+}
+
+template <typename F, typename Accepts, typename Run>
+object::Value Evaluator::trampoline(std::shared_ptr<F> function, const std::vector<object::Value>& args,
+                                    const Accepts& accepts, const Run& run) {
+    const std::vector<object::Value> *callArgs = &args;
+    std::vector<object::Value> pendingArgs;
+    TailCall tail;
+    for (;;) {
+        if (function->parameters_.size() != callArgs->size()) {
+            return newError("wrong number of arguments: want=%d, got=%d",
+                            static_cast<int>(function->parameters_.size()), static_cast<int>(callArgs->size()));
+        }
+        auto evaluated = run(function, *callArgs, tail);
+        if (!tail.pending) {
+            return unwrapReturnValue(std::move(evaluated));
+        }
+
+        tail.pending = false;
+        if (!accepts(tail.fn)) {
+            return applyFunction(tail.fn, tail.args);
+        }
+        function = std::static_pointer_cast<F>(tail.fn.AsObject());
+        tail.fn.reset();
+        pendingArgs.swap(tail.args);
+        callArgs = &pendingArgs;
+    }
+}
 } // namespace evaluator
 } // namespace dragon
 
@@ -1,18 +1,57 @@
 #include "evaluator_test.h"
+#include "closure_compiler.h"
 #include "lexer.h"
 #include "object.h"
 #include "parser.h"
 #include "evaluator.h"
+#include "flat_evaluator.h"
+#include "folder.h"
+#include "resolver.h"
+#include "stack_evaluator.h"
 
 #include "test_tool.h"
 
-std::shared_ptr<dragon::object::Object> testEval(const std::string& input)
+#include <algorithm>
+#include <limits>
+
+namespace {
+// 执行引擎的入口: 在给定的全局环境中求值整个程序
+using Engine = std::shared_ptr<dragon::object::Object> (*)(const std::shared_ptr<ast::Program>&,
+                                                            const std::shared_ptr<dragon::Environment>&);
+
+// 每个输入在新的全局环境中求值
+EvalFunc makeEval(Engine engine)
 {
-    lexer::Lexer lexer(input);
-    parser::Parser parser(lexer);
-    auto program = parser.parseProgram();
-    auto env = std::make_shared<dragon::Environment>();
+    return [engine](const std::string& input) {
+        lexer::Lexer lexer(input);
+        parser::Parser parser(lexer);
+        return engine(parser.parseProgram(), std::make_shared<dragon::Environment>());
+    };
+}
+
+const EvalFunc evaluatorEval = makeEval([](const std::shared_ptr<ast::Program>& program,
+                                           const std::shared_ptr<dragon::Environment>& env) {
     return dragon::evaluator::Evaluator::eval(program, env);
+});
+const EvalFunc flatEval = makeEval(dragon::evaluator::FlatEvaluator::eval);
+const EvalFunc closureEval = makeEval(dragon::evaluator::ClosureCompiler::eval);
+const EvalFunc stackEval = makeEval(dragon::evaluator::StackEvaluator::eval);
+
+EvalFunc currentEval = evaluatorEval;
+
+// 以 eval 作为 testEval 的执行引擎运行 suite, 结束后恢复
+void runEngineSuite(const EvalFunc& eval, void (*suite)())
+{
+    EvalFunc saved = currentEval;
+    currentEval = eval;
+    suite();
+    currentEval = saved;
+}
+} // namespace
+
+std::shared_ptr<dragon::object::Object> testEval(const std::string& input)
+{
+    return currentEval(input);
 }
 
 // 测试整数计算
@@ -38,6 +77,12 @@ void TestEvalIntegerExpression()
 		{"3 * 3 * 3 + 10", 37},
 		{"3 * (3 * 3) + 10", 37},
 		{"(5 + 10 * 2 + 15 / 3) * 2 + -10", 50},
+		{"let a = -9223372036854775807 - 1; a / -1 - a", 0},
+		{"let m = 9223372036854775807; m + 1 + m", -1},
+		{"let m = -9223372036854775807 - 1; m - 1 - 9223372036854775807", 0},
+		{"let m = 9223372036854775807; m * 2", -2},
+		{"let m = 4611686018427387904; m * 4", 0},
+		{"let m = -9223372036854775807 - 1; -m - m", 0},
     };
 
     for (const auto& tt : tests) {
@@ -218,6 +263,10 @@ void TestReturnStatements(TestingT& t) {
                     f(10);)",
                     20,
             },
+            // 值被使用的 if 中的 return 只产生值, 不离开函数; 其中的调用不是尾调用
+            {"let f = fn(n) { 1 + if (n > 0) { return 5; } else { 2 } }; f(1) + f(0)", 9},
+            {"let f = fn(n) { if (n < 1) { 0 } else { 2 + if (n > 0) { return f(n - 1); } else { 2 } } }; f(3)", 6},
+            {"let f = fn() { let x = if (true) { return 5; }; x + 1 }; f()", 6},
     };
 
     for (auto &tc : testcases) {
@@ -279,6 +328,18 @@ void TestErrorHandling(TestingT &t) {
                     "foobar",
                     "identifier not found: foobar",
             },
+            {
+                    "1 / 0",
+                    "division by zero",
+            },
+            {
+                    "let z = 0; 1 / z",
+                    "division by zero",
+            },
+            {
+                    "let f = fn(a, b) { a / b }; f(1, 1); f(1, 0)",
+                    "division by zero",
+            },
     };
 
     for (auto &tc: testcases) {
@@ -343,7 +404,6 @@ void TestFunctionObject(TestingT & t) {
     }
 
 
-
 }
 
 void TestFunctionApplication(TestingT& t) {
@@ -399,6 +459,23 @@ addTwo(2);)";
 
     std::shared_ptr<dragon::object::Object> evaluated = testEval(input);
     testIntegerObject(t, evaluated.get(), 4);
+
+    // 闭包按引用捕获: 可以引用之后才定义的变量, 看到之后的重新绑定; 函数内外一致
+    const std::vector<std::pair<string, string>> cases = {
+        {"let a = fn(n) { if (n == 0) { 0 } else { b(n - 1) } }; let b = fn(n) { a(n) }; a(3)", "0"},
+        {"let c = fn() { x }; let x = 7; c()", "7"},
+        {"let y = 1; let h = fn() { y }; let y = 2; h()", "2"},
+        {"let f = fn() { let a = fn(n) { if (n == 0) { 0 } else { b(n - 1) } }; let b = fn(n) { a(n) }; a(3) }; f()", "0"},
+        {"let f = fn() { let c = fn() { x }; let x = 7; c() }; f()", "7"},
+        {"let f = fn() { let y = 1; let h = fn() { y }; let y = 2; h() }; f()", "2"},
+        {"let f = fn(n) { let g = fn() { fn() { n } }; let n = n + 1; g()() }; f(1)", "2"},
+        // 尚未赋值时按名字找全局变量
+        {"let x = 5; let f = fn(c) { if (c) { let x = 1; }; x }; [f(true), f(false)]", "[1, 5]"},
+        {"let f = fn() { let c = fn() { z }; let r = c(); let z = 1; r }; f()", "ERROR: identifier not found: z"},
+    };
+    for (const auto &c : cases) {
+        ASSERT_EQ(testEval(c.first)->Inspect(), c.second);
+    }
 }
 
 void TestStringLiteral(TestingT &t) {
@@ -409,8 +486,8 @@ void TestStringLiteral(TestingT &t) {
         t.Fatalf("str should not be null");
     }
 
-    if (str->Value != "www.jesson32.cn") {
-        t.Fatalf("%s should equal %s", str->Value.c_str(), input.c_str());
+    if (str->str() != "www.jesson32.cn") {
+        t.Fatalf("%s should equal %s", str->str().c_str(), input.c_str());
     }
 }
 
@@ -427,7 +504,7 @@ void TestStringConcatenation(TestingT &t)
 
     if (!str) {
         t.Fatalf("");
-        if (str->Value != "Hello World!") {
+        if (str->str() != "Hello World!") {
             t.Fatalf("");
         }
     }
@@ -459,9 +536,231 @@ void TestBuiltinFunctions(TestingT &t) {
     testEval(input);
 
 }
-void TestEvals()
+// 哈希字面量与下标访问: 键按类型和值完整比较, 哈希值相同的不同键互不覆盖
+void TestHashes(TestingT &t)
 {
-	TestingT t;
+    struct Test {
+        std::string input;
+        std::string expected;
+    };
+    std::vector<Test> tests = {
+        {R"({"one": 1, "two": 2}["two"])", "2"},
+        {R"({"one": 1}["three"])", "null"},
+        {R"(let key = "foo"; {"foo": 5}[key])", "5"},
+        {R"({5: 5}[5])", "5"},
+        {R"({true: 5}[true])", "5"},
+        {R"({false: 5}[false])", "5"},
+        {R"({}["a"])", "null"},
+        // 拼接得到的未驻留字符串与驻留的字面量按内容比较
+        {R"({"ab": 1}["a" + "b"])", "1"},
+        {R"({"a" + "b": 1}["ab"])", "1"},
+        // 1 与 true 的 HashKey 值相同
+        {R"({1: "int", true: "bool"}[1])", "int"},
+        {R"({1: "int", true: "bool"}[true])", "bool"},
+        // times33("") == 5381
+        {R"({5381: "int", "": "str"}[5381])", "int"},
+        {R"({5381: "int", "": "str"}[""])", "str"},
+        {R"({"a": 1}[[1]])", "ERROR: unusable as hash key: ARRAY"},
+        {R"({[1]: 1})", "ERROR: unusable as hash key: ARRAY"},
+    };
+    for (const auto &tt : tests) {
+        auto evaluated = testEval(tt.input);
+        if (!evaluated || evaluated->Inspect() != tt.expected) {
+            t.Fatalf("input: %v, want=%v, got=%v", tt.input, tt.expected,
+                     evaluated ? evaluated->Inspect().c_str() : "nullptr");
+        }
+    }
+
+    // 多次扩容后所有键仍可查到
+    std::string input = "let h = {";
+    for (int i = 0; i < 1000; ++i) {
+        input += (i ? ", " : "") + std::to_string(i * 7) + ": " + std::to_string(i);
+    }
+    input += "}; h[0] + h[7 * 500] + h[7 * 999] + len([h[1], h[6993]])";
+    testIntegerObject(t, testEval(input).get(), 0 + 500 + 999 + 2);
+}
+
+// resolver 给出的地址, 以及按槽位求值时与按名字查找一致的边界情况
+void TestResolver(TestingT &t)
+{
+    string input = R"(let a = 1;
+let f = fn(x) {
+  let g = fn() { x + a + b };
+  let b = 2;
+  g()
+};
+len)";
+    lexer::Lexer l(input);
+    parser::Parser p(l);
+    auto program = p.parseProgram();
+    auto env = std::make_shared<dragon::Environment>();
+    dragon::evaluator::Resolver(*env).resolve(program.get());
+
+    auto f = static_cast<ast::LetStatement*>(program->statements_[1]);
+    ASSERT_TRUE(f->name_->scope_ == ast::Identifier::Scope::GLOBAL);
+    ASSERT_EQ(f->name_->slot_, 1);
+
+    auto fn = static_cast<ast::FunctionLiteral*>(f->value_);
+    ASSERT_EQ(fn->locals_->size(), size_t(3));   // x, g, b
+
+    auto g = static_cast<ast::LetStatement*>(fn->body_->statements_[0]);
+    auto gfn = static_cast<ast::FunctionLiteral*>(g->value_);
+    auto body = static_cast<ast::ExpressionStatement*>(gfn->body_->statements_[0]);
+    auto sum = static_cast<ast::InfixExpression*>(body->expression_);
+    auto xa = static_cast<ast::InfixExpression*>(sum->left_);
+    auto xId = static_cast<ast::Identifier*>(xa->left_);
+    auto aId = static_cast<ast::Identifier*>(xa->right_);
+    auto bId = static_cast<ast::Identifier*>(sum->right_);
+    ASSERT_TRUE(xId->scope_ == ast::Identifier::Scope::LOCAL);
+    ASSERT_EQ(xId->depth_, 1);
+    ASSERT_EQ(xId->slot_, 0);
+    ASSERT_TRUE(aId->scope_ == ast::Identifier::Scope::GLOBAL);
+    ASSERT_EQ(aId->slot_, 0);
+    ASSERT_TRUE(bId->scope_ == ast::Identifier::Scope::LOCAL);
+    ASSERT_EQ(bId->depth_, 1);
+    ASSERT_EQ(bId->slot_, 2);
+
+    auto builtin = static_cast<ast::ExpressionStatement*>(program->statements_[2]);
+    ASSERT_TRUE(static_cast<ast::Identifier*>(builtin->expression_)->scope_ ==
+                ast::Identifier::Scope::BUILTIN);
+
+    struct Test {
+        std::string input;
+        int64_t expected;
+    };
+    std::vector<Test> tests = {
+        // 内层函数引用外层之后才定义的变量
+        {"let f = fn(x) { let g = fn() { x + y }; let y = 2; g() }; f(1)", 3},
+        // 定义同名局部变量之前读到的是外层变量
+        {"let x = 1; let f = fn() { let y = x; let x = 2; y * 10 + x }; f()", 12},
+        // 未执行的分支中的 let 不影响外层变量
+        {"let x = 1; let f = fn() { if (false) { let x = 2; }; x }; f()", 1},
+        // 全局变量可以覆盖内置函数
+        {"let len = fn(x) { 42 }; len(\"abc\")", 42},
+        {"let f = fn(x, x) { x }; f(1, 2)", 2},
+    };
+    for (const auto &tt : tests) {
+        auto evaluated = testEval(tt.input);
+        if (!testIntegerObject(t, evaluated.get(), tt.expected)) {
+            t.Fatalf("input: %v", tt.input.c_str());
+        }
+    }
+}
+
+// true/false/null 与小整数使用共享实例, 不再每次分配
+void TestCanonicalObjects(TestingT &t)
+{
+    ASSERT_TRUE(testEval("1 < 2") == dragon::object::TrueObject());
+    ASSERT_TRUE(testEval("!true") == dragon::object::FalseObject());
+    ASSERT_TRUE(testEval("if (false) { 1 }") == dragon::object::NullObject());
+    ASSERT_TRUE(testEval("[1][5]") == dragon::object::NullObject());
+    ASSERT_TRUE(testEval("len(\"abc\")") == dragon::object::NewInteger(3));
+    ASSERT_TRUE(testEval("40 + 2") == testEval("42"));
+    ASSERT_TRUE(testEval("-5") == dragon::object::NewInteger(-5));
+
+    // 范围外的整数仍然正确计算
+    auto big = dragon::object::kSmallIntMax + 1;
+    testIntegerObject(t, testEval(std::to_string(big - 1) + " + 1").get(), big);
+    testIntegerObject(t, dragon::object::NewInteger(dragon::object::kSmallIntMin - 1).get(),
+                      dragon::object::kSmallIntMin - 1);
+}
+
+// 标量直接存放在 Value 中, 只有堆对象才持有引用
+void TestValue(TestingT &t)
+{
+    using dragon::object::Value;
+    static_assert(sizeof(Value) <= 24, "Value should stay compact");
+
+    Value i = Value::Int(1LL << 40);
+    ASSERT_TRUE(i.IsInteger());
+    ASSERT_EQ(i.AsInteger(), 1LL << 40);
+    ASSERT_TRUE(i.get() == nullptr);
+
+    // Integer/Boolean/Null 对象构造 Value 时拆箱
+    Value boxed(std::make_shared<dragon::object::Integer>(7));
+    ASSERT_TRUE(boxed.IsInteger());
+    ASSERT_TRUE(Value(dragon::object::TrueObject()).IsBoolean());
+    ASSERT_TRUE(Value(dragon::object::NullObject()).IsNil());
+    ASSERT_TRUE(Value::Bool(false).ToObject() == dragon::object::FalseObject());
+    ASSERT_TRUE(!Value());
+
+    auto str = std::make_shared<dragon::object::String>("abc");
+    {
+        Value v(str);
+        Value copy = v;
+        Value moved = std::move(copy);
+        ASSERT_TRUE(moved.IsObject());
+        ASSERT_TRUE(!copy);
+        ASSERT_EQ(str.use_count(), 3);
+        moved = Value::Int(1);
+        ASSERT_EQ(str.use_count(), 2);
+    }
+    ASSERT_EQ(str.use_count(), 1);
+
+    // return 与错误作为信号随值传递, 复制时保留, 解开 return 不影响错误
+    Value ret = Value::Return(Value::Int(3));
+    ASSERT_TRUE(ret.IsReturn() && ret.IsAbrupt() && ret.IsInteger());
+    Value retCopy = ret;
+    ASSERT_TRUE(retCopy.IsReturn());
+    retCopy.ClearReturn();
+    ASSERT_TRUE(!retCopy.IsAbrupt());
+    ASSERT_EQ(retCopy.AsInteger(), 3);
+    Value err(dragon::evaluator::Evaluator::newError("boom"));
+    ASSERT_TRUE(err.IsError());
+    ASSERT_TRUE(Value::Return(err).IsError());
+    err.ClearReturn();
+    ASSERT_TRUE(err.IsError());
+    ASSERT_TRUE(!Value(str).IsAbrupt());
+    ret = Value::Nil();
+    ASSERT_TRUE(!ret.IsAbrupt());
+    ASSERT_EQ(testEval("let f = fn() { if (true) { if (true) { return 1; } } 2 }; [f(), f()]")->Inspect(), "[1, 1]");
+
+    // 超出小整数缓存的运算也不需要装箱
+    testIntegerObject(t, testEval("let f = fn(n, acc) { if (n < 1) { acc } else { f(n - 1, acc + 100000) } }; f(100, 0)").get(),
+                      10000000);
+}
+
+// 尾调用在蹦床中执行, 深度递归不会耗尽 C++ 栈
+void TestTailCalls(TestingT &t)
+{
+    struct Test {
+        std::string input;
+        int64_t expected;
+    };
+    std::vector<Test> tests = {
+        // 末尾表达式
+        {"let loop = fn(n, acc) { if (n == 0) { acc } else { loop(n - 1, acc + 1) } }; loop(100000, 0)", 100000},
+        // return 语句, 包括非末尾语句中的 return
+        {"let loop = fn(n) { if (n == 0) { return 7; } return loop(n - 1); }; loop(100000)", 7},
+        {"let loop = fn(n) { if (n > 0) { return loop(n - 1); }; 3 }; loop(100000)", 3},
+        {"let loop = fn(n) { if (n == 0) { 0 } else { let m = n - 1; loop(m) } }; loop(100000)", 0},
+        // 相互递归
+        {"let even = fn(n) { if (n == 0) { 1 } else { odd(n - 1) } };"
+         "let odd = fn(n) { if (n == 0) { 0 } else { even(n - 1) } }; even(100001)", 0},
+        // 尾位置调用内置函数, 闭包
+        {"let f = fn(s) { len(s) }; f(\"abcd\")", 4},
+        {"let add = fn(x) { fn(y) { x + y } }; let g = fn(n) { add(n)(2) }; g(40)", 42},
+        // 非尾位置的调用照常返回
+        {"let f = fn(n) { if (n == 0) { 0 } else { 1 + f(n - 1) } }; f(100)", 100},
+    };
+    for (const auto &tt : tests) {
+        auto evaluated = testEval(tt.input);
+        if (!testIntegerObject(t, evaluated.get(), tt.expected)) {
+            t.Fatalf("input: %v", tt.input.c_str());
+        }
+    }
+
+    ASSERT_EQ(testEval("let f = fn() { g(1) }; let g = fn() { 1 }; f()")->Inspect(),
+              "ERROR: wrong number of arguments: want=0, got=1");
+    ASSERT_EQ(testEval("let f = fn() { 1(2) }; f()")->Inspect(), "ERROR: not a function: INTEGER");
+    ASSERT_EQ(testEval("let f = fn(n) { if (n == 0) { x } else { f(n - 1) } }; f(10)")->Inspect(),
+              "ERROR: identifier not found: x");
+}
+
+// 各执行引擎共用的语义用例
+void semanticsSuite()
+{
+    TestingT t;
     TestEvalIntegerExpression();
 	TestEvalBooleanExpression(t);
     TestBangOperator(t);
@@ -469,11 +768,321 @@ void TestEvals()
     TestReturnStatements(t);
     TestErrorHandling(t);
     TestLetStatements(t);
-    TestFunctionObject(t);
     TestFunctionApplication(t);
     TestEnclosingEnvironments(t);
     TestClosures(t);
     TestStringLiteral(t);
     TestStringConcatenation(t);
     TestBuiltinFunctions(t);
-}
\ No newline at end of file
+    TestHashes(t);
+    TestTailCalls(t);
+}
+
+void TestEvalSemantics(EvalFunc eval)
+{
+    runEngineSuite(eval, semanticsSuite);
+}
+
+// 字符串字面量在解析后驻留到全局环境的驻留表中, 求值不再分配, 哈希值只计算一次
+void TestInterning()
+{
+    using dragon::object::String;
+    auto env = std::make_shared<dragon::Environment>();
+    auto run = [&env](const std::string &input) {
+        lexer::Lexer lexer(input);
+        parser::Parser parser(lexer);
+        return dragon::evaluator::Evaluator::eval(parser.parseProgram(), env);
+    };
+    auto first = run(R"("interned literal")");
+    auto second = run(R"(let f = fn() { "interned literal" }; f())");
+    ASSERT_TRUE(first && first == second);
+
+    auto str = std::static_pointer_cast<String>(first);
+    ASSERT_TRUE(str->internId() != 0);
+    ASSERT_TRUE(str == env->strings().intern("interned literal"));
+    ASSERT_TRUE(str->hash() == util::string_hash(str->str()));
+
+    // 运行时生成的字符串不驻留
+    auto joined = run(R"("interned " + "literal")");
+    ASSERT_TRUE(joined && joined != first);
+    ASSERT_EQ(std::static_pointer_cast<String>(joined)->internId(), 0u);
+    ASSERT_EQ(joined->Inspect(), first->Inspect());
+
+    auto count = env->strings().size();
+    run(R"("interned literal" + "interned literal")");
+    ASSERT_EQ(env->strings().size(), count);
+
+    auto hash = std::static_pointer_cast<dragon::object::Hash>(run(R"({"key": "value"})"));
+    for (const auto &pair : hash->pairs_) {
+        ASSERT_TRUE(pair.key_.get() == env->strings().intern("key").get());
+        ASSERT_TRUE(pair.value_.get() == env->strings().intern("value").get());
+    }
+
+    // 另一个全局环境有自己的驻留表, 内容相同的驻留字符串仍是相等的哈希键
+    auto other = std::make_shared<dragon::Environment>();
+    auto key = other->strings().intern("key");
+    ASSERT_TRUE(key.get() != env->strings().intern("key").get());
+    ASSERT_TRUE(key->internId() != 0);
+    ASSERT_TRUE(dragon::object::HashKeyEquals(key, env->strings().intern("key")));
+    ASSERT_TRUE(!dragon::object::HashKeyEquals(key, env->strings().intern("value")));
+}
+
+// 长字符串拼接以绳的形式保存, len 不展开, 取内容时才展开, 操作数保持不变
+void TestStringConcat()
+{
+    using dragon::object::String;
+    auto built = testEval(R"(
+let build = fn(s, n) { if (n == 0) { s } else { build(s + "abc", n - 1) } };
+build("", 100000))");
+    auto str = std::static_pointer_cast<String>(built);
+    ASSERT_TRUE(str->isRope());
+    ASSERT_EQ(str->size(), 300000u);
+    ASSERT_EQ(str->str().substr(0, 6), "abcabc");
+    ASSERT_TRUE(!str->isRope());
+    ASSERT_EQ(str->str().substr(299994), "abcabc");
+
+    auto length = testEval(R"(
+let build = fn(s, n) { if (n == 0) { s } else { build(s + "xyz", n - 1) } };
+len(build("", 1000)))");
+    ASSERT_EQ(length->Inspect(), "3000");
+
+    // 共享前缀的两个结果互不影响
+    auto prefix = std::make_shared<String>(std::string(100, 'p'));
+    auto left = String::Concat(prefix, std::make_shared<String>("L"));
+    auto right = String::Concat(prefix, std::make_shared<String>("R"));
+    auto longer = String::Concat(left, std::make_shared<String>("!"));
+    ASSERT_EQ(prefix->str(), std::string(100, 'p'));
+    ASSERT_EQ(left->str(), std::string(100, 'p') + "L");
+    ASSERT_EQ(right->str(), std::string(100, 'p') + "R");
+    ASSERT_EQ(longer->str(), std::string(100, 'p') + "L!");
+
+    // 驻留的操作数不被修改, 绳可以作为哈希键
+    auto keyed = testEval(R"(
+let k = "key-" + "0123456789012345678901234567890123456789012345678901234567890123";
+let h = {k: 1};
+h["key-0123456789012345678901234567890123456789012345678901234567890123"] + len("key-"))");
+    ASSERT_EQ(keyed->Inspect(), "5");
+    auto env = std::make_shared<dragon::Environment>();
+    lexer::Lexer lexer(R"(let k = "key-"; len(k + "0123456789012345678901234567890123456789012345678901234567890123"))");
+    parser::Parser parser(lexer);
+    ASSERT_EQ(dragon::evaluator::Evaluator::eval(parser.parseProgram(), env)->Inspect(), "68");
+    ASSERT_EQ(env->strings().intern("key-")->str(), "key-");
+}
+
+// 中缀, 下标和调用节点在首次求值后按操作数类型特化, 类型改变时退回通用路径且结果不变
+void TestQuickening()
+{
+    auto env = std::make_shared<dragon::Environment>();
+    auto run = [&env](const std::string &input) {
+        lexer::Lexer lexer(input);
+        parser::Parser parser(lexer);
+        auto program = parser.parseProgram();
+        return std::make_pair(program, dragon::evaluator::Evaluator::eval(program, env));
+    };
+
+    auto defs = run("let op = fn(x, y) { x + y }; let at = fn(c, i) { c[i] }; let call = fn(f) { f(1, 2) + 0 };");
+    auto body = [&defs](size_t i) {
+        auto let = static_cast<ast::LetStatement *>(defs.first->statements_[i]);
+        auto fn = static_cast<ast::FunctionLiteral *>(let->value_);
+        return static_cast<ast::ExpressionStatement *>(fn->body_->statements_[0])->expression_;
+    };
+    auto add = static_cast<ast::InfixExpression *>(body(0));
+    auto index = static_cast<ast::IndexExpression *>(body(1));
+    auto call = static_cast<ast::CallExpression *>(static_cast<ast::InfixExpression *>(body(2))->left_);
+    ASSERT_TRUE(add->quick_ == ast::Quickening::UNSEEN);
+
+    ASSERT_EQ(run("op(1, 2) + op(3, 4)").second->Inspect(), "10");
+    ASSERT_TRUE(add->quick_ == ast::Quickening::INTEGER);
+    ASSERT_EQ(run(R"(op("a", "b"))").second->Inspect(), "ab");
+    ASSERT_TRUE(add->quick_ == ast::Quickening::GENERIC);
+    ASSERT_EQ(run("op(5, 6)").second->Inspect(), "11");
+    ASSERT_EQ(run("op(1, true)").second->Inspect(), "ERROR: type mismatch: INTEGER + BOOLEAN");
+
+    ASSERT_EQ(run("at([1, 2, 3], 2) + at([4], 0)").second->Inspect(), "7");
+    ASSERT_TRUE(index->quick_ == ast::Quickening::ARRAY_INDEX);
+    ASSERT_EQ(run("at([1], 5)").second->Inspect(), "null");
+    ASSERT_TRUE(index->quick_ == ast::Quickening::ARRAY_INDEX);
+    ASSERT_EQ(run(R"(at({"k": 9}, "k"))").second->Inspect(), "9");
+    ASSERT_TRUE(index->quick_ == ast::Quickening::GENERIC);
+
+    ASSERT_EQ(run("call(op)").second->Inspect(), "3");
+    ASSERT_TRUE(call->quick_ == ast::Quickening::FUNCTION);
+    ASSERT_EQ(run("call(len)").second->Inspect(), "ERROR: wrong number of arguments. got=2, want=1");
+    ASSERT_TRUE(call->quick_ == ast::Quickening::GENERIC);
+    ASSERT_EQ(run("call(fn(a, b) { a * b })").second->Inspect(), "2");
+}
+
+// 内联缓存: 只缓存全局变量形式的被调函数, 全局槽位被改写后失效
+void TestInlineCaches()
+{
+    auto env = std::make_shared<dragon::Environment>();
+    auto run = [&env](const std::string &input) {
+        lexer::Lexer lexer(input);
+        parser::Parser parser(lexer);
+        auto program = parser.parseProgram();
+        return std::make_pair(program, dragon::evaluator::Evaluator::eval(program, env));
+    };
+
+    auto defs = run("let g = fn(x) { x * 2 }; let size = len; "
+                    "let h = fn() { g(3) }; let m = fn(a) { size(a) }; let n = fn(a) { len(a) }; "
+                    "let k = fn(f) { f(1) };");
+    auto call = [&defs](size_t i) {
+        auto let = static_cast<ast::LetStatement *>(defs.first->statements_[i]);
+        auto fn = static_cast<ast::FunctionLiteral *>(let->value_);
+        return static_cast<ast::CallExpression *>(
+            static_cast<ast::ExpressionStatement *>(fn->body_->statements_[0])->expression_);
+    };
+    ASSERT_TRUE(call(2)->cache_.env == nullptr);
+
+    ASSERT_EQ(run("h() + h()").second->Inspect(), "12");
+    ASSERT_TRUE(call(2)->cache_.env == env.get());
+    ASSERT_TRUE(!call(2)->cache_.builtin);
+    ASSERT_EQ(run("let g = fn(x) { x + 1 }; h()").second->Inspect(), "4");
+    ASSERT_EQ(run("let g = 5; h()").second->Inspect(), "ERROR: not a function: INTEGER");
+    ASSERT_TRUE(call(2)->cache_.env == nullptr);
+
+    ASSERT_EQ(run("m([1, 2]) + m([3])").second->Inspect(), "3");
+    ASSERT_TRUE(call(3)->cache_.builtin);
+    ASSERT_EQ(run("let size = fn(a) { 0 }; m([1])").second->Inspect(), "0");
+    ASSERT_TRUE(!call(3)->cache_.builtin);
+
+    // 按名字找到的内置函数不经过槽位, 不缓存
+    ASSERT_EQ(run("n([1, 2, 3])").second->Inspect(), "3");
+    ASSERT_TRUE(call(4)->cache_.env == nullptr);
+
+    // 局部变量形式的被调函数不缓存
+    ASSERT_EQ(run("k(size) + k(size)").second->Inspect(), "0");
+    ASSERT_TRUE(call(5)->cache_.env == nullptr);
+}
+
+// 常量折叠: 只含字面量的子表达式被替换, 运行时会出错的运算保持原样
+void TestConstantFolding()
+{
+    struct Folded {
+        std::shared_ptr<ast::Program> program;
+        size_t count;
+        ast::Expression *expr;
+    };
+    auto fold = [](const std::string &input) {
+        lexer::Lexer lexer(input);
+        parser::Parser parser(lexer);
+        auto program = parser.parseProgram();
+        dragon::evaluator::ConstantFolder folder(*program->arena_);
+        folder.fold(program.get());
+        auto last = static_cast<ast::ExpressionStatement *>(program->statements_.back());
+        return Folded{program, folder.folded(), last->expression_};
+    };
+    auto integer = [](const Folded &f) {
+        return static_cast<ast::IntegerLiteral *>(f.expr)->value_;
+    };
+
+    auto seconds = fold("60 * 60 * 24");
+    ASSERT_TRUE(seconds.expr->Kind() == ast::NodeKind::INTEGER_LITERAL);
+    ASSERT_EQ(integer(seconds), 86400);
+    ASSERT_EQ(seconds.count, 2u);
+    ASSERT_EQ(integer(fold("-(2 - 5) + 10 / 3")), 6);
+
+    auto cmp = fold("!(1 < 2) == (true != false)");
+    ASSERT_TRUE(cmp.expr->Kind() == ast::NodeKind::BOOLEAN);
+    ASSERT_TRUE(!static_cast<ast::Boolean *>(cmp.expr)->value_);
+    ASSERT_TRUE(static_cast<ast::Boolean *>(fold("1 == true").expr)->value_ == false);
+
+    // 折叠得到的字符串与运行时拼接一样不驻留
+    auto joined = fold(R"("fold" + "ed")");
+    ASSERT_TRUE(joined.expr->Kind() == ast::NodeKind::STRING_LITERAL);
+    auto lit = static_cast<ast::StringLiteral *>(joined.expr);
+    ASSERT_EQ(lit->value_, "folded");
+    ASSERT_EQ(lit->interned_->internId(), 0u);
+
+    // 条件为常量的 if 只保留会执行的分支
+    auto branch = fold("if (1 < 2) { 7 * 6 } else { missing }");
+    ASSERT_EQ(integer(branch), 42);
+    auto kept = fold("if (false) { 1 }");
+    ASSERT_TRUE(kept.expr->Kind() == ast::NodeKind::IF_EXPRESSION);
+
+    // 变量不参与折叠, 但其中的常量子表达式仍被折叠
+    auto partial = fold("let x = 3; x * (2 + 4)");
+    ASSERT_TRUE(partial.expr->Kind() == ast::NodeKind::INFIX_EXPRESSION);
+    ASSERT_EQ(partial.count, 1u);
+    ASSERT_EQ(partial.expr->String(), "(x * 6)");
+
+    // 除以 0, 溢出, 不支持的运算符和类型不匹配留到运行时
+    for (const auto &input : {"1 / 0", "9223372036854775807 + 1", "-true", "true + false",
+                              "5 + true", R"("a" - "b")", R"("a" == "a")", "9223372036854775807 * 2"}) {
+        ASSERT_EQ(fold(input).count, 0u);
+    }
+    // 只折叠不溢出的部分; 不溢出的边界值照常折叠
+    for (const auto &input : {"(0 - 9223372036854775807) - 2", "4611686018427387904 * -3"}) {
+        ASSERT_EQ(fold(input).count, 1u);
+    }
+    ASSERT_EQ(integer(fold("3037000499 * 3037000499")), 9223372030926249001);
+    ASSERT_EQ(integer(fold("(0 - 9223372036854775807) - 1")), std::numeric_limits<int64_t>::min());
+    ASSERT_EQ(testEval("1 / 0")->Inspect(), "ERROR: division by zero");
+    ASSERT_EQ(testEval(R"("a" - "b")")->Inspect(), "ERROR: unknown operator: STRING - STRING");
+    ASSERT_EQ(testEval("if (true) { 1 } else { missing }")->Inspect(), "1");
+    ASSERT_EQ(testEval("if (true) { missing } else { 1 }")->Inspect(), "ERROR: identifier not found: missing");
+}
+
+// 扁平布局上的求值与树遍历结果一致, 尾调用同样不增长栈
+void TestFlatEvaluator()
+{
+    TestEvalSemantics(flatEval);
+}
+
+// 编译为可调用对象树后执行, 结果与树遍历一致, 尾调用不增长栈; 函数体只编译一次
+void TestClosureCompiler()
+{
+    TestEvalSemantics(closureEval);
+
+    auto made = closureEval("let make = fn(x) { fn() { x } }; [make(1), make(2)]");
+    auto arr = std::static_pointer_cast<dragon::object::Array>(made);
+    auto first = dynamic_cast<dragon::evaluator::ClosureFunction *>(arr->elements_[0].get());
+    auto second = dynamic_cast<dragon::evaluator::ClosureFunction *>(arr->elements_[1].get());
+    ASSERT_TRUE(first && second && first != second);
+    ASSERT_TRUE(first->code_ == second->code_);
+}
+
+// 显式栈求值的结果与树遍历一致; 深度递归不占用 C++ 栈, 超过上限时返回错误, 尾调用不计入深度
+void TestStackEvaluator()
+{
+    runEngineSuite(stackEval, [] {
+        using dragon::evaluator::StackEvaluator;
+        semanticsSuite();
+
+        const std::string count = "let count = fn(n) { if (n == 0) { 0 } else { 1 + count(n - 1) } }; ";
+        ASSERT_EQ(testEval(count + "count(50000)")->Inspect(), "50000");
+        // 深度嵌套的数组在释放和 Inspect 时也不递归
+        const std::string build = "let build = fn(n, acc) { if (n == 0) { acc } else { build(n - 1, [n, acc]) } }; ";
+        ASSERT_EQ(testEval(build + "let sum = fn(xs) { if (len(xs) == 0) { 0 } else { xs[0] + sum(xs[1]) } }; "
+                                   "sum(build(10000, []))")->Inspect(), "50005000");
+        auto nested = testEval(build + "build(10000, [])")->Inspect();
+        ASSERT_EQ(nested.substr(0, 10), "[1, [2, [3");
+        ASSERT_TRUE(nested.find("[9999, [10000, []]]") != std::string::npos);
+        ASSERT_EQ(std::count(nested.begin(), nested.end(), ']'), 10001);
+
+        StackEvaluator::setMaxDepth(100);
+        ASSERT_EQ(testEval(count + "count(99)")->Inspect(), "99");
+        ASSERT_EQ(testEval(count + "count(100)")->Inspect(), "ERROR: maximum call depth exceeded: 100");
+        ASSERT_EQ(testEval(count + "let r = count(500); 1 + 1")->Inspect(), "ERROR: maximum call depth exceeded: 100");
+        ASSERT_EQ(testEval("let loop = fn(n) { if (n == 0) { return 0; } return loop(n - 1); }; loop(100000)")->Inspect(), "0");
+        StackEvaluator::setMaxDepth(StackEvaluator::kDefaultMaxDepth);
+    });
+}
+
+void TestEvals()
+{
+	TestingT t;
+    TestEvalSemantics(evaluatorEval);
+    TestFunctionObject(t);
+    TestResolver(t);
+    TestCanonicalObjects(t);
+    TestValue(t);
+    TestInterning();
+    TestStringConcat();
+    TestConstantFolding();
+    TestQuickening();
+    TestInlineCaches();
+    TestFlatEvaluator();
+    TestClosureCompiler();
+    TestStackEvaluator();
+}
@@ -3,6 +3,14 @@
 
 #include "evaluator.h"
 
+#include <functional>
+#include <memory>
+#include <string>
+
 void TestEvals();
 
+// 与执行引擎无关的语义用例, 其他执行引擎 (如 vm) 复用这些用例保证结果一致
+using EvalFunc = std::function<std::shared_ptr<dragon::object::Object>(const std::string& input)>;
+void TestEvalSemantics(EvalFunc eval);
+
 #endif
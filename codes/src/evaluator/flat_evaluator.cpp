@@ -0,0 +1,268 @@
+#include "flat_evaluator.h"
+#include "folder.h"
+#include "resolver.h"
+
+#include <typeinfo>
+
+namespace dragon {
+namespace evaluator {
+
+std::shared_ptr<object::Object> FlatEvaluator::eval(const std::shared_ptr<ast::Program>& program,
+                                                    const std::shared_ptr<Environment>& env) {
+    if (!program) {
+        return nullptr;
+    }
+    FoldConstants(program.get());
+    Resolver(*env).resolve(program.get());
+    auto ast = ast::FlatAst::Build(program);
+    return eval(*ast, ast->root(), env).ToObject();
+}
+
+object::Value FlatEvaluator::eval(const ast::FlatAst& ast, ast::NodeIndex node,
+                                  const std::shared_ptr<Environment>& env) {
+    if (node == ast::kNoNode) {
+        return nullptr;
+    }
+
+    switch (ast.kind(node)) {
+    case ast::NodeKind::PROGRAM:
+        return evalStatements(ast, node, env, true);
+
+    case ast::NodeKind::BLOCK_STATEMENT:
+        return evalStatements(ast, node, env, false);
+
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return eval(ast, ast.first(node), env);
+
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto val = eval(ast, ast.first(node), env);
+        return object::Value::Return(std::move(val));
+    }
+
+    case ast::NodeKind::LET_STATEMENT: {
+        auto val = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(val)) return val;
+        const auto &ident = ast.identifier(ast.second(node));
+        if (ident.scope == ast::Identifier::Scope::LOCAL) {
+            env->setLocal(ident.slot, std::move(val));
+        } else if (ident.scope == ast::Identifier::Scope::GLOBAL) {
+            env->setGlobal(ident.slot, std::move(val));
+        } else {
+            env->set(ast.name(ident), std::move(val));
+        }
+        return nullptr;
+    }
+
+    case ast::NodeKind::INTEGER_LITERAL:
+        return object::Value::Int(ast.integer(node));
+
+    case ast::NodeKind::STRING_LITERAL:
+        return ast.string(node);
+
+    case ast::NodeKind::BOOLEAN:
+        return object::Value::Bool(ast.boolean(node));
+
+    case ast::NodeKind::PREFIX_EXPRESSION: {
+        auto right = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(right)) return right;
+        return Evaluator::evalPrefixExpression(ast.op(node), right);
+    }
+
+    case ast::NodeKind::INFIX_EXPRESSION: {
+        auto left = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(left)) return left;
+
+        auto right = eval(ast, ast.second(node), env);
+        if (Evaluator::isError(right)) return right;
+
+        return Evaluator::evalInfixExpression(ast.op(node), left, right);
+    }
+
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto condition = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(condition)) return condition;
+
+        if (Evaluator::isTruthy(condition)) {
+            return eval(ast, ast.second(node), env);
+        } else if (ast.third(node) != ast::kNoNode) {
+            return eval(ast, ast.third(node), env);
+        }
+        return object::Value::Nil();
+    }
+
+    case ast::NodeKind::HASH_LITERAL:
+        return evalHashLiteral(ast, node, env);
+
+    case ast::NodeKind::IDENTIFIER:
+        return evalIdentifier(ast, node, env);
+
+    case ast::NodeKind::FUNCTION_LITERAL:
+        return Evaluator::makeFunction(std::make_shared<FlatFunction>(ast.shared_from_this(), node, env), env);
+
+    case ast::NodeKind::CALL_EXPRESSION: {
+        auto function = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(function)) return function;
+
+        auto args = evalChildren(ast, node, env);
+        if (args.size() == 1 && Evaluator::isError(args[0])) return std::move(args[0]);
+
+        return applyFunction(function, args);
+    }
+
+    case ast::NodeKind::ARRAY_LITERAL: {
+        auto eles = evalChildren(ast, node, env);
+        if (eles.size() == 1 && Evaluator::isError(eles[0])) {
+            return std::move(eles[0]);
+        }
+
+        return Evaluator::makeArray(std::move(eles));
+    }
+
+    case ast::NodeKind::INDEX_EXPRESSION: {
+        auto left = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(left)) return left;
+
+        auto idx = eval(ast, ast.second(node), env);
+        if (Evaluator::isError(idx)) return idx;
+
+        return Evaluator::evalIndexExpression(left, idx);
+    }
+    }
+    return nullptr;
+}
+
+object::Value FlatEvaluator::evalStatements(const ast::FlatAst& ast, ast::NodeIndex node,
+                                            const std::shared_ptr<Environment>& env, bool program) {
+    object::Value result;
+    const ast::NodeIndex *statements = ast.children(node);
+    for (uint32_t i = 0, n = ast.childCount(node); i < n; ++i) {
+        result = eval(ast, statements[i], env);
+
+        if (result.IsAbrupt()) {
+            return program ? Evaluator::unwrapReturnValue(std::move(result)) : result;
+        }
+    }
+    return result;
+}
+
+object::Value FlatEvaluator::evalIdentifier(const ast::FlatAst& ast, ast::NodeIndex node,
+                                            const std::shared_ptr<Environment>& env) {
+    const auto &ident = ast.identifier(node);
+    return Evaluator::lookupIdentifier(ident.scope, ident.depth, ident.slot, ast.name(ident), env);
+}
+
+object::Value FlatEvaluator::evalHashLiteral(const ast::FlatAst& ast, ast::NodeIndex node,
+                                             const std::shared_ptr<Environment>& env) {
+    // 子节点依次为各对的键和值
+    const ast::NodeIndex *items = ast.children(node);
+    return Evaluator::evalHashPairs(ast.childCount(node) / 2,
+                                    [&](size_t i) { return eval(ast, items[2 * i], env); },
+                                    [&](size_t i) { return eval(ast, items[2 * i + 1], env); });
+}
+
+std::vector<object::Value> FlatEvaluator::evalChildren(const ast::FlatAst& ast, ast::NodeIndex node,
+                                                       const std::shared_ptr<Environment>& env) {
+    const ast::NodeIndex *items = ast.children(node);
+    uint32_t n = ast.childCount(node);
+    std::vector<object::Value> result;
+    result.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        auto evaluated = eval(ast, items[i], env);
+        if (Evaluator::isError(evaluated)) {
+            return {evaluated};
+        }
+        result.push_back(std::move(evaluated));
+    }
+    return result;
+}
+
+namespace {
+// FlatFunction 没有子类, 比较 typeid 即可, 比 dynamic_cast 便宜
+bool isFlatFunction(const object::Value& fn) {
+    return fn.Type() == object::Object::ObjectType::FUNCTION_OBJ && typeid(*fn.get()) == typeid(FlatFunction);
+}
+}
+
+object::Value FlatEvaluator::applyFunction(const object::Value& fn, const std::vector<object::Value>& args) {
+    // 内置函数, 以及不在扁平布局上创建的函数 (如 REPL 中之前的输入)
+    if (!isFlatFunction(fn)) {
+        return Evaluator::applyFunction(fn, args);
+    }
+
+    return Evaluator::trampoline(std::static_pointer_cast<FlatFunction>(fn.AsObject()), args, isFlatFunction,
+                                 [](const std::shared_ptr<FlatFunction>& function,
+                                    const std::vector<object::Value>& args, TailCall& tail) {
+                                     return evalTail(*function->ast_, function->bodyIndex_,
+                                                     Evaluator::extendFunctionEnv(function, args), tail, true);
+                                 });
+}
+
+object::Value FlatEvaluator::evalTail(const ast::FlatAst& ast, ast::NodeIndex node,
+                                      const std::shared_ptr<Environment>& env,
+                                      TailCall& tail, bool result) {
+    if (node == ast::kNoNode) {
+        return nullptr;
+    }
+
+    switch (ast.kind(node)) {
+    case ast::NodeKind::BLOCK_STATEMENT: {
+        object::Value val;
+        const ast::NodeIndex *statements = ast.children(node);
+        uint32_t n = ast.childCount(node);
+        for (uint32_t i = 0; i < n; ++i) {
+            val = evalTail(ast, statements[i], env, tail, result && i + 1 == n);
+            if (tail.pending) {
+                return nullptr;
+            }
+            if (val.IsAbrupt()) {
+                return val;
+            }
+        }
+        return val;
+    }
+
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        return evalTail(ast, ast.first(node), env, tail, result);
+
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto val = evalTail(ast, ast.first(node), env, tail, true);
+        if (tail.pending) return val;
+        return object::Value::Return(std::move(val));
+    }
+
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto condition = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(condition)) return condition;
+
+        if (Evaluator::isTruthy(condition)) {
+            return evalTail(ast, ast.second(node), env, tail, result);
+        } else if (ast.third(node) != ast::kNoNode) {
+            return evalTail(ast, ast.third(node), env, tail, result);
+        }
+        return object::Value::Nil();
+    }
+
+    case ast::NodeKind::CALL_EXPRESSION: {
+        if (!result) {
+            break;
+        }
+        auto function = eval(ast, ast.first(node), env);
+        if (Evaluator::isError(function)) return function;
+
+        auto args = evalChildren(ast, node, env);
+        if (args.size() == 1 && Evaluator::isError(args[0])) return std::move(args[0]);
+
+        tail.pending = true;
+        tail.fn = std::move(function);
+        tail.args = std::move(args);
+        return nullptr;
+    }
+
+    default:
+        break;
+    }
+    return eval(ast, node, env);
+}
+
+} // namespace evaluator
+} // namespace dragon
@@ -0,0 +1,55 @@
+#ifndef __FLAT_EVALUATOR_H__
+#define __FLAT_EVALUATOR_H__
+
+#include "evaluator.h"
+#include "flat_ast.h"
+#include <memory>
+#include <vector>
+
+namespace dragon {
+namespace evaluator {
+
+// 在扁平布局上创建的函数, 额外记住函数体所在的 FlatAst 与节点下标
+class FlatFunction final : public object::Function {
+public:
+    FlatFunction(std::shared_ptr<const ast::FlatAst> ast, ast::NodeIndex node,
+                 std::shared_ptr<Environment> env)
+        : Function(ast->function(node), std::move(env)), ast_(std::move(ast)), bodyIndex_(ast_->first(node)) {}
+
+    std::shared_ptr<const ast::FlatAst> ast_;
+    ast::NodeIndex bodyIndex_;
+};
+
+// 遍历 ast::FlatAst 的求值器, 语义与 Evaluator 一致. 运算与对象操作复用 Evaluator 的实现,
+// 只有节点的访问方式不同
+class FlatEvaluator {
+public:
+    // 对外入口: 静态解析后转换为扁平布局再求值
+    static std::shared_ptr<object::Object> eval(const std::shared_ptr<ast::Program>& program,
+                                                const std::shared_ptr<Environment>& env);
+    static object::Value eval(const ast::FlatAst& ast, ast::NodeIndex node,
+                              const std::shared_ptr<Environment>& env);
+
+private:
+    using TailCall = Evaluator::TailCall;
+
+    static object::Value evalStatements(const ast::FlatAst& ast, ast::NodeIndex node,
+                                        const std::shared_ptr<Environment>& env, bool program);
+    static object::Value evalIdentifier(const ast::FlatAst& ast, ast::NodeIndex node,
+                                        const std::shared_ptr<Environment>& env);
+    static object::Value evalHashLiteral(const ast::FlatAst& ast, ast::NodeIndex node,
+                                         const std::shared_ptr<Environment>& env);
+    // 求值 node 的子节点列表, 出错时返回只含该错误的数组
+    static std::vector<object::Value> evalChildren(const ast::FlatAst& ast, ast::NodeIndex node,
+                                                   const std::shared_ptr<Environment>& env);
+
+    static object::Value applyFunction(const object::Value& fn, const std::vector<object::Value>& args);
+    static object::Value evalTail(const ast::FlatAst& ast, ast::NodeIndex node,
+                                  const std::shared_ptr<Environment>& env,
+                                  TailCall& tail, bool result);
+};
+
+} // namespace evaluator
+} // namespace dragon
+
+#endif
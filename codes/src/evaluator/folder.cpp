@@ -0,0 +1,317 @@
+//
+// 常量折叠: 求值/编译前把只含字面量的子表达式替换为结果
+//
+
+#include "folder.h"
+#include "object.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace dragon {
+namespace evaluator {
+
+namespace {
+bool isConstant(const ast::Expression *expr)
+{
+    if (!expr) {
+        return false;
+    }
+    auto kind = expr->Kind();
+    return kind == ast::NodeKind::INTEGER_LITERAL || kind == ast::NodeKind::BOOLEAN ||
+           kind == ast::NodeKind::STRING_LITERAL;
+}
+
+// 与 Evaluator::isTruthy 一致: 常量中只有 false 为假
+bool isTruthy(const ast::Expression *constant)
+{
+    if (constant->Kind() == ast::NodeKind::BOOLEAN) {
+        return static_cast<const ast::Boolean *>(constant)->value_;
+    }
+    return true;
+}
+
+// 带溢出检查的整数运算, 溢出时返回 false. 先判断再计算, 不依赖编译器扩展
+bool checkedAdd(int64_t l, int64_t r, int64_t &result)
+{
+    constexpr int64_t max = std::numeric_limits<int64_t>::max();
+    constexpr int64_t min = std::numeric_limits<int64_t>::min();
+    if ((r > 0 && l > max - r) || (r < 0 && l < min - r)) {
+        return false;
+    }
+    result = l + r;
+    return true;
+}
+
+bool checkedSub(int64_t l, int64_t r, int64_t &result)
+{
+    constexpr int64_t max = std::numeric_limits<int64_t>::max();
+    constexpr int64_t min = std::numeric_limits<int64_t>::min();
+    if ((r < 0 && l > max + r) || (r > 0 && l < min + r)) {
+        return false;
+    }
+    result = l - r;
+    return true;
+}
+
+bool checkedMul(int64_t l, int64_t r, int64_t &result)
+{
+    constexpr int64_t max = std::numeric_limits<int64_t>::max();
+    constexpr int64_t min = std::numeric_limits<int64_t>::min();
+    if (l > 0 ? (r > 0 ? l > max / r : r < min / l)
+              : (r > 0 ? l < min / r : l != 0 && r < max / l)) {
+        return false;
+    }
+    result = l * r;
+    return true;
+}
+
+// 只含一条表达式语句的块, 其值就是该表达式的值
+ast::Expression *singleExpression(const ast::BlockStatement *block)
+{
+    if (!block || block->statements_.size() != 1) {
+        return nullptr;
+    }
+    auto stmt = block->statements_[0];
+    if (!stmt || stmt->Kind() != ast::NodeKind::EXPRESSION_STATEMENT) {
+        return nullptr;
+    }
+    return static_cast<ast::ExpressionStatement *>(stmt)->expression_;
+}
+} // namespace
+
+void FoldConstants(ast::Program *program)
+{
+    if (program && program->arena_) {
+        ConstantFolder(*program->arena_).fold(program);
+    }
+}
+
+void ConstantFolder::fold(ast::Program *program)
+{
+    for (auto stmt : program->statements_) {
+        foldStatement(stmt);
+    }
+}
+
+void ConstantFolder::foldStatement(ast::Statement *stmt)
+{
+    if (!stmt) {
+        return;
+    }
+    switch (stmt->Kind()) {
+    case ast::NodeKind::LET_STATEMENT: {
+        auto let = static_cast<ast::LetStatement *>(stmt);
+        let->value_ = foldExpression(let->value_);
+        break;
+    }
+    case ast::NodeKind::RETURN_STATEMENT: {
+        auto ret = static_cast<ast::ReturnStatement *>(stmt);
+        ret->returnValue_ = foldExpression(ret->returnValue_);
+        break;
+    }
+    case ast::NodeKind::EXPRESSION_STATEMENT: {
+        auto es = static_cast<ast::ExpressionStatement *>(stmt);
+        es->expression_ = foldExpression(es->expression_);
+        break;
+    }
+    case ast::NodeKind::BLOCK_STATEMENT:
+        foldBlock(static_cast<ast::BlockStatement *>(stmt));
+        break;
+    default:
+        break;
+    }
+}
+
+void ConstantFolder::foldBlock(ast::BlockStatement *block)
+{
+    if (!block) {
+        return;
+    }
+    for (auto stmt : block->statements_) {
+        foldStatement(stmt);
+    }
+}
+
+ast::Expression *ConstantFolder::foldExpression(ast::Expression *expr)
+{
+    if (!expr) {
+        return nullptr;
+    }
+    switch (expr->Kind()) {
+    case ast::NodeKind::PREFIX_EXPRESSION:
+        return foldPrefix(static_cast<ast::PrefixExpression *>(expr));
+    case ast::NodeKind::INFIX_EXPRESSION:
+        return foldInfix(static_cast<ast::InfixExpression *>(expr));
+    case ast::NodeKind::IF_EXPRESSION:
+        return foldIf(static_cast<ast::IfExpression *>(expr));
+    case ast::NodeKind::FUNCTION_LITERAL:
+        foldBlock(static_cast<ast::FunctionLiteral *>(expr)->body_);
+        return expr;
+    case ast::NodeKind::CALL_EXPRESSION: {
+        auto call = static_cast<ast::CallExpression *>(expr);
+        call->function_ = foldExpression(call->function_);
+        for (auto &arg : call->arguments_) {
+            arg = foldExpression(arg);
+        }
+        return expr;
+    }
+    case ast::NodeKind::ARRAY_LITERAL:
+        for (auto &e : static_cast<ast::ArrayLiteral *>(expr)->elements_) {
+            e = foldExpression(e);
+        }
+        return expr;
+    case ast::NodeKind::HASH_LITERAL:
+        for (auto &pair : static_cast<ast::HashLiteral *>(expr)->pairs_) {
+            pair.first = foldExpression(pair.first);
+            pair.second = foldExpression(pair.second);
+        }
+        return expr;
+    case ast::NodeKind::INDEX_EXPRESSION: {
+        auto index = static_cast<ast::IndexExpression *>(expr);
+        index->left_ = foldExpression(index->left_);
+        index->index_ = foldExpression(index->index_);
+        return expr;
+    }
+    default:
+        return expr;
+    }
+}
+
+ast::Expression *ConstantFolder::foldPrefix(ast::PrefixExpression *prefix)
+{
+    prefix->right_ = foldExpression(prefix->right_);
+    auto right = prefix->right_;
+    if (!isConstant(right)) {
+        return prefix;
+    }
+
+    if (prefix->op_ == ast::Operator::BANG) {
+        return makeBoolean(!isTruthy(right));
+    }
+    if (prefix->op_ == ast::Operator::MINUS && right->Kind() == ast::NodeKind::INTEGER_LITERAL) {
+        auto value = static_cast<ast::IntegerLiteral *>(right)->value_;
+        if (value != std::numeric_limits<int64_t>::min()) {
+            return makeInteger(-value);
+        }
+    }
+    return prefix;
+}
+
+ast::Expression *ConstantFolder::foldInfix(ast::InfixExpression *infix)
+{
+    infix->left_ = foldExpression(infix->left_);
+    infix->right_ = foldExpression(infix->right_);
+    auto left = infix->left_;
+    auto right = infix->right_;
+    if (!isConstant(left) || !isConstant(right)) {
+        return infix;
+    }
+
+    auto op = infix->op_;
+    auto leftKind = left->Kind();
+    auto rightKind = right->Kind();
+
+    if (leftKind == ast::NodeKind::INTEGER_LITERAL && rightKind == ast::NodeKind::INTEGER_LITERAL) {
+        int64_t l = static_cast<ast::IntegerLiteral *>(left)->value_;
+        int64_t r = static_cast<ast::IntegerLiteral *>(right)->value_;
+        int64_t result = 0;
+        switch (op) {
+        case ast::Operator::PLUS:
+            return checkedAdd(l, r, result) ? makeInteger(result) : infix;
+        case ast::Operator::MINUS:
+            return checkedSub(l, r, result) ? makeInteger(result) : infix;
+        case ast::Operator::ASTERISK:
+            return checkedMul(l, r, result) ? makeInteger(result) : infix;
+        case ast::Operator::SLASH:
+            if (r == 0 || (l == std::numeric_limits<int64_t>::min() && r == -1)) {
+                return infix;
+            }
+            return makeInteger(l / r);
+        case ast::Operator::LT: return makeBoolean(l < r);
+        case ast::Operator::GT: return makeBoolean(l > r);
+        case ast::Operator::EQ: return makeBoolean(l == r);
+        case ast::Operator::NOT_EQ: return makeBoolean(l != r);
+        default: return infix;
+        }
+    }
+
+    if (leftKind == ast::NodeKind::STRING_LITERAL && rightKind == ast::NodeKind::STRING_LITERAL) {
+        if (op != ast::Operator::PLUS) {
+            return infix;
+        }
+        return makeString(static_cast<ast::StringLiteral *>(left)->value_ +
+                          static_cast<ast::StringLiteral *>(right)->value_);
+    }
+
+    // 其余组合只有 == 和 != 有结果: 布尔值比较值, 不同类型的常量总是不相等
+    if (op != ast::Operator::EQ && op != ast::Operator::NOT_EQ) {
+        return infix;
+    }
+    bool equal = false;
+    if (leftKind == ast::NodeKind::BOOLEAN && rightKind == ast::NodeKind::BOOLEAN) {
+        equal = static_cast<ast::Boolean *>(left)->value_ == static_cast<ast::Boolean *>(right)->value_;
+    } else if (leftKind == rightKind) {
+        return infix;
+    }
+    return makeBoolean(op == ast::Operator::EQ ? equal : !equal);
+}
+
+ast::Expression *ConstantFolder::foldIf(ast::IfExpression *ie)
+{
+    ie->condition_ = foldExpression(ie->condition_);
+    foldBlock(ie->consequence_);
+    foldBlock(ie->alternative_);
+    if (!isConstant(ie->condition_)) {
+        return ie;
+    }
+
+    // 条件为常量: 去掉不会执行的分支; 留下的分支只有一个表达式时直接用它替换整个 if
+    if (isTruthy(ie->condition_)) {
+        ie->alternative_ = nullptr;
+        if (auto expr = singleExpression(ie->consequence_)) {
+            ++folded_;
+            return expr;
+        }
+    } else if (ie->alternative_) {
+        if (auto expr = singleExpression(ie->alternative_)) {
+            ++folded_;
+            return expr;
+        }
+    }
+    return ie;
+}
+
+ast::Expression *ConstantFolder::makeInteger(int64_t value)
+{
+    ++folded_;
+    auto lit = arena_.make<ast::IntegerLiteral>();
+    lit->token_ = token::Token(token::TokenType::INT, std::to_string(value));
+    lit->value_ = value;
+    return lit;
+}
+
+ast::Expression *ConstantFolder::makeBoolean(bool value)
+{
+    ++folded_;
+    auto lit = arena_.make<ast::Boolean>();
+    lit->token_ = value ? token::Token(token::TokenType::TRUE, "true")
+                        : token::Token(token::TokenType::FALSE, "false");
+    lit->value_ = value;
+    return lit;
+}
+
+// 折叠得到的字符串不驻留, 与运行时拼接的结果一样; 每次求值共用同一个对象
+ast::Expression *ConstantFolder::makeString(std::string value)
+{
+    ++folded_;
+    auto lit = arena_.make<ast::StringLiteral>();
+    lit->token_ = token::Token(token::TokenType::STRING, value);
+    lit->interned_ = std::make_shared<object::String>(value);
+    lit->value_ = std::move(value);
+    return lit;
+}
+
+} // namespace evaluator
+} // namespace dragon
@@ -0,0 +1,50 @@
+//
+// 常量折叠: 求值/编译前把只含字面量的子表达式替换为结果
+//
+
+#ifndef DRAGON_FOLDER_H
+#define DRAGON_FOLDER_H
+
+#include "ast.h"
+#include "arena.h"
+
+#include <cstddef>
+
+namespace dragon {
+namespace evaluator {
+
+// 折叠整数, 字符串, 布尔字面量上的前缀/中缀运算, 以及条件为常量的 if.
+// 运行时会报错的运算 (除以 0, 不支持的运算符, 类型不匹配) 保持原样, 错误仍在求值时按原来的顺序和信息产生;
+// 溢出的加减乘与 INT64_MIN / -1 同样保持原样, 结果由运行时决定. 新节点分配在 Program 的 arena 中.
+// 必须在 Resolver 之前运行, 被删除的分支不再分配槽位
+class ConstantFolder {
+public:
+    explicit ConstantFolder(ast::Arena &arena) : arena_(arena) {}
+
+    void fold(ast::Program *program);
+    // 被替换的节点数
+    size_t folded() const { return folded_; }
+
+private:
+    void foldStatement(ast::Statement *stmt);
+    void foldBlock(ast::BlockStatement *block);
+    ast::Expression *foldExpression(ast::Expression *expr);
+    ast::Expression *foldPrefix(ast::PrefixExpression *prefix);
+    ast::Expression *foldInfix(ast::InfixExpression *infix);
+    ast::Expression *foldIf(ast::IfExpression *ie);
+
+    ast::Expression *makeInteger(int64_t value);
+    ast::Expression *makeBoolean(bool value);
+    ast::Expression *makeString(std::string value);
+
+    ast::Arena &arena_;
+    size_t folded_ = 0;
+};
+
+// 对解析得到的程序做常量折叠, 没有 arena 的程序 (手工构造的语法树) 不处理
+void FoldConstants(ast::Program *program);
+
+} // namespace evaluator
+} // namespace dragon
+
+#endif //DRAGON_FOLDER_H
@@ -0,0 +1,132 @@
+//
+// 静态解析: 求值前为每个标识符确定 (depth, slot) 地址, 或标记为全局变量/内置函数
+//
+
+#include "resolver.h"
+#include "builtin.h"
+
+namespace dragon {
+namespace evaluator {
+
+void Resolver::resolve(ast::Program *program)
+{
+    scopes_.clear();
+
+    // 顶层的 let (包括 if 块中的) 都是全局变量, 先分配槽位
+    Scope global;
+    hoist(program, global);
+    for (const auto &name : *global.names) {
+        globals_.globalSlot(name);
+    }
+
+    resolveNode(program);
+}
+
+// 收集 node 中定义的变量, 不进入内层函数
+void Resolver::hoist(ast::Node *node, Scope &scope)
+{
+    if (!scope.names) {
+        scope.names = std::make_shared<std::vector<std::string>>();
+    }
+
+    ast::ForEachChild(node, [this, &scope](ast::Node *child) {
+        if (child->Kind() == ast::NodeKind::FUNCTION_LITERAL) {
+            return;
+        }
+        if (child->Kind() == ast::NodeKind::LET_STATEMENT) {
+            auto let = static_cast<ast::LetStatement*>(child);
+            if (let->name_) {
+                declare(scope, let->name_->value_);
+            }
+        }
+        hoist(child, scope);
+    });
+}
+
+void Resolver::declare(Scope &scope, const std::string &name)
+{
+    if (scope.slots.count(name)) {
+        return;
+    }
+    scope.slots[name] = static_cast<int>(scope.names->size());
+    scope.names->push_back(name);
+}
+
+void Resolver::resolveNode(ast::Node *node)
+{
+    switch (node->Kind()) {
+    case ast::NodeKind::IDENTIFIER:
+        resolveIdentifier(static_cast<ast::Identifier*>(node));
+        return;
+    case ast::NodeKind::FUNCTION_LITERAL:
+        resolveFunctionLiteral(static_cast<ast::FunctionLiteral*>(node));
+        return;
+    case ast::NodeKind::STRING_LITERAL: {
+        // 常量折叠产生的字面量已持有未驻留的对象, 保持不变
+        auto lit = static_cast<ast::StringLiteral*>(node);
+        if (!lit->interned_) {
+            lit->interned_ = globals_.strings().intern(lit->value_);
+        }
+        return;
+    }
+    default:
+        ast::ForEachChild(node, [this](ast::Node *child) { resolveNode(child); });
+        return;
+    }
+}
+
+void Resolver::resolveIdentifier(ast::Identifier *ident)
+{
+    for (size_t i = scopes_.size(); i-- > 0;) {
+        auto it = scopes_[i].slots.find(ident->value_);
+        if (it != scopes_[i].slots.end()) {
+            ident->scope_ = ast::Identifier::Scope::LOCAL;
+            ident->depth_ = static_cast<int>(scopes_.size() - 1 - i);
+            ident->slot_ = it->second;
+            return;
+        }
+    }
+
+    int slot = 0;
+    if (globals_.findGlobalSlot(ident->value_, slot)) {
+        ident->scope_ = ast::Identifier::Scope::GLOBAL;
+        ident->depth_ = 0;
+        ident->slot_ = slot;
+        return;
+    }
+
+    const auto &builtins = BuiltInFuncNames();
+    for (size_t i = 0; i < builtins.size(); ++i) {
+        if (builtins[i] == ident->value_) {
+            ident->scope_ = ast::Identifier::Scope::BUILTIN;
+            ident->depth_ = 0;
+            ident->slot_ = static_cast<int>(i);
+            return;
+        }
+    }
+
+    // 尚未定义的名字也分配全局槽位, 之后 (如 REPL 的下一行) 定义时即可直接访问
+    ident->scope_ = ast::Identifier::Scope::GLOBAL;
+    ident->depth_ = 0;
+    ident->slot_ = globals_.globalSlot(ident->value_);
+}
+
+void Resolver::resolveFunctionLiteral(ast::FunctionLiteral *func)
+{
+    scopes_.emplace_back();
+    Scope &scope = scopes_.back();
+    scope.names = std::make_shared<std::vector<std::string>>();
+    for (const auto &p : func->parameters_) {
+        declare(scope, p->value_);
+    }
+    if (func->body_) {
+        hoist(func->body_, scope);
+    }
+    func->locals_ = scope.names;
+
+    ast::ForEachChild(func, [this](ast::Node *child) { resolveNode(child); });
+    scopes_.pop_back();
+}
+
+} // namespace evaluator
+} // namespace dragon
@@ -0,0 +1,50 @@
+//
+// 静态解析: 求值前为每个标识符确定 (depth, slot) 地址, 或标记为全局变量/内置函数
+//
+
+#ifndef DRAGON_RESOLVER_H
+#define DRAGON_RESOLVER_H
+
+#include "ast.h"
+#include "environment.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dragon {
+namespace evaluator {
+
+// 作用域规则与求值器一致: 只有函数调用会产生新环境, 块语句不会.
+// 同一函数内的 let 会提升到函数开头分配槽位, 这样内层函数可以引用外层后定义的变量;
+// 赋值前读取槽位为空, 由求值器按名字兜底查找. 字符串字面量驻留到全局环境的驻留表中.
+class Resolver {
+public:
+    // globals 为求值时使用的全局环境, 全局变量的槽位在其中分配
+    explicit Resolver(Environment &globals) : globals_(globals) {}
+
+    void resolve(ast::Program *program);
+
+private:
+    struct Scope {
+        std::map<std::string, int> slots;
+        std::shared_ptr<std::vector<std::string>> names;
+    };
+
+    void hoist(ast::Node *node, Scope &scope);
+    void declare(Scope &scope, const std::string &name);
+
+    void resolveNode(ast::Node *node);
+    void resolveIdentifier(ast::Identifier *ident);
+    void resolveFunctionLiteral(ast::FunctionLiteral *func);
+
+private:
+    Environment &globals_;
+    std::vector<Scope> scopes_;     // 由外到内的函数作用域, 不含全局作用域
+};
+
+} // namespace evaluator
+} // namespace dragon
+
+#endif //DRAGON_RESOLVER_H
@@ -0,0 +1,576 @@
+//
+// 显式栈求值: 每个待求值的节点是任务栈上的一项, 子节点的结果依次压入值栈,
+// 节点按 state 记录进行到哪一步, 全部子节点求值完毕后弹出它们并压入自己的结果
+//
+
+#include "stack_evaluator.h"
+#include "folder.h"
+#include "resolver.h"
+
+#include <iterator>
+#include <vector>
+
+namespace dragon {
+namespace evaluator {
+
+namespace {
+size_t g_maxDepth = StackEvaluator::kDefaultMaxDepth;
+
+// 标记各节点的子树中是否含有调用; 函数字面量本身不含, 其函数体单独标记
+bool markCalls(const ast::Node* node) {
+    if (!node) {
+        return false;
+    }
+    bool calls = false;
+    auto mark = [&calls](const ast::Node* child) { calls = markCalls(child) || calls; };
+    switch (node->Kind()) {
+    case ast::NodeKind::PROGRAM:
+        for (auto stmt : static_cast<const ast::Program*>(node)->statements_) {
+            mark(stmt);
+        }
+        break;
+    case ast::NodeKind::BLOCK_STATEMENT:
+        for (auto stmt : static_cast<const ast::BlockStatement*>(node)->statements_) {
+            mark(stmt);
+        }
+        break;
+    case ast::NodeKind::EXPRESSION_STATEMENT:
+        mark(static_cast<const ast::ExpressionStatement*>(node)->expression_);
+        break;
+    case ast::NodeKind::RETURN_STATEMENT:
+        mark(static_cast<const ast::ReturnStatement*>(node)->returnValue_);
+        break;
+    case ast::NodeKind::LET_STATEMENT:
+        mark(static_cast<const ast::LetStatement*>(node)->value_);
+        break;
+    case ast::NodeKind::PREFIX_EXPRESSION:
+        mark(static_cast<const ast::PrefixExpression*>(node)->right_);
+        break;
+    case ast::NodeKind::INFIX_EXPRESSION: {
+        auto infix = static_cast<const ast::InfixExpression*>(node);
+        mark(infix->left_);
+        mark(infix->right_);
+        break;
+    }
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto ie = static_cast<const ast::IfExpression*>(node);
+        mark(ie->condition_);
+        mark(ie->consequence_);
+        mark(ie->alternative_);
+        break;
+    }
+    case ast::NodeKind::ARRAY_LITERAL:
+        for (auto e : static_cast<const ast::ArrayLiteral*>(node)->elements_) {
+            mark(e);
+        }
+        break;
+    case ast::NodeKind::INDEX_EXPRESSION: {
+        auto index = static_cast<const ast::IndexExpression*>(node);
+        mark(index->left_);
+        mark(index->index_);
+        break;
+    }
+    case ast::NodeKind::HASH_LITERAL:
+        for (const auto& pair : static_cast<const ast::HashLiteral*>(node)->pairs_) {
+            mark(pair.first);
+            mark(pair.second);
+        }
+        break;
+    case ast::NodeKind::FUNCTION_LITERAL:
+        markCalls(static_cast<const ast::FunctionLiteral*>(node)->body_);
+        break;
+    case ast::NodeKind::CALL_EXPRESSION: {
+        auto call = static_cast<const ast::CallExpression*>(node);
+        mark(call->function_);
+        for (auto arg : call->arguments_) {
+            mark(arg);
+        }
+        calls = true;
+        break;
+    }
+    case ast::NodeKind::IDENTIFIER:
+    case ast::NodeKind::BOOLEAN:
+    case ast::NodeKind::INTEGER_LITERAL:
+    case ast::NodeKind::STRING_LITERAL:
+        break;
+    }
+    node->hasCall_ = calls;
+    return calls;
+}
+
+class Machine {
+public:
+    explicit Machine(size_t maxDepth) : maxDepth_(maxDepth) {}
+
+    object::Value run(const ast::Node* node, const std::shared_ptr<Environment>& env);
+
+private:
+    // 节点的位置. VALUE: 值被表达式使用, 其中 return 的值不离开函数, 与 Evaluator::eval 相同;
+    // STATEMENT: 程序或函数体中的语句 (含 if 的分支), return 离开函数;
+    // TAIL: 另外结果即函数的返回值, 与 Evaluator::evalTail 的 result 相同
+    enum class Pos : uint8_t { VALUE, STATEMENT, TAIL };
+    // node 为空表示函数调用的边界, 其下方是调用者的任务
+    struct Task {
+        const ast::Node* node;
+        Pos pos;
+        uint32_t state;
+        size_t base;        // 开始求值子节点时值栈的高度
+    };
+    // 正在执行的函数: 任务栈与值栈在调用时的高度, 尾调用时回退到这里
+    struct Frame {
+        std::shared_ptr<Environment> env;
+        size_t tasks;
+        size_t values;
+    };
+
+    // 开始求值 node, 压入了新任务时返回 true. 不含调用的子树交给 Evaluator 递归求值,
+    // 其递归深度受源码嵌套层数限制, 与调用深度无关; 此时结果已在值栈上, 当前任务可以接着执行
+    bool enter(const ast::Node* node, Pos pos) {
+        if (!node) {
+            values_.emplace_back();
+            return false;
+        }
+        if (!node->hasCall_) {
+            values_.push_back(Evaluator::eval(node, frames_.back().env));
+            return false;
+        }
+        tasks_.push_back({node, pos, 0, values_.size()});
+        return true;
+    }
+    // 当前任务结束, 结果为 val
+    void finish(object::Value val) {
+        tasks_.pop_back();
+        values_.push_back(std::move(val));
+    }
+    // 当前任务以值栈顶的错误结束, 丢弃已求值的子节点
+    void fail(size_t base) {
+        auto err = std::move(values_.back());
+        values_.resize(base);
+        finish(std::move(err));
+    }
+    bool inFunction() const { return frames_.size() > 1; }
+
+    void step();
+    void statements(const std::vector<ast::Statement*>& stmts, bool program);
+    void let(const ast::LetStatement* let);
+    void array(const ast::ArrayLiteral* array);
+    void hash(const ast::HashLiteral* hash);
+    void call(const ast::CallExpression* call);
+    void apply(object::Value fn, std::vector<object::Value> args, bool tail);
+    // 语句序列中第 i 条 (共 n 条) 语句的位置
+    static Pos statementPos(Pos pos, size_t i, size_t n) {
+        return pos == Pos::TAIL && i + 1 < n ? Pos::STATEMENT : pos;
+    }
+    void leave();
+
+    size_t maxDepth_;
+    std::vector<Task> tasks_;
+    std::vector<object::Value> values_;
+    std::vector<Frame> frames_;
+};
+
+object::Value Machine::run(const ast::Node* node, const std::shared_ptr<Environment>& env) {
+    frames_.push_back({env, 0, 0});
+    enter(node, Pos::STATEMENT);
+    while (!tasks_.empty()) {
+        if (tasks_.back().node) {
+            step();
+        } else {
+            leave();
+        }
+    }
+    return std::move(values_.back());
+}
+
+// 执行当前任务的一步. 压入子任务后当前任务的引用即失效, 须先改好 state;
+// enter 没有压入任务时引用仍然有效, 直接继续下一步
+void Machine::step() {
+    auto& task = tasks_.back();
+    auto node = task.node;
+    const auto& env = frames_.back().env;
+
+    switch (node->Kind()) {
+    case ast::NodeKind::PROGRAM:
+        return statements(static_cast<const ast::Program*>(node)->statements_, true);
+
+    case ast::NodeKind::BLOCK_STATEMENT:
+        return statements(static_cast<const ast::BlockStatement*>(node)->statements_, false);
+
+    case ast::NodeKind::EXPRESSION_STATEMENT: {
+        auto pos = task.pos;
+        tasks_.pop_back();
+        enter(static_cast<const ast::ExpressionStatement*>(node)->expression_, pos);
+        return;
+    }
+
+    case ast::NodeKind::RETURN_STATEMENT:
+        if (task.state == 0) {
+            task.state = 1;
+            // 值被使用的 return 不离开函数, 其中的调用不是尾调用
+            auto pos = task.pos != Pos::VALUE && inFunction() ? Pos::TAIL : Pos::VALUE;
+            if (enter(static_cast<const ast::ReturnStatement*>(node)->returnValue_, pos)) {
+                return;
+            }
+        }
+        values_.back() = object::Value::Return(std::move(values_.back()));
+        tasks_.pop_back();
+        return;
+
+    case ast::NodeKind::LET_STATEMENT:
+        return let(static_cast<const ast::LetStatement*>(node));
+
+    case ast::NodeKind::INTEGER_LITERAL:
+    case ast::NodeKind::BOOLEAN:
+    case ast::NodeKind::STRING_LITERAL:
+    case ast::NodeKind::IDENTIFIER:
+    case ast::NodeKind::FUNCTION_LITERAL:
+        // 叶子节点不含调用, 由 enter 直接求值, 不会作为任务出现
+        return finish(Evaluator::eval(node, env));
+
+    case ast::NodeKind::PREFIX_EXPRESSION: {
+        auto prefix = static_cast<const ast::PrefixExpression*>(node);
+        if (task.state == 0) {
+            task.state = 1;
+            if (enter(prefix->right_, Pos::VALUE)) {
+                return;
+            }
+        }
+        auto& right = values_.back();
+        if (!right.IsError()) {
+            right = Evaluator::evalPrefixExpression(prefix->op_, right);
+        }
+        tasks_.pop_back();
+        return;
+    }
+
+    case ast::NodeKind::INFIX_EXPRESSION: {
+        auto infix = static_cast<const ast::InfixExpression*>(node);
+        switch (task.state) {
+        case 0:
+            task.state = 1;
+            if (enter(infix->left_, Pos::VALUE)) {
+                return;
+            }
+            [[fallthrough]];
+        case 1:
+            if (values_.back().IsError()) {
+                tasks_.pop_back();
+                return;
+            }
+            task.state = 2;
+            if (enter(infix->right_, Pos::VALUE)) {
+                return;
+            }
+            [[fallthrough]];
+        default:
+            break;
+        }
+        auto right = std::move(values_.back());
+        values_.pop_back();
+        auto& left = values_.back();
+        left = right.IsError() ? std::move(right) : Evaluator::evalInfixExpression(infix->op_, left, right);
+        tasks_.pop_back();
+        return;
+    }
+
+    case ast::NodeKind::IF_EXPRESSION: {
+        auto ie = static_cast<const ast::IfExpression*>(node);
+        if (task.state == 0) {
+            task.state = 1;
+            if (enter(ie->condition_, Pos::VALUE)) {
+                return;
+            }
+        }
+        auto pos = task.pos;
+        auto& condition = values_.back();
+        if (condition.IsError()) {
+            tasks_.pop_back();
+            return;
+        }
+        bool truthy = Evaluator::isTruthy(condition);
+        values_.pop_back();
+        tasks_.pop_back();
+        if (truthy) {
+            enter(ie->consequence_, pos);
+        } else if (ie->alternative_) {
+            enter(ie->alternative_, pos);
+        } else {
+            values_.push_back(object::Value::Nil());
+        }
+        return;
+    }
+
+    case ast::NodeKind::ARRAY_LITERAL:
+        return array(static_cast<const ast::ArrayLiteral*>(node));
+
+    case ast::NodeKind::INDEX_EXPRESSION: {
+        auto index = static_cast<const ast::IndexExpression*>(node);
+        switch (task.state) {
+        case 0:
+            task.state = 1;
+            if (enter(index->left_, Pos::VALUE)) {
+                return;
+            }
+            [[fallthrough]];
+        case 1:
+            if (values_.back().IsError()) {
+                tasks_.pop_back();
+                return;
+            }
+            task.state = 2;
+            if (enter(index->index_, Pos::VALUE)) {
+                return;
+            }
+            [[fallthrough]];
+        default:
+            break;
+        }
+        auto idx = std::move(values_.back());
+        values_.pop_back();
+        auto& left = values_.back();
+        left = idx.IsError() ? std::move(idx) : Evaluator::evalIndexExpression(left, idx);
+        tasks_.pop_back();
+        return;
+    }
+
+    case ast::NodeKind::HASH_LITERAL:
+        return hash(static_cast<const ast::HashLiteral*>(node));
+
+    case ast::NodeKind::CALL_EXPRESSION:
+        return call(static_cast<const ast::CallExpression*>(node));
+    }
+    finish(object::Value());
+}
+
+// 程序与块: 只保留最后一条语句的值; 遇到 return 或错误时提前结束, 程序在此解开 return
+void Machine::statements(const std::vector<ast::Statement*>& stmts, bool program) {
+    auto& task = tasks_.back();
+    size_t n = stmts.size();
+    if (task.state == 0) {
+        if (n == 0) {
+            return finish(object::Value());
+        }
+        if (n == 1 && !program) {
+            // 只有一条语句的块, 其值就是这条语句的值
+            auto pos = task.pos;
+            tasks_.pop_back();
+            enter(stmts[0], pos);
+            return;
+        }
+        task.state = 1;
+        if (enter(stmts[0], statementPos(task.pos, 0, n))) {
+            return;
+        }
+    }
+
+    for (;;) {
+        auto& val = values_.back();
+        size_t next = task.state;
+        if (val.IsAbrupt() || next == n) {
+            if (program) {
+                val.ClearReturn();
+            }
+            tasks_.pop_back();
+            return;
+        }
+        values_.pop_back();
+        task.state = static_cast<uint32_t>(next + 1);
+        if (enter(stmts[next], statementPos(task.pos, next, n))) {
+            return;
+        }
+    }
+}
+
+void Machine::let(const ast::LetStatement* let) {
+    auto& task = tasks_.back();
+    if (task.state == 0) {
+        task.state = 1;
+        if (enter(let->value_, Pos::VALUE)) {
+            return;
+        }
+    }
+    tasks_.pop_back();
+    auto& val = values_.back();
+    if (val.IsError()) {
+        return;
+    }
+    const auto& env = frames_.back().env;
+    auto name = let->name_;
+    if (name->scope_ == ast::Identifier::Scope::LOCAL) {
+        env->setLocal(name->slot_, std::move(val));
+    } else if (name->scope_ == ast::Identifier::Scope::GLOBAL) {
+        env->setGlobal(name->slot_, std::move(val));
+    } else {
+        env->set(name->value_, std::move(val));
+    }
+    val = object::Value();
+}
+
+void Machine::array(const ast::ArrayLiteral* array) {
+    auto& task = tasks_.back();
+    const auto& elements = array->elements_;
+    for (;;) {
+        if (task.state > 0 && values_.back().IsError()) {
+            return fail(task.base);
+        }
+        if (task.state == elements.size()) {
+            break;
+        }
+        if (enter(elements[task.state++], Pos::VALUE)) {
+            return;
+        }
+    }
+
+    std::vector<object::Value> eles(std::make_move_iterator(values_.begin() + task.base),
+                                    std::make_move_iterator(values_.end()));
+    values_.resize(task.base);
+    finish(Evaluator::makeArray(std::move(eles)));
+}
+
+// 键和值交替求值: state 为奇数时刚求完键, 为偶数时刚求完值
+void Machine::hash(const ast::HashLiteral* hash) {
+    auto& task = tasks_.back();
+    const auto& pairs = hash->pairs_;
+    for (;;) {
+        if (task.state > 0) {
+            const auto& val = values_.back();
+            if (val.IsError()) {
+                return fail(task.base);
+            }
+            if (task.state % 2 == 1) {
+                uint64_t code = 0;
+                if (!object::HashCodeOf(val, code)) {
+                    values_.back() = Evaluator::unusableHashKey(val);
+                    return fail(task.base);
+                }
+                if (enter(pairs[task.state++ / 2].second, Pos::VALUE)) {
+                    return;
+                }
+                continue;
+            }
+        }
+        if (task.state / 2 == pairs.size()) {
+            break;
+        }
+        if (enter(pairs[task.state++ / 2].first, Pos::VALUE)) {
+            return;
+        }
+    }
+
+    object::HashTable table;
+    table.reserve(pairs.size());
+    for (size_t i = task.base; i < values_.size(); i += 2) {
+        uint64_t code = 0;
+        object::HashCodeOf(values_[i], code);
+        table.set(code, std::move(values_[i]), std::move(values_[i + 1]));
+    }
+    values_.resize(task.base);
+    finish(Evaluator::makeHash(std::move(table)));
+}
+
+// state 为 0 时求被调函数, 之后第 i 次进入时刚求完第 i 个值
+void Machine::call(const ast::CallExpression* call) {
+    auto& task = tasks_.back();
+    const auto& arguments = call->arguments_;
+    if (task.state == 0) {
+        task.state = 1;
+        if (enter(call->function_, Pos::VALUE)) {
+            return;
+        }
+    }
+    for (;;) {
+        if (values_.back().IsError()) {
+            return fail(task.base);
+        }
+        if (task.state > arguments.size()) {
+            break;
+        }
+        if (enter(arguments[task.state++ - 1], Pos::VALUE)) {
+            return;
+        }
+    }
+
+    bool tail = task.pos == Pos::TAIL;
+    auto fn = std::move(values_[task.base]);
+    std::vector<object::Value> args(std::make_move_iterator(values_.begin() + task.base + 1),
+                                    std::make_move_iterator(values_.end()));
+    values_.resize(task.base);
+    tasks_.pop_back();
+    apply(std::move(fn), std::move(args), tail);
+}
+
+// 调用函数: 内置函数和 NativeFunction 直接执行; 其他函数压入新帧后求值函数体, 尾调用则替换当前帧
+void Machine::apply(object::Value fn, std::vector<object::Value> args, bool tail) {
+    auto type = fn.Type();
+    if (type == object::Object::ObjectType::BUILTIN_OBJ) {
+        values_.push_back(static_cast<object::Builtin*>(fn.get())->fn_(args));
+        return;
+    }
+    if (type == object::Object::ObjectType::NATIVE_FUNCTION_OBJ) {
+        values_.push_back(static_cast<const object::NativeFunction*>(fn.get())->call(std::move(args)));
+        return;
+    }
+    if (type != object::Object::ObjectType::FUNCTION_OBJ) {
+        values_.push_back(Evaluator::newError("not a function: %s", dragon::object::GetTypeString(type).c_str()));
+        return;
+    }
+
+    auto function = std::static_pointer_cast<object::Function>(fn.AsObject());
+    if (function->parameters_.size() != args.size()) {
+        values_.push_back(Evaluator::newError("wrong number of arguments: want=%d, got=%d",
+                                              static_cast<int>(function->parameters_.size()),
+                                              static_cast<int>(args.size())));
+        return;
+    }
+    auto env = Evaluator::extendFunctionEnv(function, args);
+    if (tail && inFunction()) {
+        // 当前帧中剩下的任务只是把结果原样传出, 可以直接丢弃
+        auto& frame = frames_.back();
+        tasks_.resize(frame.tasks);
+        values_.resize(frame.values);
+        frame.env = std::move(env);
+    } else {
+        if (frames_.size() > maxDepth_) {
+            values_.push_back(Evaluator::newError("maximum call depth exceeded: %zu", maxDepth_));
+            return;
+        }
+        tasks_.push_back({nullptr, Pos::VALUE, 0, values_.size()});
+        frames_.push_back({std::move(env), tasks_.size(), values_.size()});
+    }
+    enter(function->body_, Pos::TAIL);
+}
+
+// 函数体求值完毕: 弹出帧, 返回值留在值栈上
+void Machine::leave() {
+    values_.back().ClearReturn();
+    frames_.pop_back();
+    tasks_.pop_back();
+}
+} // namespace
+
+std::shared_ptr<object::Object> StackEvaluator::eval(const std::shared_ptr<ast::Program>& program,
+                                                     const std::shared_ptr<Environment>& env) {
+    if (!program) {
+        return nullptr;
+    }
+    FoldConstants(program.get());
+    Resolver(*env).resolve(program.get());
+    markCalls(program.get());
+    return eval(program.get(), env).ToObject();
+}
+
+object::Value StackEvaluator::eval(const ast::Node* node, const std::shared_ptr<Environment>& env) {
+    Machine machine(g_maxDepth);
+    return machine.run(node, env);
+}
+
+void StackEvaluator::setMaxDepth(size_t depth) {
+    g_maxDepth = depth;
+}
+
+size_t StackEvaluator::maxDepth() {
+    return g_maxDepth;
+}
+
+} // namespace evaluator
+} // namespace dragon
@@ -0,0 +1,35 @@
+#ifndef __STACK_EVALUATOR_H__
+#define __STACK_EVALUATOR_H__
+
+#include "evaluator.h"
+#include <cstddef>
+#include <memory>
+
+namespace dragon {
+namespace evaluator {
+
+// 用堆上的任务栈和值栈代替 C++ 递归的求值器, 语义与 Evaluator 一致.
+// 函数调用不占用 C++ 栈, C++ 栈很小时 (如 ulimit -s 256) 也能执行深度递归的脚本; 但 enter() 把不含调用的子树
+// 直接交给递归的 Evaluator::eval, 这部分占用的栈随源码的嵌套深度增长, 不随调用深度增长.
+// 与其他求值器一样共享进程内的全局状态 (字符串驻留表, gc::Heap, AST 节点上的缓存), 不能在多个线程中同时求值;
+// 调用深度超过 maxDepth() 时以错误结束, 而不是耗尽栈后崩溃. 尾调用复用当前帧, 不计入深度;
+// 基线 JIT 生成的代码在 C++ 栈上递归, 因此这里不使用.
+// 运算的实现复用 Evaluator; 深度嵌套的数组/哈希在释放和 Inspect 时也不递归 (见 object.cpp)
+class StackEvaluator {
+public:
+    static constexpr size_t kDefaultMaxDepth = 100000;
+
+    // 对外入口: 常量折叠, 静态解析后求值
+    static std::shared_ptr<object::Object> eval(const std::shared_ptr<ast::Program>& program,
+                                                const std::shared_ptr<Environment>& env);
+    // 求值已解析过的节点
+    static object::Value eval(const ast::Node* node, const std::shared_ptr<Environment>& env);
+
+    static void setMaxDepth(size_t depth);
+    static size_t maxDepth();
+};
+
+} // namespace evaluator
+} // namespace dragon
+
+#endif
@@ -0,0 +1,171 @@
+//
+// 循环垃圾回收: 对象仍由 shared_ptr 管理, 回收器只负责找出并断开不可达的引用环
+//
+
+#include "gc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+namespace dragon {
+namespace gc {
+
+Heap &Heap::Instance()
+{
+    static Heap heap;
+    return heap;
+}
+
+void Heap::setMinThreshold(size_t n)
+{
+    minThreshold_ = std::max<size_t>(n, 1);
+    threshold_ = minThreshold_;
+}
+
+void Heap::track(const std::shared_ptr<Collectable> &obj)
+{
+    if (!obj || obj->gcTracked_) {
+        return;
+    }
+    obj->gcTracked_ = true;
+    entries_.push_back(Entry{obj, obj.get()});
+
+    if (enabled_ && ++allocated_ >= threshold_) {
+        collect();
+    }
+}
+
+namespace {
+using Index = std::unordered_map<const Collectable *, size_t>;
+
+// 减去登记对象之间的引用, 剩下的就是外部引用
+class Decrement : public Visitor {
+public:
+    Decrement(const Index &index, std::vector<long> &refs) : index_(index), refs_(refs) {}
+    void visit(const Collectable *obj) override {
+        auto it = index_.find(obj);
+        if (it != index_.end()) {
+            refs_[it->second]--;
+        }
+    }
+private:
+    const Index &index_;
+    std::vector<long> &refs_;
+};
+
+class Mark : public Visitor {
+public:
+    Mark(const Index &index, std::vector<char> &reachable, std::vector<size_t> &pending)
+        : index_(index), reachable_(reachable), pending_(pending) {}
+    void visit(const Collectable *obj) override {
+        auto it = index_.find(obj);
+        if (it != index_.end() && !reachable_[it->second]) {
+            reachable_[it->second] = 1;
+            pending_.push_back(it->second);
+        }
+    }
+private:
+    const Index &index_;
+    std::vector<char> &reachable_;
+    std::vector<size_t> &pending_;
+};
+} // namespace
+
+size_t Heap::collect()
+{
+    if (collecting_) {
+        return 0;
+    }
+    collecting_ = true;
+    auto start = std::chrono::steady_clock::now();
+
+    // 已经被引用计数释放的对象直接移除
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [](const Entry &e) { return e.ref.expired(); }),
+                   entries_.end());
+
+    size_t n = entries_.size();
+    Index index;
+    index.reserve(n);
+    std::vector<long> refs(n);
+    for (size_t i = 0; i < n; ++i) {
+        index[entries_[i].ptr] = i;
+        refs[i] = entries_[i].ref.use_count();
+    }
+
+    Decrement decrement(index, refs);
+    for (size_t i = 0; i < n; ++i) {
+        entries_[i].ptr->traverse(decrement);
+    }
+
+    std::vector<char> reachable(n, 0);
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < n; ++i) {
+        if (refs[i] > 0) {
+            reachable[i] = 1;
+            pending.push_back(i);
+        }
+    }
+    Mark mark(index, reachable, pending);
+    while (!pending.empty()) {
+        size_t i = pending.back();
+        pending.pop_back();
+        entries_[i].ptr->traverse(mark);
+    }
+
+    // 先持有所有垃圾对象再断开引用, 避免 clear 过程中对象被提前析构
+    std::vector<std::shared_ptr<Collectable>> garbage;
+    std::vector<Entry> survivors;
+    survivors.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (reachable[i]) {
+            survivors.push_back(std::move(entries_[i]));
+        } else if (auto obj = entries_[i].ref.lock()) {
+            garbage.push_back(std::move(obj));
+        }
+    }
+    entries_.swap(survivors);
+    for (auto &obj : garbage) {
+        obj->clear();
+        obj->gcTracked_ = false;
+    }
+    size_t freed = garbage.size();
+    garbage.clear();
+
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    stats_.collections++;
+    stats_.freed += freed;
+    stats_.lastFreed = freed;
+    stats_.lastSurvivors = entries_.size();
+    stats_.lastMicros = static_cast<uint64_t>(micros);
+    stats_.totalMicros += static_cast<uint64_t>(micros);
+
+    allocated_ = 0;
+    threshold_ = std::max(minThreshold_, static_cast<size_t>(entries_.size() * growthFactor_));
+    collecting_ = false;
+    return freed;
+}
+
+Stats Heap::stats() const
+{
+    Stats s = stats_;
+    s.tracked = entries_.size();
+    s.threshold = threshold_;
+    return s;
+}
+
+std::ostream &operator<<(std::ostream &out, const Stats &stats)
+{
+    return out << "gc: collections=" << stats.collections
+               << " freed=" << stats.freed
+               << " last_freed=" << stats.lastFreed
+               << " survivors=" << stats.lastSurvivors
+               << " tracked=" << stats.tracked
+               << " threshold=" << stats.threshold
+               << " time_us=" << stats.totalMicros;
+}
+
+} // namespace gc
+} // namespace dragon
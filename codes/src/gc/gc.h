@@ -0,0 +1,100 @@
+//
+// 循环垃圾回收: 对象仍由 shared_ptr 管理, 回收器只负责找出并断开不可达的引用环
+// (典型的是 Function -> Environment -> Function)
+//
+
+#ifndef DRAGON_GC_H
+#define DRAGON_GC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace dragon {
+namespace gc {
+
+class Collectable;
+
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+    virtual void visit(const Collectable *obj) = 0;
+};
+
+// 可能参与引用环的对象 (环境, 函数, 容器) 实现此接口
+class Collectable {
+public:
+    virtual ~Collectable() = default;
+
+    // 对持有的每个 shared_ptr 引用调用一次 visitor, 必须与实际持有的引用一一对应
+    virtual void traverse(Visitor &visitor) const = 0;
+    // 断开持有的引用, 只对判定为垃圾的对象调用
+    virtual void clear() = 0;
+
+    bool gcTracked() const { return gcTracked_; }
+
+private:
+    friend class Heap;
+    bool gcTracked_ = false;
+};
+
+struct Stats {
+    uint64_t collections = 0;
+    uint64_t freed = 0;             // 累计回收的对象数
+    uint64_t lastFreed = 0;
+    uint64_t lastSurvivors = 0;
+    uint64_t totalMicros = 0;       // 累计耗时
+    uint64_t lastMicros = 0;
+    size_t tracked = 0;             // 当前登记的对象数 (含已释放但尚未清理的)
+    size_t threshold = 0;           // 下次回收前允许新增的登记数
+};
+
+std::ostream &operator<<(std::ostream &out, const Stats &stats);
+
+// 标记-清除: 回收时先用 use_count 减去登记对象之间的引用数, 剩余大于 0 的对象被解释器栈,
+// REPL 环境等外部持有, 作为根; 从根出发标记, 未被标记的对象构成不可达的环, 调用 clear 断开.
+// 外部引用由引用计数精确给出, 因此任何时刻回收都是安全的, 不需要登记 C++ 栈上的根
+class Heap {
+public:
+    static Heap &Instance();
+
+    // 登记对象, 新增数量达到阈值时触发一次回收
+    void track(const std::shared_ptr<Collectable> &obj);
+    // 立即回收, 返回本次释放的对象数
+    size_t collect();
+
+    // 阈值调整: 回收后阈值 = max(minThreshold, 存活数 * growthFactor)
+    void setMinThreshold(size_t n);
+    void setGrowthFactor(double f) { growthFactor_ = f; }
+    size_t minThreshold() const { return minThreshold_; }
+    double growthFactor() const { return growthFactor_; }
+
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool enabled() const { return enabled_; }
+
+    Stats stats() const;
+
+private:
+    Heap() = default;
+
+    struct Entry {
+        std::weak_ptr<Collectable> ref;
+        Collectable *ptr;
+    };
+
+    std::vector<Entry> entries_;
+    size_t allocated_ = 0;          // 上次回收后新增的登记数
+    size_t minThreshold_ = 1024;
+    size_t threshold_ = 1024;
+    double growthFactor_ = 2.0;
+    bool enabled_ = true;
+    bool collecting_ = false;
+    Stats stats_;
+};
+
+} // namespace gc
+} // namespace dragon
+
+#endif //DRAGON_GC_H
@@ -0,0 +1,114 @@
+#include "gc_test.h"
+#include "gc.h"
+#include "environment.hpp"
+#include "evaluator.h"
+#include "evaluator_test.h"
+#include "lexer.h"
+#include "parser.h"
+#include "test_tool.h"
+
+#include <memory>
+#include <string>
+
+using namespace dragon;
+
+static std::shared_ptr<object::Object> evalIn(const std::string &input, const std::shared_ptr<Environment> &env)
+{
+    lexer::Lexer lexer(input);
+    parser::Parser parser(lexer);
+    auto program = parser.parseProgram();
+    return evaluator::Evaluator::eval(program, env);
+}
+
+static std::shared_ptr<object::Object> gcEval(const std::string &input)
+{
+    return evalIn(input, std::make_shared<Environment>());
+}
+
+// 全局环境 <-> 递归函数 构成的环, 环境被释放后只能由 gc 回收
+void TestGCCycle()
+{
+    auto &heap = gc::Heap::Instance();
+    heap.collect();
+
+    std::weak_ptr<Environment> weakEnv;
+    std::weak_ptr<object::Object> weakFn;
+    {
+        auto env = std::make_shared<Environment>();
+        weakEnv = env;
+        weakFn = evalIn("let f = fn() { f }; f", env);
+
+        // 仍被外部持有, 不能回收
+        heap.collect();
+        ASSERT_TRUE(!weakFn.expired());
+        auto result = evalIn("f()", env);
+        ASSERT_TRUE(result && result->Type() == object::Object::ObjectType::FUNCTION_OBJ);
+    }
+    ASSERT_TRUE(!weakEnv.expired());
+
+    auto freed = heap.collect();
+    ASSERT_TRUE(weakEnv.expired());
+    ASSERT_TRUE(weakFn.expired());
+    ASSERT_TRUE(freed >= 2);
+
+    // 经由数组成环
+    {
+        auto env = std::make_shared<Environment>();
+        weakEnv = env;
+        auto result = evalIn("let g = fn() { let a = [fn() { a }]; a }; g()", env);
+        ASSERT_TRUE(result && result->Type() == object::Object::ObjectType::ARRAY_OBJ);
+        weakFn = result;
+    }
+    heap.collect();
+    ASSERT_TRUE(weakEnv.expired());
+    ASSERT_TRUE(weakFn.expired());
+}
+
+// 达到阈值时自动回收
+void TestGCThreshold()
+{
+    auto &heap = gc::Heap::Instance();
+    auto minThreshold = heap.minThreshold();
+    heap.collect();
+    heap.setMinThreshold(16);
+    auto before = heap.stats();
+
+    auto result = gcEval(R"(
+        let make = fn(n) {
+            let g = fn(x) { if (x == 0) { 0 } else { g(x - 1) } };
+            g(n)
+        };
+        let loop = fn(i) { if (i == 0) { 0 } else { make(3); loop(i - 1) } };
+        loop(200))");
+    ASSERT_EQ(result->Inspect(), "0");
+
+    auto after = heap.stats();
+    ASSERT_TRUE(after.collections > before.collections);
+    ASSERT_TRUE(after.freed - before.freed >= 150);
+    ASSERT_TRUE(after.tracked < 64);
+
+    heap.setMinThreshold(minThreshold);
+    heap.collect();
+}
+
+// 每次登记都回收, 检查回收不会破坏求值中仍在使用的对象
+void TestGCStress()
+{
+    auto &heap = gc::Heap::Instance();
+    auto minThreshold = heap.minThreshold();
+    heap.setMinThreshold(1);
+    heap.setGrowthFactor(0);
+
+    TestEvalSemantics(gcEval);
+
+    heap.setGrowthFactor(2.0);
+    heap.setMinThreshold(minThreshold);
+    heap.collect();
+}
+
+void TestGC()
+{
+    TestGCCycle();
+    TestGCThreshold();
+    TestGCStress();
+}
@@ -0,0 +1,6 @@
+#ifndef DRAGON_GC_TEST_H
+#define DRAGON_GC_TEST_H
+
+void TestGC();
+
+#endif //DRAGON_GC_TEST_H
@@ -0,0 +1,598 @@
+//
+// 基线 JIT: 按语法树逐节点生成栈式 x86-64 代码, 表达式结果放在 rax 中
+//
+
+#include "jit.h"
+
+#include <cstring>
+#include <initializer_list>
+
+#ifdef DRAGON_JIT
+#include <sys/mman.h>
+#endif
+
+namespace dragon {
+namespace jit {
+
+namespace {
+bool g_enabled = true;
+}
+
+void SetEnabled(bool enabled)
+{
+    g_enabled = enabled;
+}
+
+bool Enabled()
+{
+    return g_enabled;
+}
+
+#ifdef DRAGON_JIT
+
+NativeCode::NativeCode(void *memory, size_t size, size_t entry, size_t params, Type result,
+                       std::vector<SelfRef> selfRefs)
+    : memory_(memory), size_(size), entry_(entry), params_(params), result_(result),
+      selfRefs_(std::move(selfRefs))
+{
+}
+
+NativeCode::~NativeCode()
+{
+    munmap(memory_, size_);
+}
+
+bool NativeCode::run(const int64_t *args, int64_t &result) const
+{
+    using Entry = int64_t (*)(const int64_t *, int64_t *);
+    Entry entry;
+    auto *address = static_cast<uint8_t *>(memory_) + entry_;
+    std::memcpy(&entry, &address, sizeof(entry));
+    int64_t bailed = 0;
+    result = entry(args, &bailed);
+    return bailed == 0;
+}
+
+namespace {
+
+// 只包含本 JIT 用到的指令编码
+class Emitter {
+public:
+    size_t pos() const { return code_.size(); }
+    const std::vector<uint8_t> &code() const { return code_; }
+
+    void emit(std::initializer_list<uint8_t> bytes) { code_.insert(code_.end(), bytes); }
+    void imm32(int32_t v) { append(&v, sizeof(v)); }
+    void imm64(int64_t v) { append(&v, sizeof(v)); }
+
+    void movRaxImm(int64_t v) {
+        if (v >= INT32_MIN && v <= INT32_MAX) {
+            emit({0x48, 0xC7, 0xC0});               // mov rax, imm32 (符号扩展)
+            imm32(static_cast<int32_t>(v));
+        } else {
+            emit({0x48, 0xB8});                     // mov rax, imm64
+            imm64(v);
+        }
+    }
+    void loadParam(size_t i) {                      // mov rax, [rbp + 16 + 8i]
+        emit({0x48, 0x8B, 0x85});
+        imm32(static_cast<int32_t>(16 + 8 * i));
+    }
+    void storeParam(size_t i) {                     // mov [rbp + 16 + 8i], rax
+        emit({0x48, 0x89, 0x85});
+        imm32(static_cast<int32_t>(16 + 8 * i));
+    }
+    void pushArg(size_t i) {                        // push qword [rdi + 8i]
+        emit({0xFF, 0xB7});
+        imm32(static_cast<int32_t>(8 * i));
+    }
+    void dropArgs(size_t n) {                       // add rsp, 8n
+        if (n > 0) {
+            emit({0x48, 0x81, 0xC4});
+            imm32(static_cast<int32_t>(8 * n));
+        }
+    }
+    void prologue() { emit({0x55, 0x48, 0x89, 0xE5}); }          // push rbp; mov rbp, rsp
+    void resetStack() { emit({0x48, 0x89, 0xEC}); }              // mov rsp, rbp
+    void epilogue() { emit({0x48, 0x89, 0xEC, 0x5D, 0xC3}); }    // mov rsp, rbp; pop rbp; ret
+
+    // rel32 跳转/调用, 目标已知时直接写入, 否则返回待回填的位置
+    void call(size_t target) { emit({0xE8}); rel32(target); }
+    void jmp(size_t target) { emit({0xE9}); rel32(target); }
+    size_t jmp() { emit({0xE9}); return hole(); }
+    size_t jz() { emit({0x0F, 0x84}); return hole(); }
+    size_t jne() { emit({0x0F, 0x85}); return hole(); }
+    void bind(size_t hole) {
+        int32_t rel = static_cast<int32_t>(pos() - (hole + 4));
+        std::memcpy(&code_[hole], &rel, sizeof(rel));
+    }
+
+private:
+    void append(const void *p, size_t n) {
+        auto bytes = static_cast<const uint8_t *>(p);
+        code_.insert(code_.end(), bytes, bytes + n);
+    }
+    void rel32(size_t target) {
+        imm32(static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(pos() + 4)));
+    }
+    size_t hole() {
+        size_t at = pos();
+        imm32(0);
+        return at;
+    }
+
+    std::vector<uint8_t> code_;
+};
+
+// 表达式的静态类型. NONE: 值不可用 (如没有 else 的 if), 只能出现在值被丢弃的位置;
+// NEVER: 不会正常结束 (return 或尾调用)
+enum class Ty : uint8_t { INT, BOOL, NONE, NEVER };
+
+// 语法位置. 解释器中 return 的值只沿语句向外传递; 被表达式使用时 (如 1 + if (c) { return 5; })
+// 只作为普通的值, 不离开函数. VALUE: 值被表达式使用, 其中的 return 不编译;
+// STATEMENT: 函数体或其中 if 分支的语句, return 离开函数; TAIL: 另外还是函数的结果, 自调用可跳回开头
+enum class Pos : uint8_t { VALUE, STATEMENT, TAIL };
+
+// 函数体编译. 布局: 偏移 0 处是函数体 (参数由调用方压栈, 位于 [rbp + 16 + 8i]),
+// 其后是供 C++ 调用的入口, 把参数数组压栈后调用函数体; 最后是退出桩.
+// 函数体遇到解释器会报错的情况 (除数为 0) 时跳到退出桩: 它按入口保存在 rbx 中的 rsp
+// 丢弃所有嵌套调用的栈帧, 恢复 rbp, 在 [rsi] 中写入 1 后返回, 由解释器从头执行这次调用.
+// 函数体不使用 rbx 和 rsi, 也没有副作用, 重新执行是安全的
+class FunctionCompiler {
+public:
+    FunctionCompiler(const object::Function &fn, Ty result) : fn_(fn), result_(result) {}
+
+    bool compile() {
+        auto &params = fn_.parameters_;
+        if (params.size() > kMaxParams) {
+            return false;
+        }
+        for (size_t i = 0; i < params.size(); ++i) {
+            if (params[i]->scope_ != ast::Identifier::Scope::LOCAL || paramIndex(params[i]->slot_) != i) {
+                return false;
+            }
+        }
+
+        e_.prologue();
+        loop_ = e_.pos();
+        Ty ty;
+        if (!block(fn_.body_, Pos::TAIL, ty) || (ty != result_ && ty != Ty::NEVER)) {
+            return false;
+        }
+        e_.epilogue();
+
+        entry_ = e_.pos();
+        e_.emit({0x55, 0x53, 0x48, 0x89, 0xE3});        // push rbp; push rbx; mov rbx, rsp
+        for (size_t i = params.size(); i-- > 0;) {
+            e_.pushArg(i);
+        }
+        e_.call(0);
+        e_.emit({0x48, 0x89, 0xDC, 0x5B, 0x5D, 0xC3});  // mov rsp, rbx; pop rbx; pop rbp; ret
+
+        for (auto hole : bailouts_) {
+            e_.bind(hole);
+        }
+        e_.emit({0x48, 0xC7, 0x06});                    // mov qword [rsi], 1
+        e_.imm32(1);
+        e_.emit({0x48, 0x89, 0xDC, 0x5B, 0x5D, 0xC3});  // mov rsp, rbx; pop rbx; pop rbp; ret
+        return true;
+    }
+
+    std::shared_ptr<const NativeCode> install() {
+        const auto &code = e_.code();
+        void *memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+        std::memcpy(memory, code.data(), code.size());
+        if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, code.size());
+            return nullptr;
+        }
+        auto type = result_ == Ty::INT ? NativeCode::Type::INTEGER : NativeCode::Type::BOOLEAN;
+        return std::make_shared<NativeCode>(memory, code.size(), entry_, fn_.parameters_.size(), type,
+                                            std::move(selfRefs_));
+    }
+
+private:
+    // 参数槽位对应的参数下标, 不是参数 (或有同名参数) 时返回 SIZE_MAX
+    size_t paramIndex(int slot) const {
+        size_t found = SIZE_MAX;
+        for (size_t i = 0; i < fn_.parameters_.size(); ++i) {
+            if (fn_.parameters_[i]->slot_ == slot) {
+                if (found != SIZE_MAX) {
+                    return SIZE_MAX;
+                }
+                found = i;
+            }
+        }
+        return found;
+    }
+
+    static bool value(Ty ty) { return ty == Ty::INT || ty == Ty::BOOL; }
+
+    // 与 Evaluator::evalTail 相同: 只有最后一条语句的值是块的值
+    bool block(const ast::BlockStatement *b, Pos pos, Ty &ty) {
+        if (!b) {
+            return false;
+        }
+        ty = Ty::NONE;
+        bool never = false;
+        for (size_t i = 0, n = b->statements_.size(); i < n; ++i) {
+            Pos at = pos == Pos::TAIL && i + 1 < n ? Pos::STATEMENT : pos;
+            if (!statement(b->statements_[i], at, ty)) {
+                return false;
+            }
+            never = never || ty == Ty::NEVER;
+        }
+        if (never) {
+            ty = Ty::NEVER;
+        }
+        return true;
+    }
+
+    bool statement(const ast::Statement *stmt, Pos pos, Ty &ty) {
+        if (!stmt) {
+            return false;
+        }
+        switch (stmt->Kind()) {
+        case ast::NodeKind::EXPRESSION_STATEMENT:
+            return expression(static_cast<const ast::ExpressionStatement *>(stmt)->expression_, pos, ty);
+        case ast::NodeKind::RETURN_STATEMENT: {
+            // 值被使用的 return 在解释器中不离开函数, 不编译
+            if (pos == Pos::VALUE) {
+                return false;
+            }
+            Ty val;
+            if (!expression(static_cast<const ast::ReturnStatement *>(stmt)->returnValue_, Pos::TAIL, val)) {
+                return false;
+            }
+            if (val != result_ && val != Ty::NEVER) {
+                return false;
+            }
+            e_.epilogue();
+            ty = Ty::NEVER;
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool expression(const ast::Expression *expr, Pos pos, Ty &ty) {
+        if (!expr) {
+            return false;
+        }
+        switch (expr->Kind()) {
+        case ast::NodeKind::INTEGER_LITERAL:
+            e_.movRaxImm(static_cast<const ast::IntegerLiteral *>(expr)->value_);
+            ty = Ty::INT;
+            return true;
+        case ast::NodeKind::BOOLEAN:
+            e_.movRaxImm(static_cast<const ast::Boolean *>(expr)->value_ ? 1 : 0);
+            ty = Ty::BOOL;
+            return true;
+        case ast::NodeKind::IDENTIFIER: {
+            auto ident = static_cast<const ast::Identifier *>(expr);
+            if (ident->scope_ != ast::Identifier::Scope::LOCAL || ident->depth_ != 0) {
+                return false;
+            }
+            size_t i = paramIndex(ident->slot_);
+            if (i == SIZE_MAX) {
+                return false;
+            }
+            e_.loadParam(i);
+            ty = Ty::INT;
+            return true;
+        }
+        case ast::NodeKind::PREFIX_EXPRESSION:
+            return prefix(static_cast<const ast::PrefixExpression *>(expr), ty);
+        case ast::NodeKind::INFIX_EXPRESSION:
+            return infix(static_cast<const ast::InfixExpression *>(expr), ty);
+        case ast::NodeKind::IF_EXPRESSION:
+            return ifExpression(static_cast<const ast::IfExpression *>(expr), pos, ty);
+        case ast::NodeKind::CALL_EXPRESSION:
+            return selfCall(static_cast<const ast::CallExpression *>(expr), pos == Pos::TAIL, ty);
+        default:
+            return false;
+        }
+    }
+
+    bool prefix(const ast::PrefixExpression *prefix, Ty &ty) {
+        Ty right;
+        if (!expression(prefix->right_, Pos::VALUE, right) || !value(right)) {
+            return false;
+        }
+        switch (prefix->op_) {
+        case ast::Operator::MINUS:
+            if (right != Ty::INT) {
+                return false;
+            }
+            e_.emit({0x48, 0xF7, 0xD8});                // neg rax
+            ty = Ty::INT;
+            return true;
+        case ast::Operator::BANG:
+            // 整数总为真, 取反恒为 false
+            if (right == Ty::BOOL) {
+                e_.emit({0x48, 0x83, 0xF0, 0x01});      // xor rax, 1
+            } else {
+                e_.movRaxImm(0);
+            }
+            ty = Ty::BOOL;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool infix(const ast::InfixExpression *infix, Ty &ty) {
+        Ty left, right;
+        if (!expression(infix->left_, Pos::VALUE, left) || !value(left)) {
+            return false;
+        }
+        e_.emit({0x50});                                // push rax
+        if (!expression(infix->right_, Pos::VALUE, right) || right != left) {
+            return false;
+        }
+        e_.emit({0x48, 0x89, 0xC1, 0x58});              // mov rcx, rax; pop rax
+
+        // 布尔值只支持 == 和 !=, 其余组合在解释器中报错, 不编译
+        bool integers = left == Ty::INT;
+        switch (infix->op_) {
+        case ast::Operator::PLUS:
+            if (!integers) return false;
+            e_.emit({0x48, 0x01, 0xC8});                // add rax, rcx
+            ty = Ty::INT;
+            return true;
+        case ast::Operator::MINUS:
+            if (!integers) return false;
+            e_.emit({0x48, 0x29, 0xC8});                // sub rax, rcx
+            ty = Ty::INT;
+            return true;
+        case ast::Operator::ASTERISK:
+            if (!integers) return false;
+            e_.emit({0x48, 0x0F, 0xAF, 0xC1});          // imul rax, rcx
+            ty = Ty::INT;
+            return true;
+        case ast::Operator::SLASH: {
+            if (!integers) return false;
+            // 除数为 0 时退出, 由解释器报错; INT64_MIN / -1 会使 idiv 触发异常,
+            // 除数为 -1 时改为取负, 与解释器一样回绕
+            e_.emit({0x48, 0x85, 0xC9});                // test rcx, rcx
+            bailouts_.push_back(e_.jz());
+            e_.emit({0x48, 0x83, 0xF9, 0xFF});          // cmp rcx, -1
+            size_t toDivide = e_.jne();
+            e_.emit({0x48, 0xF7, 0xD8});                // neg rax
+            size_t toEnd = e_.jmp();
+            e_.bind(toDivide);
+            e_.emit({0x48, 0x99, 0x48, 0xF7, 0xF9});    // cqo; idiv rcx
+            e_.bind(toEnd);
+            ty = Ty::INT;
+            return true;
+        }
+        case ast::Operator::LT:
+            return integers && compare(0x9C, ty);       // setl
+        case ast::Operator::GT:
+            return integers && compare(0x9F, ty);       // setg
+        case ast::Operator::EQ:
+            return compare(0x94, ty);                   // sete
+        case ast::Operator::NOT_EQ:
+            return compare(0x95, ty);                   // setne
+        default:
+            return false;
+        }
+    }
+
+    bool compare(uint8_t setcc, Ty &ty) {
+        e_.emit({0x48, 0x39, 0xC8});                    // cmp rax, rcx
+        e_.emit({0x0F, setcc, 0xC0});                   // setcc al
+        e_.emit({0x0F, 0xB6, 0xC0});                    // movzx eax, al
+        ty = Ty::BOOL;
+        return true;
+    }
+
+    bool ifExpression(const ast::IfExpression *ie, Pos pos, Ty &ty) {
+        Ty cond;
+        if (!expression(ie->condition_, Pos::VALUE, cond) || !value(cond)) {
+            return false;
+        }
+        // 整数总为真, 只编译成立分支
+        if (cond == Ty::INT) {
+            return block(ie->consequence_, pos, ty);
+        }
+
+        e_.emit({0x48, 0x85, 0xC0});                    // test rax, rax
+        size_t toElse = e_.jz();
+        Ty then;
+        if (!block(ie->consequence_, pos, then)) {
+            return false;
+        }
+        size_t toEnd = e_.jmp();
+        e_.bind(toElse);
+        Ty otherwise = Ty::NONE;
+        if (ie->alternative_) {
+            if (!block(ie->alternative_, pos, otherwise)) {
+                return false;
+            }
+        } else {
+            e_.movRaxImm(0);
+        }
+        e_.bind(toEnd);
+
+        if (then == Ty::NEVER) {
+            ty = otherwise;
+        } else if (otherwise == Ty::NEVER || then == otherwise) {
+            ty = then;
+        } else {
+            ty = Ty::NONE;
+        }
+        return true;
+    }
+
+    // 被调函数必须是当前正在编译的函数; 编译时确认, 运行时由入口守卫保证
+    bool selfCall(const ast::CallExpression *call, bool tail, Ty &ty) {
+        if (!call->function_ || call->function_->Kind() != ast::NodeKind::IDENTIFIER) {
+            return false;
+        }
+        auto callee = static_cast<const ast::Identifier *>(call->function_);
+        NativeCode::SelfRef ref{callee->scope_, callee->depth_ - 1, callee->slot_};
+        if (callee->scope_ == ast::Identifier::Scope::GLOBAL) {
+            ref.depth = 0;
+        } else if (callee->scope_ != ast::Identifier::Scope::LOCAL || callee->depth_ < 1) {
+            return false;
+        }
+        if (!fn_.env_ || Lookup(*fn_.env_, ref).get() != &fn_) {
+            return false;
+        }
+        addSelfRef(ref);
+
+        size_t n = call->arguments_.size();
+        if (n != fn_.parameters_.size()) {
+            return false;
+        }
+        if (tail) {
+            // 尾调用: 参数写回参数槽位后跳回函数体开头, 不增长栈
+            for (size_t i = 0; i < n; ++i) {
+                if (!intArgument(call->arguments_[i])) return false;
+            }
+            for (size_t i = n; i-- > 0;) {
+                e_.emit({0x58});                        // pop rax
+                e_.storeParam(i);
+            }
+            e_.resetStack();
+            e_.jmp(loop_);
+            ty = Ty::NEVER;
+            return true;
+        }
+
+        for (size_t i = n; i-- > 0;) {
+            if (!intArgument(call->arguments_[i])) return false;
+        }
+        e_.call(0);
+        e_.dropArgs(n);
+        ty = result_;
+        return true;
+    }
+
+    bool intArgument(const ast::Expression *arg) {
+        Ty ty;
+        if (!expression(arg, Pos::VALUE, ty) || ty != Ty::INT) {
+            return false;
+        }
+        e_.emit({0x50});                                // push rax
+        return true;
+    }
+
+    void addSelfRef(const NativeCode::SelfRef &ref) {
+        for (const auto &r : selfRefs_) {
+            if (r.scope == ref.scope && r.depth == ref.depth && r.slot == ref.slot) {
+                return;
+            }
+        }
+        selfRefs_.push_back(ref);
+    }
+
+public:
+    static const object::Value &Lookup(const Environment &env, const NativeCode::SelfRef &ref) {
+        if (ref.scope == ast::Identifier::Scope::GLOBAL) {
+            return env.getGlobal(ref.slot);
+        }
+        return env.getLocal(ref.depth, ref.slot);
+    }
+
+private:
+    const object::Function &fn_;
+    Ty result_;
+    Emitter e_;
+    size_t loop_ = 0;
+    size_t entry_ = 0;
+    std::vector<size_t> bailouts_;     // 跳到退出桩的待回填位置
+    std::vector<NativeCode::SelfRef> selfRefs_;
+};
+
+} // namespace
+
+std::shared_ptr<const NativeCode> Compile(const object::Function &fn)
+{
+    // 返回类型未知, 依次按整数和布尔尝试
+    for (auto result : {Ty::INT, Ty::BOOL}) {
+        FunctionCompiler compiler(fn, result);
+        if (compiler.compile()) {
+            return compiler.install();
+        }
+    }
+    return nullptr;
+}
+
+bool TryCall(object::Function &fn, const std::vector<object::Value> &args, object::Value &result)
+{
+    if (!g_enabled) {
+        return false;
+    }
+    if (!fn.native_) {
+        // 只在到达阈值时尝试一次, 不可编译的函数之后只多一次比较
+        if (fn.calls_ >= kHotCalls || ++fn.calls_ < kHotCalls) {
+            return false;
+        }
+        fn.native_ = Compile(fn);
+        if (!fn.native_) {
+            return false;
+        }
+    }
+
+    // 守卫: 参数个数 (不符时由解释器报错), 参数类型, 自身引用
+    const auto &native = *fn.native_;
+    if (args.size() != native.params()) {
+        return false;
+    }
+    int64_t values[kMaxParams];
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (!args[i].IsInteger()) {
+            return false;
+        }
+        values[i] = args[i].AsInteger();
+    }
+    for (const auto &ref : native.selfRefs()) {
+        if (FunctionCompiler::Lookup(*fn.env_, ref).get() != &fn) {
+            return false;
+        }
+    }
+
+    int64_t r;
+    if (!native.run(values, r)) {
+        return false;
+    }
+    result = native.result() == NativeCode::Type::INTEGER ? object::Value::Int(r) : object::Value::Bool(r != 0);
+    return true;
+}
+
+#else
+
+NativeCode::NativeCode(void *memory, size_t size, size_t entry, size_t params, Type result,
+                       std::vector<SelfRef> selfRefs)
+    : memory_(memory), size_(size), entry_(entry), params_(params), result_(result),
+      selfRefs_(std::move(selfRefs))
+{
+}
+
+NativeCode::~NativeCode() = default;
+
+bool NativeCode::run(const int64_t *, int64_t &) const
+{
+    return false;
+}
+
+std::shared_ptr<const NativeCode> Compile(const object::Function &)
+{
+    return nullptr;
+}
+
+bool TryCall(object::Function &, const std::vector<object::Value> &, object::Value &)
+{
+    return false;
+}
+
+#endif
+
+} // namespace jit
+} // namespace dragon
@@ -0,0 +1,78 @@
+//
+// 基线 JIT: 把只做整数/布尔运算的热点函数编译为 x86-64 机器码
+//
+
+#ifndef DRAGON_JIT_H
+#define DRAGON_JIT_H
+
+#include "function.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 只在 x86-64 Linux 上生成机器码, 其他平台 TryCall 总是交回解释器
+#if defined(__x86_64__) && defined(__linux__)
+#define DRAGON_JIT 1
+#endif
+
+namespace dragon {
+namespace jit {
+
+// 同一个函数对象被调用这么多次后尝试编译
+constexpr uint32_t kHotCalls = 1000;
+// 参数多于此数的函数不编译
+constexpr size_t kMaxParams = 6;
+
+// 可编译的函数体只含: 参数, 整数/布尔字面量, + - * / < > == != ! -, if/else, return,
+// 以及对自身的调用 (通过全局变量或外层函数的变量引用自身). 参数都按整数编译,
+// 表达式的类型在编译时确定, 运行时只需在入口检查守卫.
+class NativeCode {
+public:
+    enum class Type : uint8_t { INTEGER, BOOLEAN };
+
+    // 对自身的引用: 入口处检查它仍指向被调用的函数, 否则退回解释器
+    struct SelfRef {
+        ast::Identifier::Scope scope;
+        int depth;      // 相对函数定义环境 env_ 的层数
+        int slot;
+    };
+
+    NativeCode(void *memory, size_t size, size_t entry, size_t params, Type result, std::vector<SelfRef> selfRefs);
+    ~NativeCode();
+    NativeCode(const NativeCode &) = delete;
+    NativeCode &operator=(const NativeCode &) = delete;
+
+    size_t params() const { return params_; }
+    Type result() const { return result_; }
+    const std::vector<SelfRef> &selfRefs() const { return selfRefs_; }
+    size_t size() const { return size_; }
+
+    // 执行机器码; 中途退出 (见 FunctionCompiler) 时返回 false, result 无意义
+    bool run(const int64_t *args, int64_t &result) const;
+
+private:
+    void *memory_;      // mmap 得到的可执行内存
+    size_t size_;
+    size_t entry_;
+    size_t params_;
+    Type result_;
+    std::vector<SelfRef> selfRefs_;
+};
+
+// 编译 fn 的函数体, 不满足条件或平台不支持时返回 nullptr
+std::shared_ptr<const NativeCode> Compile(const object::Function &fn);
+
+// 由 Evaluator 在执行函数体之前调用: 记录调用次数, 到达阈值时编译.
+// 已编译且参数都是整数, 自身引用未变时执行机器码, 结果放在 result 中并返回 true;
+// 否则, 或机器码中途退出 (如除数为 0) 时返回 false, 由解释器照常执行 (去优化)
+bool TryCall(object::Function &fn, const std::vector<object::Value> &args, object::Value &result);
+
+// 命令行 --no-jit 关闭; 关闭后 TryCall 总是返回 false
+void SetEnabled(bool enabled);
+bool Enabled();
+
+} // namespace jit
+} // namespace dragon
+
+#endif //DRAGON_JIT_H
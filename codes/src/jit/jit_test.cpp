@@ -0,0 +1,142 @@
+#include "jit_test.h"
+#include "jit.h"
+#include "environment.hpp"
+#include "evaluator.h"
+#include "lexer.h"
+#include "parser.h"
+#include "test_tool.h"
+
+#include <memory>
+#include <string>
+
+using namespace dragon;
+
+namespace {
+
+// 反复调用 f, 使其超过编译阈值; 自身不是自调用, 不会被编译
+const char *kRepeat = "let repeat = fn(f, i, x) { if (i == 0) { f(x) } else { f(x); repeat(f, i - 1, x) } };";
+
+std::string evalIn(const std::string &input, const std::shared_ptr<Environment> &env)
+{
+    lexer::Lexer lexer(input);
+    parser::Parser parser(lexer);
+    auto program = parser.parseProgram();
+    auto result = evaluator::Evaluator::eval(program, env);
+    return result ? result->Inspect() : "";
+}
+
+object::Function *function(const std::shared_ptr<Environment> &env, const std::string &name)
+{
+    return dynamic_cast<object::Function *>(env->get(name).first.get());
+}
+
+// 不开 JIT 的结果
+std::string interpret(const std::string &input)
+{
+    bool enabled = jit::Enabled();
+    jit::SetEnabled(false);
+    auto result = evalIn(input, std::make_shared<Environment>());
+    jit::SetEnabled(enabled);
+    return result;
+}
+
+// 每个程序先由 repeat 把 name 调热, 再求值 check; 结果应与解释执行一致, 并确认是否编译
+void expectJit(const std::string &define, const std::string &name, const std::string &warm,
+               const std::string &check, bool compiled)
+{
+    auto program = std::string(kRepeat) + define + "; repeat(" + name + ", 1000, " + warm + ");";
+    auto env = std::make_shared<Environment>();
+    evalIn(program, env);
+    auto fn = function(env, name);
+    ASSERT_TRUE(fn != nullptr);
+    if (fn == nullptr) {
+        return;
+    }
+    ASSERT_TRUE((fn->native_ != nullptr) == compiled);
+    ASSERT_EQ(evalIn(check, env), interpret(program + check));
+}
+
+} // namespace
+
+void TestJitCompile()
+{
+    jit::SetEnabled(true);
+
+    // 递归调用超过阈值后编译, 之后的调用直接执行机器码
+    auto env = std::make_shared<Environment>();
+    ASSERT_EQ(evalIn("let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; fib(20)", env),
+              "6765");
+    auto fib = function(env, "fib");
+    ASSERT_TRUE(fib && fib->native_);
+    ASSERT_EQ(evalIn("fib(25)", env), "75025");
+
+    // 尾递归编译为循环
+    env = std::make_shared<Environment>();
+    ASSERT_EQ(evalIn("let loop = fn(n, acc) { if (n == 0) { acc } else { loop(n - 1, acc + 1) } };"
+                     "loop(100000, 0)", env), "100000");
+    ASSERT_TRUE(function(env, "loop")->native_);
+    ASSERT_EQ(evalIn("loop(1000000, 5)", env), "1000005");
+
+    // 非尾位置的 return, 布尔结果, 各运算符, 嵌套在外层函数中的自调用
+    expectJit("let g = fn(n) { if (n > 5) { return n * 2; } n + 1 }", "g", "1", "[g(10), g(3)]", true);
+    expectJit("let even = fn(n) { if (n == 0) { true } else { if (n == 1) { false } else { even(n - 2) } } }",
+              "even", "10", "[even(7), even(100)]", true);
+    expectJit("let k = fn(a) { if (!(a > 4)) { -a / 2 } else { a - a * 3 } }", "k", "1",
+              "[k(3), k(10), k(-9), k(5) == k(6), !k(1)]", true);
+    expectJit("let s = fn(n) { if (n > 0) { 1 }; n != 3 }", "s", "1", "[s(3), s(-1)]", true);
+    expectJit("let outer = fn() { let c = fn(n) { if (n < 1) { 0 } else { c(n - 1) + 2 } }; c }; let c = outer()",
+              "c", "3", "c(50)", true);
+
+    // 含不支持的结构时不编译, 照常解释执行
+    expectJit("let h = fn(n) { let m = n; m }", "h", "1", "h(4)", false);
+    expectJit("let t = fn(n) { if (n == 0) { 1 } }", "t", "0", "[t(0), t(1)]", false);
+    expectJit("let u = fn(n) { n + len(\"ab\") }", "u", "1", "u(1)", false);
+    expectJit("let w = fn(n) { n == true }", "w", "1", "w(1)", false);
+
+    // 值被使用的 if 中的 return (包括其中的自调用) 在解释器中不离开函数, 不编译
+    expectJit("let v = fn(n) { 1 + if (n > 0) { return 5; } else { 2 } }", "v", "1", "[v(1), v(0)]", false);
+    expectJit("let r = fn(n) { if (n < 1) { 0 } else { 2 + if (n > 0) { return r(n - 1); } else { 2 } } }",
+              "r", "9", "r(9)", false);
+}
+
+// 入口守卫不满足时退回解释器, 结果与不开 JIT 一致
+void TestJitDeopt()
+{
+    jit::SetEnabled(true);
+
+    auto define = std::string("let f = fn(n) { if (n == 0) { 0 } else { 1 + f(n - 1) } }");
+    expectJit(define, "f", "5", "f(true)", true);
+    expectJit(define, "f", "5", "f(\"a\")", true);
+    expectJit(define, "f", "5", "f(1, 2)", true);
+
+    // 自身引用被重新绑定后, 机器码中的直接调用不再成立
+    expectJit(define, "f", "5", "let g = f; let f = fn(n) { 100 }; g(5)", true);
+    auto env = std::make_shared<Environment>();
+    evalIn(std::string(kRepeat) + define + "; repeat(f, 1000, 5); let g = f; let f = fn(n) { 100 };", env);
+    ASSERT_EQ(evalIn("g(5)", env), "101");
+
+    // 除数为 0 时机器码中途退出 (包括嵌套的自调用中), 由解释器报错; INT64_MIN / -1 与解释器一样回绕
+    auto divide = std::string("let d = fn(n) { if (n > 10) { d(n - 11) + 1 } else { (0 - 9223372036854775807 - 1) / (n - 3) } }");
+    for (auto check : {"d(7)", "d(3)", "d(14)", "d(2)", "d(13)"}) {
+        expectJit(divide, "d", "1", check, true);
+    }
+    env = std::make_shared<Environment>();
+    evalIn(std::string(kRepeat) + divide + "; repeat(d, 1000, 1);", env);
+    ASSERT_EQ(evalIn("d(14)", env), "ERROR: division by zero");
+    ASSERT_EQ(evalIn("d(13)", env), "-9223372036854775807");
+
+    // 关闭后不再编译
+    jit::SetEnabled(false);
+    env = std::make_shared<Environment>();
+    evalIn(std::string(kRepeat) + define + "; repeat(f, 1000, 5);", env);
+    ASSERT_TRUE(function(env, "f")->native_ == nullptr);
+    jit::SetEnabled(true);
+}
+
+void TestJit()
+{
+#ifdef DRAGON_JIT
+    TestJitCompile();
+    TestJitDeopt();
+#endif
+}
@@ -0,0 +1,6 @@
+#ifndef DRAGON_JIT_TEST_H
+#define DRAGON_JIT_TEST_H
+
+void TestJit();
+
+#endif //DRAGON_JIT_TEST_H
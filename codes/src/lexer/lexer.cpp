@@ -1,126 +1,151 @@
+
 #include "lexer.h"
 
+#include <algorithm>
+
 namespace lexer
 {
-Lexer::Lexer(const string &input)
+Lexer::Lexer(const string &input) : Lexer(input, InputMode::COPY)
+{
+}
+
+Lexer::Lexer(std::string_view input, InputMode mode)
 {
-	input_ = input;
+	if (mode == InputMode::COPY) {
+		owned_ = string(input);
+		input_ = owned_;
+	} else {
+		input_ = input;
+	}
 	position_ = 0;
 	readPosition_ = 0;
 	ch_ = '\0';
+	line_ = 1;
+	column_ = 0;
 	this->readChar();
 }
 
 token::Token Lexer::NextToken()
 {
-	token::Token tok;
-	string literal;
+	return ToToken(NextTokenView());
+}
+
+token::TokenView Lexer::NextTokenView()
+{
+	token::TokenView tok;
     skipWhitespace();
+
+	size_t start = position_;
+	uint32_t line = line_;
+	uint32_t column = column_;
 	switch (ch_) {
 	case '=':
 		if (peekChar() == '=') 
 		{
 			readChar();
-			literal = "==";
-			tok = token::Token(EQ, "==");
+			tok = newToken(token::TokenType::EQ, start, 2);
 		} 
 		else 
 		{
-			tok = newToken(ASSIGN, ch_);
+			tok = newToken(token::TokenType::ASSIGN, start, 1);
 		}
 		break;
 
 	case '+':
-		tok = newToken(PLUS, ch_);
+		tok = newToken(token::TokenType::PLUS, start, 1);
 		break;
 
 	case '-':
-		tok = newToken(MINUS, ch_);
+		tok = newToken(token::TokenType::MINUS, start, 1);
 		break;
 
 	case '!':
 		if (peekChar() == '=')
 		{
-			// ch = ch_;
 			readChar();
-			tok = token::Token(NOT_EQ, NOT_EQ);
-
+			tok = newToken(token::TokenType::NOT_EQ, start, 2);
 		} 
 		else 
 		{
-			tok = newToken(BANG, ch_);
+			tok = newToken(token::TokenType::BANG, start, 1);
 		}
 		break;
 
 	case '/':
-		tok = newToken(SLASH, ch_);
+		tok = newToken(token::TokenType::SLASH, start, 1);
 		break;
 
 	case '*':
-		tok = newToken(ASTERISK, ch_);
+		tok = newToken(token::TokenType::ASTERISK, start, 1);
 		break;
 
 	case '<':
-		tok = newToken(LT, ch_);
+		tok = newToken(token::TokenType::LT, start, 1);
 		break;
 
 	case '>':
-		tok = newToken(GT, ch_);
+		tok = newToken(token::TokenType::GT, start, 1);
 		break;
 
 	case ';':
-		tok = newToken(SEMICOLON, ch_);
+		tok = newToken(token::TokenType::SEMICOLON, start, 1);
 		break;
         case ':':
-            tok = newToken(COLON, ch_);
+            tok = newToken(token::TokenType::COLON, start, 1);
             break;
 	case ',':
-		tok = newToken(COMMA, ch_);
+		tok = newToken(token::TokenType::COMMA, start, 1);
 		break;
 
 	case '{':
-		tok = newToken(LBRACE, ch_);
+		tok = newToken(token::TokenType::LBRACE, start, 1);
 		break;
 
 	case '}':
-		tok = newToken(RBRACE, ch_);
+		tok = newToken(token::TokenType::RBRACE, start, 1);
 		break;
 		
 	case '(':
-		tok = newToken(LPAREN, ch_);
+		tok = newToken(token::TokenType::LPAREN, start, 1);
 		break;
 		
 	case ')':
-		tok = newToken(RPAREN, ch_);
+		tok = newToken(token::TokenType::RPAREN, start, 1);
 		break;
 
-    case '"':
-        tok.Type = STRING;
-        tok.Literal = readString();
+    case '"': {
+        auto s = readString();
+        tok = newToken(token::TokenType::STRING, start + 1, s.size());
         break;
+    }
     case '[':
-        tok = newToken(LBRACKET, ch_);
+        tok = newToken(token::TokenType::LBRACKET, start, 1);
         break;
     case ']':
-         tok = newToken(RBRACKET, ch_);
+         tok = newToken(token::TokenType::RBRACKET, start, 1);
          break;
 	case 0:
-		tok.Literal = "";
-		tok.Type = MEOF;
+		tok = newToken(token::TokenType::MEOF, start, 0);
 		break;
 	default:
 	if (isLetter(ch_)) {
-		tok.Literal = readIdentifier();
-		tok.Type = token::LookupIdent(tok.Literal);
+		auto ident = readIdentifier();
+		tok = newToken(token::LookupIdent(ident), start, ident.size());
+		tok.Pos.line = line;
+		tok.Pos.column = column;
         return tok;  // 需要直接返回
 	} else if (isDigit(ch_)) {
-		tok.Type = INT;
-		tok.Literal = readNumber();
+		auto number = readNumber();
+		tok = newToken(token::TokenType::INT, start, number.size());
+		tok.Pos.line = line;
+		tok.Pos.column = column;
 		return tok;
 	} else {
-		tok = newToken(ILLEGAL, ch_);
+		tok = newToken(token::TokenType::ILLEGAL, start, 1);
 	}
  	}
+	tok.Pos.line = line;
+	tok.Pos.column = column;
 	readChar();
 	return tok;
 }
@@ -138,6 +163,13 @@ void Lexer::skipWhitespace()
 
 void Lexer::readChar()
 {
+	if (ch_ == '\n') {
+		line_++;
+		column_ = 1;
+	} else {
+		column_++;
+	}
+
 	if (readPosition_ >= input_.length())
 	{
 		ch_ = '\0';
@@ -162,9 +194,9 @@ char Lexer::peekChar()
 	return input_[readPosition_];
 }
 
-string Lexer::readIdentifier()
+std::string_view Lexer::readIdentifier()
 {
-	int pos = position_;
+	size_t pos = position_;
 	while (isLetter(ch_)) 
 	{
 		readChar();
@@ -173,9 +205,9 @@ string Lexer::readIdentifier()
 	return input_.substr(pos, position_ - pos);
 }
 
-string Lexer::readNumber() 
+std::string_view Lexer::readNumber()
 {
-	int pos = position_;
+	size_t pos = position_;
 	while (isDigit(ch_)) {
 		readChar();
 	}
@@ -183,8 +215,8 @@ string Lexer::readNumber()
 	return input_.substr(pos, position_ - pos);
 }
 
-string Lexer::readString() {
-    int pos = position_ + 1;
+std::string_view Lexer::readString() {
+    size_t pos = position_ + 1;
     for (;;) {
         readChar();
         if (ch_ == '"' || ch_ == '\0') {
@@ -192,7 +224,7 @@ string Lexer::readString() {
         }
     }
 
-    return input_.substr(pos, position_ - pos);
+    return input_.substr(pos, std::min(position_, input_.length()) - pos);
 }
 
 bool Lexer::isLetter(char ch)
@@ -208,12 +240,14 @@ bool Lexer::isDigit(char ch)
 	return '0' <= ch && ch <= '9';
 }
 
-token::Token Lexer::newToken(token::TokenType tt, char ch)
+token::TokenView Lexer::newToken(token::TokenType tt, size_t start, size_t length)
 {
-	token::Token t;
-	t.Literal = string(1, ch);
+	token::TokenView t;
 	t.Type = tt;
+	// 到达末尾后 position_ 会越过输入长度
+	t.Pos.offset = static_cast<uint32_t>(std::min(start, input_.length()));
+	t.Pos.length = static_cast<uint32_t>(length);
 	return t;
 }
 
-} // namespace lexer
\ No newline at end of file
+} // namespace lexer
@@ -1,34 +1,58 @@
 #ifndef __LEXER__
 #define __LEXER__
 #include <string>
+#include <string_view>
 #include "token/token.h"
 
 using std::string;
 
 namespace lexer
 {
+enum class InputMode {
+	COPY,       // 复制一份输入, Lexer 自己持有
+	BORROW,     // 不复制, 调用方保证输入在 Lexer 及其产生的 TokenView 使用期间一直有效
+};
+
 class Lexer
 {
 public:
 	Lexer(const string &input);
+	Lexer(std::string_view input, InputMode mode);
+	Lexer(const Lexer &) = delete;
+	Lexer &operator=(const Lexer &) = delete;
 public:
+	// 零拷贝接口, 不做任何堆分配
+	token::TokenView NextTokenView();
+	std::string_view Literal(const token::TokenView &tok) const {
+		return input_.substr(tok.Pos.offset, tok.Pos.length);
+	}
+
+	// 需要持有文本时使用, 会复制 token 的文本
 	token::Token NextToken();
+	token::Token ToToken(const token::TokenView &tok) const {
+		return token::Token(tok.Type, string(Literal(tok)));
+	}
+
+	std::string_view Input() const { return input_; }
+
 	void skipWhitespace();
 	void readChar();
 	char peekChar();
-	string readIdentifier();
-	string readNumber();
-    string readString();
+	std::string_view readIdentifier();
+	std::string_view readNumber();
+	std::string_view readString();
 	bool isLetter(char ch);
 	bool isDigit(char ch);
-	token::Token newToken(token::TokenType tt, char ch);
+	token::TokenView newToken(token::TokenType tt, size_t start, size_t length);
 
 public:
-	string input_;
+	string owned_;              // COPY 模式下持有的输入
+	std::string_view input_;
 	size_t position_;       // current position in input (points to current char)
 	size_t readPosition_;   // current reading position in input (after current char)
 	char ch_;               // current char under examination
+	uint32_t line_;         // 当前字符所在的行
+	uint32_t column_;       // 当前字符所在的列
 };
 } // namespace lexer
 #endif
-
@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <cassert>
 
 using std::vector;
 using std::string;
@@ -50,93 +51,93 @@ if (5 < 10) {
 
 	vector<Test> expected =
     {
-		Test{LET, "let"},//0
-        Test{IDENT, "five"},
-        Test{ASSIGN, "="},
-        Test{INT, "5"},
-        Test{SEMICOLON, ";"},
-        Test{LET, "let"},//5
-        Test{IDENT, "ten"},
-        Test{ASSIGN, "="},
-        Test{INT, "10"},
-        Test{SEMICOLON, ";"},
-        Test{LET, "let"}, // 10
-        Test{IDENT, "add"},
-        Test{ASSIGN, "="},
-        Test{FUNCTION, "fn"},
-        Test{LPAREN, "("},
-        Test{IDENT, "x"},//15
-        Test{COMMA, ","},
-        Test{IDENT, "y"},
-        Test{RPAREN, ")"},
-        Test{LBRACE, "{"},
-        Test{IDENT, "x"},
-        Test{PLUS, "+"},
-        Test{IDENT, "y"},
-        Test{SEMICOLON, ";"},
-        Test{RBRACE, "}"},
-        Test{SEMICOLON, ";"},
-        Test{LET, "let"},
-        Test{IDENT, "result"},
-        Test{ASSIGN, "="},
-        Test{IDENT, "add"},
-        Test{LPAREN, "("},
-        Test{IDENT, "five"},
-        Test{COMMA, ","},
-        Test{IDENT, "ten"},
-        Test{RPAREN, ")"},
-        Test{SEMICOLON, ";"},
-        Test{BANG, "!"},
-        Test{MINUS, "-"},
-        Test{SLASH, "/"},
-        Test{ASTERISK, "*"},
-        Test{INT, "5"},
-        Test{SEMICOLON, ";"},
-        Test{INT, "5"},
-        Test{LT, "<"},
-        Test{INT, "10"},
-        Test{GT, ">"},
-        Test{INT, "5"},
-        Test{SEMICOLON, ";"},
-        Test{IF, "if"},
-        Test{LPAREN, "("},
-        Test{INT, "5"},
-        Test{LT, "<"},
-        Test{INT, "10"},
-        Test{RPAREN, ")"},
-        Test{LBRACE, "{"},
-        Test{RETURN, "return"},
-        Test{TRUE, "true"},
-        Test{SEMICOLON, ";"},
-        Test{RBRACE, "}"},
-        Test{ELSE, "else"},
-        Test{LBRACE, "{"},
-        Test{RETURN, "return"},
-        Test{FALSE, "false"},
-        Test{SEMICOLON, ";"},
-        Test{RBRACE, "}"},
-        Test{INT, "10"},
-        Test{EQ, "=="},
-        Test{INT, "10"},
-        Test{SEMICOLON, ";"},
-        Test{INT, "10"},
-        Test{NOT_EQ, "!="},
-        Test{INT, "9"},
-        Test{SEMICOLON, ";"},
-        Test{STRING, "foobar"},
-        Test{STRING, "foo bar"},
-        Test{LBRACKET, "["},
-        Test{INT, "1"},
-        Test{COMMA, ","},
-        Test{INT, "2"},
-        Test{RBRACKET, "]"},
-        Test{SEMICOLON, ";"},
-        Test{LBRACE, "{"},
-        Test{STRING, "foo"},
-        Test{COLON, ":"},
-        Test{STRING, "bar"},
-        Test{RBRACE, "}"},
-        Test{MEOF, ""},
+		Test{token::TokenType::LET, "let"},//0
+        Test{token::TokenType::IDENT, "five"},
+        Test{token::TokenType::ASSIGN, "="},
+        Test{token::TokenType::INT, "5"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::LET, "let"},//5
+        Test{token::TokenType::IDENT, "ten"},
+        Test{token::TokenType::ASSIGN, "="},
+        Test{token::TokenType::INT, "10"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::LET, "let"}, // 10
+        Test{token::TokenType::IDENT, "add"},
+        Test{token::TokenType::ASSIGN, "="},
+        Test{token::TokenType::FUNCTION, "fn"},
+        Test{token::TokenType::LPAREN, "("},
+        Test{token::TokenType::IDENT, "x"},//15
+        Test{token::TokenType::COMMA, ","},
+        Test{token::TokenType::IDENT, "y"},
+        Test{token::TokenType::RPAREN, ")"},
+        Test{token::TokenType::LBRACE, "{"},
+        Test{token::TokenType::IDENT, "x"},
+        Test{token::TokenType::PLUS, "+"},
+        Test{token::TokenType::IDENT, "y"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::RBRACE, "}"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::LET, "let"},
+        Test{token::TokenType::IDENT, "result"},
+        Test{token::TokenType::ASSIGN, "="},
+        Test{token::TokenType::IDENT, "add"},
+        Test{token::TokenType::LPAREN, "("},
+        Test{token::TokenType::IDENT, "five"},
+        Test{token::TokenType::COMMA, ","},
+        Test{token::TokenType::IDENT, "ten"},
+        Test{token::TokenType::RPAREN, ")"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::BANG, "!"},
+        Test{token::TokenType::MINUS, "-"},
+        Test{token::TokenType::SLASH, "/"},
+        Test{token::TokenType::ASTERISK, "*"},
+        Test{token::TokenType::INT, "5"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::INT, "5"},
+        Test{token::TokenType::LT, "<"},
+        Test{token::TokenType::INT, "10"},
+        Test{token::TokenType::GT, ">"},
+        Test{token::TokenType::INT, "5"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::IF, "if"},
+        Test{token::TokenType::LPAREN, "("},
+        Test{token::TokenType::INT, "5"},
+        Test{token::TokenType::LT, "<"},
+        Test{token::TokenType::INT, "10"},
+        Test{token::TokenType::RPAREN, ")"},
+        Test{token::TokenType::LBRACE, "{"},
+        Test{token::TokenType::RETURN, "return"},
+        Test{token::TokenType::TRUE, "true"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::RBRACE, "}"},
+        Test{token::TokenType::ELSE, "else"},
+        Test{token::TokenType::LBRACE, "{"},
+        Test{token::TokenType::RETURN, "return"},
+        Test{token::TokenType::FALSE, "false"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::RBRACE, "}"},
+        Test{token::TokenType::INT, "10"},
+        Test{token::TokenType::EQ, "=="},
+        Test{token::TokenType::INT, "10"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::INT, "10"},
+        Test{token::TokenType::NOT_EQ, "!="},
+        Test{token::TokenType::INT, "9"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::STRING, "foobar"},
+        Test{token::TokenType::STRING, "foo bar"},
+        Test{token::TokenType::LBRACKET, "["},
+        Test{token::TokenType::INT, "1"},
+        Test{token::TokenType::COMMA, ","},
+        Test{token::TokenType::INT, "2"},
+        Test{token::TokenType::RBRACKET, "]"},
+        Test{token::TokenType::SEMICOLON, ";"},
+        Test{token::TokenType::LBRACE, "{"},
+        Test{token::TokenType::STRING, "foo"},
+        Test{token::TokenType::COLON, ":"},
+        Test{token::TokenType::STRING, "bar"},
+        Test{token::TokenType::RBRACE, "}"},
+        Test{token::TokenType::MEOF, ""},
 	};
 
 	lexer::Lexer lexer(input);
@@ -147,6 +148,53 @@ if (5 < 10) {
 		if (tok.Type != expected[i].expectedType)
 		{
 			cout << i << " ERROR real:" << tok.Type << " expected:" << expected[i].expectedType << endl;
+			assert(false);
 		}
+		if (tok.Literal != expected[i].expectedLiteral)
+		{
+			cout << i << " ERROR literal:" << tok.Literal << " expected:" << expected[i].expectedLiteral << endl;
+			assert(false);
+		}
+	}
+}
+
+// 借用模式下 token 文本直接指向输入缓冲区, 位置信息按行列记录
+void TestTokenView()
+{
+	string input = "let x = 10;\n  x != \"ab\"";
+	lexer::Lexer lexer(input, lexer::InputMode::BORROW);
+
+	struct SpanTest {
+		token::TokenType type;
+		uint32_t line;
+		uint32_t column;
+		string literal;
+	};
+	vector<SpanTest> expected = {
+		{token::TokenType::LET, 1, 1, "let"},
+		{token::TokenType::IDENT, 1, 5, "x"},
+		{token::TokenType::ASSIGN, 1, 7, "="},
+		{token::TokenType::INT, 1, 9, "10"},
+		{token::TokenType::SEMICOLON, 1, 11, ";"},
+		{token::TokenType::IDENT, 2, 3, "x"},
+		{token::TokenType::NOT_EQ, 2, 5, "!="},
+		{token::TokenType::STRING, 2, 8, "ab"},
+		{token::TokenType::MEOF, 2, 12, ""},
+	};
+
+	for (const auto &e : expected) {
+		auto tok = lexer.NextTokenView();
+		auto literal = lexer.Literal(tok);
+		if (tok.Type != e.type || tok.Pos.line != e.line || tok.Pos.column != e.column || literal != e.literal) {
+			cout << "ERROR token:" << tok.Type << " " << tok.Pos.line << ":" << tok.Pos.column
+				<< " expected:" << e.type << " " << e.line << ":" << e.column << endl;
+			assert(false);
+		}
+		// 零拷贝: 文本就是输入中的一段
+		assert(literal.empty() || (literal.data() >= input.data() && literal.data() < input.data() + input.size()));
 	}
+
+	// 到达末尾后一直返回 EOF
+	assert(lexer.NextTokenView().Type == token::TokenType::MEOF);
+	assert(lexer.NextTokenView().Type == token::TokenType::MEOF);
 }
\ No newline at end of file
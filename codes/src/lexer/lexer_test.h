@@ -3,6 +3,7 @@
 
 
 void TestNextToken();
+void TestTokenView();
 
 
 #endif
\ No newline at end of file
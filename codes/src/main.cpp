@@ -2,18 +2,38 @@
 // Author: Jesson
 // Email: jesson3264@163.com
 //
+#include <cstdlib>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include "repl.h"
 #include "lexer_test.h"
 #include "ast_test.h"
 #include "parser_test.h"
 #include "evaluator_test.h"
+#include "code_test.h"
+#include "vm_test.h"
+#include "gc_test.h"
+#include "hash_test.h"
+#include "jit_test.h"
+#include "aot_test.h"
+#include "gc.h"
+#include "jit.h"
+#include "cpp_emitter.h"
+#include "stack_evaluator.h"
+#include "lexer.h"
+#include "parser.h"
 
 using namespace std;
 #define Version "1.0.0"
 
 void Test() {
     TestNextToken();
+    TestTokenView();
+    TestNodeKind();
+    TestArena();
+    TestFlatAst();
+    ParserTest();
 //    cout << "Version:" << Version << endl;
 //    cout << "Author: Jesson.Deng" << endl;
 //	cout << "Email: jesson3264@163.com" << endl;
@@ -21,32 +41,145 @@ void Test() {
 //    r.Start();
 //
 //    TestAst();
-//     ParserTest();
     TestEvals();
+    TestCode();
+    TestVM();
+    TestGC();
+    TestStringHash();
+    TestJit();
+    TestAot();
 
 //    repl::Repl r;
 //    r.Start(std::cin, std::cout);
 }
 
-void Repl()
+void Repl(repl::Engine engine)
 {
-    repl::Repl r;
+    repl::Repl r(engine);
     r.Start(std::cin, std::cout);
 }
 
+int RunFile(const string &path, repl::Engine engine)
+{
+    ifstream in(path);
+    if (!in) {
+        cerr << "can not open file: " << path << endl;
+        return 1;
+    }
+    stringstream ss;
+    ss << in.rdbuf();
+
+    repl::Repl r(engine);
+    auto result = r.Execute(ss.str(), cout);
+    if (result && result->Type() == dragon::object::Object::ObjectType::ERROR_OBJ) {
+        cerr << result->Inspect() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// 把脚本翻译为 C++ 源码, output 为空时输出到标准输出
+int EmitCpp(const string &path, const string &output)
+{
+    ifstream in(path);
+    if (!in) {
+        cerr << "can not open file: " << path << endl;
+        return 1;
+    }
+    stringstream ss;
+    ss << in.rdbuf();
+
+    lexer::Lexer l(ss.str());
+    parser::Parser p(l);
+    auto program = p.parseProgram();
+    if (!p.errors.empty()) {
+        for (const auto &msg : p.errors) {
+            cerr << path << ": " << msg << endl;
+        }
+        return 1;
+    }
+
+    auto code = dragon::aot::EmitCpp(program.get(), path);
+    if (output.empty()) {
+        cout << code;
+        return 0;
+    }
+    ofstream out(output);
+    if (!out || !(out << code)) {
+        cerr << "can not write file: " << output << endl;
+        return 1;
+    }
+    return 0;
+}
+
+void Usage()
+{
+    cout << "usage: dragon [-t] [-v] [--engine=eval|vm|flat|closure|stack] [--max-depth=N] [--no-jit] [--gc-stats] [script]" << endl;
+    cout << "       dragon --emit-cpp [-o output.cpp] script" << endl;
+}
+
 int main(int argc, char **argv)
 {
-    if (argc > 1) {
-        if (string(argv[1]) == "-t") {
+    repl::Engine engine = repl::Engine::EVAL;
+    string script;
+    bool gcStats = false;
+    bool emitCpp = false;
+    string output;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-t") {
             Test();
+            return 0;
+        } else if (arg == "-v") {
+            cout << Version << endl;
+            return 0;
+        } else if (arg.compare(0, 9, "--engine=") == 0) {
+            if (!repl::ParseEngine(arg.substr(9), engine)) {
+                Usage();
+                return 1;
+            }
+        } else if (arg.compare(0, 12, "--max-depth=") == 0) {
+            char *end = nullptr;
+            auto depth = std::strtoull(arg.c_str() + 12, &end, 10);
+            if (end == arg.c_str() + 12 || *end != '\0') {
+                Usage();
+                return 1;
+            }
+            dragon::evaluator::StackEvaluator::setMaxDepth(depth);
+        } else if (arg == "--no-jit") {
+            dragon::jit::SetEnabled(false);
+        } else if (arg == "--emit-cpp") {
+            emitCpp = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--gc-stats") {
+            gcStats = true;
+        } else if (arg == "--vm") {
+            engine = repl::Engine::VM;
+        } else if (!arg.empty() && arg[0] == '-') {
+            Usage();
+            return 1;
+        } else {
+            script = arg;
         }
+    }
 
-        if (string(argv[1]) == "-v") {
-            cout << Version << endl;
+    if (emitCpp) {
+        if (script.empty()) {
+            Usage();
+            return 1;
+        }
+        return EmitCpp(script, output);
+    }
+
+    if (!script.empty()) {
+        int ret = RunFile(script, engine);
+        if (gcStats) {
+            cerr << dragon::gc::Heap::Instance().stats() << endl;
         }
-    } else if (argc == 1) {
-        Repl();
+        return ret;
     }
 
+    Repl(engine);
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,79 @@
+#ifndef __COMPILED_FUNCTION_H__
+#define __COMPILED_FUNCTION_H__
+
+#include "object.h"
+#include "code.h"
+
+#include <memory>
+#include <vector>
+
+namespace dragon {
+namespace object {
+
+// 编译后的函数体, 存放在常量池中
+class CompiledFunction : public Object {
+public:
+    CompiledFunction(code::Instructions ins, int numLocals, int numParameters,
+                     std::vector<std::string> localNames = {}, std::vector<std::string> freeNames = {})
+        : instructions_(std::move(ins)), numLocals_(numLocals), numParameters_(numParameters),
+          localNames_(std::move(localNames)), freeNames_(std::move(freeNames)) {}
+    ObjectType Type() const override { return ObjectType::COMPILED_FUNCTION_OBJ; }
+    std::string Inspect() const override {
+        std::ostringstream out;
+        out << "CompiledFunction[" << this << "]";
+        return out.str();
+    }
+
+public:
+    code::Instructions instructions_;
+    int numLocals_;
+    int numParameters_;
+    // 局部变量与自由变量的名字, 槽位尚未赋值时按名字查找全局变量
+    std::vector<std::string> localNames_;
+    std::vector<std::string> freeNames_;
+};
+
+// 被内层函数引用的局部变量放在 Cell 中, 外层函数的槽位与各个闭包共享同一个 Cell, 即按引用捕获
+class Cell : public Object, public gc::Collectable {
+public:
+    ObjectType Type() const override { return ObjectType::CELL_OBJ; }
+    std::string Inspect() const override { return value_ ? value_->Inspect() : "null"; }
+
+    void traverse(gc::Visitor &visitor) const override {
+        if (auto c = dynamic_cast<const gc::Collectable *>(value_.get())) {
+            visitor.visit(c);
+        }
+    }
+    void clear() override { value_.reset(); }
+
+public:
+    std::shared_ptr<Object> value_;     // 为空表示尚未赋值
+};
+
+// 运行时闭包: 编译后的函数 + 捕获的自由变量
+class Closure : public Object, public gc::Collectable {
+public:
+    Closure(std::shared_ptr<CompiledFunction> fn, std::vector<std::shared_ptr<Cell>> free)
+        : fn_(std::move(fn)), free_(std::move(free)) {}
+    ObjectType Type() const override { return ObjectType::CLOSURE_OBJ; }
+    std::string Inspect() const override {
+        std::ostringstream out;
+        out << "Closure[" << this << "]";
+        return out.str();
+    }
+
+    void traverse(gc::Visitor &visitor) const override {
+        for (const auto &cell : free_) {
+            visitor.visit(cell.get());
+        }
+    }
+    void clear() override { free_.clear(); }
+
+public:
+    std::shared_ptr<CompiledFunction> fn_;
+    std::vector<std::shared_ptr<Cell>> free_;
+};
+
+} // namespace object
+} // namespace dragon
+#endif
@@ -2,50 +2,199 @@
 #define __ENVIRONMENT_H__
 
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "object.h"
+#include "gc.h"
 
 namespace dragon {
 
-class Environment {
+// 变量按槽位存放. 函数调用环境的槽位数和槽位名由 resolver 在 FunctionLiteral 上确定;
+// 全局环境的槽位随定义增长, 名字到槽位的映射放在 globalIndex_ 中.
+// 解析过的标识符通过 getLocal/getGlobal 直接按下标访问, get/set 按名字查找, 作为兜底.
+// 闭包与其定义环境之间可能形成引用环, 只有创建过闭包的环境才登记到 gc::Heap.
+// 全局环境的版本戳 version() 在每次改写全局槽位时取一个进程内递增的新值, 从未改写时为 0;
+// (全局环境, 版本) 不变即说明全局槽位都没有被改写, 供求值器的内联缓存判断缓存是否有效
+class Environment : public gc::Collectable {
 public:
-    Environment() : outer_(nullptr) {}
-    
+    using Names = std::vector<std::string>;
+
+    Environment() : outer_(nullptr), globals_(this) {}
+    Environment(const Environment &) = delete;
+    Environment &operator=(const Environment &) = delete;
+
     static std::shared_ptr<Environment> newEnvironment() {
         return std::make_shared<Environment>();
     }
-    
-    static std::shared_ptr<Environment> newEnclosedEnvironment(std::shared_ptr<Environment> outer) {
+
+    static std::shared_ptr<Environment> newEnclosedEnvironment(std::shared_ptr<Environment> outer,
+                                                               std::shared_ptr<const Names> names = nullptr) {
         auto env = newEnvironment();
+        if (names) {
+            env->slots_.resize(names->size());
+        }
+        env->names_ = std::move(names);
+        if (outer) {
+            env->globals_ = outer->globals_;
+        }
         env->outer_ = std::move(outer);
         return env;
     }
-    
-    std::pair<std::shared_ptr<object::Object>, bool> get(const std::string& name) const {
-        auto it = store_.find(name);
-        if (it != store_.end()) {
-            return {it->second, true};
+
+    // depth 为向外跨过的函数层数
+    const object::Value &getLocal(int depth, int slot) const {
+        const Environment *e = this;
+        while (depth-- > 0) {
+            e = e->outer_.get();
         }
-        
-        if (outer_) {
-            return outer_->get(name);
+        return e->slots_[slot];
+    }
+
+    const Environment *globalScope() const { return globals_; }
+
+    void setLocal(int slot, object::Value val) {
+        slots_[slot] = std::move(val);
+    }
+
+    uint64_t version() const { return version_; }
+
+    const object::Value &getGlobal(int slot) const {
+        static const object::Value none;
+        if (static_cast<size_t>(slot) >= globals_->slots_.size()) {
+            return none;
+        }
+        return globals_->slots_[slot];
+    }
+
+    void setGlobal(int slot, object::Value val) {
+        auto &slots = globals_->slots_;
+        if (static_cast<size_t>(slot) >= slots.size()) {
+            slots.resize(slot + 1);
+        }
+        slots[slot] = std::move(val);
+        globals_->version_ = nextVersion();
+    }
+
+    // 返回全局变量的槽位, 不存在时分配一个新槽位
+    int globalSlot(const std::string &name) {
+        auto &index = globals_->globalIndex_;
+        auto it = index.find(name);
+        if (it != index.end()) {
+            return it->second;
+        }
+        int slot = static_cast<int>(index.size());
+        index.emplace(name, slot);
+        globals_->slots_.resize(index.size());
+        globals_->version_ = nextVersion();
+        return slot;
+    }
+
+    // 字符串字面量的驻留表, 由全局环境持有, 首次使用时创建
+    object::InternTable &strings() {
+        auto &table = globals_->strings_;
+        if (!table) {
+            table = std::make_unique<object::InternTable>();
         }
-        
+        return *table;
+    }
+
+    bool findGlobalSlot(const std::string &name, int &slot) const {
+        auto &index = globals_->globalIndex_;
+        auto it = index.find(name);
+        if (it == index.end()) {
+            return false;
+        }
+        slot = it->second;
+        return true;
+    }
+
+    // 按名字逐层查找, 只认已经赋过值的槽位, 与原先逐层查 map 的语义一致
+    std::pair<object::Value, bool> get(const std::string& name) const {
+        for (const Environment *e = this; e; e = e->outer_.get()) {
+            if (!e->names_) {
+                continue;
+            }
+            const auto &names = *e->names_;
+            for (size_t i = 0; i < names.size(); ++i) {
+                if (names[i] == name && e->slots_[i]) {
+                    return {e->slots_[i], true};
+                }
+            }
+        }
+
+        int slot = 0;
+        if (findGlobalSlot(name, slot)) {
+            const auto &val = getGlobal(slot);
+            if (val) {
+                return {val, true};
+            }
+        }
+
         return {nullptr, false};
     }
-    
-    std::shared_ptr<object::Object> set(const std::string& name, std::shared_ptr<object::Object> val) {
-        store_[name] = std::move(val);
-        return store_[name];
+
+    // 当前环境有该名字的槽位时写入槽位, 否则定义为全局变量
+    object::Value set(const std::string& name, object::Value val) {
+        if (names_) {
+            const auto &names = *names_;
+            for (size_t i = 0; i < names.size(); ++i) {
+                if (names[i] == name) {
+                    slots_[i] = std::move(val);
+                    return slots_[i];
+                }
+            }
+        }
+
+        int slot = globalSlot(name);
+        setGlobal(slot, std::move(val));
+        return globals_->slots_[slot];
+    }
+
+    // 登记 env 及其外层环境, 遇到已登记的环境即停止
+    static void track(const std::shared_ptr<Environment> &env) {
+        auto &heap = gc::Heap::Instance();
+        for (auto e = env; e && !e->gcTracked(); e = e->outer_) {
+            heap.track(e);
+        }
+    }
+
+    void traverse(gc::Visitor &visitor) const override {
+        for (const auto &v : slots_) {
+            v.Traverse(visitor);
+        }
+        if (outer_) {
+            visitor.visit(outer_.get());
+        }
+    }
+
+    void clear() override {
+        slots_.clear();
+        outer_.reset();
+        if (globals_ == this) {
+            version_ = nextVersion();
+        }
     }
 
 private:
-    std::unordered_map<std::string, std::shared_ptr<object::Object>> store_;
+    static uint64_t nextVersion() {
+        static std::atomic<uint64_t> next{0};
+        return next.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    std::vector<object::Value> slots_;
+    std::shared_ptr<const Names> names_;
     std::shared_ptr<Environment> outer_;
+    Environment *globals_;      // 最外层的全局环境, 由 outer_ 链保证存活
+    uint64_t version_ = 0;      // 只在全局环境中使用
+    std::unordered_map<std::string, int> globalIndex_;  // 只在全局环境中使用
+    std::unique_ptr<object::InternTable> strings_;      // 只在全局环境中使用
 };
 
 } // namespace dragon
 
 
-#endif
\ No newline at end of file
+#endif
@@ -4,15 +4,20 @@
 
 #include "object.h"
 #include "ast.h"
+#include "arena.h"
 #include "environment.hpp"
 namespace dragon {
+namespace jit {
+class NativeCode;
+}
+
 namespace object {
-class Function : public Object {
+class Function : public Object, public gc::Collectable {
 public:
-    Function(std::vector<std::shared_ptr<ast::Identifier>> parameters, 
-        std::shared_ptr<ast::BlockStatement> body, 
-        std::shared_ptr<Environment> env)
-        : parameters_(parameters), body_(body), env_(env) {}
+    Function(const ast::FunctionLiteral *literal, std::shared_ptr<Environment> env)
+        : parameters_(literal->parameters_), body_(literal->body_), env_(std::move(env)),
+          locals_(literal->locals_),
+          arena_(literal->arena_ ? literal->arena_->shared_from_this() : nullptr) {}
     ObjectType Type() const override { return ObjectType::FUNCTION_OBJ; }
     std::string Inspect() const override {
         std::ostringstream out;
@@ -25,11 +30,24 @@ public:
         out << body_->String() << "\n}";
         return out.str();
     }
-    
+
+    void traverse(gc::Visitor &visitor) const override {
+        if (env_) {
+            visitor.visit(env_.get());
+        }
+    }
+    void clear() override { env_.reset(); }
+
 public:
-    std::vector<std::shared_ptr<ast::Identifier>>  parameters_;
-    std::shared_ptr<ast::BlockStatement> body_;
+    const std::vector<ast::Identifier *> &parameters_;  // 指向语法树中的节点, 由 arena_ 保证有效
+    const ast::BlockStatement *body_;
     std::shared_ptr<Environment> env_;
+    std::shared_ptr<const std::vector<std::string>> locals_;   // 函数环境的槽位名, 见 ast::FunctionLiteral
+    std::shared_ptr<const ast::Arena> arena_;
+
+    // 调用次数与编译得到的机器码, 由 jit::TryCall 维护
+    uint32_t calls_ = 0;
+    std::shared_ptr<const jit::NativeCode> native_;
 };
 } // namespace object
 } // namespace dragon
@@ -2,12 +2,14 @@
 #include "ast.h"
 #include "object.h"
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 using std::map;
 
 
@@ -21,13 +23,18 @@ namespace dragon {
                 {Object::ObjectType::BOOLEAN_OBJ, "BOOLEAN"},
                 {Object::ObjectType::STRING_OBJ, "STRING"},
 
-                {Object::ObjectType::RETURN_VALUE_OBJ, "RETURN_VALUE"},
 
                 {Object::ObjectType::FUNCTION_OBJ, "FUNCTION"},
                 {Object::ObjectType::BUILTIN_OBJ, "BUILTIN"},
 
                 {Object::ObjectType::ARRAY_OBJ, "ARRAY"},
                 {Object::ObjectType::HASH_OBJ, "HASH"},
+
+                {Object::ObjectType::COMPILED_FUNCTION_OBJ, "COMPILED_FUNCTION"},
+                {Object::ObjectType::CLOSURE_OBJ, "CLOSURE"},
+
+                {Object::ObjectType::NATIVE_FUNCTION_OBJ, "FUNCTION"},
+                {Object::ObjectType::CELL_OBJ, "CELL"},
         };
         string GetTypeString(const Object::ObjectType &ot) {
             if (m.find(ot) != m.end()) {
@@ -35,6 +42,402 @@ namespace dragon {
             }
             return "";
         }
+
+        Value::Value(std::shared_ptr<Object> obj) : tag_(Tag::NONE), signal_(Signal::NONE), int_(0) {
+            if (!obj) {
+                return;
+            }
+            switch (obj->Type()) {
+            case Object::ObjectType::INTEGER_OBJ:
+                tag_ = Tag::INTEGER;
+                int_ = static_cast<Integer*>(obj.get())->Value;
+                break;
+            case Object::ObjectType::BOOLEAN_OBJ:
+                tag_ = Tag::BOOLEAN;
+                int_ = static_cast<Boolean*>(obj.get())->Value ? 1 : 0;
+                break;
+            case Object::ObjectType::NULL_OBJ:
+                tag_ = Tag::NIL;
+                break;
+            case Object::ObjectType::ERROR_OBJ:
+                signal_ = Signal::ERROR;
+                tag_ = Tag::OBJECT;
+                new (&obj_) std::shared_ptr<Object>(std::move(obj));
+                break;
+            default:
+                tag_ = Tag::OBJECT;
+                new (&obj_) std::shared_ptr<Object>(std::move(obj));
+                break;
+            }
+        }
+
+        std::string Value::Inspect() const {
+            switch (tag_) {
+            case Tag::INTEGER: return std::to_string(int_);
+            case Tag::BOOLEAN: return int_ ? "true" : "false";
+            case Tag::OBJECT: return obj_->Inspect();
+            case Tag::NONE:
+            case Tag::NIL: break;
+            }
+            return "null";
+        }
+
+        std::shared_ptr<Object> Value::ToObject() const {
+            switch (tag_) {
+            case Tag::INTEGER: return NewInteger(int_);
+            case Tag::BOOLEAN: return BoolObject(int_ != 0);
+            case Tag::NIL: return NullObject();
+            case Tag::OBJECT: return obj_;
+            case Tag::NONE: break;
+            }
+            return nullptr;
+        }
+
+        void Value::Traverse(gc::Visitor &visitor) const {
+            if (tag_ != Tag::OBJECT) {
+                return;
+            }
+            if (auto c = dynamic_cast<const gc::Collectable*>(obj_.get())) {
+                visitor.visit(c);
+            }
+        }
+
+        bool HashKeyOf(const Value &v, HashKey &key) {
+            switch (v.tag()) {
+            case Value::Tag::INTEGER:
+                key = HashKey(Object::ObjectType::INTEGER_OBJ, v.AsInteger());
+                return true;
+            case Value::Tag::BOOLEAN:
+                key = HashKey(Object::ObjectType::BOOLEAN_OBJ, v.AsBoolean() ? 1 : 0);
+                return true;
+            case Value::Tag::OBJECT: {
+                auto hashable = dynamic_cast<const Hashable*>(v.get());
+                if (!hashable) {
+                    return false;
+                }
+                key = hashable->Hashkey();
+                return true;
+            }
+            case Value::Tag::NONE:
+            case Value::Tag::NIL:
+                break;
+            }
+            return false;
+        }
+
+        bool HashCodeOf(const Value &key, uint64_t &hash) {
+            HashKey hk(Object::ObjectType::NULL_OBJ, 0);
+            if (!HashKeyOf(key, hk)) {
+                return false;
+            }
+            // 混入类型后再打散 (splitmix64 的终结步骤), 连续整数也能均匀分布到各槽位
+            uint64_t h = hk.Value ^ (static_cast<uint64_t>(hk.Type) * 0x9e3779b97f4a7c15ULL);
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+            hash = h ^ (h >> 31);
+            return true;
+        }
+
+        bool HashKeyEquals(const Value &left, const Value &right) {
+            if (left.tag() != right.tag()) {
+                return false;
+            }
+            switch (left.tag()) {
+            case Value::Tag::INTEGER:
+            case Value::Tag::BOOLEAN:
+                return left.AsInteger() == right.AsInteger();
+            case Value::Tag::NONE:
+            case Value::Tag::NIL:
+                return true;
+            case Value::Tag::OBJECT:
+                break;
+            }
+            if (left.get() == right.get()) {
+                return true;
+            }
+            if (left.Type() == Object::ObjectType::STRING_OBJ && right.Type() == Object::ObjectType::STRING_OBJ) {
+                auto l = static_cast<const String*>(left.get());
+                auto r = static_cast<const String*>(right.get());
+                // 同一张表中两个不同的驻留字符串内容一定不同
+                if (l->internId() && r->internId() && l->internTable() == r->internTable()) {
+                    return false;
+                }
+                return l->hash() == r->hash() && l->size() == r->size() && l->str() == r->str();
+            }
+            return false;
+        }
+
+        void HashTable::reserve(size_t n) {
+            entries_.reserve(n);
+            size_t capacity = 8;
+            while (capacity * 2 < n * 3) {
+                capacity <<= 1;
+            }
+            if (capacity > index_.size()) {
+                rehash(capacity);
+            }
+        }
+
+        size_t HashTable::probe(uint64_t hash, const Value &key) const {
+            size_t mask = index_.size() - 1;
+            for (size_t i = hash & mask;; i = (i + 1) & mask) {
+                int32_t slot = index_[i];
+                if (slot == kEmpty) {
+                    return i;
+                }
+                const auto &e = entries_[slot];
+                if (e.hash_ == hash && HashKeyEquals(e.key_, key)) {
+                    return i;
+                }
+            }
+        }
+
+        void HashTable::rehash(size_t capacity) {
+            index_.assign(capacity, kEmpty);
+            size_t mask = capacity - 1;
+            for (size_t n = 0; n < entries_.size(); ++n) {
+                size_t i = entries_[n].hash_ & mask;
+                while (index_[i] != kEmpty) {
+                    i = (i + 1) & mask;
+                }
+                index_[i] = static_cast<int32_t>(n);
+            }
+        }
+
+        void HashTable::set(uint64_t hash, Value key, Value value) {
+            if ((entries_.size() + 1) * 3 > index_.size() * 2) {
+                rehash(index_.empty() ? 8 : index_.size() * 2);
+            }
+            size_t i = probe(hash, key);
+            if (index_[i] != kEmpty) {
+                entries_[index_[i]].value_ = std::move(value);
+                return;
+            }
+            index_[i] = static_cast<int32_t>(entries_.size());
+            Entry e;
+            e.key_ = std::move(key);
+            e.value_ = std::move(value);
+            e.hash_ = hash;
+            entries_.push_back(std::move(e));
+        }
+
+        const HashPair *HashTable::find(uint64_t hash, const Value &key) const {
+            if (entries_.empty()) {
+                return nullptr;
+            }
+            int32_t slot = index_[probe(hash, key)];
+            return slot == kEmpty ? nullptr : &entries_[slot];
+        }
+
+        namespace {
+            constexpr size_t kFlatLimit = 64;   // 拼接结果不超过此长度时直接复制
+            constexpr size_t kLeafLimit = 256;  // 追加的短串与末尾片段合并, 片段不超过此长度
+        }
+
+        String::String(std::shared_ptr<const String> left, std::shared_ptr<const String> right)
+            : left_(std::move(left)), right_(std::move(right)), size_(left_->size_ + right_->size_) {}
+
+        // 长的拼接链会形成很深的左斜树, 逐层析构会递归过深, 这里用显式栈拆开
+        String::~String() {
+            std::vector<std::shared_ptr<const String>> pending;
+            auto detach = [&pending](const String *s) {
+                if (s->left_) {
+                    pending.push_back(std::move(s->left_));
+                    pending.push_back(std::move(s->right_));
+                }
+            };
+            detach(this);
+            while (!pending.empty()) {
+                auto node = std::move(pending.back());
+                pending.pop_back();
+                if (node.use_count() == 1) {
+                    detach(node.get());
+                }
+            }
+        }
+
+        namespace {
+            bool isContainer(const Value &v) {
+                auto *obj = v.get();
+                return obj && (obj->Type() == Object::ObjectType::ARRAY_OBJ
+                               || obj->Type() == Object::ObjectType::HASH_OBJ);
+            }
+
+            // 把数组/哈希直接持有的子容器移到 pending 上, 再清空它
+            void detachContainers(Object *obj, std::vector<std::shared_ptr<Object>> &pending) {
+                if (obj->Type() == Object::ObjectType::ARRAY_OBJ) {
+                    auto &elements = static_cast<Array *>(obj)->elements_;
+                    for (const auto &e : elements) {
+                        if (isContainer(e)) {
+                            pending.push_back(e.AsObject());
+                        }
+                    }
+                    elements.clear();
+                    return;
+                }
+                auto &pairs = static_cast<Hash *>(obj)->pairs_;
+                for (const auto &pair : pairs) {
+                    if (isContainer(pair.value_)) {
+                        pending.push_back(pair.value_.AsObject());
+                    }
+                }
+                pairs.clear();
+            }
+
+            // 与 String 相同: 嵌套很深的容器逐层析构会耗尽栈, 只被当前容器持有的子容器改在显式的栈上释放
+            void releaseContainers(Object *root) {
+                std::vector<std::shared_ptr<Object>> pending;
+                detachContainers(root, pending);
+                while (!pending.empty()) {
+                    auto node = std::move(pending.back());
+                    pending.pop_back();
+                    if (node.use_count() == 1) {
+                        detachContainers(node.get(), pending);
+                    }
+                }
+            }
+
+            size_t containerSize(const Object *obj) {
+                if (obj->Type() == Object::ObjectType::ARRAY_OBJ) {
+                    return static_cast<const Array *>(obj)->elements_.size();
+                }
+                return static_cast<const Hash *>(obj)->pairs_.size();
+            }
+
+            // 数组输出全部元素, 哈希只输出值
+            const Value &containerItem(const Object *obj, size_t i) {
+                if (obj->Type() == Object::ObjectType::ARRAY_OBJ) {
+                    return static_cast<const Array *>(obj)->elements_[i];
+                }
+                return (static_cast<const Hash *>(obj)->pairs_.begin() + i)->value_;
+            }
+
+            // 数组带方括号, 哈希不带; 子容器压入显式的栈, 不随嵌套深度递归
+            std::string inspectContainer(const Object *root) {
+                struct Frame {
+                    const Object *obj;
+                    size_t next;
+                };
+                auto open = [](const Object *obj) { return obj->Type() == Object::ObjectType::ARRAY_OBJ ? "[" : ""; };
+                auto close = [](const Object *obj) { return obj->Type() == Object::ObjectType::ARRAY_OBJ ? "]" : ""; };
+
+                std::string out = open(root);
+                std::vector<Frame> stack{{root, 0}};
+                while (!stack.empty()) {
+                    auto &top = stack.back();
+                    if (top.next == containerSize(top.obj)) {
+                        out += close(top.obj);
+                        stack.pop_back();
+                        continue;
+                    }
+                    if (top.next != 0) {
+                        out += ", ";
+                    }
+                    const auto &item = containerItem(top.obj, top.next++);
+                    if (isContainer(item)) {
+                        out += open(item.get());
+                        stack.push_back({item.get(), 0});
+                    } else {
+                        out += item.Inspect();
+                    }
+                }
+                return out;
+            }
+        } // namespace
+
+        Array::~Array() { releaseContainers(this); }
+
+        std::string Array::Inspect() const { return inspectContainer(this); }
+
+        Hash::~Hash() { releaseContainers(this); }
+
+        std::string Hash::Inspect() const { return inspectContainer(this); }
+
+        std::shared_ptr<String> String::Concat(const std::shared_ptr<String> &left,
+                                               const std::shared_ptr<String> &right) {
+            size_t total = left->size_ + right->size_;
+            if (total <= kFlatLimit) {
+                string s;
+                s.reserve(total);
+                s += left->str();
+                s += right->str();
+                return std::make_shared<String>(std::move(s));
+            }
+
+            // 追加短串时复制左边最末的短片段, 其余部分共享, 避免产生大量很小的节点
+            if (left->left_ && !left->right_->left_ && left->right_->size_ + right->size_ <= kLeafLimit) {
+                string tail;
+                tail.reserve(left->right_->size_ + right->size_);
+                tail += left->right_->value_;
+                tail += right->str();
+                return std::shared_ptr<String>(new String(left->left_, std::make_shared<String>(std::move(tail))));
+            }
+            return std::shared_ptr<String>(new String(left, right));
+        }
+
+        void String::flatten() const {
+            string out;
+            out.reserve(size_);
+            std::vector<const String *> stack{this};
+            while (!stack.empty()) {
+                const String *s = stack.back();
+                stack.pop_back();
+                if (s->left_) {
+                    stack.push_back(s->right_.get());
+                    stack.push_back(s->left_.get());
+                } else {
+                    out += s->value_;
+                }
+            }
+            value_ = std::move(out);
+            left_.reset();
+            right_.reset();
+        }
+
+        InternTable::InternTable() {
+            static std::atomic<uint32_t> next{0};
+            id_ = next.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        const std::shared_ptr<String> &InternTable::intern(std::string_view s) {
+            auto it = table_.find(s);
+            if (it != table_.end()) {
+                return it->second;
+            }
+            auto str = std::make_shared<String>(std::string(s));
+            str->hash();
+            str->internTable_ = id_;
+            str->internId_ = static_cast<uint32_t>(table_.size() + 1);
+            std::string_view key(str->str());
+            return table_.emplace(key, std::move(str)).first->second;
+        }
+
+        const std::shared_ptr<Object> &TrueObject() {
+            static const std::shared_ptr<Object> obj = std::make_shared<Boolean>(true);
+            return obj;
+        }
+
+        const std::shared_ptr<Object> &FalseObject() {
+            static const std::shared_ptr<Object> obj = std::make_shared<Boolean>(false);
+            return obj;
+        }
+
+        const std::shared_ptr<Object> &NullObject() {
+            static const std::shared_ptr<Object> obj = std::make_shared<Null>();
+            return obj;
+        }
+
+        const std::vector<std::shared_ptr<Object>> &SmallIntegers() {
+            static const std::vector<std::shared_ptr<Object>> ints = [] {
+                std::vector<std::shared_ptr<Object>> v;
+                v.reserve(kSmallIntMax - kSmallIntMin + 1);
+                for (int64_t i = kSmallIntMin; i <= kSmallIntMax; ++i) {
+                    v.push_back(std::make_shared<Integer>(i));
+                }
+                return v;
+            }();
+            return ints;
+        }
     }
 } // namespace dragon
 
@@ -3,7 +3,17 @@
 
 #include "ast.h"
 #include "hash.h"
+#include "gc.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
 #include <string>
+#include <functional>
+#include <type_traits>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace dragon {
 namespace object {
@@ -18,20 +28,179 @@ public:
         BOOLEAN_OBJ,
         STRING_OBJ,
 
-        RETURN_VALUE_OBJ,
-
         FUNCTION_OBJ,
         BUILTIN_OBJ,
 
         ARRAY_OBJ,
         HASH_OBJ, // "HASH
+
+        COMPILED_FUNCTION_OBJ,
+        CLOSURE_OBJ,
+
+        NATIVE_FUNCTION_OBJ,
+        CELL_OBJ,
     };
     virtual ~Object() = default;
     virtual ObjectType Type() const = 0;
     virtual std::string Inspect() const = 0;
 };
 
-using BuiltinFunction = std::function<std::shared_ptr<Object>(const std::vector<std::shared_ptr<Object>>&)>;
+// 求值器中流动的值: int64/bool/null 直接存放在 Value 内, 不分配内存;
+// 字符串/数组/哈希/函数/错误等仍是堆上的 Object.
+// NONE 表示 "没有值" (如 let 语句的结果), 对应原先的空指针.
+// signal() 是随值一起传递的控制流状态: return 语句的值带 RETURN, 错误带 ERROR,
+// 求值器据此提前结束块和函数, 不再为 return 分配包装对象, 也不必在每条语句后查询对象类型.
+// GCC 在优化构建中无法把 tag_ 与 union 成员关联起来, 会误报 obj_ 未初始化
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+class Value {
+public:
+    enum class Tag : uint8_t { NONE, NIL, BOOLEAN, INTEGER, OBJECT };
+    enum class Signal : uint8_t { NONE, RETURN, ERROR };
+
+    Value() noexcept : tag_(Tag::NONE), signal_(Signal::NONE), int_(0) {}
+    Value(std::nullptr_t) noexcept : Value() {}
+    // Integer/Boolean/Null 对象会被拆箱为内联的值
+    Value(std::shared_ptr<Object> obj);
+    template <typename T, typename = typename std::enable_if<std::is_base_of<Object, T>::value>::type>
+    Value(std::shared_ptr<T> obj) : Value(std::shared_ptr<Object>(std::move(obj))) {}
+
+    Value(const Value &other) : tag_(other.tag_), signal_(other.signal_) {
+        if (tag_ == Tag::OBJECT) {
+            new (&obj_) std::shared_ptr<Object>(other.obj_);
+        } else {
+            int_ = other.int_;
+        }
+    }
+
+    Value(Value &&other) noexcept : tag_(other.tag_), signal_(other.signal_) {
+        if (tag_ == Tag::OBJECT) {
+            new (&obj_) std::shared_ptr<Object>(std::move(other.obj_));
+            other.reset();
+        } else {
+            int_ = other.int_;
+        }
+    }
+
+    Value &operator=(const Value &other) {
+        if (this != &other) {
+            reset();
+            tag_ = other.tag_;
+            signal_ = other.signal_;
+            if (tag_ == Tag::OBJECT) {
+                new (&obj_) std::shared_ptr<Object>(other.obj_);
+            } else {
+                int_ = other.int_;
+            }
+        }
+        return *this;
+    }
+
+    Value &operator=(Value &&other) noexcept {
+        if (this != &other) {
+            reset();
+            tag_ = other.tag_;
+            signal_ = other.signal_;
+            if (tag_ == Tag::OBJECT) {
+                new (&obj_) std::shared_ptr<Object>(std::move(other.obj_));
+                other.reset();
+            } else {
+                int_ = other.int_;
+            }
+        }
+        return *this;
+    }
+
+    ~Value() { reset(); }
+
+    static Value Int(int64_t v) { Value r; r.tag_ = Tag::INTEGER; r.int_ = v; return r; }
+    static Value Bool(bool v) { Value r; r.tag_ = Tag::BOOLEAN; r.int_ = v ? 1 : 0; return r; }
+    static Value Nil() { Value r; r.tag_ = Tag::NIL; return r; }
+    // return 语句的值; 错误保持 ERROR
+    static Value Return(Value v) {
+        if (v.signal_ == Signal::NONE) {
+            v.signal_ = Signal::RETURN;
+        }
+        return v;
+    }
+
+    void reset() noexcept {
+        if (tag_ == Tag::OBJECT) {
+            obj_.~shared_ptr<Object>();
+        }
+        tag_ = Tag::NONE;
+        signal_ = Signal::NONE;
+        int_ = 0;
+    }
+
+    Tag tag() const { return tag_; }
+    Signal signal() const { return signal_; }
+    bool IsError() const { return signal_ == Signal::ERROR; }
+    bool IsReturn() const { return signal_ == Signal::RETURN; }
+    // 带 RETURN 或 ERROR, 所在的块应当立即结束
+    bool IsAbrupt() const { return signal_ != Signal::NONE; }
+    // 在函数调用或程序的边界上解开 return
+    void ClearReturn() {
+        if (signal_ == Signal::RETURN) {
+            signal_ = Signal::NONE;
+        }
+    }
+
+    explicit operator bool() const { return tag_ != Tag::NONE; }
+    bool IsInteger() const { return tag_ == Tag::INTEGER; }
+    bool IsBoolean() const { return tag_ == Tag::BOOLEAN; }
+    bool IsNil() const { return tag_ == Tag::NIL; }
+    bool IsObject() const { return tag_ == Tag::OBJECT; }
+
+    int64_t AsInteger() const { return int_; }
+    bool AsBoolean() const { return int_ != 0; }
+    // 只在 IsObject() 时有效
+    const std::shared_ptr<Object> &AsObject() const { return obj_; }
+    Object *get() const { return tag_ == Tag::OBJECT ? obj_.get() : nullptr; }
+
+    Object::ObjectType Type() const {
+        switch (tag_) {
+        case Tag::BOOLEAN: return Object::ObjectType::BOOLEAN_OBJ;
+        case Tag::INTEGER: return Object::ObjectType::INTEGER_OBJ;
+        case Tag::OBJECT: return obj_->Type();
+        case Tag::NONE:
+        case Tag::NIL: break;
+        }
+        return Object::ObjectType::NULL_OBJ;
+    }
+
+    std::string Inspect() const;
+    // 装箱为 Object, 供虚拟机和对外接口使用; 小整数与 true/false/null 使用共享实例
+    std::shared_ptr<Object> ToObject() const;
+
+    // 函数/闭包/数组/哈希可能参与引用环, 由 gc::Heap 登记
+    bool IsCollectable() const {
+        if (tag_ != Tag::OBJECT) {
+            return false;
+        }
+        auto t = obj_->Type();
+        return t == Object::ObjectType::FUNCTION_OBJ || t == Object::ObjectType::NATIVE_FUNCTION_OBJ
+            || t == Object::ObjectType::CLOSURE_OBJ || t == Object::ObjectType::ARRAY_OBJ
+            || t == Object::ObjectType::HASH_OBJ;
+    }
+    // 持有可回收对象时对其调用 visitor
+    void Traverse(gc::Visitor &visitor) const;
+
+private:
+    Tag tag_;
+    Signal signal_;
+    union {
+        int64_t int_;
+        std::shared_ptr<Object> obj_;
+    };
+};
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+using BuiltinFunction = std::function<Value(const std::vector<Value>&)>;
 
 class HashKey {
 public:
@@ -49,32 +218,65 @@ public:
 
 class HashPair {
 public:
-    std::shared_ptr<Object> key_;
-    std::shared_ptr<Object> value_;
+    Value key_;
+    Value value_;
 };
 
-class Hash : public Object{
+// 可哈希的键 (整数/布尔/字符串) 计算哈希值, 类型参与计算; 不可哈希时返回 false
+bool HashCodeOf(const Value &key, uint64_t &hash);
+// 键的类型和值都相等才视为同一个键
+bool HashKeyEquals(const Value &left, const Value &right);
+
+// 开放寻址哈希表: 键值对按插入顺序连续存放在 entries_ 中, 并缓存各自的哈希值;
+// index_ 是线性探测的槽位数组, 保存 entries_ 的下标. 哈希对象不可变, 因此不支持删除
+class HashTable {
 public:
-    Hash(std::map<HashKey, HashPair> m) : pairs_(m){}
-    std::map<HashKey, HashPair> pairs_;
+    struct Entry : HashPair {
+        uint64_t hash_;
+    };
+
+    void reserve(size_t n);
+    // 键已存在时覆盖其值
+    void set(uint64_t hash, Value key, Value value);
+    const HashPair *find(uint64_t hash, const Value &key) const;
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    void clear() { entries_.clear(); index_.clear(); }
+
+    std::vector<Entry>::const_iterator begin() const { return entries_.begin(); }
+    std::vector<Entry>::const_iterator end() const { return entries_.end(); }
+
+private:
+    static constexpr int32_t kEmpty = -1;
+
+    // 返回 hash/key 所在的槽位, 不存在时返回探测到的空槽位
+    size_t probe(uint64_t hash, const Value &key) const;
+    void rehash(size_t capacity);
+
+    std::vector<Entry> entries_;
+    std::vector<int32_t> index_;    // 容量为 2 的幂, 负载不超过 2/3
+};
+
+class Hash : public Object, public gc::Collectable {
+public:
+    Hash(HashTable pairs) : pairs_(std::move(pairs)){}
+    HashTable pairs_;
 public:
     ObjectType Type() const override {
         return ObjectType::HASH_OBJ;
     }
 
-    string Inspect() const override {
-        std::stringstream out;
-        bool first = true;
-        for (const auto& pair : pairs_) {
-            if (!first) {
-                out << ", ";
-            }
-            first = false;
-            out << pair.second.value_->Inspect();
+    void traverse(gc::Visitor &visitor) const override {
+        for (const auto &pair : pairs_) {
+            pair.key_.Traverse(visitor);
+            pair.value_.Traverse(visitor);
         }
-
-        return out.str();
     }
+    void clear() override { pairs_.clear(); }
+
+    ~Hash() override;
+    string Inspect() const override;
 };
 // hash 接口
 class Hashable {
@@ -135,22 +337,92 @@ public:
     }
 };
 
+// 字符串. 较长的拼接结果先以绳 (rope) 的形式只记录左右两部分, 等到需要连续内容
+// (str, 哈希, Inspect) 时才展开一次, 反复执行 s = s + t 因而不必每次复制整个前缀.
+// 字符串对外不可变, 展开只改变内部表示
 class String : public Object, public Hashable {
 public:
-    string Value;
-    String(const string &s):Value(s){}
+    String(const string &s):value_(s), size_(value_.size()){}
+    String(string &&s):value_(std::move(s)), size_(value_.size()){}
+    ~String() override;
+
+    // 返回 left + right, 两个操作数保持不变
+    static std::shared_ptr<String> Concat(const std::shared_ptr<String> &left,
+                                          const std::shared_ptr<String> &right);
+
+    // 连续的内容, 必要时先展开
+    const string &str() const {
+        if (left_) {
+            flatten();
+        }
+        return value_;
+    }
+    // 长度不需要展开
+    size_t size() const { return size_; }
+    bool isRope() const { return left_ != nullptr; }
+
     bool lessThan (const Hashable& other) const override{
         const auto* p = dynamic_cast<const String*>(&other);
-        return Value < p->Value;
+        return str() < p->str();
     }
     ObjectType Type() const override {return ObjectType::STRING_OBJ;}
     std::string Inspect() const override {
-        return Value;
+        return str();
     }
 
     HashKey Hashkey() const override {
-        return HashKey(Type(), util::times33_hash(Value.c_str()));
+        return HashKey(Type(), hash());
+    }
+
+    // 内容的哈希值, 第一次使用时计算并缓存
+    uint64_t hash() const {
+        if (!hashed_) {
+            hash_ = util::string_hash(str());
+            hashed_ = true;
+        }
+        return hash_;
     }
+
+    // 驻留编号, 0 表示未驻留. 同一张驻留表中内容相同的驻留字符串是同一个对象
+    uint32_t internId() const { return internId_; }
+    // 所在驻留表的编号, 未驻留时为 0
+    uint32_t internTable() const { return internTable_; }
+
+private:
+    friend class InternTable;
+
+    String(std::shared_ptr<const String> left, std::shared_ptr<const String> right);
+    void flatten() const;
+
+    mutable string value_;                          // 展开后的内容, 绳节点展开前为空
+    mutable std::shared_ptr<const String> left_;    // 绳节点的左右两部分, 展开后释放
+    mutable std::shared_ptr<const String> right_;
+    size_t size_;
+    mutable uint64_t hash_ = 0;
+    mutable bool hashed_ = false;
+    uint32_t internTable_ = 0;
+    uint32_t internId_ = 0;
+};
+
+// 字符串驻留表, 由全局环境持有 (见 Environment::strings), 随其释放.
+// 驻留字符串不可修改; 不同表中的驻留字符串内容可能相同
+class InternTable {
+public:
+    InternTable();
+    InternTable(const InternTable &) = delete;
+    InternTable &operator=(const InternTable &) = delete;
+
+    // 返回内容为 s 的驻留字符串, 首次出现时创建
+    const std::shared_ptr<String> &intern(std::string_view s);
+    size_t size() const { return table_.size(); }
+
+private:
+    struct Hash {
+        size_t operator()(std::string_view s) const { return util::string_hash(s); }
+    };
+    // 键指向驻留字符串自身的内容, 字符串由表持有且不会被修改, 因此一直有效
+    std::unordered_map<std::string_view, std::shared_ptr<String>, Hash> table_;
+    uint32_t id_;
 };
 
 // 内置函数
@@ -169,28 +441,34 @@ public:
     }
 };
 
+// 函数体不是语法树的脚本函数 (如 aot::Function), 由对象自身执行调用.
+// 对脚本而言与 Function 没有区别, 类型名同为 FUNCTION
+class NativeFunction : public Object, public gc::Collectable {
+public:
+    ObjectType Type() const override { return ObjectType::NATIVE_FUNCTION_OBJ; }
+    virtual Value call(std::vector<Value> args) const = 0;
+};
+
 // 数组对象
-class Array :public Object {
+class Array :public Object, public gc::Collectable {
 public:
-    std::vector<std::shared_ptr<Object>> elements_;
+    std::vector<Value> elements_;
 public:
-    Array(vector<std::shared_ptr<Object>> &es): elements_(es){}
+    Array(std::vector<Value> es): elements_(std::move(es)){}
     ObjectType Type()const override {
         return ObjectType::ARRAY_OBJ;
     }
 
-    std::string Inspect() const override {
-        std::stringstream out;
-        out << "[";
-        for (size_t i = 0; i < elements_.size(); ++i) {
-            if (i != 0) {
-                out << ", ";
-            }
-            out << elements_[i]->Inspect();
+    void traverse(gc::Visitor &visitor) const override {
+        for (const auto &e : elements_) {
+            e.Traverse(visitor);
         }
-        out << "]";
-        return out.str();
     }
+    void clear() override { elements_.clear(); }
+
+    // 析构和 Inspect 不随嵌套深度递归, 见 object.cpp
+    ~Array() override;
+    std::string Inspect() const override;
 };
 
 
@@ -200,14 +478,6 @@ public:
     std::string Inspect() const override { return "null"; }
 };
 
-class ReturnValue : public Object {
-public:
-    std::shared_ptr<Object> value_;
-    ReturnValue(std::shared_ptr<Object> v) : value_(v) {}
-    ObjectType Type() const override { return ObjectType::RETURN_VALUE_OBJ; }
-    std::string Inspect() const override { return value_ ? value_->Inspect() : "null"; }
-};
-
 class Error : public Object {
 public:
     std::string Message;
@@ -217,6 +487,39 @@ public:
 };
 
 string GetTypeString(const Object::ObjectType &ot);
+
+// 规范实例: true/false/null 全局唯一, 小整数预先分配.
+// 值对象创建后不再修改, 因此可以安全共享; 比较布尔值或 null 时也可以直接比较指针
+#ifndef DRAGON_SMALL_INT_MIN
+#define DRAGON_SMALL_INT_MIN (-128)
+#endif
+#ifndef DRAGON_SMALL_INT_MAX
+#define DRAGON_SMALL_INT_MAX 1023
+#endif
+const int64_t kSmallIntMin = DRAGON_SMALL_INT_MIN;
+const int64_t kSmallIntMax = DRAGON_SMALL_INT_MAX;
+
+const std::shared_ptr<Object> &TrueObject();
+const std::shared_ptr<Object> &FalseObject();
+const std::shared_ptr<Object> &NullObject();
+const std::vector<std::shared_ptr<Object>> &SmallIntegers();
+
+inline const std::shared_ptr<Object> &BoolObject(bool v)
+{
+    return v ? TrueObject() : FalseObject();
+}
+
+// 取值的哈希键, 不可作为键时返回 false
+bool HashKeyOf(const Value &v, HashKey &key);
+
+// 范围内的整数返回缓存的实例, 否则新建
+inline std::shared_ptr<Object> NewInteger(int64_t v)
+{
+    if (v >= kSmallIntMin && v <= kSmallIntMax) {
+        return SmallIntegers()[v - kSmallIntMin];
+    }
+    return std::make_shared<Integer>(v);
+}
 } // namespace object
 } // namespace dragon
 
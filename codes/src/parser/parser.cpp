@@ -3,20 +3,25 @@
 //
 
 #include "parser.h"
-#include <map>
 #include "token.h"
 namespace parser {
-std::map<token::TokenType, parser::Precedence> precedences = {
-        {EQ, parser::EQUALS},
-        {NOT_EQ, parser::EQUALS},
-        {LT, parser::LESSGREATER},
-        {GT, parser::LESSGREATER},
-        {PLUS, parser::SUM},
-        {MINUS, parser::SUM},
-        {SLASH, parser::PRODUCT},
-        {ASTERISK, parser::PRODUCT},
-        {LPAREN, parser::CALL},
-        {LBRACKET, parser::INDEX},
-};
+static std::array<Precedence, token::kTokenTypeCount> makePrecedences()
+{
+    std::array<Precedence, token::kTokenTypeCount> p;
+    p.fill(LOWEST);
+    p[static_cast<size_t>(token::TokenType::EQ)] = EQUALS;
+    p[static_cast<size_t>(token::TokenType::NOT_EQ)] = EQUALS;
+    p[static_cast<size_t>(token::TokenType::LT)] = LESSGREATER;
+    p[static_cast<size_t>(token::TokenType::GT)] = LESSGREATER;
+    p[static_cast<size_t>(token::TokenType::PLUS)] = SUM;
+    p[static_cast<size_t>(token::TokenType::MINUS)] = SUM;
+    p[static_cast<size_t>(token::TokenType::SLASH)] = PRODUCT;
+    p[static_cast<size_t>(token::TokenType::ASTERISK)] = PRODUCT;
+    p[static_cast<size_t>(token::TokenType::LPAREN)] = CALL;
+    p[static_cast<size_t>(token::TokenType::LBRACKET)] = INDEX;
+    return p;
+}
 
-} // namespace parser
\ No newline at end of file
+const std::array<Precedence, token::kTokenTypeCount> precedences = makePrecedences();
+
+} // namespace parser
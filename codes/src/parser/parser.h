@@ -6,15 +6,16 @@
 #define MYPROJECT_PARSER_H
 
 #include "ast.h"
+#include "arena.h"
 #include "lexer.h"
 
 #include <memory>
 #include <vector>
 #include <string>
+#include <array>
 #include <map>
-#include <stdexcept>
-#include <functional>
-#include <cstdlib> // for strtol
+#include <charconv>
+#include <string_view>
 
 namespace parser
 {
@@ -30,37 +31,40 @@ enum Precedence {
     INDEX // array[index]
 };
 
-extern std::map<token::TokenType, Precedence> precedences;
+extern const std::array<Precedence, token::kTokenTypeCount> precedences;
 class Parser {
 public:
-    using PrefixParseFn = std::function<std::unique_ptr<ast::Expression>()>;
-    using InfixParseFn = std::function<std::unique_ptr<ast::Expression>(std::unique_ptr<ast::Expression>)>;
-    explicit Parser(lexer::Lexer& l) : lexer(l) {
+    using PrefixParseFn = ast::Expression *(Parser::*)();
+    using InfixParseFn = ast::Expression *(Parser::*)(ast::Expression *);
+    explicit Parser(lexer::Lexer& l) : lexer(l), arena_(std::make_shared<ast::Arena>()) {
+        prefixParseFns.fill(nullptr);
+        infixParseFns.fill(nullptr);
+
         // Initialize prefix parse functions
-        registerPrefix(IDENT, [this]() { return parseIdentifier(); });
-        registerPrefix(INT, [this]() { return parseIntegerLiteral(); });
-        registerPrefix(STRING, [this](){return parseStringLiteral();});
-        registerPrefix(BANG, [this]() { return parsePrefixExpression(); });
-        registerPrefix(MINUS, [this]() { return parsePrefixExpression(); });
-        registerPrefix(TRUE, [this]() { return parseBoolean(); });
-        registerPrefix(FALSE, [this]() { return parseBoolean(); });
-        registerPrefix(LPAREN, [this]() { return parseGroupedExpression(); });
-        registerPrefix(IF, [this]() { return parseIfExpression(); });
-        registerPrefix(FUNCTION, [this]() { return parseFunctionLiteral(); });
-        registerPrefix(LBRACKET, [this]() { return parseArrayLiteral(); } ); //
-        registerPrefix(LBRACE, [this](){return parseHashLiteral();});
+        registerPrefix(token::TokenType::IDENT, &Parser::parseIdentifier);
+        registerPrefix(token::TokenType::INT, &Parser::parseIntegerLiteral);
+        registerPrefix(token::TokenType::STRING, &Parser::parseStringLiteral);
+        registerPrefix(token::TokenType::BANG, &Parser::parsePrefixExpression);
+        registerPrefix(token::TokenType::MINUS, &Parser::parsePrefixExpression);
+        registerPrefix(token::TokenType::TRUE, &Parser::parseBoolean);
+        registerPrefix(token::TokenType::FALSE, &Parser::parseBoolean);
+        registerPrefix(token::TokenType::LPAREN, &Parser::parseGroupedExpression);
+        registerPrefix(token::TokenType::IF, &Parser::parseIfExpression);
+        registerPrefix(token::TokenType::FUNCTION, &Parser::parseFunctionLiteral);
+        registerPrefix(token::TokenType::LBRACKET, &Parser::parseArrayLiteral);
+        registerPrefix(token::TokenType::LBRACE, &Parser::parseHashLiteral);
 
         // Initialize infix parse functions
-        registerInfix(PLUS, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(MINUS, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(SLASH, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(ASTERISK, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(EQ, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(NOT_EQ, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(LT, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(GT, [this](auto left) { return parseInfixExpression(std::move(left)); });
-        registerInfix(LPAREN, [this](auto left) { return parseCallExpression(std::move(left)); });
-        registerInfix(LBRACKET, [this](auto left){return parseIndexExpression(std::move(left));});
+        registerInfix(token::TokenType::PLUS, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::MINUS, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::SLASH, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::ASTERISK, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::EQ, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::NOT_EQ, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::LT, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::GT, &Parser::parseInfixExpression);
+        registerInfix(token::TokenType::LPAREN, &Parser::parseCallExpression);
+        registerInfix(token::TokenType::LBRACKET, &Parser::parseIndexExpression);
         // Read two tokens to initialize
         nextToken();
         nextToken();
@@ -68,11 +72,12 @@ public:
 
     std::shared_ptr<ast::Program> parseProgram() {
         auto program = std::make_shared<ast::Program>();
+        program->arena_ = arena_;
 
-        while (currentToken.Type != MEOF) {
+        while (currentToken.Type != token::TokenType::MEOF) {
             auto stmt = parseStatement();
             if (stmt) {
-                program->statements_.push_back(std::move(stmt));
+                program->statements_.push_back(stmt);
             }
             nextToken();
         }
@@ -84,15 +89,28 @@ public:
 
     lexer::Lexer& lexer;
     std::vector<std::string> errors;
-    token::Token currentToken;
-    token::Token peekToken;
+    // 本次解析产生的节点都分配在这里, 由 parseProgram 返回的 Program 持有
+    std::shared_ptr<ast::Arena> arena_;
+    // 只保存 token 的位置, 文本按需从 lexer 的输入中取
+    token::TokenView currentToken;
+    token::TokenView peekToken;
 
-    std::map<token::TokenType, PrefixParseFn> prefixParseFns;
-    std::map<token::TokenType, InfixParseFn> infixParseFns;
+    // 以 TokenType 为下标直接查表
+    std::array<PrefixParseFn, token::kTokenTypeCount> prefixParseFns;
+    std::array<InfixParseFn, token::kTokenTypeCount> infixParseFns;
 
     void nextToken() {
         currentToken = peekToken;
-        peekToken = lexer.NextToken();
+        peekToken = lexer.NextTokenView();
+    }
+
+    // AST 节点可能比源码活得久, 挂到节点上的 token 需要复制文本
+    token::Token ownedToken() const {
+        return lexer.ToToken(currentToken);
+    }
+
+    std::string_view currentLiteral() const {
+        return lexer.Literal(currentToken);
     }
 
     bool currentTokenIs(token::TokenType t) const {
@@ -114,23 +132,23 @@ public:
     }
 
     void peekError(token::TokenType t) {
-        errors.push_back("expected next token to be " +
-                         t +
+        errors.push_back(std::string("expected next token to be ") +
+                         token::TokenTypeName(t) +
                          ", got " +
-                         peekToken.Type +
+                         token::TokenTypeName(peekToken.Type) +
                          " instead");
     }
 
     void noPrefixParseFnError(token::TokenType t) {
-        errors.push_back("no prefix parse function for " +
-                         t +
+        errors.push_back(std::string("no prefix parse function for ") +
+                         token::TokenTypeName(t) +
                          " found");
     }
 
-    std::unique_ptr<ast::Statement> parseStatement() {
-        if (currentToken.Type == LET) {
+    ast::Statement *parseStatement() {
+        if (currentToken.Type == token::TokenType::LET) {
             return parseLetStatement();
-        } else if (currentToken.Type == RETURN) {
+        } else if (currentToken.Type == token::TokenType::RETURN) {
             return parseReturnStatement();
         }
         else
@@ -139,131 +157,127 @@ public:
         }
     }
 
-    std::unique_ptr<ast::LetStatement> parseLetStatement() {
-        auto stmt = std::make_unique<ast::LetStatement>();
-        stmt->token_ = currentToken;
+    ast::LetStatement *parseLetStatement() {
+        auto stmt = arena_->make<ast::LetStatement>();
+        stmt->token_ = ownedToken();
 
-        if (!expectPeek(IDENT)) {
+        if (!expectPeek(token::TokenType::IDENT)) {
             return nullptr;
         }
 
-        stmt->name_ = std::make_unique<ast::Identifier>();
-        stmt->name_->token_ = currentToken;
-        stmt->name_->value_ = currentToken.Literal;
+        stmt->name_ = arena_->make<ast::Identifier>();
+        stmt->name_->token_ = ownedToken();
+        stmt->name_->value_ = std::string(currentLiteral());
 
-        if (!expectPeek(ASSIGN)) {
+        if (!expectPeek(token::TokenType::ASSIGN)) {
             return nullptr;
         }
 
         nextToken();
         stmt->value_ = parseExpression(LOWEST);
 
-        if (peekTokenIs(SEMICOLON)) {
+        if (peekTokenIs(token::TokenType::SEMICOLON)) {
             nextToken();
         }
 
         return stmt;
     }
 
-    std::unique_ptr<ast::ReturnStatement> parseReturnStatement() {
-        auto stmt = std::make_unique<ast::ReturnStatement>();
-        stmt->token_ = currentToken;
+    ast::ReturnStatement *parseReturnStatement() {
+        auto stmt = arena_->make<ast::ReturnStatement>();
+        stmt->token_ = ownedToken();
 
         nextToken();
         stmt->returnValue_ = parseExpression(LOWEST);
 
-        if (peekTokenIs(SEMICOLON)) {
+        if (peekTokenIs(token::TokenType::SEMICOLON)) {
             nextToken();
         }
 
         return stmt;
     }
 
-    std::unique_ptr<ast::ExpressionStatement> parseExpressionStatement() {
-        auto stmt = std::make_unique<ast::ExpressionStatement>();
-        stmt->token_ = currentToken;
+    ast::ExpressionStatement *parseExpressionStatement() {
+        auto stmt = arena_->make<ast::ExpressionStatement>();
+        stmt->token_ = ownedToken();
         stmt->expression_ = parseExpression(LOWEST);
 
-        if (peekTokenIs(SEMICOLON)) {
+        if (peekTokenIs(token::TokenType::SEMICOLON)) {
             nextToken();
         }
 
         return stmt;
     }
 
-    std::unique_ptr<ast::Expression> parseExpression(Precedence precedence) {
-        auto prefix = prefixParseFns[currentToken.Type];
+    ast::Expression *parseExpression(Precedence precedence) {
+        auto prefix = prefixParseFns[static_cast<size_t>(currentToken.Type)];
         if (!prefix) {
             noPrefixParseFnError(currentToken.Type);
             return nullptr;
         }
 
-        auto leftExp = prefix();
+        auto leftExp = (this->*prefix)();
 
-        while (!peekTokenIs(SEMICOLON) && precedence < peekPrecedence()) {
-            auto infix = infixParseFns[peekToken.Type];
+        while (!peekTokenIs(token::TokenType::SEMICOLON) && precedence < peekPrecedence()) {
+            auto infix = infixParseFns[static_cast<size_t>(peekToken.Type)];
             if (!infix) {
                 return leftExp;
             }
 
             nextToken();
-            leftExp = infix(std::move(leftExp));
+            leftExp = (this->*infix)(leftExp);
         }
 
         return leftExp;
     }
 
     Precedence peekPrecedence() const {
-        auto it = precedences.find(peekToken.Type);
-        if (it != precedences.end()) {
-            return it->second;
-        }
-        return LOWEST;
+        return precedences[static_cast<size_t>(peekToken.Type)];
     }
 
     Precedence currentPrecedence() const {
-        auto it = precedences.find(currentToken.Type);
-        if (it != precedences.end()) {
-            return it->second;
-        }
-        return LOWEST;
+        return precedences[static_cast<size_t>(currentToken.Type)];
     }
 
-    std::unique_ptr<ast::Expression> parseIdentifier() {
-        auto ident = std::make_unique<ast::Identifier>();
-        ident->token_ = currentToken;
-        ident->value_ = currentToken.Literal;
+    ast::Expression *parseIdentifier() {
+        auto ident = arena_->make<ast::Identifier>();
+        ident->token_ = ownedToken();
+        ident->value_ = std::string(currentLiteral());
         return ident;
     }
 
-    std::unique_ptr<ast::Expression> parseIntegerLiteral() {
-        auto lit = std::make_unique<ast::IntegerLiteral>();
-        lit->token_ = currentToken;
+    ast::Expression *parseIntegerLiteral() {
+        auto lit = arena_->make<ast::IntegerLiteral>();
+        lit->token_ = ownedToken();
 
-        try {
-            lit->value_ = std::stol(currentToken.Literal);
-        } catch (const std::invalid_argument&) {
-            errors.push_back("could not parse " + currentToken.Literal + " as integer");
+        auto literal = currentLiteral();
+        int64_t value = 0;
+        auto res = std::from_chars(literal.data(), literal.data() + literal.size(), value);
+        if (res.ec == std::errc::result_out_of_range) {
+            errors.push_back("integer " + std::string(literal) + " is out of range");
             return nullptr;
-        } catch (const std::out_of_range&) {
-            errors.push_back("integer " + currentToken.Literal + " is out of range");
+        }
+        if (res.ec != std::errc() || res.ptr != literal.data() + literal.size()) {
+            errors.push_back("could not parse " + std::string(literal) + " as integer");
             return nullptr;
         }
+        lit->value_ = value;
 
         return lit;
     }
 
-    std::unique_ptr<ast::Expression> parseStringLiteral() {
-        auto s = std::make_unique<ast::StringLiteral>();
-        s->token_ = currentToken;
-        s->value_ = currentToken.Literal;
+    ast::Expression *parseStringLiteral() {
+        auto s = arena_->make<ast::StringLiteral>();
+        s->token_ = ownedToken();
+        s->value_ = std::string(currentLiteral());
         return s;
     }
 
-    std::unique_ptr<ast::Expression> parsePrefixExpression() {
-        auto expr = std::make_unique<ast::PrefixExpression>();
-        expr->token_ = currentToken;
-        expr->operator_ = currentToken.Literal;
+    ast::Expression *parsePrefixExpression() {
+        auto expr = arena_->make<ast::PrefixExpression>();
+        expr->token_ = ownedToken();
+        expr->operator_ = std::string(currentLiteral());
+        expr->op_ = ast::OperatorFromToken(expr->token_.Type);
 
         nextToken();
         expr->right_ = parseExpression(PREFIX);
@@ -271,11 +285,12 @@ public:
         return expr;
     }
 
-    std::unique_ptr<ast::Expression> parseInfixExpression(std::unique_ptr<ast::Expression> left) {
-        auto expr = std::make_unique<ast::InfixExpression>();
-        expr->token_ = currentToken;
-        expr->operator_ = currentToken.Literal;
-        expr->left_ = std::move(left);
+    ast::Expression *parseInfixExpression(ast::Expression *left) {
+        auto expr = arena_->make<ast::InfixExpression>();
+        expr->token_ = ownedToken();
+        expr->operator_ = std::string(currentLiteral());
+        expr->op_ = ast::OperatorFromToken(expr->token_.Type);
+        expr->left_ = left;
 
         auto precedence = currentPrecedence();
         nextToken();
@@ -284,49 +299,49 @@ public:
         return expr;
     }
 
-    std::unique_ptr<ast::Expression> parseBoolean() {
-        auto boolean = std::make_unique<ast::Boolean>();
-        boolean->token_ = currentToken;
-        boolean->value_ = currentTokenIs(TRUE);
+    ast::Expression *parseBoolean() {
+        auto boolean = arena_->make<ast::Boolean>();
+        boolean->token_ = ownedToken();
+        boolean->value_ = currentTokenIs(token::TokenType::TRUE);
         return boolean;
     }
 
-    std::unique_ptr<ast::Expression> parseGroupedExpression() {
+    ast::Expression *parseGroupedExpression() {
         nextToken();
         auto expr = parseExpression(LOWEST);
 
-        if (!expectPeek(RPAREN)) {
+        if (!expectPeek(token::TokenType::RPAREN)) {
             return nullptr;
         }
 
         return expr;
     }
 
-    std::unique_ptr<ast::Expression> parseIfExpression() {
-        auto expr = std::make_unique<ast::IfExpression>();
-        expr->token_ = currentToken;
+    ast::Expression *parseIfExpression() {
+        auto expr = arena_->make<ast::IfExpression>();
+        expr->token_ = ownedToken();
 
-        if (!expectPeek(LPAREN)) {
+        if (!expectPeek(token::TokenType::LPAREN)) {
             return nullptr;
         }
 
         nextToken();
         expr->condition_ = parseExpression(LOWEST);
 
-        if (!expectPeek(RPAREN)) {
+        if (!expectPeek(token::TokenType::RPAREN)) {
             return nullptr;
         }
 
-        if (!expectPeek(LBRACE)) {
+        if (!expectPeek(token::TokenType::LBRACE)) {
             return nullptr;
         }
 
         expr->consequence_ = parseBlockStatement();
 
-        if (peekTokenIs(ELSE)) {
+        if (peekTokenIs(token::TokenType::ELSE)) {
             nextToken();
 
-            if (!expectPeek(LBRACE)) {
+            if (!expectPeek(token::TokenType::LBRACE)) {
                 return nullptr;
             }
 
@@ -336,16 +351,16 @@ public:
         return expr;
     }
 
-    std::unique_ptr<ast::BlockStatement> parseBlockStatement() {
-        auto block = std::make_unique<ast::BlockStatement>();
-        block->token_ = currentToken;
+    ast::BlockStatement *parseBlockStatement() {
+        auto block = arena_->make<ast::BlockStatement>();
+        block->token_ = ownedToken();
 
         nextToken();
 
-        while (!currentTokenIs(RBRACE) && !currentTokenIs(MEOF)) {
+        while (!currentTokenIs(token::TokenType::RBRACE) && !currentTokenIs(token::TokenType::MEOF)) {
             auto stmt = parseStatement();
             if (stmt) {
-                block->statements_.push_back(std::move(stmt));
+                block->statements_.push_back(stmt);
             }
             nextToken();
         }
@@ -353,17 +368,18 @@ public:
         return block;
     }
 
-    std::unique_ptr<ast::Expression> parseFunctionLiteral() {
-        auto lit = std::make_unique<ast::FunctionLiteral>();
-        lit->token_ = currentToken;
+    ast::Expression *parseFunctionLiteral() {
+        auto lit = arena_->make<ast::FunctionLiteral>();
+        lit->token_ = ownedToken();
+        lit->arena_ = arena_.get();
 
-        if (!expectPeek(LPAREN)) {
+        if (!expectPeek(token::TokenType::LPAREN)) {
             return nullptr;
         }
 
         lit->parameters_ = parseFunctionParameters();
 
-        if (!expectPeek(LBRACE)) {
+        if (!expectPeek(token::TokenType::LBRACE)) {
             return nullptr;
         }
 
@@ -372,93 +388,93 @@ public:
         return lit;
     }
 
-    std::unique_ptr<ast::Expression> parseArrayLiteral() {
-        std::unique_ptr<ast::ArrayLiteral>  al = std::make_unique<ast::ArrayLiteral>();
-        al->token_ = currentToken;
-        al->elements_ = parseExpressionList(RBRACKET);
+    ast::Expression *parseArrayLiteral() {
+        auto al = arena_->make<ast::ArrayLiteral>();
+        al->token_ = ownedToken();
+        al->elements_ = parseExpressionList(token::TokenType::RBRACKET);
         return al;
     }
 
-    std::unique_ptr<ast::Expression> parseHashLiteral() {
-        std::unique_ptr<ast::HashLiteral> hl = std::make_unique<ast::HashLiteral>();
-        hl->token_ = currentToken;
-        while (!peekTokenIs(RBRACE)) { // 没有取到右括号 )，则已知进行解析
+    ast::Expression *parseHashLiteral() {
+        auto hl = arena_->make<ast::HashLiteral>();
+        hl->token_ = ownedToken();
+        while (!peekTokenIs(token::TokenType::RBRACE)) { // 没有取到右括号 )，则已知进行解析
             nextToken();
-            std::shared_ptr<ast::Expression> key = parseExpression(LOWEST);
+            ast::Expression *key = parseExpression(LOWEST);
             // 跳过 :
-            if (!expectPeek(COLON)) {
+            if (!expectPeek(token::TokenType::COLON)) {
                 return nullptr;
             }
             nextToken();
-            std::shared_ptr<ast::Expression> value = parseExpression(LOWEST);
+            ast::Expression *value = parseExpression(LOWEST);
 
-            hl->pairs_[key] = value;
+            hl->pairs_.emplace_back(key, value);
 
-            if (!peekTokenIs(RBRACE) && !expectPeek(COMMA)) {
+            if (!peekTokenIs(token::TokenType::RBRACE) && !expectPeek(token::TokenType::COMMA)) {
                 return nullptr;
             }
         }
 
-        if (!expectPeek(RBRACE)) {
+        if (!expectPeek(token::TokenType::RBRACE)) {
             return nullptr;
         }
         return hl;
     }
 
-    std::vector<std::shared_ptr<ast::Identifier>> parseFunctionParameters() {
-        std::vector<std::shared_ptr<ast::Identifier>> params;
+    std::vector<ast::Identifier *> parseFunctionParameters() {
+        std::vector<ast::Identifier *> params;
 
-        if (peekTokenIs(RPAREN)) {
+        if (peekTokenIs(token::TokenType::RPAREN)) {
             nextToken();
             return params;
         }
 
         nextToken();
 
-        auto ident = std::make_unique<ast::Identifier>();
-        ident->token_ = currentToken;
-        ident->value_ = currentToken.Literal;
-        params.push_back(std::move(ident));
+        auto ident = arena_->make<ast::Identifier>();
+        ident->token_ = ownedToken();
+        ident->value_ = std::string(currentLiteral());
+        params.push_back(ident);
 
-        while (peekTokenIs(COMMA)) {
+        while (peekTokenIs(token::TokenType::COMMA)) {
             nextToken();
             nextToken();
 
-            auto identi = std::make_unique<ast::Identifier>();
-            identi->token_ = currentToken;
-            identi->value_ = currentToken.Literal;
-            params.push_back(std::move(identi));
+            auto identi = arena_->make<ast::Identifier>();
+            identi->token_ = ownedToken();
+            identi->value_ = std::string(currentLiteral());
+            params.push_back(identi);
         }
 
-        if (!expectPeek(RPAREN)) {
+        if (!expectPeek(token::TokenType::RPAREN)) {
             return {};
         }
 
         return params;
     }
 
-    std::unique_ptr<ast::Expression> parseCallExpression(std::unique_ptr<ast::Expression> function) {
-        auto expr = std::make_unique<ast::CallExpression>();
-        expr->token_ = currentToken;
-        expr->function_ = std::move(function);
+    ast::Expression *parseCallExpression(ast::Expression *function) {
+        auto expr = arena_->make<ast::CallExpression>();
+        expr->token_ = ownedToken();
+        expr->function_ = function;
         expr->arguments_ = parseCallArguments();
         return expr;
     }
 
-    std::unique_ptr<ast::Expression> parseIndexExpression(std::unique_ptr<ast::Expression> left) {
-        auto expr = std::make_unique<ast::IndexExpression>();
-        expr->token_ = currentToken;
-        expr->left_ = std::move(left);
+    ast::Expression *parseIndexExpression(ast::Expression *left) {
+        auto expr = arena_->make<ast::IndexExpression>();
+        expr->token_ = ownedToken();
+        expr->left_ = left;
         nextToken();
         expr->index_ = parseExpression(LOWEST);
-        if (!expectPeek(RBRACKET)) {
+        if (!expectPeek(token::TokenType::RBRACKET)) {
             return nullptr;
         }
 
         return expr;
     }
-    std::vector<std::shared_ptr<ast::Expression>> parseExpressionList(token::TokenType end) {
-        std::vector<std::shared_ptr<ast::Expression>> eles;
+    std::vector<ast::Expression *> parseExpressionList(token::TokenType end) {
+        std::vector<ast::Expression *> eles;
         if (peekTokenIs(end)) {
             nextToken();
             return eles;
@@ -468,7 +484,7 @@ public:
 
         eles.push_back(parseExpression(LOWEST));
 
-        while (peekTokenIs(COMMA)) {
+        while (peekTokenIs(token::TokenType::COMMA)) {
             nextToken();
             nextToken();
             eles.push_back(parseExpression(LOWEST));
@@ -481,10 +497,10 @@ public:
         return eles;
     }
 
-    std::vector<std::shared_ptr<ast::Expression>> parseCallArguments() {
-        std::vector<std::shared_ptr<ast::Expression>> args;
+    std::vector<ast::Expression *> parseCallArguments() {
+        std::vector<ast::Expression *> args;
 
-        if (peekTokenIs(RPAREN)) {
+        if (peekTokenIs(token::TokenType::RPAREN)) {
             nextToken();
             return args;
         }
@@ -492,13 +508,13 @@ public:
         nextToken();
         args.push_back(parseExpression(LOWEST));
 
-        while (peekTokenIs(COMMA)) {
+        while (peekTokenIs(token::TokenType::COMMA)) {
             nextToken();
             nextToken();
             args.push_back(parseExpression(LOWEST));
         }
 
-        if (!expectPeek(RPAREN)) {
+        if (!expectPeek(token::TokenType::RPAREN)) {
             return {};
         }
 
@@ -508,11 +524,11 @@ public:
 
 
     void registerPrefix(token::TokenType type, PrefixParseFn fn) {
-        prefixParseFns[type] = fn;
+        prefixParseFns[static_cast<size_t>(type)] = fn;
     }
 
     void registerInfix(token::TokenType type, InfixParseFn fn) {
-        infixParseFns[type] = fn;
+        infixParseFns[static_cast<size_t>(type)] = fn;
     }
 };
 } // namespace parser
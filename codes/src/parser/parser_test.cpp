@@ -206,13 +206,13 @@ void TestLetStatements()
 
         ASSERT_EQ(program->statements_.size(), (size_t)1);
 
-        auto* stmt = program->statements_[0].get();
+        auto* stmt = program->statements_[0];
         ASSERT_TRUE(testLetStatement(stmt, tt.expectedIdentifier));
 
         auto* letStmt = dynamic_cast<ast::LetStatement*>(stmt);
         // ASSERT_NE(letStmt, nullptr);
 
-        auto* val = letStmt->value_.get();
+        auto* val = letStmt->value_;
         ASSERT_TRUE(testLiteralExpression(val, tt.expectedValue));
     }
 
@@ -238,7 +238,7 @@ void TestReturnStatements()
 
         ASSERT_EQ(program->statements_.size(), (size_t)1);
 
-        auto* stmt = program->statements_[0].get();
+        auto* stmt = program->statements_[0];
         auto* retStmt = dynamic_cast<ast::ReturnStatement*>(stmt);
         // ASSERT_NE(letStmt, nullptr);
         if (retStmt == nullptr) {
@@ -246,11 +246,11 @@ void TestReturnStatements()
             exit(1);
         }
 
-        if (retStmt->token_.Type != RETURN) {
+        if (retStmt->token_.Type != token::TokenType::RETURN) {
             std::cout << "type error." << std::endl;
         }
 
-        auto expr = retStmt->returnValue_.get();
+        auto expr = retStmt->returnValue_;
         testLiteralExpression(expr, tt.expectedValue);
     }
 }
@@ -267,11 +267,11 @@ void TestIdentifierExpression() {
         std::cerr << "ERROR:identifier expression should have 1 statement" << std::endl;
     }
 
-    auto x = program->statements_[0].get();
+    auto x = program->statements_[0];
     (void)x;
-    auto *expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto *expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
 
-    auto* ident = dynamic_cast<ast::Identifier*> (expr->expression_.get());
+    auto* ident = dynamic_cast<ast::Identifier*> (expr->expression_);
     // auto* ident = dynamic_cast<ast::Identifier*>(stmt);
     if (ident == nullptr) {
         std::cerr << "ERROR:identifier expression should not be ExpressionStatement" << std::endl;
@@ -299,14 +299,14 @@ void TestIntegerLiteralExpression( ) {
 
     ASSERT_EQ(program->statements_.size(), (size_t)1);
 
-    auto* stmt = program->statements_[0].get();
+    auto* stmt = program->statements_[0];
     auto* expr = dynamic_cast<ast::ExpressionStatement*>(stmt);
     if (expr == nullptr) {
         std::cerr << "ERROR:expression should not be ExpressionStatement" << std::endl;
         exit(1);
     }
 
-    auto* inter = dynamic_cast<ast::IntegerLiteral*>(expr->expression_.get());
+    auto* inter = dynamic_cast<ast::IntegerLiteral*>(expr->expression_);
     if (inter == nullptr) {
         std::cerr << "ERROR:expression should not be IntegerLiteralExpression" << std::endl;
         exit(1);
@@ -345,21 +345,21 @@ void TestParsingPrefixExpressions()
             exit(1);
         }
 
-        auto* expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+        auto* expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
 
-        auto* prefixStmt = dynamic_cast<ast::PrefixExpression*>(expr->expression_.get());
+        auto* prefixStmt = dynamic_cast<ast::PrefixExpression*>(expr->expression_);
 
         if (!prefixStmt) {
             std::cerr <<"ERROR " << tt.input<< std::endl;
             exit(1);
         }
 
-        if (prefixStmt->operator_ != tt.operator_) {
+        if (prefixStmt->operator_ != tt.operator_ || ast::OperatorName(prefixStmt->op_) != tt.operator_) {
             std::cerr << "ERROR " << tt.input << std::endl ;
             exit(2);
         }
 
-        testLiteralExpression(prefixStmt->right_.get(), tt.value);
+        testLiteralExpression(prefixStmt->right_, tt.value);
     }
 }
 
@@ -371,15 +371,15 @@ bool testInfixExpression(ast::Expression* exp, const Value & left,
         return false;
     }
 
-    if (!testLiteralExpression(opExp->left_.get(), left)) {
+    if (!testLiteralExpression(opExp->left_, left)) {
         return false;
     }
 
-    if (opExp->operator_ != operator_) {
+    if (opExp->operator_ != operator_ || ast::OperatorName(opExp->op_) != operator_) {
         return false;
     }
 
-    if (!testLiteralExpression(opExp->right_.get(), right)) {
+    if (!testLiteralExpression(opExp->right_, right)) {
         return false;
     }
 
@@ -430,12 +430,12 @@ void TestParsingInfixExpressions()
             exit(1);
         }
 
-        auto *expr =dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+        auto *expr =dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
         if (!expr) {
             S << "ERROR" << E;
             exit(1);
         }
-        auto* infixStmt = dynamic_cast<ast::InfixExpression*>(expr->expression_.get());
+        auto* infixStmt = dynamic_cast<ast::InfixExpression*>(expr->expression_);
         if (!infixStmt) {
             S << "ERROR" << E;
             exit(1);
@@ -598,13 +598,13 @@ void TestBooleanExpression() {
             exit(1);
         }
 
-        auto *expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+        auto *expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
         if (!expr) {
             S << "ERROR" << E;
             exit(1);
         }
 
-        auto * boolean = dynamic_cast<ast::Boolean*> (expr->expression_.get());
+        auto * boolean = dynamic_cast<ast::Boolean*> (expr->expression_);
         if (!boolean) {
             S << "ERROR" << E;
         }
@@ -621,16 +621,16 @@ bool testInfixExpression(ast::Expression* exp, const Value& left,std::string& op
     if (!opExpr) {
         return false;
     }
-    if (!testLiteralExpression(opExpr->left_.get(), left)) {
+    if (!testLiteralExpression(opExpr->left_, left)) {
         ERRINFO
         return false;
     }
 
-    if (opExpr->operator_ != oper) {
+    if (opExpr->operator_ != oper || ast::OperatorName(opExpr->op_) != oper) {
         ERRINFO
         return false;
     }
-    if (!testLiteralExpression(opExpr->right_.get(), right)) {
+    if (!testLiteralExpression(opExpr->right_, right)) {
         ERRINFO
         return false;
     }
@@ -650,19 +650,19 @@ void TestIfExpression() {
         exit(1);
     }
 
-    auto *expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto *expr = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!expr) {
         ERRINFO;
         exit(1);
     }
 
-    auto * ifexpr = dynamic_cast<ast::IfExpression*> (expr->expression_.get());
+    auto * ifexpr = dynamic_cast<ast::IfExpression*> (expr->expression_);
     if (!ifexpr) {
         ERRINFO;
         exit(1);
     }
 
-    if (!testInfixExpression(ifexpr->condition_.get(), "x", "<", "y")) {
+    if (!testInfixExpression(ifexpr->condition_, "x", "<", "y")) {
         ERRINFO
         exit(1);
     }
@@ -672,17 +672,17 @@ void TestIfExpression() {
         exit(1);
     }
 
-    auto* consequence = dynamic_cast<ast::ExpressionStatement*>(ifexpr->consequence_->statements_[0].get());
+    auto* consequence = dynamic_cast<ast::ExpressionStatement*>(ifexpr->consequence_->statements_[0]);
     if (!consequence) {
         ERRINFO
         exit(1);
     }
-    if (!testIdentifier(consequence->expression_.get(), "x")) {
+    if (!testIdentifier(consequence->expression_, "x")) {
         ERRINFO
         exit(1);
     }
 
-    if (ifexpr->alternative_.get() != nullptr) {
+    if (ifexpr->alternative_ != nullptr) {
         ERRINFO
         exit(1);
     }
@@ -701,19 +701,19 @@ void TestIfElseExpression() {
         exit(1);
     }
 
-    auto *stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto *stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         ERRINFO
         exit(1);
     }
 
-    auto* exp = dynamic_cast<ast::IfExpression*>(stmt->expression_.get());
+    auto* exp = dynamic_cast<ast::IfExpression*>(stmt->expression_);
     if (!exp) {
         ERRINFO
         exit(1);
     }
 
-    if (!testInfixExpression(exp->condition_.get(), "x", "<", "y")) {
+    if (!testInfixExpression(exp->condition_, "x", "<", "y")) {
         ERRINFO
         exit(1);
     }
@@ -723,13 +723,13 @@ void TestIfElseExpression() {
         exit(1);
     }
 
-    auto *consequence =  dynamic_cast<ast::ExpressionStatement*>(exp->consequence_->statements_[0].get());
+    auto *consequence =  dynamic_cast<ast::ExpressionStatement*>(exp->consequence_->statements_[0]);
     if (!consequence) {
         ERRINFO
         exit(1);
     }
 
-    if (!testIdentifier(consequence->expression_.get(), "x")) {
+    if (!testIdentifier(consequence->expression_, "x")) {
         ERRINFO
         exit(1);
     }
@@ -739,13 +739,13 @@ void TestIfElseExpression() {
         exit(1);
     }
 
-    auto *alternative =  dynamic_cast<ast::ExpressionStatement*>(exp->alternative_->statements_[0].get());
+    auto *alternative =  dynamic_cast<ast::ExpressionStatement*>(exp->alternative_->statements_[0]);
     if (!alternative) {
         ERRINFO
         exit(1);
     }
 
-    if (!testIdentifier(alternative->expression_.get(), "y")) {
+    if (!testIdentifier(alternative->expression_, "y")) {
         ERRINFO
         exit(1);
     }
@@ -763,13 +763,13 @@ void TestFunctionLiteralParsing(TestingT &t) {
         exit(1);
     }
 
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*> (program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*> (program->statements_[0]);
     if (!stmt) {
         ERRINFO
         exit(1);
     }
 
-    auto *func = dynamic_cast<ast::FunctionLiteral*>(stmt->expression_.get());
+    auto *func = dynamic_cast<ast::FunctionLiteral*>(stmt->expression_);
     if (!func) {
         ERRINFO
         exit(1);
@@ -780,13 +780,13 @@ void TestFunctionLiteralParsing(TestingT &t) {
         exit(1);
     }
 
-    if (!testLiteralExpression(func->parameters_[0].get(), "x")) {
-        t.Fatalf("func->parameters_[0].get() should be x");
+    if (!testLiteralExpression(func->parameters_[0], "x")) {
+        t.Fatalf("func->parameters_[0] should be x");
         exit(1);
     }
 
-    if (!testLiteralExpression(func->parameters_[1].get(), "y")) {
-        t.Fatalf("func->parameters_[1].get() should be y");
+    if (!testLiteralExpression(func->parameters_[1], "y")) {
+        t.Fatalf("func->parameters_[1] should be y");
         exit(1);
     }
 
@@ -794,13 +794,13 @@ void TestFunctionLiteralParsing(TestingT &t) {
         t.Fatalf("function.Body.Statements has not 1 statements. got=%d\n", func->body_->statements_.size());
     }
 
-    auto* bodyStatement = dynamic_cast<ast::ExpressionStatement*>(func->body_->statements_[0].get());
+    auto* bodyStatement = dynamic_cast<ast::ExpressionStatement*>(func->body_->statements_[0]);
     if (!bodyStatement) {
         t.Fatalf("body.Statements should not be NULL");
     }
 
-    if (!testInfixExpression(bodyStatement->expression_.get(), "x", "+", "y")) {
-        t.Fatalf("%s", R"(bodyStatement->expression_.get(), x, +, y)");
+    if (!testInfixExpression(bodyStatement->expression_, "x", "+", "y")) {
+        t.Fatalf("%s", R"(bodyStatement->expression_, x, +, y)");
     }
 }
 
@@ -822,11 +822,11 @@ void TestFunctionParameterParsing(TestingT &t) {
         auto program = p.parseProgram();
         checkParserErrors(p);
 
-        auto* stmt =dynamic_cast<ast::ExpressionStatement*>( program->statements_[0].get());
+        auto* stmt =dynamic_cast<ast::ExpressionStatement*>( program->statements_[0]);
         if (!stmt) {
             t.Fatalf("stmt.Statements should not be NULL");
         }
-        auto* func = dynamic_cast<ast::FunctionLiteral*>(stmt->expression_.get());
+        auto* func = dynamic_cast<ast::FunctionLiteral*>(stmt->expression_);
         if (!func) {
             t.Fatalf("func.Statements should not be NULL");
         }
@@ -836,7 +836,7 @@ void TestFunctionParameterParsing(TestingT &t) {
         }
 
         for (decltype(tt.expectedParams.size())  i = 0; i < tt.expectedParams.size(); ++i) {
-            testLiteralExpression(func->parameters_[i].get(), tt.expectedParams[i]);
+            testLiteralExpression(func->parameters_[i], tt.expectedParams[i]);
         }
     }
 }
@@ -852,17 +852,17 @@ void TestCallExpressionParsing(TestingT &t) {
         t.Fatalf("program.Statements does not contain %d statements. got=%d\n", 1, program->statements_.size());
     }
 
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         t.Fatalf("stmt should not be NULL");
     }
 
-    auto* exp = dynamic_cast<ast::CallExpression*>(stmt->expression_.get());
+    auto* exp = dynamic_cast<ast::CallExpression*>(stmt->expression_);
     if (!exp) {
         t.Fatalf("exp should not be NULL");
     }
 
-    if (!testIdentifier(exp->function_.get(), "add")) {
+    if (!testIdentifier(exp->function_, "add")) {
         t.Fatalf("");
     }
 
@@ -874,14 +874,14 @@ void TestCallExpressionParsing(TestingT &t) {
         t.Fatalf("wrong length of arguments. got=%d", exp->arguments_.size());
     }
 
-    if (!testLiteralExpression(exp->arguments_[0].get(), 1)) {
+    if (!testLiteralExpression(exp->arguments_[0], 1)) {
         t.Fatalf("");
     }
-    if (!testInfixExpression(exp->arguments_[1].get(), 2, "*", 3)) {
+    if (!testInfixExpression(exp->arguments_[1], 2, "*", 3)) {
         t.Fatalf("");
     }
 
-    if (!testInfixExpression(exp->arguments_[2].get(), 4, "+", 5)) {
+    if (!testInfixExpression(exp->arguments_[2], 4, "+", 5)) {
         t.Fatalf("");
     }
 }
@@ -905,18 +905,18 @@ void TestCallExpressionParameterParsing(TestingT &t) {
         auto program = p.parseProgram();
         checkParserErrors(p);
 
-        auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+        auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
         if (!stmt) {
             t.Fatalf("stmt.Statements should not be NULL");
         }
 
-        auto* exp = dynamic_cast<ast::CallExpression*>(stmt->expression_.get());
+        auto* exp = dynamic_cast<ast::CallExpression*>(stmt->expression_);
         if (!exp) {
             t.Fatalf("exp should not be NULL");
         }
 
-        if (!testIdentifier(exp->function_.get(), tt.expectedIdent)) {
-            t.Fatalf("exp->function_.get() should be %s", tt.expectedIdent.c_str());
+        if (!testIdentifier(exp->function_, tt.expectedIdent)) {
+            t.Fatalf("exp->function_ should be %s", tt.expectedIdent.c_str());
         }
         if (exp->arguments_.size() != tt.expectedArgs.size()) {
             t.Fatalf("");
@@ -938,12 +938,12 @@ void TestStringLiteralExpression(TestingT &t) {
     auto program = p.parseProgram();
     checkParserErrors(p);
 
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         t.Fatalf("stmt.Statements should not be NULL");
     }
 
-    auto *literal = dynamic_cast<ast::StringLiteral*> (stmt->expression_.get());
+    auto *literal = dynamic_cast<ast::StringLiteral*> (stmt->expression_);
     if (!literal) {
         t.Fatalf("TODO");
     }
@@ -964,12 +964,12 @@ void TestParsingEmptyArrayLiterals(TestingT & t)
 
     checkParserErrors(p);
 
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         t.Fatalf("stmt.Statements should not be NULL");
     }
 
-    auto *array = dynamic_cast<ast::ArrayLiteral*>(stmt->expression_.get());
+    auto *array = dynamic_cast<ast::ArrayLiteral*>(stmt->expression_);
     if (!array) {
         t.Fatalf("array should not be null");
     }
@@ -988,12 +988,12 @@ void TestParsingArrayLiterals(TestingT &t)
     auto program = p.parseProgram();
 
     checkParserErrors(p);
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         t.Fatalf("stmt.Statements should not be NULL");
     }
 
-    auto *array = dynamic_cast<ast::ArrayLiteral*>(stmt->expression_.get());
+    auto *array = dynamic_cast<ast::ArrayLiteral*>(stmt->expression_);
     if (!array) {
         t.Fatalf("array should not be null");
     }
@@ -1002,9 +1002,9 @@ void TestParsingArrayLiterals(TestingT &t)
         t.Fatalf("array size should be 3");
     }
 
-    testIntergerLiteral(array->elements_[0].get(), 1);
-    testInfixExpression(array->elements_[1].get(), 2, "*", 2);
-    testInfixExpression(array->elements_[2].get(), 3, "+", 3);
+    testIntergerLiteral(array->elements_[0], 1);
+    testInfixExpression(array->elements_[1], 2, "*", 2);
+    testInfixExpression(array->elements_[2], 3, "+", 3);
 }
 
 // --- 增加数组索引测试
@@ -1016,21 +1016,21 @@ void TestParsingIndexExpressions(TestingT &t)
     auto program = p.parseProgram();
 
     checkParserErrors(p);
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         t.Fatalf("stmt.Statements should not be NULL");
     }
 
-    auto *index = dynamic_cast<ast::IndexExpression*>(stmt->expression_.get());
+    auto *index = dynamic_cast<ast::IndexExpression*>(stmt->expression_);
     if (!index) {
         t.Fatalf("array should not be null");
     }
 
-    if (!testIdentifier(index->left_.get(), "myArray")) {
+    if (!testIdentifier(index->left_, "myArray")) {
         t.Fatalf("index error.");
     }
 
-    if (!testInfixExpression(index->index_.get(), 1, "+", 1)) {
+    if (!testInfixExpression(index->index_, 1, "+", 1)) {
         t.Fatalf("index error.");
     }
 }
@@ -1044,12 +1044,12 @@ void TestParsingEmptyHashLiteral(TestingT &t)
     auto program = p.parseProgram();
 
     checkParserErrors(p);
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         t.Fatalf("stmt.Statements should not be NULL");
     }
 
-    auto* hash = dynamic_cast<ast::HashLiteral*>(stmt->expression_.get());
+    auto* hash = dynamic_cast<ast::HashLiteral*>(stmt->expression_);
     if (!hash) {
         t.Fatalf("hash should not be null");
     }
@@ -1066,12 +1066,12 @@ void TestParsingHashLiteralsStringKeys(TestingT &t) {
     auto program = p.parseProgram();
 
     checkParserErrors(p);
-    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0].get());
+    auto* stmt = dynamic_cast<ast::ExpressionStatement*>(program->statements_[0]);
     if (!stmt) {
         t.Fatalf("stmt.Statements should not be NULL");
     }
 
-    auto* mm = dynamic_cast<ast::HashLiteral*>(stmt->expression_.get());
+    auto* mm = dynamic_cast<ast::HashLiteral*>(stmt->expression_);
     if (!mm) {
         t.Fatalf("mm should not be null");
     }
@@ -1086,8 +1086,8 @@ void TestParsingHashLiteralsStringKeys(TestingT &t) {
     }
 
     for (const auto &pair : mm->pairs_) {
-        auto* key = dynamic_cast<ast::StringLiteral*>(pair.first.get());
-        auto* value = dynamic_cast<ast::IntegerLiteral*>(pair.second.get());
+        auto* key = dynamic_cast<ast::StringLiteral*>(pair.first);
+        auto* value = dynamic_cast<ast::IntegerLiteral*>(pair.second);
 //        if (expected[key->value_] != value->value_) {
 //
 //        }
@@ -7,7 +7,12 @@
 #include "object.h"
 #include "parser.h"
 #include "evaluator.h"
+#include "closure_compiler.h"
+#include "flat_evaluator.h"
+#include "stack_evaluator.h"
 #include "environment.hpp"
+#include "compiler.h"
+#include "vm.h"
 
 #include <iostream>
 #include <string>
@@ -15,10 +20,51 @@
 #include <memory>
 
 namespace repl {
-Repl::Repl()
+Repl::Repl() : Repl(Engine::EVAL)
 {
 
 }
+
+Repl::Repl(Engine engine) : engine_(engine)
+{
+    env_ = std::make_shared<dragon::Environment>();
+    symbolTable_ = dragon::compiler::Compiler::newSymbolTable();
+}
+
+bool ParseEngine(const std::string& name, Engine& engine)
+{
+    if (name == "eval") {
+        engine = Engine::EVAL;
+    } else if (name == "vm") {
+        engine = Engine::VM;
+    } else if (name == "flat") {
+        engine = Engine::FLAT;
+    } else if (name == "closure") {
+        engine = Engine::CLOSURE;
+    } else if (name == "stack") {
+        engine = Engine::STACK;
+    } else {
+        return false;
+    }
+    return true;
+}
+const char* EngineName(Engine engine)
+{
+    switch (engine) {
+    case Engine::VM:
+        return "vm";
+    case Engine::FLAT:
+        return "flat";
+    case Engine::CLOSURE:
+        return "closure";
+    case Engine::STACK:
+        return "stack";
+    case Engine::EVAL:
+        break;
+    }
+    return "eval";
+}
+
 const std::string PROMPT = ">> ";
 const std::string DRAGON_FACE = R"(
                        ZZ    ZZZ     Z Z     ZZ   ZZ
@@ -77,9 +123,43 @@ void printParserErrors(std::ostream& out, const std::vector<std::string>& errors
         }
 }
 
+std::shared_ptr<dragon::object::Object> Repl::Execute(const std::string& source, std::ostream& out) {
+    lexer::Lexer l(source, lexer::InputMode::BORROW);
+    parser::Parser p(l);
+
+    auto program = p.parseProgram();
+    if (p.errors.size()) {
+        printParserErrors(out, p.errors);
+        return nullptr;
+    }
+
+    if (engine_ == Engine::VM) {
+        dragon::compiler::Compiler c(symbolTable_, constants_);
+        auto err = c.compile(program);
+        // 编译失败时丢弃本次新增的常量
+        if (err) {
+            return err;
+        }
+        constants_ = c.constants_;
+
+        dragon::vm::VM machine(c.bytecode(), globals_);
+        return machine.run();
+    }
+
+    if (engine_ == Engine::FLAT) {
+        return dragon::evaluator::FlatEvaluator::eval(program, env_);
+    }
+    if (engine_ == Engine::CLOSURE) {
+        return dragon::evaluator::ClosureCompiler::eval(program, env_);
+    }
+    if (engine_ == Engine::STACK) {
+        return dragon::evaluator::StackEvaluator::eval(program, env_);
+    }
+    return dragon::evaluator::Evaluator::eval(program, env_);
+}
+
 void Repl::Start(std::istream& in, std::ostream& out) {
     std::string line;
-    auto env = std::make_shared<dragon::Environment>();
 
     while (true) {
         out << PROMPT;
@@ -87,16 +167,7 @@ void Repl::Start(std::istream& in, std::ostream& out) {
             return;
         }
 
-        lexer::Lexer l(line);
-        parser::Parser p(l);
-
-        auto program = p.parseProgram();
-        if (p.errors.size()) {
-            printParserErrors(out, p.errors);
-            continue;
-        }
-
-        auto evaluated = dragon::evaluator::Evaluator::eval(program, env);
+        auto evaluated = Execute(line, out);
         if (evaluated != nullptr) {
             out << evaluated->Inspect() << "\n";
         }
@@ -7,11 +7,47 @@
 #define MYPROJECT_REPL_H
 #include <istream>
 #include <ostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "environment.hpp"
+#include "symbol_table.h"
+#include "vm.h"
+
 namespace repl {
+// 执行引擎
+enum class Engine {
+    EVAL,   // 树遍历求值 (evaluator::Evaluator)
+    VM,     // 字节码编译 + 虚拟机 (compiler::Compiler + vm::VM)
+    FLAT,   // 转换为扁平布局后树遍历求值 (ast::FlatAst + evaluator::FlatEvaluator)
+    CLOSURE,    // 编译为预先绑定的 C++ 可调用对象树后执行 (evaluator::ClosureCompiler)
+    STACK,  // 用堆上的显式栈代替 C++ 递归的树遍历求值 (evaluator::StackEvaluator)
+};
+
+// 根据名字解析执行引擎, 未知名字返回 false
+bool ParseEngine(const std::string& name, Engine& engine);
+const char* EngineName(Engine engine);
+
 class Repl {
 public:
     Repl();
+    explicit Repl(Engine engine);
     void Start(std::istream& in, std::ostream& out);
+
+    // 执行一段源码, 解析出错时输出错误并返回 nullptr
+    std::shared_ptr<dragon::object::Object> Execute(const std::string& source, std::ostream& out);
+
+private:
+    Engine engine_;
+
+    // EVAL, FLAT, CLOSURE 与 STACK 引擎的状态
+    std::shared_ptr<dragon::Environment> env_;
+
+    // VM 引擎在多次执行之间共享的状态
+    std::shared_ptr<dragon::compiler::SymbolTable> symbolTable_;
+    std::vector<std::shared_ptr<dragon::object::Object>> constants_;
+    dragon::vm::Globals globals_;
 };
 
 } // namespace repl
@@ -1,26 +1,33 @@
 #include "token.h"
 
+#include <cstring>
 
-#include <map>
-using std::map;
 namespace token {
-map<string, TokenType> keywords = {
-	{"fn", FUNCTION},
-	{"let", LET},
-	{"true", TRUE},
-	{"false", FALSE},
-	{"if", IF},
-	{"else", ELSE},
-	{"return", RETURN},
+struct Keyword {
+	const char *name;
+	size_t length;
+	TokenType type;
 };
 
-TokenType LookupIdent(string ident)
+static const Keyword keywords[] = {
+	{"fn", 2, TokenType::FUNCTION},
+	{"let", 3, TokenType::LET},
+	{"true", 4, TokenType::TRUE},
+	{"false", 5, TokenType::FALSE},
+	{"if", 2, TokenType::IF},
+	{"else", 4, TokenType::ELSE},
+	{"return", 6, TokenType::RETURN},
+};
+
+// 关键字很少, 先比较长度再比较内容, 比查 map 省去构造与哈希
+TokenType LookupIdent(std::string_view ident)
 {
-	if (keywords.find(ident) != keywords.end())
-	{
-		return keywords[ident];
+	for (const auto &k : keywords) {
+		if (k.length == ident.size() && memcmp(k.name, ident.data(), k.length) == 0) {
+			return k.type;
+		}
 	}
-	
-	return IDENT;
+
+	return TokenType::IDENT;
+}
 }
-}
\ No newline at end of file
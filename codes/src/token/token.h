@@ -1,60 +1,134 @@
 #ifndef __TOKEN__
 #define __TOKEN__
 
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <string_view>
 using std::string;
 
 namespace token {
-typedef string TokenType;
-//namespace token{
-#define ILLEGAL  "ILLEGAL"
-#define MEOF     "EOF"
-
-// Identifiers + literals
-#define IDENT  "IDENT"// num, foobar, x, y, ...
-#define INT    "INT"  // 123
-#define STRING "STRING"
-
-// Operators
-#define ASSIGN    "="
-#define PLUS      "+"
-#define MINUS     "-"
-#define BANG      "!"
-#define ASTERISK  "*"
-#define SLASH     "/"
-
-#define LT   "<"
-#define GT   ">"
-
-#define EQ       "=="
-#define NOT_EQ   "!="
-
-// Delimiters
-#define COMMA       ","
-#define SEMICOLON   ";"
-#define COLON       ":"  // For HASH
-
-#define LPAREN   "("
-#define RPAREN   ")"
-#define LBRACE   "{"
-#define RBRACE   "}"
-#define LBRACKET "["    // For Array
-#define RBRACKET "]"    // For Array
-
-// Keywords
-#define FUNCTION   "FUNCTION"
-#define LET        "LET"
-#define TRUE       "TRUE"
-#define FALSE      "FALSE"
-#define IF         "IF"
-#define ELSE       "ELSE"
-#define RETURN     "RETURN"
+// 新增类型时需要同步修改 kTokenTypeNames
+enum class TokenType : uint8_t {
+	ILLEGAL,
+	MEOF,
+
+	// Identifiers + literals
+	IDENT,      // num, foobar, x, y, ...
+	INT,        // 123
+	STRING,
+
+	// Operators
+	ASSIGN,
+	PLUS,
+	MINUS,
+	BANG,
+	ASTERISK,
+	SLASH,
+
+	LT,
+	GT,
+
+	EQ,
+	NOT_EQ,
+
+	// Delimiters
+	COMMA,
+	SEMICOLON,
+	COLON,      // For HASH
+
+	LPAREN,
+	RPAREN,
+	LBRACE,
+	RBRACE,
+	LBRACKET,   // For Array
+	RBRACKET,   // For Array
+
+	// Keywords
+	FUNCTION,
+	LET,
+	TRUE,
+	FALSE,
+	IF,
+	ELSE,
+	RETURN,
+
+	COUNT,      // 类型总数, 不是真正的 token
+};
+
+const size_t kTokenTypeCount = static_cast<size_t>(TokenType::COUNT);
+
+// 类型名, 用于错误信息与调试输出
+constexpr const char *kTokenTypeNames[kTokenTypeCount] = {
+	"ILLEGAL",
+	"EOF",
+
+	"IDENT",
+	"INT",
+	"STRING",
+
+	"=",
+	"+",
+	"-",
+	"!",
+	"*",
+	"/",
+
+	"<",
+	">",
+
+	"==",
+	"!=",
+
+	",",
+	";",
+	":",
+
+	"(",
+	")",
+	"{",
+	"}",
+	"[",
+	"]",
+
+	"FUNCTION",
+	"LET",
+	"TRUE",
+	"FALSE",
+	"IF",
+	"ELSE",
+	"RETURN",
+};
+
+constexpr const char *TokenTypeName(TokenType tt)
+{
+	return kTokenTypeNames[static_cast<size_t>(tt)];
+}
+
+inline std::ostream &operator<<(std::ostream &out, TokenType tt)
+{
+	return out << TokenTypeName(tt);
+}
+
+// token 在源码中的位置, line/column 从 1 开始
+struct Span {
+	uint32_t offset = 0;
+	uint32_t length = 0;
+	uint32_t line = 0;
+	uint32_t column = 0;
+};
+
+// 零拷贝 token: 只记录类型和位置, 文本通过 Lexer::Literal 以 string_view 取得,
+// 有效期与 Lexer 的输入缓冲区相同
+struct TokenView {
+	TokenType Type = TokenType::ILLEGAL;
+	Span Pos;
+};
 
 typedef struct Token {
 	Token()
 	{
-		Type = ILLEGAL;
-		Literal = ILLEGAL;
+		Type = TokenType::ILLEGAL;
 	}
 
 	Token(TokenType tt, string s)
@@ -62,12 +136,12 @@ typedef struct Token {
 		Type = tt;
 		Literal = s;
 	}
-	
+
 	TokenType Type;
 	string Literal;
 }Token;
 
 
-TokenType LookupIdent(string ident);
+TokenType LookupIdent(std::string_view ident);
 } // namespace token
-#endif
\ No newline at end of file
+#endif
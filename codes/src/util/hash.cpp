@@ -3,6 +3,12 @@
 //
 
 #include "hash.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
 namespace util
 {
     uint32_t times33_hash(const char *str)
@@ -16,4 +22,116 @@ namespace util
 
         return hash;
     }
-}
\ No newline at end of file
+
+    namespace {
+        const uint64_t kSecret[4] = {
+                0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL,
+        };
+
+        // 64x64 -> 128 位乘法, 高低两半分别写回 a, b
+        inline void mum(uint64_t &a, uint64_t &b)
+        {
+#if defined(__SIZEOF_INT128__)
+            __extension__ typedef unsigned __int128 uint128;
+            uint128 r = static_cast<uint128>(a) * b;
+            a = static_cast<uint64_t>(r);
+            b = static_cast<uint64_t>(r >> 64);
+#else
+            uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+            uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+            uint64_t t = rl + (rm0 << 32);
+            uint64_t c = t < rl;
+            uint64_t lo = t + (rm1 << 32);
+            c += lo < t;
+            a = lo;
+            b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+        }
+
+        inline uint64_t mix(uint64_t a, uint64_t b)
+        {
+            mum(a, b);
+            return a ^ b;
+        }
+
+        // 按小端读取, memcpy 允许未对齐访问且会被编译为单条 load
+        inline uint64_t read64(const uint8_t *p)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline uint64_t read32(const uint8_t *p)
+        {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        uint64_t makeSeed()
+        {
+            if (const char *env = std::getenv("DRAGON_HASH_SEED")) {
+                return std::strtoull(env, nullptr, 0);
+            }
+            std::random_device rd;
+            uint64_t seed = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+            seed ^= static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+            return mix(seed ^ kSecret[0], kSecret[1]);
+        }
+    }
+
+    uint64_t hash_seed()
+    {
+        static const uint64_t seed = makeSeed();
+        return seed;
+    }
+
+    uint64_t string_hash(const char *data, size_t len, uint64_t seed)
+    {
+        auto p = reinterpret_cast<const uint8_t *>(data);
+        seed ^= kSecret[0];
+
+        uint64_t a, b;
+        if (len <= 16) {
+            if (len >= 4) {
+                // 4~16 字节: 首尾各取两个可能重叠的 4 字节
+                size_t mid = (len >> 3) << 2;
+                a = (read32(p) << 32) | read32(p + mid);
+                b = (read32(p + len - 4) << 32) | read32(p + len - 4 - mid);
+            } else if (len > 0) {
+                a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t i = len;
+            if (i > 48) {
+                // 三路并行处理 48 字节块, 减少乘法间的依赖
+                uint64_t seed1 = seed, seed2 = seed;
+                do {
+                    seed = mix(read64(p) ^ kSecret[1], read64(p + 8) ^ seed);
+                    seed1 = mix(read64(p + 16) ^ kSecret[2], read64(p + 24) ^ seed1);
+                    seed2 = mix(read64(p + 32) ^ kSecret[3], read64(p + 40) ^ seed2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (i > 16) {
+                seed = mix(read64(p) ^ kSecret[1], read64(p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+            // 最后 16 字节 (可能与已处理部分重叠)
+            a = read64(p + i - 16);
+            b = read64(p + i - 8);
+        }
+
+        a ^= kSecret[1];
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+    }
+}
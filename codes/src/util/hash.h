@@ -4,9 +4,22 @@
 
 #ifndef DRAGON_HASH_H
 #define DRAGON_HASH_H
+#include <cstddef>
 #include <cstdint>
+#include <string_view>
 namespace util {
+    // 逐字节的 DJB 哈希, 遇到 '\0' 结束; 仅保留作基准对比
     uint32_t times33_hash(const char *str);
+
+    // 按 8 字节读取的带种子哈希, 用 64x64->128 位乘法混合 (结构参考 wyhash)
+    uint64_t string_hash(const char *data, size_t len, uint64_t seed);
+
+    // 进程级随机种子, 启动时生成一次; 设置环境变量 DRAGON_HASH_SEED 可固定种子便于复现
+    uint64_t hash_seed();
+
+    inline uint64_t string_hash(std::string_view s) {
+        return string_hash(s.data(), s.size(), hash_seed());
+    }
 }
 
 
@@ -0,0 +1,65 @@
+#include "hash_test.h"
+#include "hash.h"
+#include "test_tool.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+// times33 下互相碰撞的字符串: "Ez" 与 "FY" 的哈希相同, 任意拼接后仍然相同
+static std::vector<std::string> times33Collisions(int blocks)
+{
+    std::vector<std::string> keys = {""};
+    for (int i = 0; i < blocks; ++i) {
+        std::vector<std::string> next;
+        for (const auto &k : keys) {
+            next.push_back(k + "Ez");
+            next.push_back(k + "FY");
+        }
+        keys.swap(next);
+    }
+    return keys;
+}
+
+void TestStringHash()
+{
+    // 同一字符串哈希相同, 覆盖各个长度分支
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text.push_back(static_cast<char>('a' + i % 26));
+        std::string copy = text;
+        ASSERT_TRUE(util::string_hash(text) == util::string_hash(copy));
+        ASSERT_TRUE(util::string_hash(text.data(), text.size(), 1) == util::string_hash(copy.data(), copy.size(), 1));
+    }
+
+    // 所有长度的前缀互不相同
+    std::set<uint64_t> prefixes;
+    for (size_t n = 0; n <= text.size(); ++n) {
+        prefixes.insert(util::string_hash(text.data(), n, 0));
+    }
+    ASSERT_EQ(prefixes.size(), text.size() + 1);
+
+    // 内嵌的 '\0' 参与计算
+    std::string a("ab\0c", 4), b("ab\0d", 4);
+    ASSERT_TRUE(util::string_hash(a) != util::string_hash(b));
+    ASSERT_TRUE(util::string_hash(a) != util::string_hash(std::string_view("ab")));
+
+    // 单比特差异
+    std::string x(64, 'x'), y = x;
+    y[40] ^= 1;
+    ASSERT_TRUE(util::string_hash(x) != util::string_hash(y));
+
+    // 种子不同结果不同
+    ASSERT_TRUE(util::string_hash(text.data(), text.size(), 1) != util::string_hash(text.data(), text.size(), 2));
+
+    // times33 构造出的碰撞集合在新哈希下不再碰撞
+    auto keys = times33Collisions(10);
+    std::set<uint32_t> old;
+    std::set<uint64_t> now;
+    for (const auto &k : keys) {
+        old.insert(util::times33_hash(k.c_str()));
+        now.insert(util::string_hash(k));
+    }
+    ASSERT_EQ(old.size(), static_cast<size_t>(1));
+    ASSERT_EQ(now.size(), keys.size());
+}
@@ -0,0 +1,6 @@
+#ifndef DRAGON_HASH_TEST_H
+#define DRAGON_HASH_TEST_H
+
+void TestStringHash();
+
+#endif //DRAGON_HASH_TEST_H
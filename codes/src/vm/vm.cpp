@@ -0,0 +1,527 @@
+//
+// 基于栈的虚拟机, 执行 compiler::Compiler 生成的字节码
+//
+
+#include "vm.h"
+#include "builtin.h"
+#include "evaluator.h"
+#include "gc.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+// GCC/Clang 下使用 computed goto 分发指令, 其他编译器退化为 switch
+#if defined(__GNUC__)
+#define DRAGON_COMPUTED_GOTO 1
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+namespace dragon {
+namespace vm {
+
+using object::Object;
+
+VM::VM(const compiler::Bytecode &bytecode) : VM(bytecode, ownGlobals_)
+{
+}
+
+VM::VM(const compiler::Bytecode &bytecode, Globals &globals)
+    : constants_(bytecode.constants), symbolTable_(bytecode.symbolTable), stack_(kStackSize),
+      globals_(globals), frames_(kMaxFrames)
+{
+    auto mainFn = std::make_shared<object::CompiledFunction>(bytecode.instructions, 0, 0);
+    frames_[0].cl = std::make_shared<object::Closure>(mainFn, std::vector<std::shared_ptr<object::Cell>>{});
+    frames_[0].basePointer = 0;
+    framesIndex_ = 1;
+
+    true_ = object::TrueObject();
+    false_ = object::FalseObject();
+    null_ = object::NullObject();
+}
+
+std::shared_ptr<object::Error> VM::newError(const char *format, ...)
+{
+    char buffer[1024] = {0};
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return std::make_shared<object::Error>(buffer);
+}
+
+// 编译时未能解析的名字, 以及尚未赋值的局部变量 (与 Evaluator 一样按名字兜底):
+// 按全局符号表查找已赋值的全局变量和内置函数, 找不到时返回错误.
+// 与 Evaluator 不同, 外层函数中的同名变量不参与查找
+std::shared_ptr<Object> VM::lookup(const std::string &name)
+{
+    compiler::Symbol sym;
+    if (symbolTable_ && symbolTable_->resolve(name, sym)) {
+        if (sym.scope == compiler::SymbolScope::BUILTIN_SCOPE) {
+            return GetBuiltInFunc(sym.index);
+        }
+        if (sym.scope == compiler::SymbolScope::GLOBAL_SCOPE && static_cast<size_t>(sym.index) < globals_.size() &&
+            globals_[sym.index]) {
+            return globals_[sym.index];
+        }
+    }
+    return newError("identifier not found: %s", name.c_str());
+}
+
+static inline bool isInteger(const std::shared_ptr<Object> &o)
+{
+    return o->Type() == Object::ObjectType::INTEGER_OBJ;
+}
+
+static inline int64_t intValue(const std::shared_ptr<Object> &o)
+{
+    return static_cast<object::Integer *>(o.get())->Value;
+}
+
+static inline bool isError(const std::shared_ptr<Object> &o)
+{
+    return o && o->Type() == Object::ObjectType::ERROR_OBJ;
+}
+
+// 与 Evaluator::isTruthy 一致: 只有 null 和 false 为假
+static inline bool isTruthy(const std::shared_ptr<Object> &o)
+{
+    switch (o->Type()) {
+    case Object::ObjectType::NULL_OBJ:
+        return false;
+    case Object::ObjectType::BOOLEAN_OBJ:
+        return static_cast<object::Boolean *>(o.get())->Value;
+    default:
+        return true;
+    }
+}
+
+std::shared_ptr<Object> VM::run()
+{
+    Frame *frame = &frames_[framesIndex_ - 1];
+    const uint8_t *ins = frame->cl->fn_->instructions_.data();
+    const uint8_t *ip = ins;
+    std::shared_ptr<Object> *stack = stack_.data();
+    size_t sp = sp_;
+
+#define PUSH(o)                                                         \
+    do {                                                                \
+        if (sp >= kStackSize) return newError("stack overflow");        \
+        stack[sp++] = (o);                                              \
+    } while (0)
+#define POP() std::move(stack[--sp])
+#define CHECK_ERROR(o)                                                  \
+    do {                                                                \
+        if (isError(o)) return (o);                                     \
+    } while (0)
+    // 槽位尚未赋值: 与 Evaluator 一样按名字兜底查找
+#define PUSH_UNASSIGNED(name)                                           \
+    do {                                                                \
+        auto found = lookup(name);                                      \
+        CHECK_ERROR(found);                                             \
+        PUSH(std::move(found));                                         \
+    } while (0)
+
+    // 非整数操作数复用 Evaluator 的实现, 保证两套执行引擎的语义一致
+#define BINARY_OP(op, intExpr)                                          \
+    {                                                                   \
+        auto right = POP();                                             \
+        auto left = POP();                                              \
+        if (isInteger(left) && isInteger(right)) {                      \
+            int64_t l = intValue(left);                                 \
+            int64_t r = intValue(right);                                \
+            PUSH(intExpr);                                              \
+        } else {                                                        \
+            auto result = evaluator::Evaluator::evalInfixExpression(op, left, right).ToObject(); \
+            CHECK_ERROR(result);                                        \
+            PUSH(result ? result : null_);                              \
+        }                                                               \
+        DISPATCH();                                                     \
+    }
+
+#ifdef DRAGON_COMPUTED_GOTO
+    static void *dispatchTable[] = {
+            &&L_OpConstant, &&L_OpAdd, &&L_OpSub, &&L_OpMul, &&L_OpDiv, &&L_OpPop,
+            &&L_OpTrue, &&L_OpFalse, &&L_OpEqual, &&L_OpNotEqual, &&L_OpGreaterThan,
+            &&L_OpLessThan, &&L_OpMinus, &&L_OpBang, &&L_OpJumpNotTruthy, &&L_OpJump,
+            &&L_OpNull, &&L_OpGetGlobal, &&L_OpSetGlobal, &&L_OpArray, &&L_OpHash,
+            &&L_OpIndex, &&L_OpCall, &&L_OpReturnValue, &&L_OpReturn, &&L_OpGetLocal,
+            &&L_OpSetLocal, &&L_OpGetBuiltin, &&L_OpClosure, &&L_OpGetFree,
+            &&L_OpGetFreeCell, &&L_OpMakeCell, &&L_OpGetCell, &&L_OpSetCell,
+            &&L_OpGetName, &&L_OpTailCall,
+    };
+    static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == code::OpCount,
+                  "dispatch table out of sync with opcodes");
+#define DISPATCH() goto *dispatchTable[*ip++]
+#define CASE(op) L_##op:
+    DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(op) case code::op:
+    for (;;) {
+    switch (*ip++) {
+#endif
+
+    CASE(OpConstant) {
+        uint16_t idx = code::ReadUint16(ip);
+        ip += 2;
+        PUSH(constants_[idx]);
+        DISPATCH();
+    }
+
+    CASE(OpAdd) BINARY_OP(ast::Operator::PLUS, object::NewInteger(evaluator::Evaluator::wrappingAdd(l, r)))
+    CASE(OpSub) BINARY_OP(ast::Operator::MINUS, object::NewInteger(evaluator::Evaluator::wrappingSub(l, r)))
+    CASE(OpMul) BINARY_OP(ast::Operator::ASTERISK, object::NewInteger(evaluator::Evaluator::wrappingMul(l, r)))
+    CASE(OpDiv) {
+        // 除数为 0 与 INT64_MIN / -1 的处理只在 Evaluator 的整数运算表中实现
+        auto right = POP();
+        auto left = POP();
+        auto result = evaluator::Evaluator::evalInfixExpression(ast::Operator::SLASH, left, right).ToObject();
+        CHECK_ERROR(result);
+        PUSH(result);
+        DISPATCH();
+    }
+    CASE(OpEqual) BINARY_OP(ast::Operator::EQ, l == r ? true_ : false_)
+    CASE(OpNotEqual) BINARY_OP(ast::Operator::NOT_EQ, l != r ? true_ : false_)
+    CASE(OpGreaterThan) BINARY_OP(ast::Operator::GT, l > r ? true_ : false_)
+    CASE(OpLessThan) BINARY_OP(ast::Operator::LT, l < r ? true_ : false_)
+
+    CASE(OpPop) {
+        stack[--sp].reset();
+        DISPATCH();
+    }
+
+    CASE(OpTrue) {
+        PUSH(true_);
+        DISPATCH();
+    }
+
+    CASE(OpFalse) {
+        PUSH(false_);
+        DISPATCH();
+    }
+
+    CASE(OpNull) {
+        PUSH(null_);
+        DISPATCH();
+    }
+
+    CASE(OpMinus) {
+        auto right = POP();
+        if (isInteger(right)) {
+            PUSH(object::NewInteger(evaluator::Evaluator::wrappingNeg(intValue(right))));
+        } else {
+            auto result = evaluator::Evaluator::evalPrefixExpression(ast::Operator::MINUS, right).ToObject();
+            CHECK_ERROR(result);
+            PUSH(result);
+        }
+        DISPATCH();
+    }
+
+    CASE(OpBang) {
+        auto right = POP();
+        PUSH(isTruthy(right) ? false_ : true_);
+        DISPATCH();
+    }
+
+    CASE(OpJumpNotTruthy) {
+        uint16_t target = code::ReadUint16(ip);
+        ip += 2;
+        auto condition = POP();
+        if (!isTruthy(condition)) {
+            ip = ins + target;
+        }
+        DISPATCH();
+    }
+
+    CASE(OpJump) {
+        ip = ins + code::ReadUint16(ip);
+        DISPATCH();
+    }
+
+    CASE(OpGetGlobal) {
+        uint16_t idx = code::ReadUint16(ip);
+        ip += 2;
+        PUSH(idx < globals_.size() && globals_[idx] ? globals_[idx] : null_);
+        DISPATCH();
+    }
+
+    CASE(OpSetGlobal) {
+        uint16_t idx = code::ReadUint16(ip);
+        ip += 2;
+        if (idx >= globals_.size()) {
+            globals_.resize(idx + 1);
+        }
+        globals_[idx] = POP();
+        DISPATCH();
+    }
+
+    CASE(OpGetLocal) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        const auto &val = stack[frame->basePointer + idx];
+        if (val) {
+            PUSH(val);
+        } else {
+            PUSH_UNASSIGNED(frame->cl->fn_->localNames_[idx]);
+        }
+        DISPATCH();
+    }
+
+    CASE(OpSetLocal) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        stack[frame->basePointer + idx] = POP();
+        DISPATCH();
+    }
+
+    CASE(OpGetBuiltin) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        PUSH(GetBuiltInFunc(idx));
+        DISPATCH();
+    }
+
+    CASE(OpGetFree) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        const auto &val = frame->cl->free_[idx]->value_;
+        if (val) {
+            PUSH(val);
+        } else {
+            PUSH_UNASSIGNED(frame->cl->fn_->freeNames_[idx]);
+        }
+        DISPATCH();
+    }
+
+    CASE(OpGetFreeCell) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        PUSH(frame->cl->free_[idx]);
+        DISPATCH();
+    }
+
+    CASE(OpMakeCell) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        auto cell = std::make_shared<object::Cell>();
+        auto &slot = stack[frame->basePointer + idx];
+        cell->value_ = std::move(slot);
+        gc::Heap::Instance().track(cell);
+        slot = std::move(cell);
+        DISPATCH();
+    }
+
+    CASE(OpGetCell) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        const auto &val = static_cast<object::Cell *>(stack[frame->basePointer + idx].get())->value_;
+        if (val) {
+            PUSH(val);
+        } else {
+            PUSH_UNASSIGNED(frame->cl->fn_->localNames_[idx]);
+        }
+        DISPATCH();
+    }
+
+    CASE(OpSetCell) {
+        uint8_t idx = code::ReadUint8(ip);
+        ip += 1;
+        static_cast<object::Cell *>(stack[frame->basePointer + idx].get())->value_ = POP();
+        DISPATCH();
+    }
+
+    CASE(OpGetName) {
+        uint16_t idx = code::ReadUint16(ip);
+        ip += 2;
+        auto val = lookup(static_cast<object::String *>(constants_[idx].get())->str());
+        CHECK_ERROR(val);
+        PUSH(std::move(val));
+        DISPATCH();
+    }
+
+    CASE(OpArray) {
+        uint16_t n = code::ReadUint16(ip);
+        ip += 2;
+        std::vector<object::Value> elements;
+        elements.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            elements.emplace_back(std::move(stack[sp - n + i]));
+        }
+        sp -= n;
+        PUSH(evaluator::Evaluator::makeArray(std::move(elements)).AsObject());
+        DISPATCH();
+    }
+
+    CASE(OpHash) {
+        uint16_t n = code::ReadUint16(ip);
+        ip += 2;
+        object::HashTable pairs;
+        pairs.reserve(n / 2);
+        for (size_t i = sp - n; i < sp; i += 2) {
+            object::Value key(stack[i]);
+            uint64_t hash = 0;
+            if (!object::HashCodeOf(key, hash)) {
+                return newError("unusable as hash key: %s", object::GetTypeString(key.Type()).c_str());
+            }
+            pairs.set(hash, std::move(key), object::Value(stack[i + 1]));
+        }
+        for (size_t i = sp - n; i < sp; ++i) {
+            stack[i].reset();
+        }
+        sp -= n;
+        PUSH(evaluator::Evaluator::makeHash(std::move(pairs)).AsObject());
+        DISPATCH();
+    }
+
+    CASE(OpIndex) {
+        auto index = POP();
+        auto left = POP();
+        auto result = evaluator::Evaluator::evalIndexExpression(left, index).ToObject();
+        CHECK_ERROR(result);
+        PUSH(result ? result : null_);
+        DISPATCH();
+    }
+
+    CASE(OpCall)
+    callFunction: {
+        uint8_t numArgs = code::ReadUint8(ip);
+        ip += 1;
+        auto &callee = stack[sp - 1 - numArgs];
+        if (callee->Type() == Object::ObjectType::CLOSURE_OBJ) {
+            auto cl = std::static_pointer_cast<object::Closure>(callee);
+            if (numArgs != cl->fn_->numParameters_) {
+                return newError("wrong number of arguments: want=%d, got=%d",
+                                cl->fn_->numParameters_, static_cast<int>(numArgs));
+            }
+            if (framesIndex_ >= kMaxFrames || sp + cl->fn_->numLocals_ >= kStackSize) {
+                return newError("stack overflow");
+            }
+
+            frame->ip = ip;
+            frame = &frames_[framesIndex_++];
+            frame->cl = std::move(cl);
+            frame->basePointer = sp - numArgs;
+            sp = frame->basePointer + frame->cl->fn_->numLocals_;
+            ins = frame->cl->fn_->instructions_.data();
+            ip = ins;
+        } else if (callee->Type() == Object::ObjectType::BUILTIN_OBJ) {
+            auto builtin = std::static_pointer_cast<object::Builtin>(callee);
+            std::vector<object::Value> args(stack + sp - numArgs, stack + sp);
+            auto result = builtin->fn_(args).ToObject();
+            for (size_t i = sp - numArgs - 1; i < sp; ++i) {
+                stack[i].reset();
+            }
+            sp -= numArgs + 1;
+            CHECK_ERROR(result);
+            PUSH(result ? result : null_);
+        } else {
+            return newError("not a function: %s", object::GetTypeString(callee->Type()).c_str());
+        }
+        DISPATCH();
+    }
+
+    // 被调函数是闭包时用它和参数覆盖当前帧, 尾递归的深度不受 kMaxFrames 限制;
+    // 其他情况与 OpCall 相同
+    CASE(OpTailCall) {
+        uint8_t numArgs = code::ReadUint8(ip);
+        if (stack[sp - 1 - numArgs]->Type() != Object::ObjectType::CLOSURE_OBJ) {
+            goto callFunction;
+        }
+        ip += 1;
+        auto cl = std::static_pointer_cast<object::Closure>(stack[sp - 1 - numArgs]);
+        if (numArgs != cl->fn_->numParameters_) {
+            return newError("wrong number of arguments: want=%d, got=%d",
+                            cl->fn_->numParameters_, static_cast<int>(numArgs));
+        }
+        size_t base = frame->basePointer;
+        if (base + cl->fn_->numLocals_ >= kStackSize) {
+            return newError("stack overflow");
+        }
+
+        for (size_t i = 0; i < numArgs; ++i) {
+            stack[base + i] = std::move(stack[sp - numArgs + i]);
+        }
+        for (size_t i = base + numArgs; i < sp; ++i) {
+            stack[i].reset();
+        }
+        stack[base - 1] = cl;
+        sp = base + cl->fn_->numLocals_;
+        frame->cl = std::move(cl);
+        ins = frame->cl->fn_->instructions_.data();
+        ip = ins;
+        DISPATCH();
+    }
+
+    CASE(OpReturnValue) {
+        auto returnValue = POP();
+        if (framesIndex_ == 1) {
+            sp_ = sp;
+            return returnValue;
+        }
+        for (size_t i = frame->basePointer - 1; i < sp; ++i) {
+            stack[i].reset();
+        }
+        sp = frame->basePointer - 1;
+        frame->cl.reset();
+        frame = &frames_[--framesIndex_ - 1];
+        ins = frame->cl->fn_->instructions_.data();
+        ip = frame->ip;
+        stack[sp++] = std::move(returnValue);
+        DISPATCH();
+    }
+
+    CASE(OpReturn) {
+        // 顶层程序没有值 (例如最后一条语句是 let)
+        if (framesIndex_ == 1) {
+            sp_ = sp;
+            return nullptr;
+        }
+        for (size_t i = frame->basePointer - 1; i < sp; ++i) {
+            stack[i].reset();
+        }
+        sp = frame->basePointer - 1;
+        frame->cl.reset();
+        frame = &frames_[--framesIndex_ - 1];
+        ins = frame->cl->fn_->instructions_.data();
+        ip = frame->ip;
+        stack[sp++] = null_;
+        DISPATCH();
+    }
+
+    CASE(OpClosure) {
+        uint16_t idx = code::ReadUint16(ip);
+        uint8_t numFree = code::ReadUint8(ip + 2);
+        ip += 3;
+        auto fn = std::static_pointer_cast<object::CompiledFunction>(constants_[idx]);
+        std::vector<std::shared_ptr<object::Cell>> free(numFree);
+        for (size_t i = 0; i < numFree; ++i) {
+            free[i] = std::static_pointer_cast<object::Cell>(std::move(stack[sp - numFree + i]));
+        }
+        sp -= numFree;
+        auto cl = std::make_shared<object::Closure>(fn, std::move(free));
+        // 闭包与 Cell 之间可能形成引用环 (如引用自身的局部函数)
+        if (numFree > 0) {
+            gc::Heap::Instance().track(cl);
+        }
+        PUSH(std::move(cl));
+        DISPATCH();
+    }
+
+#ifndef DRAGON_COMPUTED_GOTO
+    default:
+        return newError("unknown opcode: %d", static_cast<int>(*(ip - 1)));
+    }
+    }
+#endif
+
+#undef PUSH
+#undef POP
+#undef CHECK_ERROR
+#undef PUSH_UNASSIGNED
+#undef BINARY_OP
+#undef DISPATCH
+#undef CASE
+}
+
+} // namespace vm
+} // namespace dragon
@@ -0,0 +1,64 @@
+//
+// 基于栈的虚拟机, 执行 compiler::Compiler 生成的字节码
+//
+
+#ifndef DRAGON_VM_H
+#define DRAGON_VM_H
+
+#include "compiler.h"
+#include "compiled_function.h"
+#include "object.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dragon {
+namespace vm {
+
+const size_t kStackSize = 1 << 16;
+const size_t kMaxFrames = 1 << 14;
+
+struct Frame {
+    std::shared_ptr<object::Closure> cl;
+    const uint8_t *ip = nullptr;   // 调用其他函数时保存的返回地址
+    size_t basePointer = 0;
+};
+
+using Globals = std::vector<std::shared_ptr<object::Object>>;
+
+class VM {
+public:
+    explicit VM(const compiler::Bytecode &bytecode);
+    // REPL 中多次执行需要共享全局变量
+    VM(const compiler::Bytecode &bytecode, Globals &globals);
+
+    // 执行字节码, 返回程序的结果; 运行时错误以 object::Error 返回
+    std::shared_ptr<object::Object> run();
+
+private:
+    std::shared_ptr<object::Error> newError(const char *format, ...);
+    std::shared_ptr<object::Object> lookup(const std::string &name);
+
+private:
+    std::vector<std::shared_ptr<object::Object>> constants_;
+    std::shared_ptr<compiler::SymbolTable> symbolTable_;
+
+    std::vector<std::shared_ptr<object::Object>> stack_;
+    size_t sp_ = 0;     // 指向栈顶的下一个空位
+
+    Globals ownGlobals_;
+    Globals &globals_;
+
+    std::vector<Frame> frames_;
+    size_t framesIndex_ = 0;
+
+    std::shared_ptr<object::Object> true_;
+    std::shared_ptr<object::Object> false_;
+    std::shared_ptr<object::Object> null_;
+};
+
+} // namespace vm
+} // namespace dragon
+
+#endif //DRAGON_VM_H
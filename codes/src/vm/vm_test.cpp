@@ -0,0 +1,156 @@
+#include "vm_test.h"
+#include "vm.h"
+#include "compiler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "evaluator_test.h"
+#include "test_tool.h"
+
+#include <string>
+#include <vector>
+
+using namespace dragon;
+
+std::shared_ptr<object::Object> vmEval(const std::string &input)
+{
+    lexer::Lexer lexer(input);
+    parser::Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    compiler::Compiler c;
+    auto err = c.compile(program);
+    if (err) {
+        return err;
+    }
+    vm::VM machine(c.bytecode());
+    return machine.run();
+}
+
+static void expectInspect(const std::string &input, const std::string &expected)
+{
+    auto result = vmEval(input);
+    ASSERT_TRUE(result != nullptr);
+    if (result) {
+        ASSERT_EQ(result->Inspect(), expected);
+    }
+}
+
+void TestVMRecursiveFunctions()
+{
+    expectInspect(R"(
+        let fib = fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };
+        fib(15);)", "610");
+
+    // 局部作用域中的递归闭包
+    expectInspect(R"(
+        let wrapper = fn() {
+            let countDown = fn(x) { if (x == 0) { return 0; } countDown(x - 1); };
+            countDown(100);
+        };
+        wrapper();)", "0");
+}
+
+void TestVMClosures()
+{
+    expectInspect(R"(
+        let newAdderOuter = fn(a, b) {
+            let c = a + b;
+            fn(d) {
+                let e = d + c;
+                fn(f) { e + f; };
+            };
+        };
+        let newAdderInner = newAdderOuter(1, 2);
+        let adder = newAdderInner(3);
+        adder(8);)", "14");
+}
+
+void TestVMArraysAndHashes()
+{
+    expectInspect("[1, 2 * 2, 3 + 3]", "[1, 4, 6]");
+    expectInspect("[1, 2, 3][1]", "2");
+    expectInspect("[1, 2, 3][3]", "null");
+    expectInspect("[1, 2, 3][-1]", "null");
+    expectInspect(R"({"one": 1, "two": 2}["two"])", "2");
+    expectInspect(R"({1: 1}[0])", "null");
+    expectInspect(R"(len([1, 2, 3]))", "3");
+    expectInspect(R"(len("four"))", "4");
+}
+
+void TestVMErrors()
+{
+    expectInspect("fn() { 1; }(1);", "ERROR: wrong number of arguments: want=0, got=1");
+    expectInspect("1(1);", "ERROR: not a function: INTEGER");
+    expectInspect("let f = fn(x) { 1 + f(x + 1) }; f(0);", "ERROR: stack overflow");
+    expectInspect("1 / 0", "ERROR: division by zero");
+}
+
+// 编译时未定义的名字到执行时才查找, 与 Evaluator 一致
+void TestVMUnboundNames()
+{
+    expectInspect("let c = false; let r = if (c) { x } else { 1 }; r", "1");
+    expectInspect("let f = fn() { g() }; let g = fn() { 2 }; f()", "2");
+    expectInspect("let f = fn() { y }; f()", "ERROR: identifier not found: y");
+    expectInspect("let f = fn() { z }; f(); let z = 1;", "ERROR: identifier not found: z");
+}
+
+// 值被使用的 if 中的 return 只结束这个 if, 与 Evaluator 一致
+void TestVMReturnInIf()
+{
+    expectInspect("let f = fn() { let a = if (true) { return 5; }; 10 }; f()", "10");
+    expectInspect("let f = fn() { let a = if (true) { if (true) { return 5; }; 7 }; a }; f()", "5");
+    expectInspect("let f = fn() { 1 + if (true) { return 5; } }; f()", "6");
+    expectInspect("let f = fn() { [if (true) { return 5; }, 2] }; f()", "[5, 2]");
+    expectInspect("let f = fn() { if (true) { return 5; }; 10 }; f()", "5");
+    expectInspect("let a = if (true) { return 5; }; a + 1", "6");
+}
+
+// 尾调用复用帧, 深度超过 kMaxFrames 的尾递归也能执行; TestEvalSemantics 中另有尾调用用例
+void TestVMTailCalls()
+{
+    expectInspect("let g = fn(n, acc) { if (n == 0) { acc } else { g(n - 1, acc + n) } }; g(100000, 0)",
+                  "5000050000");
+    // 尾位置上调用内置函数和非函数照常处理
+    expectInspect("let f = fn(a) { len(a) }; f([1, 2])", "2");
+    expectInspect("let f = fn() { 1(2) }; f()", "ERROR: not a function: INTEGER");
+}
+
+void TestVMGlobalsAcrossRuns()
+{
+    // REPL 模式: 多次编译执行共享符号表, 常量池和全局变量
+    auto symbolTable = compiler::Compiler::newSymbolTable();
+    std::vector<std::shared_ptr<object::Object>> constants;
+    vm::Globals globals;
+
+    std::vector<std::pair<std::string, std::string>> lines = {
+            {"let a = 5;", ""},
+            {"let add = fn(x) { x + a };", ""},
+            {"add(10)", "15"},
+    };
+    for (const auto &l : lines) {
+        lexer::Lexer lexer(l.first);
+        parser::Parser parser(lexer);
+        auto program = parser.parseProgram();
+        compiler::Compiler c(symbolTable, constants);
+        ASSERT_TRUE(c.compile(program) == nullptr);
+        constants = c.constants_;
+        vm::VM machine(c.bytecode(), globals);
+        auto result = machine.run();
+        ASSERT_EQ(result ? result->Inspect() : "", l.second);
+    }
+}
+
+void TestVM()
+{
+    // 与 Evaluator 共用的语义用例
+    TestEvalSemantics(vmEval);
+
+    TestVMRecursiveFunctions();
+    TestVMClosures();
+    TestVMArraysAndHashes();
+    TestVMErrors();
+    TestVMUnboundNames();
+    TestVMReturnInIf();
+    TestVMTailCalls();
+    TestVMGlobalsAcrossRuns();
+}
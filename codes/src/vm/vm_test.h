@@ -0,0 +1,6 @@
+#ifndef DRAGON_VM_TEST_H
+#define DRAGON_VM_TEST_H
+
+void TestVM();
+
+#endif //DRAGON_VM_TEST_H